@@ -0,0 +1,115 @@
+#ifndef CAFFE_BENCHMARKS_BENCHMARK_HPP_
+#define CAFFE_BENCHMARKS_BENCHMARK_HPP_
+
+#include <gflags/gflags.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+DECLARE_int32(batch_size);
+
+namespace caffe {
+
+/**
+ * @brief A single timed operation, e.g. one GEMM shape or one layer's
+ *        forward pass.
+ *
+ * The runner calls SetUp once, then Run repeatedly while timing each call,
+ * then TearDown. Inputs are allocated in SetUp rather than in the
+ * constructor so only the selected benchmarks hold memory, one at a time.
+ */
+class Benchmark {
+ public:
+  explicit Benchmark(const string& name) : name_(name) {}
+  virtual ~Benchmark() {}
+
+  virtual void SetUp() {}
+  virtual void Run() = 0;
+  virtual void TearDown() {}
+
+  // Work done by one Run, used to report GFLOP/s and GB/s; 0 if unknown.
+  // Only valid after SetUp.
+  virtual double flops() const { return 0; }
+  virtual double bytes() const { return 0; }
+
+  inline const string& name() const { return name_; }
+
+ private:
+  const string name_;
+
+  DISABLE_COPY_AND_ASSIGN(Benchmark);
+};
+
+class BenchmarkRegistry {
+ public:
+  static vector<shared_ptr<Benchmark> >& Registry() {
+    static vector<shared_ptr<Benchmark> >* g_registry_ =
+        new vector<shared_ptr<Benchmark> >();
+    return *g_registry_;
+  }
+
+  // Takes ownership of the benchmark.
+  static void Add(Benchmark* benchmark) {
+    Registry().push_back(shared_ptr<Benchmark>(benchmark));
+  }
+
+ private:
+  // Benchmark registry should never be instantiated - everything is done with
+  // its static variables.
+  BenchmarkRegistry() {}
+};
+
+class BenchmarkRegisterer {
+ public:
+  explicit BenchmarkRegisterer(void (*add_benchmarks)()) {
+    add_benchmarks();
+  }
+};
+
+// Runs add_benchmarks at static initialization time; it should call
+// BenchmarkRegistry::Add for each benchmark of a group.
+#define REGISTER_BENCHMARKS(add_benchmarks)                                   \
+  static BenchmarkRegisterer g_benchmark_registerer_##add_benchmarks(         \
+      &add_benchmarks)
+
+/**
+ * @brief The geometry of a convolution layer of a well-known net, used as
+ *        a realistic shape for GEMM, im2col and layer benchmarks.
+ */
+struct ConvShape {
+  const char* name;
+  int channels;
+  int height;
+  int width;
+  int num_output;
+  int kernel;
+  int stride;
+  int pad;
+
+  inline int output_height() const {
+    return (height + 2 * pad - kernel) / stride + 1;
+  }
+  inline int output_width() const {
+    return (width + 2 * pad - kernel) / stride + 1;
+  }
+};
+
+// Convolutions of AlexNet, VGG-16 and ResNet-50, with groups ignored.
+const vector<ConvShape>& ConvShapes();
+
+/**
+ * @brief The geometry of a fully connected layer of a well-known net.
+ */
+struct InnerProductShape {
+  const char* name;
+  int num_input;
+  int num_output;
+};
+
+const vector<InnerProductShape>& InnerProductShapes();
+
+}  // namespace caffe
+
+#endif  // CAFFE_BENCHMARKS_BENCHMARK_HPP_
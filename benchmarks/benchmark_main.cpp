@@ -0,0 +1,197 @@
+// Runs the registered microbenchmarks and reports the time per call of each,
+// optionally as JSON for scripts/compare_benchmarks.py.
+// Usage:
+//    caffe_benchmarks [--filter=gemm,im2col] [--json=results.json] ...
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>  // NOLINT(readability/streams)
+#include <iomanip>
+#include <iostream>  // NOLINT(readability/streams)
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "boost/algorithm/string.hpp"
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+#include "benchmark.hpp"
+#include "caffe/util/benchmark.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+using std::string;
+using std::vector;
+
+DEFINE_string(filter, "",
+    "Optional; comma-separated substrings, run only the benchmarks whose "
+    "name contains one of them.");
+DEFINE_bool(list, false, "List the benchmark names and exit.");
+DEFINE_double(min_time, 0.5,
+    "Minimum number of seconds to time each benchmark for.");
+DEFINE_int32(min_samples, 5, "Minimum number of timed samples per benchmark.");
+DEFINE_string(json, "", "Optional; write the results as JSON to this file.");
+DEFINE_string(label, "",
+    "Optional; free text stored with the JSON results, e.g. a commit id.");
+DEFINE_int32(batch_size, 4, "Batch size of the layer benchmarks.");
+
+// Each sample times enough calls to last at least this long, so short
+// operations are not dominated by the timer resolution.
+static const double kMinSampleMicroSeconds = 1000;
+
+struct Result {
+  string name;
+  int calls;
+  double mean_us;
+  double median_us;
+  double min_us;
+  double stddev_us;
+  double gflops;
+  double gbps;
+};
+
+bool Selected(const string& name, const vector<string>& filters) {
+  if (filters.empty()) {
+    return true;
+  }
+  for (int i = 0; i < filters.size(); ++i) {
+    if (name.find(filters[i]) != string::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Times calls_per_sample back-to-back calls and returns the time per call.
+double TimeSample(Benchmark* benchmark, int calls_per_sample) {
+  CPUTimer timer;
+  timer.Start();
+  for (int i = 0; i < calls_per_sample; ++i) {
+    benchmark->Run();
+  }
+  timer.Stop();
+  return timer.MicroSeconds() / calls_per_sample;
+}
+
+Result RunBenchmark(Benchmark* benchmark) {
+  benchmark->SetUp();
+  // Warm up caches and lazy allocations, and find how many calls make a
+  // sample long enough to time.
+  int calls_per_sample = 1;
+  while (TimeSample(benchmark, calls_per_sample) * calls_per_sample <
+      kMinSampleMicroSeconds && calls_per_sample < (1 << 24)) {
+    calls_per_sample *= 2;
+  }
+  vector<double> samples;
+  double total_us = 0;
+  while (samples.size() < FLAGS_min_samples ||
+      total_us < FLAGS_min_time * 1e6) {
+    samples.push_back(TimeSample(benchmark, calls_per_sample));
+    total_us += samples.back() * calls_per_sample;
+  }
+
+  Result result;
+  result.name = benchmark->name();
+  result.calls = samples.size() * calls_per_sample;
+  double sum = 0;
+  for (int i = 0; i < samples.size(); ++i) {
+    sum += samples[i];
+  }
+  result.mean_us = sum / samples.size();
+  double squares = 0;
+  for (int i = 0; i < samples.size(); ++i) {
+    squares += (samples[i] - result.mean_us) * (samples[i] - result.mean_us);
+  }
+  result.stddev_us = std::sqrt(squares / samples.size());
+  std::sort(samples.begin(), samples.end());
+  result.median_us = samples[samples.size() / 2];
+  result.min_us = samples[0];
+  // FLOP (bytes) per microsecond are MFLOP/s (MB/s).
+  result.gflops = benchmark->flops() / result.median_us / 1e3;
+  result.gbps = benchmark->bytes() / result.median_us / 1e3;
+  benchmark->TearDown();
+  return result;
+}
+
+void WriteJson(const vector<Result>& results, const string& filename) {
+  std::ofstream out(filename.c_str());
+  CHECK(out) << "Failed to open " << filename;
+  out << std::setprecision(6);
+  out << "{\n  \"context\": {\n"
+      << "    \"caffe_version\": \"" << AS_STRING(CAFFE_VERSION) << "\",\n"
+      << "    \"date\": \"" << boost::posix_time::to_iso_extended_string(
+          boost::posix_time::second_clock::universal_time()) << "\",\n"
+      << "    \"label\": \"" << FLAGS_label << "\",\n"
+      << "    \"batch_size\": " << FLAGS_batch_size << ",\n"
+      << "    \"min_time\": " << FLAGS_min_time << "\n"
+      << "  },\n  \"benchmarks\": [";
+  for (int i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    out << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\", "
+        << "\"calls\": " << r.calls << ", "
+        << "\"mean_us\": " << r.mean_us << ", "
+        << "\"median_us\": " << r.median_us << ", "
+        << "\"min_us\": " << r.min_us << ", "
+        << "\"stddev_us\": " << r.stddev_us << ", "
+        << "\"gflops\": " << r.gflops << ", "
+        << "\"gbps\": " << r.gbps << "}";
+  }
+  out << "\n  ]\n}\n";
+  CHECK(out) << "Failed to write " << filename;
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Runs Caffe's CPU microbenchmarks.\n"
+      "Usage:\n"
+      "    caffe_benchmarks [--filter=gemm,im2col] [--json=results.json]\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK_GT(FLAGS_batch_size, 0);
+  CHECK_GT(FLAGS_min_samples, 0);
+  Caffe::set_mode(Caffe::CPU);
+
+  vector<string> filters;
+  if (!FLAGS_filter.empty()) {
+    boost::split(filters, FLAGS_filter, boost::is_any_of(","));
+  }
+  const vector<shared_ptr<Benchmark> >& registry =
+      BenchmarkRegistry::Registry();
+  vector<Result> results;
+  for (int i = 0; i < registry.size(); ++i) {
+    Benchmark* benchmark = registry[i].get();
+    if (!Selected(benchmark->name(), filters)) {
+      continue;
+    }
+    if (FLAGS_list) {
+      std::cout << benchmark->name() << std::endl;
+      continue;
+    }
+    results.push_back(RunBenchmark(benchmark));
+    const Result& r = results.back();
+    std::ostringstream line;
+    line << std::left << std::setw(56) << r.name << std::right
+        << std::fixed << std::setprecision(2)
+        << std::setw(14) << r.median_us << " us";
+    if (r.gflops > 0) {
+      line << std::setw(10) << r.gflops << " GFLOP/s";
+    }
+    if (r.gbps > 0) {
+      line << std::setw(10) << r.gbps << " GB/s";
+    }
+    LOG(INFO) << line.str();
+  }
+  if (!FLAGS_json.empty() && !FLAGS_list) {
+    WriteJson(results, FLAGS_json);
+    LOG(INFO) << "Wrote " << results.size() << " results to " << FLAGS_json;
+  }
+  return 0;
+}
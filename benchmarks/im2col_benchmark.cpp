@@ -0,0 +1,69 @@
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "caffe/blob.hpp"
+#include "caffe/util/im2col.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+// Unrolls (im2col) or folds back (col2im) one image of a convolution input.
+class Im2colBenchmark : public Benchmark {
+ public:
+  Im2colBenchmark(const string& name, const ConvShape& shape, bool col2im)
+      : Benchmark(name), shape_(shape), col2im_(col2im) {}
+  virtual void SetUp() {
+    image_.reset(new Blob<float>(1, shape_.channels, shape_.height,
+        shape_.width));
+    col_.reset(new Blob<float>(1, shape_.channels * shape_.kernel *
+        shape_.kernel, shape_.output_height(), shape_.output_width()));
+    caffe_rng_uniform<float>(image_->count(), -1, 1,
+        image_->mutable_cpu_data());
+    caffe_rng_uniform<float>(col_->count(), -1, 1, col_->mutable_cpu_data());
+  }
+  virtual void Run() {
+    const ConvShape& s = shape_;
+    if (col2im_) {
+      col2im_cpu(col_->cpu_data(), s.channels, s.height, s.width, s.kernel,
+          s.kernel, s.pad, s.pad, s.stride, s.stride, 1, 1,
+          image_->mutable_cpu_data());
+    } else {
+      im2col_cpu(image_->cpu_data(), s.channels, s.height, s.width, s.kernel,
+          s.kernel, s.pad, s.pad, s.stride, s.stride, 1, 1,
+          col_->mutable_cpu_data());
+    }
+  }
+  virtual void TearDown() {
+    image_.reset();
+    col_.reset();
+  }
+  // Each column element is read or written once, as is the image.
+  virtual double bytes() const {
+    return sizeof(float) * (static_cast<double>(image_->count()) +
+        col_->count());
+  }
+
+ protected:
+  const ConvShape shape_;
+  const bool col2im_;
+  shared_ptr<Blob<float> > image_, col_;
+};
+
+static void AddIm2colBenchmarks() {
+  const vector<ConvShape>& convs = ConvShapes();
+  for (int i = 0; i < convs.size(); ++i) {
+    // 1x1 stride 1 convolutions skip im2col altogether.
+    if (convs[i].kernel == 1 && convs[i].stride == 1 && convs[i].pad == 0) {
+      continue;
+    }
+    BenchmarkRegistry::Add(new Im2colBenchmark(
+        string("im2col/") + convs[i].name, convs[i], false));
+    BenchmarkRegistry::Add(new Im2colBenchmark(
+        string("col2im/") + convs[i].name, convs[i], true));
+  }
+}
+
+REGISTER_BENCHMARKS(AddIm2colBenchmarks);
+
+}  // namespace caffe
@@ -0,0 +1,146 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+
+#include "benchmark.hpp"
+#include "caffe/blob.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/layer_factory.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+// Runs one layer's Forward_cpu or Backward_cpu on a batch of --batch_size
+// random inputs. Every Caffe layer is created with engine CAFFE so the
+// benchmark measures Caffe's own CPU kernels.
+class LayerBenchmark : public Benchmark {
+ public:
+  // bottom_shape is the shape of one input item, without the batch axis;
+  // flops_per_item is the forward work per item, 0 if not meaningful.
+  LayerBenchmark(const string& name, const string& layer_param,
+      const vector<int>& bottom_shape, double flops_per_item, bool backward)
+      : Benchmark(name), bottom_shape_(bottom_shape),
+        flops_per_item_(flops_per_item), backward_(backward),
+        propagate_down_(1, true) {
+    CHECK(google::protobuf::TextFormat::ParseFromString(layer_param,
+        &layer_param_)) << layer_param;
+    layer_param_.set_name(name);
+    layer_param_.set_phase(TRAIN);
+  }
+
+  virtual void SetUp() {
+    vector<int> shape(bottom_shape_);
+    shape.insert(shape.begin(), FLAGS_batch_size);
+    bottom_.reset(new Blob<float>(shape));
+    top_.reset(new Blob<float>());
+    bottom_vec_.assign(1, bottom_.get());
+    top_vec_.assign(1, top_.get());
+    FillerParameter filler_param;
+    GaussianFiller<float> filler(filler_param);
+    filler.Fill(bottom_.get());
+    layer_ = LayerRegistry<float>::CreateLayer(layer_param_);
+    layer_->SetUp(bottom_vec_, top_vec_);
+    if (backward_) {
+      layer_->Forward(bottom_vec_, top_vec_);
+      caffe_rng_gaussian<float>(top_->count(), 0, 1,
+          top_->mutable_cpu_diff());
+    }
+  }
+  virtual void Run() {
+    if (backward_) {
+      layer_->Backward(top_vec_, propagate_down_, bottom_vec_);
+    } else {
+      layer_->Forward(bottom_vec_, top_vec_);
+    }
+  }
+  virtual void TearDown() {
+    layer_.reset();
+    bottom_.reset();
+    top_.reset();
+    bottom_vec_.clear();
+    top_vec_.clear();
+  }
+  // The backward pass of a weighted layer computes both the data and the
+  // parameter gradients, each about as much work as the forward pass.
+  virtual double flops() const {
+    return (backward_ ? 2 : 1) * flops_per_item_ * FLAGS_batch_size;
+  }
+
+ protected:
+  LayerParameter layer_param_;
+  const vector<int> bottom_shape_;
+  const double flops_per_item_;
+  const bool backward_;
+  const vector<bool> propagate_down_;
+  shared_ptr<Layer<float> > layer_;
+  shared_ptr<Blob<float> > bottom_, top_;
+  vector<Blob<float>*> bottom_vec_, top_vec_;
+};
+
+static vector<int> ItemShape(int channels, int height, int width) {
+  vector<int> shape(1, channels);
+  shape.push_back(height);
+  shape.push_back(width);
+  return shape;
+}
+
+// Registers the forward and backward benchmarks of a layer.
+static void AddLayer(const string& name, const string& layer_param,
+    const vector<int>& bottom_shape, double flops_per_item) {
+  BenchmarkRegistry::Add(new LayerBenchmark(name + "/forward", layer_param,
+      bottom_shape, flops_per_item, false));
+  BenchmarkRegistry::Add(new LayerBenchmark(name + "/backward", layer_param,
+      bottom_shape, flops_per_item, true));
+}
+
+static void AddLayerBenchmarks() {
+  const vector<ConvShape>& convs = ConvShapes();
+  for (int i = 0; i < convs.size(); ++i) {
+    const ConvShape& s = convs[i];
+    std::ostringstream param;
+    param << "type: 'Convolution' convolution_param { "
+        << "num_output: " << s.num_output << " kernel_size: " << s.kernel
+        << " stride: " << s.stride << " pad: " << s.pad << " engine: CAFFE "
+        << "weight_filler { type: 'gaussian' std: 0.01 } }";
+    AddLayer(string("conv/") + s.name, param.str(),
+        ItemShape(s.channels, s.height, s.width),
+        2. * s.num_output * s.channels * s.kernel * s.kernel *
+        s.output_height() * s.output_width());
+  }
+  const vector<InnerProductShape>& ips = InnerProductShapes();
+  for (int i = 0; i < ips.size(); ++i) {
+    std::ostringstream param;
+    param << "type: 'InnerProduct' inner_product_param { "
+        << "num_output: " << ips[i].num_output
+        << " weight_filler { type: 'gaussian' std: 0.01 } }";
+    AddLayer(string("ip/") + ips[i].name, param.str(),
+        vector<int>(1, ips[i].num_input),
+        2. * ips[i].num_input * ips[i].num_output);
+  }
+  AddLayer("pool/alexnet/pool1", "type: 'Pooling' pooling_param { "
+      "pool: MAX kernel_size: 3 stride: 2 engine: CAFFE }",
+      ItemShape(96, 55, 55), 0);
+  AddLayer("pool/vgg16/pool1", "type: 'Pooling' pooling_param { "
+      "pool: MAX kernel_size: 2 stride: 2 engine: CAFFE }",
+      ItemShape(64, 224, 224), 0);
+  AddLayer("pool/resnet50/pool5", "type: 'Pooling' pooling_param { "
+      "pool: AVE kernel_size: 7 stride: 1 engine: CAFFE }",
+      ItemShape(2048, 7, 7), 0);
+  AddLayer("relu/alexnet/relu1", "type: 'ReLU' relu_param { engine: CAFFE }",
+      ItemShape(96, 55, 55), 0);
+  AddLayer("relu/vgg16/relu1_1", "type: 'ReLU' relu_param { engine: CAFFE }",
+      ItemShape(64, 224, 224), 0);
+  AddLayer("lrn/alexnet/norm1", "type: 'LRN' lrn_param { local_size: 5 "
+      "alpha: 0.0001 beta: 0.75 engine: CAFFE }", ItemShape(96, 55, 55), 0);
+  AddLayer("batchnorm/resnet50/bn2a_2a", "type: 'BatchNorm'",
+      ItemShape(64, 56, 56), 0);
+  AddLayer("softmax/imagenet", "type: 'Softmax' softmax_param { "
+      "engine: CAFFE }", vector<int>(1, 1000), 0);
+}
+
+REGISTER_BENCHMARKS(AddLayerBenchmarks);
+
+}  // namespace caffe
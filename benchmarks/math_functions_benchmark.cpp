@@ -0,0 +1,134 @@
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "caffe/blob.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+// Returns a blob of count random values.
+static shared_ptr<Blob<float> > UniformBlob(int count) {
+  shared_ptr<Blob<float> > blob(new Blob<float>(vector<int>(1, count)));
+  caffe_rng_uniform<float>(count, -1, 1, blob->mutable_cpu_data());
+  return blob;
+}
+
+// C = A * B with A M x K and B K x N, as in the forward pass of a
+// convolution (one image) or of an inner product layer (one batch).
+class GemmBenchmark : public Benchmark {
+ public:
+  GemmBenchmark(const string& name, int M, int N, int K)
+      : Benchmark(name), M_(M), N_(N), K_(K) {}
+  virtual void SetUp() {
+    a_ = UniformBlob(M_ * K_);
+    b_ = UniformBlob(K_ * N_);
+    c_ = UniformBlob(M_ * N_);
+  }
+  virtual void Run() {
+    caffe_cpu_gemm<float>(CblasNoTrans, CblasNoTrans, M_, N_, K_, 1.,
+        a_->cpu_data(), b_->cpu_data(), 0., c_->mutable_cpu_data());
+  }
+  virtual void TearDown() {
+    a_.reset();
+    b_.reset();
+    c_.reset();
+  }
+  virtual double flops() const { return 2. * M_ * N_ * K_; }
+
+ protected:
+  const int M_, N_, K_;
+  shared_ptr<Blob<float> > a_, b_, c_;
+};
+
+// A level 1 BLAS-like routine over vectors of count floats.
+class VectorBenchmark : public Benchmark {
+ public:
+  enum Op { AXPY, DOT, ASUM, SCAL, EXP };
+
+  VectorBenchmark(const string& name, Op op, int count)
+      : Benchmark(name), op_(op), count_(count), scale_(2), sink_(0) {}
+  virtual void SetUp() {
+    x_ = UniformBlob(count_);
+    y_ = UniformBlob(count_);
+  }
+  virtual void Run() {
+    switch (op_) {
+    case AXPY:
+      caffe_axpy<float>(count_, 0.5, x_->cpu_data(), y_->mutable_cpu_data());
+      break;
+    case DOT:
+      sink_ += caffe_cpu_dot<float>(count_, x_->cpu_data(), y_->cpu_data());
+      break;
+    case ASUM:
+      sink_ += caffe_cpu_asum<float>(count_, x_->cpu_data());
+      break;
+    case SCAL:
+      // Alternate the factor so the values stay bounded.
+      caffe_scal<float>(count_, scale_, y_->mutable_cpu_data());
+      scale_ = 1. / scale_;
+      break;
+    case EXP:
+      caffe_exp<float>(count_, x_->cpu_data(), y_->mutable_cpu_data());
+      break;
+    }
+  }
+  virtual void TearDown() {
+    x_.reset();
+    y_.reset();
+  }
+  virtual double flops() const {
+    return op_ == AXPY || op_ == DOT ? 2. * count_ : count_;
+  }
+  virtual double bytes() const {
+    const int inputs = op_ == AXPY || op_ == DOT ? 2 : 1;
+    const int outputs = op_ == AXPY || op_ == SCAL || op_ == EXP ? 1 : 0;
+    return (inputs + outputs) * sizeof(float) * static_cast<double>(count_);
+  }
+
+ protected:
+  const Op op_;
+  const int count_;
+  shared_ptr<Blob<float> > x_, y_;
+  float scale_;
+  // Keeps the reductions from being optimized away.
+  float sink_;
+};
+
+static void AddMathFunctionsBenchmarks() {
+  const vector<ConvShape>& convs = ConvShapes();
+  for (int i = 0; i < convs.size(); ++i) {
+    const ConvShape& s = convs[i];
+    BenchmarkRegistry::Add(new GemmBenchmark(
+        string("gemm/") + s.name, s.num_output,
+        s.output_height() * s.output_width(),
+        s.channels * s.kernel * s.kernel));
+  }
+  // Inner products over a batch of 32, independent of --batch_size so the
+  // GEMM shapes stay comparable between runs.
+  const vector<InnerProductShape>& ips = InnerProductShapes();
+  for (int i = 0; i < ips.size(); ++i) {
+    BenchmarkRegistry::Add(new GemmBenchmark(
+        string("gemm/") + ips[i].name, 32, ips[i].num_output,
+        ips[i].num_input));
+  }
+  const int kCounts[] = { 1 << 10, 1 << 16, 1 << 22 };
+  const char* kCountNames[] = { "1K", "64K", "4M" };
+  for (int i = 0; i < 3; ++i) {
+    const string suffix = string("/") + kCountNames[i];
+    BenchmarkRegistry::Add(new VectorBenchmark("axpy" + suffix,
+        VectorBenchmark::AXPY, kCounts[i]));
+    BenchmarkRegistry::Add(new VectorBenchmark("dot" + suffix,
+        VectorBenchmark::DOT, kCounts[i]));
+    BenchmarkRegistry::Add(new VectorBenchmark("asum" + suffix,
+        VectorBenchmark::ASUM, kCounts[i]));
+    BenchmarkRegistry::Add(new VectorBenchmark("scal" + suffix,
+        VectorBenchmark::SCAL, kCounts[i]));
+    BenchmarkRegistry::Add(new VectorBenchmark("exp" + suffix,
+        VectorBenchmark::EXP, kCounts[i]));
+  }
+}
+
+REGISTER_BENCHMARKS(AddMathFunctionsBenchmarks);
+
+}  // namespace caffe
@@ -0,0 +1,48 @@
+#include <vector>
+
+#include "benchmark.hpp"
+
+namespace caffe {
+
+const vector<ConvShape>& ConvShapes() {
+  static const ConvShape kShapes[] = {
+    // name                   C    H    W    N    K  S  P
+    { "alexnet/conv1",          3, 227, 227,   96, 11, 4, 0 },
+    { "alexnet/conv2",         96,  27,  27,  256,  5, 1, 2 },
+    { "alexnet/conv3",        256,  13,  13,  384,  3, 1, 1 },
+    { "alexnet/conv4",        384,  13,  13,  384,  3, 1, 1 },
+    { "alexnet/conv5",        384,  13,  13,  256,  3, 1, 1 },
+    { "vgg16/conv1_1",          3, 224, 224,   64,  3, 1, 1 },
+    { "vgg16/conv1_2",         64, 224, 224,   64,  3, 1, 1 },
+    { "vgg16/conv2_1",         64, 112, 112,  128,  3, 1, 1 },
+    { "vgg16/conv3_1",        128,  56,  56,  256,  3, 1, 1 },
+    { "vgg16/conv4_1",        256,  28,  28,  512,  3, 1, 1 },
+    { "vgg16/conv5_1",        512,  14,  14,  512,  3, 1, 1 },
+    { "resnet50/conv1",         3, 224, 224,   64,  7, 2, 3 },
+    { "resnet50/res2a_2a",     64,  56,  56,   64,  1, 1, 0 },
+    { "resnet50/res2a_2b",     64,  56,  56,   64,  3, 1, 1 },
+    { "resnet50/res2a_2c",     64,  56,  56,  256,  1, 1, 0 },
+    { "resnet50/res3a_2b",    128,  28,  28,  128,  3, 1, 1 },
+    { "resnet50/res4a_2b",    256,  14,  14,  256,  3, 1, 1 },
+    { "resnet50/res5a_2b",    512,   7,   7,  512,  3, 1, 1 },
+    { "resnet50/res5a_2c",    512,   7,   7, 2048,  1, 1, 0 },
+  };
+  static const vector<ConvShape> shapes(kShapes,
+      kShapes + sizeof(kShapes) / sizeof(kShapes[0]));
+  return shapes;
+}
+
+const vector<InnerProductShape>& InnerProductShapes() {
+  static const InnerProductShape kShapes[] = {
+    { "alexnet/fc6",   9216, 4096 },
+    { "alexnet/fc7",   4096, 4096 },
+    { "alexnet/fc8",   4096, 1000 },
+    { "vgg16/fc6",    25088, 4096 },
+    { "resnet50/fc",   2048, 1000 },
+  };
+  static const vector<InnerProductShape> shapes(kShapes,
+      kShapes + sizeof(kShapes) / sizeof(kShapes[0]));
+  return shapes;
+}
+
+}  // namespace caffe
@@ -0,0 +1,76 @@
+#ifndef CAFFE_AUTOTUNER_HPP_
+#define CAFFE_AUTOTUNER_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+namespace caffe {
+
+template <typename Dtype> class Net;
+
+/**
+ * @brief Chooses the CPU implementation and the BLAS threads of each layer
+ *        by timing the candidates, and keeps the winners in a cache file.
+ *
+ * The layers that have a choice list it in Layer::cpu_algorithms(). Each
+ * implementation is timed with 1, 2, 4, ... BLAS threads up to the library's
+ * setting, if the library can change it for one thread (MKL), so that nets
+ * running concurrently do not change each other's. Results are keyed by
+ * the CPU model and the layer geometry (type, parameters and input shapes),
+ * so one cache file serves several nets, and later runs on the same machine
+ * only time the layers it lacks. A choice is made for the shapes the layer
+ * has when tuned; a net reshaped later keeps it. The nets of a process tune
+ * one at a time, and the cache file is replaced atomically.
+ */
+template <typename Dtype>
+class Autotuner {
+ public:
+  /// Loads the cache file, if it exists.
+  explicit Autotuner(const string& cache_file);
+
+  /**
+   * @brief Applies to each layer of the net its cached configuration, timing
+   *        the candidates of the layers missing from the cache, and saves
+   *        the new results. Runs the passes of the net in the current mode,
+   *        which should be CPU.
+   */
+  void Tune(Net<Dtype>* net);
+
+  /// The cache key of a layer with the given inputs.
+  static string LayerKey(const Layer<Dtype>& layer,
+      const vector<Blob<Dtype>*>& bottom);
+  /// The model name of the CPU and its number of hardware threads.
+  static string CpuModel();
+
+  inline const AutotuneCache& cache() const { return cache_; }
+
+ protected:
+  /// Times the candidates of a layer and returns the fastest.
+  AutotuneResult TuneLayer(Net<Dtype>* net, int layer_id);
+  /// Times a Forward, and Backward if needed, taking the fastest of a few.
+  float TimeLayer(Net<Dtype>* net, int layer_id);
+  /// Reads the cache file, if it exists.
+  void Load();
+  /// Replaces the cache file with cache_.
+  void Save() const;
+  /// Configures the layer as in the result, unless the cache is stale.
+  void Apply(const AutotuneResult& result, Layer<Dtype>* layer);
+
+  const string cache_file_;
+  const string cpu_model_;
+  AutotuneCache cache_;
+  /// The index in cache_ of the results for cpu_model_, by layer key.
+  map<string, int> index_;
+
+  DISABLE_COPY_AND_ASSIGN(Autotuner);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_AUTOTUNER_HPP_
@@ -262,6 +262,26 @@ class Blob {
    * shared_ptr calls its destructor when reset with the "=" operator.
    */
   void ShareDiff(const Blob& other);
+  /**
+   * @brief Set the data_ shared_ptr to point to an externally supplied
+   *        SyncedMemory, e.g. one wrapping a caller-owned buffer via
+   *        SyncedMemory::set_cpu_data. The caller controls the buffer's
+   *        lifetime through the shared_ptr's deleter.
+   *
+   * If the Blob is later reshaped beyond the size of the memory, it gets a
+   * private data_ again.
+   */
+  void ShareDataMemory(const shared_ptr<SyncedMemory>& data);
+  /**
+   * @brief Set the diff_ shared_ptr to point to a SyncedMemory that may be
+   *        larger than this Blob and shared with other Blob%s -- used by
+   *        Net to reuse diff storage between blobs whose gradients are not
+   *        live at the same time.
+   *
+   * If the Blob is later reshaped beyond the size of the shared memory, it
+   * gets a private diff_ again.
+   */
+  void ShareDiffMemory(const shared_ptr<SyncedMemory>& diff);
 
   bool ShapeEquals(const BlobProto& other);
 
@@ -183,6 +183,10 @@ class Caffe {
   inline static void set_solver_count(int val) { Get().solver_count_ = val; }
   inline static bool root_solver() { return Get().root_solver_; }
   inline static void set_root_solver(bool val) { Get().root_solver_ = val; }
+  // The Autotuner cache file of the process, shared by all threads. When
+  // set, nets created in CPU mode tune their layers, see autotuner.hpp.
+  static const string& autotune_cache();
+  static void set_autotune_cache(const string& path);
 
  protected:
 #ifndef CPU_ONLY
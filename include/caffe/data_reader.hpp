@@ -9,6 +9,7 @@
 #include "caffe/internal_thread.hpp"
 #include "caffe/util/blocking_queue.hpp"
 #include "caffe/util/db.hpp"
+#include "caffe/util/spsc_queue.hpp"
 
 namespace caffe {
 
@@ -25,22 +26,23 @@ class DataReader {
   explicit DataReader(const LayerParameter& param);
   ~DataReader();
 
-  inline BlockingQueue<Datum*>& free() const {
+  inline SPSCQueue<Datum*>& free() const {
     return queue_pair_->free_;
   }
-  inline BlockingQueue<Datum*>& full() const {
+  inline SPSCQueue<Datum*>& full() const {
     return queue_pair_->full_;
   }
 
  protected:
-  // Queue pairs are shared between a body and its readers
+  // Queue pairs are shared between a body and its readers. Each queue has
+  // exactly one producer and one consumer thread.
   class QueuePair {
    public:
     explicit QueuePair(int size);
     ~QueuePair();
 
-    BlockingQueue<Datum*> free_;
-    BlockingQueue<Datum*> full_;
+    SPSCQueue<Datum*> free_;
+    SPSCQueue<Datum*> full_;
 
   DISABLE_COPY_AND_ASSIGN(QueuePair);
   };
@@ -75,6 +75,16 @@ class DataTransformer {
    *    set_cpu_data() is used. See image_data_layer.cpp for an example.
    */
   void Transform(const cv::Mat& cv_img, Blob<Dtype>* transformed_blob);
+
+  /**
+   * @brief Decodes an encoded Datum the way Transform does, honoring
+   * force_color and force_gray, so that callers can time decoding apart
+   * from the transformation of the resulting cv::Mat.
+   *
+   * @param datum
+   *    Datum whose data is an encoded image.
+   */
+  cv::Mat Decode(const Datum& datum);
 #endif  // USE_OPENCV
 
   /**
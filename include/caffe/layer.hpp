@@ -38,7 +38,8 @@ class Layer {
    * layer.
    */
   explicit Layer(const LayerParameter& param)
-    : layer_param_(param), is_shared_(false) {
+    : layer_param_(param), cpu_algorithm_(0), cpu_algorithm_set_(false),
+      cpu_threads_(0), is_shared_(false) {
       // Set phase and copy blobs (if there are any).
       phase_ = param.phase();
       if (layer_param_.blobs_size() > 0) {
@@ -316,6 +317,30 @@ class Layer {
     param_propagate_down_[param_id] = value;
   }
 
+  /**
+   * @brief Returns the names of the CPU implementations the layer can choose
+   *        between for its current shapes, or nothing if it has no choice.
+   *        The Autotuner times them.
+   */
+  virtual vector<string> cpu_algorithms() const { return vector<string>(); }
+  /**
+   * @brief The index in cpu_algorithms() of the CPU implementation to use.
+   *        Until set, the layer uses its default, the first unless the layer
+   *        chooses by shape.
+   */
+  inline int cpu_algorithm() const { return cpu_algorithm_; }
+  inline void set_cpu_algorithm(int algorithm) {
+    cpu_algorithm_ = algorithm;
+    cpu_algorithm_set_ = true;
+  }
+  inline bool cpu_algorithm_set() const { return cpu_algorithm_set_; }
+  /**
+   * @brief The number of BLAS threads for the CPU passes of this layer, or 0
+   *        to leave the BLAS library's setting alone. Only applied if the
+   *        library has a per-thread setting (MKL).
+   */
+  inline int cpu_threads() const { return cpu_threads_; }
+  inline void set_cpu_threads(int threads) { cpu_threads_ = threads; }
 
  protected:
   /** The protobuf that stores the layer parameters */
@@ -326,6 +351,10 @@ class Layer {
   vector<shared_ptr<Blob<Dtype> > > blobs_;
   /** Vector indicating whether to compute the diff of each param blob. */
   vector<bool> param_propagate_down_;
+  /** The CPU implementation and BLAS threads chosen, e.g. by the Autotuner. */
+  int cpu_algorithm_;
+  bool cpu_algorithm_set_;
+  int cpu_threads_;
 
   /** The vector that indicates whether each top blob has a non-zero weight in
    *  the objective function. */
@@ -441,6 +470,20 @@ class Layer {
   /** Unlock forward_mutex_ if this layer is shared */
   void Unlock();
 
+  /**
+   * Sets the calling thread's BLAS threads to cpu_threads_, returning its
+   * previous count, or -1 if left alone. The count of the process is never
+   * changed, as nets running on other threads would see it.
+   */
+  inline int SetBlasThreads() {
+    if (cpu_threads_ <= 0 || !caffe_has_local_blas_threads()) { return -1; }
+    return caffe_set_local_blas_threads(cpu_threads_);
+  }
+  /** Restores the BLAS threads changed by SetBlasThreads */
+  inline void RestoreBlasThreads(int previous) {
+    if (previous >= 0) { caffe_set_local_blas_threads(previous); }
+  }
+
   DISABLE_COPY_AND_ASSIGN(Layer);
 };  // class Layer
 
@@ -490,6 +533,7 @@ inline Dtype Layer<Dtype>::Forward(const vector<Blob<Dtype>*>& bottom,
       printf ("run fwd layer %s mode=%s name=%s\n", type(), mode==Caffe::CPU ? "CPU" : "GPU", layer_param().name().c_str());
   }
   std::string layerName(type()); layerName += '.'; layerName += layer_param().name();
+  const int blas_threads = mode == Caffe::CPU ? SetBlasThreads() : -1;
   switch (mode) {
   case Caffe::CPU:
     HIP_BEGIN_MARKER(layerName.c_str() , "CAFFE-fwd");
@@ -527,6 +571,7 @@ inline Dtype Layer<Dtype>::Forward(const vector<Blob<Dtype>*>& bottom,
   default:
     LOG(FATAL) << "Unknown caffe mode.";
   }
+  RestoreBlasThreads(blas_threads);
   Unlock();
   return loss;
 }
@@ -557,6 +602,7 @@ inline void Layer<Dtype>::Backward(const vector<Blob<Dtype>*>& top,
       printf ("run bwd layer %s mode=%s name=%s\n", type(), mode==Caffe::CPU ? "CPU" : "GPU", layer_param().name().c_str());
   }
   std::string layerName(type()); layerName += '.'; layerName += layer_param().name();
+  const int blas_threads = mode == Caffe::CPU ? SetBlasThreads() : -1;
   switch (mode) {
   case Caffe::CPU:
     HIP_BEGIN_MARKER(layerName.c_str(),  "CAFFE-back");
@@ -571,6 +617,7 @@ inline void Layer<Dtype>::Backward(const vector<Blob<Dtype>*>& top,
   default:
     LOG(FATAL) << "Unknown caffe mode.";
   }
+  RestoreBlasThreads(blas_threads);
 }
 
 // Serialize LayerParameter to protocol buffer
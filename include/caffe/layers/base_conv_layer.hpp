@@ -40,6 +40,13 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   void weight_cpu_gemm(const Dtype* input, const Dtype* output, Dtype*
       weights);
   void backward_cpu_bias(Dtype* bias, const Dtype* input);
+  // Computes the convolution of all num_ images of input with one GEMM per
+  // group of images, on their column buffers side by side, which keeps the
+  // GEMM efficient when each image has few output positions.
+  void forward_cpu_gemm_batched(const Dtype* input, const Dtype* weights,
+      Dtype* output);
+  // Whether forward_cpu_gemm_batched applies: one group and an im2col.
+  inline bool can_batch_gemm() const { return group_ == 1 && !is_1x1_; }
 
 #ifndef CPU_ONLY
   void forward_gpu_gemm(const Dtype* col_input, const Dtype* weights,
@@ -167,6 +174,9 @@ class BaseConvolutionLayer : public Layer<Dtype> {
 
   Blob<Dtype> col_buffer_;
   Blob<Dtype> bias_multiplier_;
+  /// @brief Scratch holding the columns, and the output, of several images.
+  Blob<Dtype> batched_col_buffer_;
+  Blob<Dtype> batched_output_;
 };
 
 }  // namespace caffe
@@ -1,6 +1,7 @@
 #ifndef CAFFE_DATA_LAYERS_HPP_
 #define CAFFE_DATA_LAYERS_HPP_
 
+#include <string>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -8,7 +9,10 @@
 #include "caffe/internal_thread.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
-#include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/histogram.hpp"
+#include "caffe/util/spsc_queue.hpp"
+
+namespace boost { class mutex; }
 
 namespace caffe {
 
@@ -51,6 +55,26 @@ class Batch {
   Blob<Dtype> data_, label_;
 };
 
+/**
+ * @brief Where the input pipeline of a prefetching data layer spends its
+ *        time, to tell whether the net is starved for data and why.
+ */
+struct DataPipelineStats {
+  // Per batch, the microseconds the prefetch thread spent getting the items
+  // from their source, decoding encoded images (when done separately from
+  // the transformation) and transforming the items.
+  Histogram read_us;
+  Histogram decode_us;
+  Histogram transform_us;
+  // Per Forward, the microseconds it waited for a prefetched batch, and the
+  // number of prefetched batches that were ready when it asked for one.
+  Histogram wait_us;
+  Histogram queue_depth;
+
+  // A one-line summary of the means and 99th percentiles.
+  string Summary() const;
+};
+
 template <typename Dtype>
 class BasePrefetchingDataLayer :
     public BaseDataLayer<Dtype>, public InternalThread {
@@ -70,15 +94,38 @@ class BasePrefetchingDataLayer :
   // Prefetches batches (asynchronously if to GPU memory)
   static const int PREFETCH_COUNT = 3;
 
+  // Number of times, and total microseconds, Forward waited for the prefetch
+  // thread to fill a batch; nonzero means the data pipeline is a bottleneck.
+  uint64_t forward_waits() const { return prefetch_full_.pop_stalls(); }
+  uint64_t forward_wait_us() const { return prefetch_full_.pop_stall_us(); }
+  // Number of times, and total microseconds, the prefetch thread waited for
+  // Forward to consume a batch, i.e. was ahead of the net.
+  uint64_t prefetch_waits() const { return prefetch_free_.pop_stalls(); }
+  uint64_t prefetch_wait_us() const { return prefetch_free_.pop_stall_us(); }
+
+  // The pipeline statistics gathered since the last ResetPipelineStats.
+  // The Solver logs and resets them every display iterations.
+  DataPipelineStats pipeline_stats() const;
+  void ResetPipelineStats();
+
  protected:
   virtual void InternalThreadEntry();
   virtual void load_batch(Batch<Dtype>* batch) = 0;
+  // Pops the next prefetched batch for Forward, recording the wait.
+  Batch<Dtype>* NextBatch();
+  // Records the time load_batch spent on a batch, in microseconds.
+  void RecordBatchTimes(double read_us, double decode_us,
+      double transform_us);
 
   Batch<Dtype> prefetch_[PREFETCH_COUNT];
-  BlockingQueue<Batch<Dtype>*> prefetch_free_;
-  BlockingQueue<Batch<Dtype>*> prefetch_full_;
+  SPSCQueue<Batch<Dtype>*> prefetch_free_;
+  SPSCQueue<Batch<Dtype>*> prefetch_full_;
 
   Blob<Dtype> transformed_data_;
+
+  // Guards stats_, which the prefetch thread and Forward both update.
+  shared_ptr<boost::mutex> stats_mutex_;
+  DataPipelineStats stats_;
 };
 
 }  // namespace caffe
@@ -1,6 +1,7 @@
 #ifndef CAFFE_CONV_LAYER_HPP_
 #define CAFFE_CONV_LAYER_HPP_
 
+#include <string>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -65,8 +66,11 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
       : BaseConvolutionLayer<Dtype>(param) {}
 
   virtual inline const char* type() const { return "Convolution"; }
+  virtual vector<string> cpu_algorithms() const;
 
  protected:
+  enum CpuAlgorithm { GEMM, BATCHED_GEMM };
+
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
   virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
@@ -1,6 +1,7 @@
 #ifndef CAFFE_DECONV_LAYER_HPP_
 #define CAFFE_DECONV_LAYER_HPP_
 
+#include <string>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -32,8 +33,13 @@ class DeconvolutionLayer : public BaseConvolutionLayer<Dtype> {
       : BaseConvolutionLayer<Dtype>(param) {}
 
   virtual inline const char* type() const { return "Deconvolution"; }
+  // The plain GEMM and tiled forward passes of 2D layers; bilinear
+  // upsampling is always done separably.
+  virtual vector<string> cpu_algorithms() const;
 
  protected:
+  enum CpuAlgorithm { GEMM, TILED };
+
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
   virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
@@ -44,6 +50,32 @@ class DeconvolutionLayer : public BaseConvolutionLayer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual inline bool reverse_dimensions() { return true; }
   virtual void compute_output_shape();
+
+ private:
+  // 2D forward pass that multiplies the filters with a few input rows at a
+  // time and accumulates the resulting columns straight into the output, so
+  // that the column buffer never has to hold the whole image.
+  void forward_cpu_tiled(const Dtype* input, const Dtype* weights,
+      const Dtype* bias, Dtype* output);
+  // Whether the 2D forward pass is tiled unless an algorithm is set, e.g. by
+  // the Autotuner: when the whole column buffer would be large.
+  bool tiled_by_default() const;
+  // Whether the layer performs channel-wise upsampling with the coefficients
+  // set by BilinearFiller, in which case forward_cpu_bilinear can be used.
+  bool is_bilinear_upsampling();
+  // Separable interpolation equivalent to the deconvolution with bilinear
+  // filters, interpolating the rows first and the columns second.
+  void forward_cpu_bilinear(const Dtype* input, const Dtype* bias,
+      Dtype* output);
+
+  /// @brief The 1D interpolation kernel of the bilinear filters.
+  vector<Dtype> bilinear_kernel_;
+  /// @brief Scratch holding the input rows of a tile.
+  Blob<Dtype> input_tile_;
+  /// @brief Scratch holding the columns computed for a tile.
+  Blob<Dtype> col_tile_;
+  /// @brief Scratch holding the row-interpolated channel.
+  Blob<Dtype> interp_buffer_;
 };
 
 }  // namespace caffe
@@ -0,0 +1,61 @@
+#ifndef CAFFE_MIXED_DATA_LAYER_HPP_
+#define CAFFE_MIXED_DATA_LAYER_HPP_
+
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/data_reader.hpp"
+#include "caffe/data_transformer.hpp"
+#include "caffe/internal_thread.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/layers/base_data_layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+namespace caffe {
+
+/**
+ * @brief Provides data to the Net from several databases mixed by weight.
+ *
+ * Each item of a batch is drawn from a source picked at random with
+ * probability proportional to its weight, so mixing ratios can be changed
+ * in the prototxt without rebuilding the databases. Every source has its
+ * own DataReader cursor. The datums of a batch are transformed on the CPU
+ * ThreadPool, in mixed_data_param.num_threads interleaved groups of items
+ * with a transformer each.
+ */
+template <typename Dtype>
+class MixedDataLayer : public BasePrefetchingDataLayer<Dtype> {
+ public:
+  explicit MixedDataLayer(const LayerParameter& param);
+  virtual ~MixedDataLayer();
+  virtual void DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  // Each solver's layer reads its own share of every source through the
+  // shared DataReaders, so the layer itself is never shared.
+  virtual inline bool ShareInParallel() const { return false; }
+  virtual inline const char* type() const { return "MixedData"; }
+  virtual inline int ExactNumBottomBlobs() const { return 0; }
+  virtual inline int MinTopBlobs() const { return 1; }
+  virtual inline int MaxTopBlobs() const { return 2; }
+
+ protected:
+  virtual void load_batch(Batch<Dtype>* batch);
+  // Picks the source of the next item according to the weights.
+  int SampleSource();
+  // Transforms items group, group + num_groups, ... of the batch.
+  void TransformItems(const vector<Datum*>& datums, int group,
+      int num_groups, Dtype* top_data);
+
+  vector<shared_ptr<DataReader> > readers_;
+  // Cumulative sampling weights of the sources.
+  vector<float> cumulative_weights_;
+  shared_ptr<Caffe::RNG> prefetch_rng_;
+  // One transformer and item view per group of items; group 0 uses the
+  // layer's own data_transformer_.
+  vector<shared_ptr<DataTransformer<Dtype> > > transformers_;
+  vector<shared_ptr<Blob<Dtype> > > transformed_items_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_MIXED_DATA_LAYER_HPP_
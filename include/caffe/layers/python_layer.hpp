@@ -10,6 +10,21 @@ namespace bp = boost::python;
 
 namespace caffe {
 
+// Holds the GIL for the lifetime of the object. pycaffe releases the GIL
+// around Net::ForwardFromTo, Net::BackwardFromTo and Solver::Step, so every
+// call from C++ back into Python must take it again. PyGILState_Ensure is
+// reentrant, so this is also safe when the GIL is already held (e.g. during
+// net construction or when running from the caffe tool).
+class ScopedGILAcquire {
+ public:
+  ScopedGILAcquire() : state_(PyGILState_Ensure()) { }
+  ~ScopedGILAcquire() { PyGILState_Release(state_); }
+
+ private:
+  PyGILState_STATE state_;
+  DISABLE_COPY_AND_ASSIGN(ScopedGILAcquire);
+};
+
 template <typename Dtype>
 class PythonLayer : public Layer<Dtype> {
  public:
@@ -24,6 +39,7 @@ class PythonLayer : public Layer<Dtype> {
         && !ShareInParallel()) {
       LOG(FATAL) << "PythonLayer is not implemented in Multi-GPU training";
     }
+    ScopedGILAcquire gil;
     self_.attr("param_str") = bp::str(
         this->layer_param_.python_param().param_str());
     self_.attr("phase") = static_cast<int>(this->phase_);
@@ -31,6 +47,7 @@ class PythonLayer : public Layer<Dtype> {
   }
   virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
+    ScopedGILAcquire gil;
     self_.attr("reshape")(bottom, top);
   }
 
@@ -43,10 +60,12 @@ class PythonLayer : public Layer<Dtype> {
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
+    ScopedGILAcquire gil;
     self_.attr("forward")(bottom, top);
   }
   virtual void Backward_cpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {
+    ScopedGILAcquire gil;
     self_.attr("backward")(top, propagate_down, bottom);
   }
 
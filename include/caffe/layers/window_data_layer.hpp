@@ -1,6 +1,11 @@
 #ifndef CAFFE_WINDOW_DATA_LAYER_HPP_
 #define CAFFE_WINDOW_DATA_LAYER_HPP_
 
+#include <boost/thread/mutex.hpp>
+#include <stdint.h>
+
+#include <list>
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -14,6 +19,43 @@
 
 namespace caffe {
 
+/**
+ * @brief A thread-safe LRU cache of decoded images keyed by image index,
+ *        holding at most a given number of bytes of pixels.
+ *
+ * cv::Mat is reference counted, so an image handed out stays valid after
+ * eviction.
+ */
+class DecodedImageCache {
+ public:
+  explicit DecodedImageCache(uint64_t capacity);
+
+  // Sets *image to the cached image and returns true, if there is one.
+  bool Get(int key, cv::Mat* image);
+  // Caches the image, evicting the least recently used ones to make room.
+  // Images larger than the whole cache are not kept.
+  void Put(int key, const cv::Mat& image);
+
+  int hits();
+  int misses();
+  // The bytes of the cached images.
+  uint64_t bytes();
+
+ private:
+  typedef std::pair<cv::Mat, std::list<int>::iterator> Entry;
+
+  const uint64_t capacity_;
+  boost::mutex mutex_;
+  // Most recently used first.
+  std::list<int> lru_;
+  std::map<int, Entry> entries_;
+  uint64_t bytes_;
+  int hits_;
+  int misses_;
+
+  DISABLE_COPY_AND_ASSIGN(DecodedImageCache);
+};
+
 /**
  * @brief Provides data to the Net from windows of images files, specified
  *        by a window data file.
@@ -37,6 +79,21 @@ class WindowDataLayer : public BasePrefetchingDataLayer<Dtype> {
   virtual unsigned int PrefetchRand();
   virtual void load_batch(Batch<Dtype>* batch);
 
+  // Returns the decoded image, from the LRU cache if enabled; the result
+  // has no data if the image could not be read.
+  cv::Mat LoadImage(int image_index);
+  // Loads images [begin, end) of a batch and warps each image's windows
+  // into its items of top_data, adding the time spent to the totals.
+  void ExtractWindows(const vector<std::pair<int, vector<int> > >& images,
+      const vector<const vector<float>*>& windows,
+      const vector<bool>& mirrors, int begin, int end, Dtype* top_data,
+      double* read_time, double* trans_time);
+  // Crops one window (with context padding) out of cv_img, warps it to
+  // crop_size x crop_size and writes it, mean-subtracted and scaled, into
+  // item item_id of top_data.
+  void WarpWindow(const cv::Mat& cv_img, const vector<float>& window,
+      bool do_mirror, int item_id, Dtype* top_data);
+
   shared_ptr<Caffe::RNG> prefetch_rng_;
   vector<std::pair<std::string, vector<int> > > image_database_;
   enum WindowField { IMAGE_INDEX, LABEL, OVERLAP, X1, Y1, X2, Y2, NUM };
@@ -48,6 +105,9 @@ class WindowDataLayer : public BasePrefetchingDataLayer<Dtype> {
   bool has_mean_values_;
   bool cache_images_;
   vector<std::pair<std::string, Datum > > image_database_cache_;
+  shared_ptr<DecodedImageCache> decoded_cache_;
+  // Guards the times ExtractWindows adds up.
+  boost::mutex time_mutex_;
 };
 
 }  // namespace caffe
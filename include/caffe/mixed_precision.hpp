@@ -0,0 +1,92 @@
+#ifndef CAFFE_MIXED_PRECISION_HPP_
+#define CAFFE_MIXED_PRECISION_HPP_
+
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/net.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+namespace caffe {
+
+/**
+ * @brief Trains a net in reduced precision, fp16 or bfloat16, with float
+ *        master weights and loss scaling, for the solver's precision.
+ *
+ * Blobs still store Dtype: the reduced precision is emulated by rounding
+ * the weights before the forward pass, and each layer's outputs and
+ * gradients as it computes them, to the nearest value of the format. The
+ * numerics then match those of reduced precision storage, including
+ * gradients that underflow to zero or overflow to inf.
+ *
+ * To keep small gradients representable, the loss gradient is multiplied by
+ * the loss scale before Backward and the parameter gradients are divided by
+ * it after. With a dynamic loss scale, an iteration whose gradients
+ * overflow is skipped and the scale decreased, and the scale is increased
+ * again after a window of iterations without overflow.
+ *
+ * The solver calls Begin before the iteration's forward and backward passes
+ * and End before applying the update. Test nets run in full precision.
+ */
+template <typename Dtype>
+class MixedPrecision {
+ public:
+  MixedPrecision(const SolverParameter& param, Net<Dtype>* net);
+
+  // Saves the master weights and rounds the net's weights. Params with a
+  // zero learning rate are left in full precision.
+  void Begin();
+  // Restores the master weights and unscales the gradients. Returns false,
+  // after adjusting the loss scale, if the gradients overflowed and the
+  // update must be skipped.
+  bool End();
+
+  inline float loss_scale() const { return loss_scale_; }
+  // The iterations since the loss scale last changed.
+  inline int loss_scale_iter() const { return loss_scale_iter_; }
+  // Restores the state of a snapshot.
+  void set_loss_scale(float loss_scale, int loss_scale_iter);
+
+ protected:
+  // Rounds count values in place to the precision.
+  void Round(Blob<Dtype>* blob, bool diff);
+  // Sets the gradient of the losses of a layer to their weights, times the
+  // loss scale if scaled.
+  void SetLossDiffs(int layer_id, bool scaled);
+  // Whether the solver updates learnable param i, which then has a master.
+  inline bool updated(int i) const { return net_->params_lr()[i] != 0; }
+
+  // The Net callbacks, each calling a member of the MixedPrecision.
+  class Callback : public Net<Dtype>::Callback {
+   public:
+    Callback(MixedPrecision* owner, void (MixedPrecision::*function)(int))
+        : owner_(owner), function_(function) {}
+
+   protected:
+    virtual void run(int layer) { (owner_->*function_)(layer); }
+
+    MixedPrecision* owner_;
+    void (MixedPrecision::*function_)(int);
+  };
+  void AfterForward(int layer_id);
+  void BeforeBackward(int layer_id);
+  void AfterBackward(int layer_id);
+
+  const SolverParameter::Precision precision_;
+  const bool dynamic_;
+  const float factor_;
+  const int window_;
+  float loss_scale_;
+  int loss_scale_iter_;
+  Net<Dtype>* net_;
+  // The master copies of the net's learnable_params, for those updated.
+  vector<shared_ptr<Blob<Dtype> > > masters_;
+  Callback after_forward_, before_backward_, after_backward_;
+
+  DISABLE_COPY_AND_ASSIGN(MixedPrecision);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_MIXED_PRECISION_HPP_
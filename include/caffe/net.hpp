@@ -11,6 +11,7 @@
 #include "caffe/common.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/syncedmem.hpp"
 
 namespace caffe {
 
@@ -105,6 +106,12 @@ class Net {
    *        additional memory) the pre-trained layers from another Net.
    */
   void ShareTrainedLayersWith(const Net* other);
+  /**
+   * @brief For an already initialized net, copies the parameters of the
+   *        layers of the same names in another Net into its own, so that
+   *        later updates of either do not affect the other.
+   */
+  void CopyTrainedLayersFrom(const Net* other);
   // For an already initialized net, CopyTrainedLayersFrom() copies the already
   // trained layers from another net parameter instance.
   /**
@@ -119,6 +126,14 @@ class Net {
   void ToProto(NetParameter* param, bool write_diff = false) const;
   /// @brief Writes the net to an HDF5 file.
   void ToHDF5(const string& filename, bool write_diff = false) const;
+  /**
+   * @brief Returns a table of the host (and device, if any) memory held by
+   *        each layer's parameters, top data, top diffs and internal buffers,
+   *        with each layer's high-water mark and the process totals.
+   *
+   * Memory is allocated lazily, so run Forward (and Backward) first.
+   */
+  string MemoryReport() const;
 
   /// @brief returns the network name.
   inline const string& name() const { return name_; }
@@ -134,6 +149,10 @@ class Net {
   inline const vector<shared_ptr<Layer<Dtype> > >& layers() const {
     return layers_;
   }
+  /// @brief returns the memory accounts of the layers
+  inline const vector<shared_ptr<MemoryAccount> >& layer_memory() const {
+    return layer_memory_;
+  }
   /// @brief returns the phase: TRAIN or TEST
   inline Phase phase() const { return phase_; }
   /**
@@ -228,6 +247,34 @@ class Net {
   static bool StateMeetsRule(const NetState& state, const NetStateRule& rule,
       const string& layer_name);
 
+  // Invoked before and after each layer's Forward and Backward, e.g. to
+  // profile the layers; Backward is skipped for layers that don't need it.
+  class Callback {
+   protected:
+    virtual void run(int layer) = 0;
+
+    template <typename T>
+    friend class Net;
+  };
+  const vector<Callback*>& before_forward() const { return before_forward_; }
+  void add_before_forward(Callback* value) {
+    before_forward_.push_back(value);
+  }
+  const vector<Callback*>& after_forward() const { return after_forward_; }
+  void add_after_forward(Callback* value) {
+    after_forward_.push_back(value);
+  }
+  const vector<Callback*>& before_backward() const {
+    return before_backward_;
+  }
+  void add_before_backward(Callback* value) {
+    before_backward_.push_back(value);
+  }
+  const vector<Callback*>& after_backward() const { return after_backward_; }
+  void add_after_backward(Callback* value) {
+    after_backward_.push_back(value);
+  }
+
  protected:
   // Helpers for Init.
   /// @brief Append a new top blob to the net.
@@ -242,6 +289,10 @@ class Net {
   void AppendParam(const NetParameter& param, const int layer_id,
                    const int param_id);
 
+  /// @brief Share diff memory between blobs whose gradients are not live at
+  ///        the same time during Backward.
+  void ShareDiffs();
+
   /// @brief Helper for displaying debug info in Forward.
   void ForwardDebugInfo(const int layer_id);
   /// @brief Helper for displaying debug info in Backward.
@@ -258,6 +309,8 @@ class Net {
   vector<string> layer_names_;
   map<string, int> layer_names_index_;
   vector<bool> layer_need_backward_;
+  /// @brief the memory allocated while setting up and running each layer
+  vector<shared_ptr<MemoryAccount> > layer_memory_;
   /// @brief the blobs storing intermediate results between the layer.
   vector<shared_ptr<Blob<Dtype> > > blobs_;
   vector<string> blob_names_;
@@ -308,6 +361,10 @@ class Net {
   bool debug_info_;
   /// The root net that actually holds the shared layers in data parallelism
   const Net* const root_net_;
+  vector<Callback*> before_forward_;
+  vector<Callback*> after_forward_;
+  vector<Callback*> before_backward_;
+  vector<Callback*> after_backward_;
   DISABLE_COPY_AND_ASSIGN(Net);
 };
 
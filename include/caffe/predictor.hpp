@@ -0,0 +1,99 @@
+#ifndef CAFFE_PREDICTOR_HPP_
+#define CAFFE_PREDICTOR_HPP_
+
+#include <boost/function.hpp>
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/net.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/blocking_queue.hpp"
+
+namespace caffe {
+
+/// @brief The output of a Predictor for one input image.
+template <typename Dtype>
+struct Prediction {
+  /// Values of the net's first output blob for this image.
+  vector<Dtype> scores;
+  /// Indices of the highest scores, best first; empty unless top_k > 0.
+  vector<int> top_k;
+};
+
+/**
+ * @brief Thread-safe batched inference on a deploy Net.
+ *
+ * Requests from any number of threads go into one queue served by
+ * num_workers threads. Each worker owns a replica of the net that shares
+ * the trained weights with the others. A worker coalesces queued requests
+ * into forward passes of up to max_batch_size images. It preprocesses the
+ * images with a DataTransformer directly into its input blob, whose memory
+ * is reused from batch to batch.
+ *
+ * The net must have a single input blob of shape N x C x H x W. Images are
+ * resized to H x W unless the transformation crops. Datums are used as-is
+ * and must already have the input (or an at least crop_size) geometry.
+ * Workers inherit the Caffe mode and device of the constructing thread.
+ */
+template <typename Dtype>
+class Predictor {
+ public:
+  typedef boost::function<void(const vector<Prediction<Dtype> >&)> Callback;
+
+  Predictor(const NetParameter& net_param, const string& weights_file,
+      const TransformationParameter& transform_param, int num_workers,
+      int max_batch_size);
+  Predictor(const string& model_file, const string& weights_file,
+      const TransformationParameter& transform_param, int num_workers,
+      int max_batch_size);
+  /// Stops the workers. The callbacks of queued requests no worker got to
+  /// run with no results.
+  ~Predictor();
+
+  /// @brief Classifies the datums, blocking until done. Results follow the
+  ///        input order.
+  vector<Prediction<Dtype> > Predict(const vector<Datum>& datums,
+      int top_k = 0);
+  /// @brief Queues the datums (by copy) and returns immediately. done runs
+  ///        on a worker thread once all of them are classified.
+  void PredictAsync(const vector<Datum>& datums, int top_k,
+      const Callback& done);
+#ifdef USE_OPENCV
+  /// @brief Classifies 8-bit images, converting channels and resizing to
+  ///        the input geometry as needed.
+  vector<Prediction<Dtype> > Predict(const vector<cv::Mat>& images,
+      int top_k = 0);
+  /// @brief Asynchronous counterpart of Predict(images). cv::Mat copies
+  ///        share pixels with the caller's images, which must not change
+  ///        until done runs.
+  void PredictAsync(const vector<cv::Mat>& images, int top_k,
+      const Callback& done);
+#endif  // USE_OPENCV
+
+  /// Shape of the net's input blob with the batch dimension set to 1.
+  inline const vector<int>& input_shape() const { return input_shape_; }
+  inline int num_workers() const { return workers_.size(); }
+  inline int max_batch_size() const { return max_batch_size_; }
+
+ protected:
+  struct Job;
+  class Worker;
+
+  void Init(const NetParameter& net_param, const string& weights_file,
+      int num_workers);
+  void Submit(Job* job);
+
+  const TransformationParameter transform_param_;
+  const int max_batch_size_;
+  vector<int> input_shape_;
+  vector<shared_ptr<Net<Dtype> > > nets_;
+  vector<shared_ptr<Worker> > workers_;
+  BlockingQueue<Job*> jobs_;
+
+  DISABLE_COPY_AND_ASSIGN(Predictor);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_PREDICTOR_HPP_
@@ -143,6 +143,74 @@ class AdamSolver : public SGDSolver<Dtype> {
   DISABLE_COPY_AND_ASSIGN(AdamSolver);
 };
 
+/**
+ * @brief LARSSolver, SGD with momentum and layer-wise adaptive rate scaling
+ *        for training with large batches, as described in [1].
+ *
+ * The learning rate of each parameter blob is scaled by its trust ratio
+ * trust_coefficient * ||w|| / ||g||, where g includes the weight decay, so
+ * that each layer's update is a fixed fraction of its weights however the
+ * gradient magnitudes differ between layers.
+ *
+ * [1] Y. You, I. Gitman and B. Ginsburg, "Large Batch Training of
+ *     Convolutional Networks." arXiv preprint arXiv:1708.03888 (2017).
+ */
+template <typename Dtype>
+class LARSSolver : public SGDSolver<Dtype> {
+ public:
+  explicit LARSSolver(const SolverParameter& param)
+      : SGDSolver<Dtype>(param) { constructor_sanity_check(); }
+  explicit LARSSolver(const string& param_file)
+      : SGDSolver<Dtype>(param_file) { constructor_sanity_check(); }
+  virtual inline const char* type() const { return "LARS"; }
+
+ protected:
+  virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  void constructor_sanity_check() {
+    CHECK_GT(this->param_.trust_coefficient(), 0)
+        << "trust_coefficient should be positive.";
+  }
+  // The per block sums of squares of the GPU pass.
+  Blob<Dtype> sumsq_;
+
+  DISABLE_COPY_AND_ASSIGN(LARSSolver);
+};
+
+/**
+ * @brief LAMBSolver, Adam with decoupled weight decay and layer-wise
+ *        adaptive rate scaling for training with large batches, as
+ *        described in [1].
+ *
+ * Each parameter blob's Adam step, plus the weight decay, r is scaled by
+ * the trust ratio ||w|| / ||r||. The weight decay is not added to the
+ * gradient, so only L2 regularization is supported.
+ *
+ * [1] Y. You et al., "Large Batch Optimization for Deep Learning: Training
+ *     BERT in 76 minutes." arXiv preprint arXiv:1904.00962 (2019).
+ */
+template <typename Dtype>
+class LAMBSolver : public AdamSolver<Dtype> {
+ public:
+  explicit LAMBSolver(const SolverParameter& param)
+      : AdamSolver<Dtype>(param) { constructor_sanity_check(); }
+  explicit LAMBSolver(const string& param_file)
+      : AdamSolver<Dtype>(param_file) { constructor_sanity_check(); }
+  virtual inline const char* type() const { return "LAMB"; }
+
+ protected:
+  // The weight decay is applied in ComputeUpdateValue.
+  virtual void Regularize(int param_id) {}
+  virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  void constructor_sanity_check() {
+    CHECK_EQ("L2", this->param_.regularization_type())
+        << "LAMB supports L2 regularization only.";
+  }
+  // The per block sums of squares of the GPU pass.
+  Blob<Dtype> sumsq_;
+
+  DISABLE_COPY_AND_ASSIGN(LAMBSolver);
+};
+
 }  // namespace caffe
 
 #endif  // CAFFE_SGD_SOLVERS_HPP_
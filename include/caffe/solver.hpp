@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 
+#include "caffe/mixed_precision.hpp"
 #include "caffe/net.hpp"
 #include "caffe/solver_factory.hpp"
 
@@ -31,6 +32,9 @@ namespace caffe {
  */
 typedef boost::function<SolverAction::Enum()> ActionCallback;
 
+template <typename Dtype>
+class AsyncTester;
+
 /**
  * @brief An interface for classes that perform optimization on Net%s.
  *
@@ -73,6 +77,10 @@ class Solver {
     return test_nets_;
   }
   int iter() { return iter_; }
+  // The reduced precision training state, or NULL when training in Dtype.
+  inline MixedPrecision<Dtype>* mixed_precision() {
+    return mixed_precision_.get();
+  }
 
   // Invoked at specific points during an iteration
   class Callback {
@@ -103,10 +111,24 @@ class Solver {
   // The test routine
   void TestAll();
   void Test(const int test_net_id = 0);
+  // With test_async, starts testing all the test nets in the background on a
+  // copy of the current weights, once the previous test is done.
+  void TestAllAsync();
+  // Runs the test iterations of a test net on its current weights and logs
+  // its mean outputs, each line starting with log_prefix. Returns false if
+  // the test was stopped, as stop returned true before an iteration.
+  bool TestNet(const int test_net_id, const string& log_prefix,
+      const boost::function<bool()>& stop);
+  // Handles the client's requests during a synchronous test, and returns
+  // whether to stop.
+  bool HandleTestRequests();
   virtual void SnapshotSolverState(const string& model_filename) = 0;
   virtual void RestoreSolverStateFromHDF5(const string& state_file) = 0;
   virtual void RestoreSolverStateFromBinaryProto(const string& state_file) = 0;
   void DisplayOutputBlobs(const int net_id);
+  // Logs, then resets, the pipeline statistics of the train net's
+  // prefetching data layers.
+  void DisplayDataPipelineStats();
   void UpdateSmoothedLoss(Dtype loss, int start_iter, int average_loss);
 
   SolverParameter param_;
@@ -114,6 +136,8 @@ class Solver {
   int current_step_;
   shared_ptr<Net<Dtype> > net_;
   vector<shared_ptr<Net<Dtype> > > test_nets_;
+  // With a reduced precision, rounds the train net and scales its loss.
+  shared_ptr<MixedPrecision<Dtype> > mixed_precision_;
   vector<Callback*> callbacks_;
   vector<Dtype> losses_;
   Dtype smoothed_loss_;
@@ -129,6 +153,12 @@ class Solver {
   // True iff a request to stop early was received.
   bool requested_early_exit_;
 
+  // Tests the test nets in the background with test_async. Last, so that it
+  // stops before the nets it uses are destroyed.
+  shared_ptr<AsyncTester<Dtype> > async_tester_;
+
+  friend class AsyncTester<Dtype>;
+
   DISABLE_COPY_AND_ASSIGN(Solver);
 };
 
@@ -2,6 +2,7 @@
 #define CAFFE_SYNCEDMEM_HPP_
 
 #include <cstdlib>
+#include <string>
 
 #include "caffe/common.hpp"
 
@@ -37,6 +38,57 @@ inline void CaffeFreeHost(void* ptr, bool use_hip) {
 }
 
 
+/**
+ * @brief Counts the bytes of host and device memory held by the SyncedMemory
+ *        charged to it, and their high-water marks.
+ *
+ * A SyncedMemory is charged for its whole life to the account in scope on
+ * the thread that creates it (see Scope), if any, and always to Total().
+ * Net opens a scope per layer so that each layer's parameters, outputs and
+ * internal buffers are charged to it.
+ */
+class MemoryAccount {
+ public:
+  enum Location { HOST, DEVICE };
+
+  explicit MemoryAccount(const string& name);
+  ~MemoryAccount();
+
+  inline const string& name() const { return name_; }
+  size_t live_bytes(Location location) const;
+  size_t peak_bytes(Location location) const;
+  // Lowers the high-water marks to the live bytes, e.g. to measure a phase.
+  void ResetPeak();
+
+  void Allocate(Location location, size_t size);
+  void Free(Location location, size_t size);
+
+  // All the SyncedMemory of the process.
+  static MemoryAccount& Total();
+  // The account in scope on this thread, or NULL.
+  static shared_ptr<MemoryAccount> Current();
+
+  // Makes account the current one of this thread until destroyed.
+  class Scope {
+   public:
+    explicit Scope(const shared_ptr<MemoryAccount>& account);
+    ~Scope();
+
+   private:
+    const shared_ptr<MemoryAccount>* previous_;
+
+    DISABLE_COPY_AND_ASSIGN(Scope);
+  };
+
+ private:
+  class Counters;
+
+  const string name_;
+  shared_ptr<Counters> counters_;
+
+  DISABLE_COPY_AND_ASSIGN(MemoryAccount);
+};
+
 /**
  * @brief Manages memory allocation and synchronization between the host (CPU)
  *        and device (GPU).
@@ -48,11 +100,11 @@ class SyncedMemory {
   SyncedMemory()
       : cpu_ptr_(NULL), gpu_ptr_(NULL), size_(0), head_(UNINITIALIZED),
         own_cpu_data_(false), cpu_malloc_use_hip_(false), own_gpu_data_(false),
-        gpu_device_(-1) {}
+        gpu_device_(-1), account_(MemoryAccount::Current()) {}
   explicit SyncedMemory(size_t size)
       : cpu_ptr_(NULL), gpu_ptr_(NULL), size_(size), head_(UNINITIALIZED),
         own_cpu_data_(false), cpu_malloc_use_hip_(false), own_gpu_data_(false),
-        gpu_device_(-1) {}
+        gpu_device_(-1), account_(MemoryAccount::Current()) {}
   ~SyncedMemory();
   const void* cpu_data();
   void set_cpu_data(void* data);
@@ -63,6 +115,12 @@ class SyncedMemory {
   enum SyncedHead { UNINITIALIZED, HEAD_AT_CPU, HEAD_AT_GPU, SYNCED };
   SyncedHead head() { return head_; }
   size_t size() { return size_; }
+  // The bytes this object allocated, and still holds, on the host and the
+  // device; memory set with set_cpu_data or set_gpu_data is not counted.
+  size_t host_bytes() const { return own_cpu_data_ ? size_ : 0; }
+  size_t device_bytes() const { return own_gpu_data_ ? size_ : 0; }
+  // The account charged for this memory besides the total, or NULL.
+  const shared_ptr<MemoryAccount>& account() const { return account_; }
 
 #ifndef CPU_ONLY
   void async_gpu_push(const hipStream_t& stream);
@@ -71,6 +129,8 @@ class SyncedMemory {
  private:
   void to_cpu();
   void to_gpu();
+  void Charge(MemoryAccount::Location location);
+  void Refund(MemoryAccount::Location location);
   void* cpu_ptr_;
   void* gpu_ptr_;
   size_t size_;
@@ -79,6 +139,7 @@ class SyncedMemory {
   bool cpu_malloc_use_hip_;
   bool own_gpu_data_;
   int gpu_device_;
+  shared_ptr<MemoryAccount> account_;
 
   DISABLE_COPY_AND_ASSIGN(SyncedMemory);
 };  // class SyncedMemory
@@ -0,0 +1,55 @@
+#ifndef CAFFE_UTIL_CONVERT_IMAGESET_HPP_
+#define CAFFE_UTIL_CONVERT_IMAGESET_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/db.hpp"
+
+#ifdef USE_OPENCV
+namespace caffe {
+
+// The settings of ConvertImageset, with the defaults of convert_imageset.
+struct ConvertImagesetOptions {
+  ConvertImagesetOptions()
+      : is_color(true), resize_height(0), resize_width(0), encoded(false),
+        check_size(false), num_threads(1), chunk_size(256),
+        commit_bytes(64 << 20) {}
+
+  bool is_color;
+  int resize_height;
+  int resize_width;
+  bool encoded;
+  // The type the images are encoded as, guessed from the file name if empty.
+  string encode_type;
+  // Checks that all the datums have the same size.
+  bool check_size;
+  int num_threads;
+  // The number of images converted by each thread before they are written.
+  int chunk_size;
+  // Commits the transaction once this many bytes have been put into it.
+  int64_t commit_bytes;
+};
+
+/**
+ * @brief Reads the images of a list of (file name, label) pairs, relative to
+ *        root_folder, into Datums and puts them into db.
+ *
+ * The images are converted by num_threads threads, one chunk of the list at
+ * a time, and the next chunk is converted while the current one is written.
+ * The keys are put in list order, so the DB is the same whatever the number
+ * of threads. Returns the number of images put, and the number of bytes in
+ * total_bytes if not NULL.
+ */
+int ConvertImageset(const vector<std::pair<string, int> >& lines,
+    const string& root_folder, const ConvertImagesetOptions& options,
+    db::DB* db, int64_t* total_bytes);
+
+}  // namespace caffe
+#endif  // USE_OPENCV
+
+#endif  // CAFFE_UTIL_CONVERT_IMAGESET_HPP_
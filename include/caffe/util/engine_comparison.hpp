@@ -0,0 +1,86 @@
+#ifndef CAFFE_UTIL_ENGINE_COMPARISON_HPP_
+#define CAFFE_UTIL_ENGINE_COMPARISON_HPP_
+
+#include <string>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/net.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+namespace caffe {
+
+typedef vector<shared_ptr<Blob<float> > > BlobVec;
+
+/**
+ * @brief A way to run a layer: an engine, as named in the layers' engine
+ *        enums, on a device. On the CPU, also the number of ThreadPool
+ *        threads and the implementation from Layer::cpu_algorithms().
+ */
+struct EngineVariant {
+  EngineVariant(const string& engine, Caffe::Brew mode, int threads = 0,
+      const string& cpu_algorithm = "")
+      : engine(engine), mode(mode), threads(threads),
+        cpu_algorithm(cpu_algorithm) {}
+  // e.g. CAFFE/GPU, CAFFE/CPUx1 or CAFFE/CPUx8:batched_gemm.
+  string name() const;
+
+  string engine;
+  Caffe::Brew mode;
+  // The CPU threads, 0 keeping the ThreadPool's count.
+  int threads;
+  // The CPU implementation, empty for the layer's default.
+  string cpu_algorithm;
+};
+
+/// @brief What one layer computed under one variant, and how long it took.
+struct EngineResult {
+  EngineResult() : forward_ms(0), backward_ms(0) {}
+
+  // The top data, and the bottom and parameter diffs.
+  BlobVec outputs, gradients;
+  double forward_ms, backward_ms;
+};
+
+/**
+ * @brief The variants to run the layers of a net under, the reference first:
+ *        CAFFE on one CPU thread. Then CAFFE on the ThreadPool's threads, if
+ *        more than one, with each CPU implementation the layers of the net
+ *        have, and with gpu the GPU engines of the build.
+ */
+vector<EngineVariant> EngineVariants(const Net<float>& net, bool gpu);
+
+/**
+ * @brief Sets the engine of a layer whose type chooses one in
+ *        layer_factory.cpp, in the parameter named after the type, e.g.
+ *        relu_param for ReLU. Returns false if the type has no such engine.
+ */
+bool SetLayerEngine(const string& engine, LayerParameter* param);
+
+/// @brief Copies the data, or the diffs, of the blobs into new blobs' data.
+BlobVec CopyBlobs(const vector<Blob<float>*>& blobs, bool diff);
+
+/**
+ * @brief Sets up a copy of net_layer under the variant, with its parameters,
+ *        and times iterations passes of it on the inputs.
+ *
+ * top_diffs holds the gradients fed to Backward; the first call fills it.
+ * Returns false if the layer lacks the variant's engine or implementation.
+ */
+bool RunLayerVariant(const EngineVariant& variant, Layer<float>* net_layer,
+    const BlobVec& inputs, int num_top, const vector<bool>& propagate_down,
+    bool backward, int iterations, BlobVec* top_diffs, EngineResult* result);
+
+/**
+ * @brief The largest absolute difference between the blobs, and the largest
+ *        one relative to the magnitude of the values, at least 1, as
+ *        GradientChecker does.
+ */
+void CompareBlobs(const BlobVec& blobs, const BlobVec& reference,
+    double* max_abs, double* max_rel);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_ENGINE_COMPARISON_HPP_
@@ -0,0 +1,51 @@
+#ifndef CAFFE_UTIL_HISTOGRAM_HPP_
+#define CAFFE_UTIL_HISTOGRAM_HPP_
+
+#include <stdint.h>
+
+namespace caffe {
+
+/**
+ * @brief A histogram of non-negative values, e.g. durations, with a fixed
+ *        memory footprint.
+ *
+ * Values are counted in buckets whose width grows geometrically, four per
+ * power of two, so percentiles are accurate to about 20% whatever the scale
+ * while count, sum, mean, min and max are exact. Not thread-safe.
+ */
+class Histogram {
+ public:
+  Histogram();
+
+  void Add(double value);
+  void Merge(const Histogram& other);
+  void Clear();
+
+  inline uint64_t count() const { return count_; }
+  inline double sum() const { return sum_; }
+  inline double mean() const { return count_ ? sum_ / count_ : 0; }
+  inline double min() const { return count_ ? min_ : 0; }
+  inline double max() const { return count_ ? max_ : 0; }
+  // The value below which a fraction p in [0, 1] of the values fall,
+  // interpolated within its bucket; 0 if the histogram is empty.
+  double Percentile(double p) const;
+
+ private:
+  static const int kBucketsPerPowerOfTwo = 4;
+  static const int kMaxPowerOfTwo = 48;
+  // Bucket 0 holds [0, 1), the last one everything from 2^kMaxPowerOfTwo.
+  static const int kNumBuckets = 1 + kBucketsPerPowerOfTwo * kMaxPowerOfTwo;
+
+  static int Bucket(double value);
+  static double BucketLowerBound(int bucket);
+
+  uint64_t buckets_[kNumBuckets];
+  uint64_t count_;
+  double sum_;
+  double min_;
+  double max_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_HISTOGRAM_HPP_
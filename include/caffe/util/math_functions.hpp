@@ -12,6 +12,22 @@
 
 namespace caffe {
 
+// The number of threads of the BLAS library, or 0 if it cannot be changed at
+// run time, as with ATLAS.
+int caffe_blas_threads();
+
+// Sets the number of threads of the BLAS library, if it can be changed.
+void caffe_set_blas_threads(const int threads);
+
+// Whether the BLAS library can use a different number of threads on each
+// calling thread, as MKL can.
+bool caffe_has_local_blas_threads();
+
+// Sets the number of BLAS threads of the calling thread only, 0 meaning the
+// library's setting, and returns the previous count of the thread. Requires
+// caffe_has_local_blas_threads().
+int caffe_set_local_blas_threads(const int threads);
+
 // Caffe gemm provides a simpler interface to the gemm functions, with the
 // limitation that the data has to be contiguous in memory.
 template <typename Dtype>
@@ -93,9 +109,29 @@ void caffe_exp(const int n, const Dtype* a, Dtype* y);
 template <typename Dtype>
 void caffe_log(const int n, const Dtype* a, Dtype* y);
 
+// y = log(1 + a)
+template <typename Dtype>
+void caffe_log1p(const int n, const Dtype* a, Dtype* y);
+
+template <typename Dtype>
+void caffe_tanh(const int n, const Dtype* a, Dtype* y);
+
+// y = 1 / (1 + exp(-a))
+template <typename Dtype>
+void caffe_sigmoid(const int n, const Dtype* a, Dtype* y);
+
 template <typename Dtype>
 void caffe_abs(const int n, const Dtype* a, Dtype* y);
 
+// Rounds a to the nearest IEEE half precision (fp16) or bfloat16 value, ties
+// to even, to emulate storing it in that format: values beyond its range
+// become inf, and fp16 values under 2^-14 lose precision down to zero.
+template <typename Dtype>
+void caffe_round_fp16(const int n, const Dtype* a, Dtype* y);
+
+template <typename Dtype>
+void caffe_round_bf16(const int n, const Dtype* a, Dtype* y);
+
 template <typename Dtype>
 Dtype caffe_cpu_dot(const int n, const Dtype* x, const Dtype* y);
 
@@ -202,6 +238,12 @@ void caffe_gpu_div(const int N, const Dtype* a, const Dtype* b, Dtype* y);
 template <typename Dtype>
 void caffe_gpu_abs(const int n, const Dtype* a, Dtype* y);
 
+template <typename Dtype>
+void caffe_gpu_round_fp16(const int n, const Dtype* a, Dtype* y);
+
+template <typename Dtype>
+void caffe_gpu_round_bf16(const int n, const Dtype* a, Dtype* y);
+
 template <typename Dtype>
 void caffe_gpu_exp(const int n, const Dtype* a, Dtype* y);
 
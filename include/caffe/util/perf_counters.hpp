@@ -0,0 +1,104 @@
+#ifndef CAFFE_UTIL_PERF_COUNTERS_HPP_
+#define CAFFE_UTIL_PERF_COUNTERS_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Counts of hardware events, e.g. over a layer's Forward.
+ */
+struct PerfCounts {
+  enum Event {
+    CYCLES,
+    INSTRUCTIONS,
+    // Last level cache references and misses.
+    CACHE_REFERENCES,
+    CACHE_MISSES,
+    NUM_EVENTS
+  };
+  // Bytes per last level cache miss, to estimate the memory traffic.
+  static const int kCacheLineBytes = 64;
+
+  PerfCounts();
+
+  PerfCounts& operator+=(const PerfCounts& other);
+  PerfCounts operator-(const PerfCounts& other) const;
+
+  // Instructions per cycle, low when stalled e.g. on memory.
+  double ipc() const;
+  // The fraction of last level cache references that missed.
+  double cache_miss_rate() const;
+  // An estimate of the bytes read from memory: one line per miss.
+  double memory_bytes() const;
+
+  uint64_t count[NUM_EVENTS];
+};
+
+/**
+ * @brief Hardware performance counters of the calling thread, and of the
+ *        threads it starts afterwards, read with Linux perf_event_open.
+ *
+ * The counters are unavailable off Linux, when the kernel forbids them
+ * (see /proc/sys/kernel/perf_event_paranoid) or in most virtual machines;
+ * Read then returns zeros. Only user space events are counted.
+ */
+class PerfCounters {
+ public:
+  PerfCounters();
+  ~PerfCounters();
+
+  // Whether at least cycles and instructions are counted.
+  bool available() const;
+  bool available(PerfCounts::Event event) const;
+  // The counts since construction, scaled up for the time the kernel did
+  // not count an event because it had more events than hardware counters.
+  PerfCounts Read() const;
+
+ private:
+  int fds_[PerfCounts::NUM_EVENTS];
+
+  DISABLE_COPY_AND_ASSIGN(PerfCounters);
+};
+
+/**
+ * @brief Accumulates the hardware counters of each layer's Forward and
+ *        Backward over the passes of a net.
+ *
+ * Call Start before and Stop after each layer pass, on the thread running
+ * it, e.g. from the Net callbacks or around the calls of caffe time.
+ */
+class LayerPerfCounters {
+ public:
+  explicit LayerPerfCounters(int num_layers);
+
+  inline bool available() const { return counters_.available(); }
+  void Start();
+  void Stop(int layer_id, bool backward);
+  void Clear();
+
+  inline const PerfCounts& forward(int layer_id) const {
+    return forward_[layer_id];
+  }
+  inline const PerfCounts& backward(int layer_id) const {
+    return backward_[layer_id];
+  }
+  // A table of the cycles, IPC, cache miss rate and memory traffic of the
+  // layers per pass, averaged over the given number of iterations.
+  string Report(const vector<string>& layer_names, int iterations) const;
+
+ private:
+  PerfCounters counters_;
+  PerfCounts start_;
+  vector<PerfCounts> forward_;
+  vector<PerfCounts> backward_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_PERF_COUNTERS_HPP_
@@ -0,0 +1,193 @@
+#ifndef CAFFE_UTIL_SIMD_KERNELS_H_
+#define CAFFE_UTIL_SIMD_KERNELS_H_
+
+#include <math.h>  // for HUGE_VALF and NAN
+
+namespace caffe {
+
+// The vector kernels behind simd_math.hpp, for the translation units that
+// compile them for one instruction set each. Only simd_math.cpp calls them.
+//
+// Each instantiates MakeSimdKernels with a traits type T providing a vector
+// type V of kWidth floats, a mask type M as returned by the comparisons,
+// and the operations the kernels are written with. The kernels must not
+// call functions that could be shared with other translation units, such as
+// those of libm or the standard library, as the linker could keep the copy
+// compiled for an instruction set the CPU lacks.
+
+// The kernels of one instruction set. Each processes the whole vectors at
+// the front of a and returns the number of elements done; simd_math.cpp
+// computes the others with libm.
+struct SimdKernels {
+  const char* isa;
+  int (*exp)(const int n, const float* a, float* y);
+  int (*log)(const int n, const float* a, float* y);
+  int (*log1p)(const int n, const float* a, float* y);
+  int (*tanh)(const int n, const float* a, float* y);
+  int (*sigmoid)(const int n, const float* a, float* y);
+  // a^b, where integral and odd tell whether b is an integer and an odd one.
+  int (*powx)(const int n, const float* a, const float b, const bool integral,
+      const bool odd, float* y);
+};
+
+// The kernels of each instruction set, or NULL if the compiler could not
+// target it.
+const SimdKernels* simd_avx512_kernels();
+const SimdKernels* simd_avx2_kernels();
+const SimdKernels* simd_sse2_kernels();
+
+namespace simd {
+
+// The kernels follow the Cephes single precision functions.
+
+template <typename T>
+inline typename T::V Exp(typename T::V x) {
+  typedef typename T::V V;
+  // The range in which the result is a normal float and the exponent of
+  // the scale below fits.
+  const V lowest = T::set1(-87.3365447504f);
+  const V highest = T::set1(88.3762626647949f);
+  const V clamped = T::min(T::max(x, lowest), highest);
+  // exp(x) = 2^n * exp(r), with r = x - n * ln(2) in [-ln(2)/2, ln(2)/2].
+  const V n = T::round(T::mul(clamped, T::set1(1.44269504088896341f)));
+  V r = T::fmadd(n, T::set1(-0.693359375f), clamped);
+  r = T::fmadd(n, T::set1(2.12194440e-4f), r);
+  V p = T::set1(1.9875691500e-4f);
+  p = T::fmadd(p, r, T::set1(1.3981999507e-3f));
+  p = T::fmadd(p, r, T::set1(8.3334519073e-3f));
+  p = T::fmadd(p, r, T::set1(4.1665795894e-2f));
+  p = T::fmadd(p, r, T::set1(1.6666665459e-1f));
+  p = T::fmadd(p, r, T::set1(5.0000001201e-1f));
+  V y = T::add(T::fmadd(p, T::mul(r, r), r), T::set1(1.f));
+  y = T::mul(y, T::pow2(n));
+  y = T::select(T::lt(x, lowest), T::set1(0.f), y);
+  y = T::select(T::gt(x, highest), T::set1(HUGE_VALF), y);
+  return T::select(T::isnan(x), x, y);
+}
+
+template <typename T>
+inline typename T::V Log(typename T::V x) {
+  typedef typename T::V V;
+  // Scale denormals up to normals.
+  const typename T::M denormal = T::lt(x, T::set1(1.17549435e-38f));
+  const V scaled = T::select(denormal, T::mul(x, T::set1(33554432.f)), x);
+  V e;
+  V m = T::frexp(scaled, &e);
+  e = T::sub(e, T::select(denormal, T::set1(25.f), T::set1(0.f)));
+  // log(x) = e * ln(2) + log(m), with m in [sqrt(1/2), sqrt(2)).
+  const typename T::M low = T::lt(m, T::set1(0.707106781186547524f));
+  e = T::sub(e, T::select(low, T::set1(1.f), T::set1(0.f)));
+  m = T::select(low, T::add(m, m), m);
+  const V t = T::sub(m, T::set1(1.f));
+  const V z = T::mul(t, t);
+  V p = T::set1(7.0376836292e-2f);
+  p = T::fmadd(p, t, T::set1(-1.1514610310e-1f));
+  p = T::fmadd(p, t, T::set1(1.1676998740e-1f));
+  p = T::fmadd(p, t, T::set1(-1.2420140846e-1f));
+  p = T::fmadd(p, t, T::set1(1.4249322787e-1f));
+  p = T::fmadd(p, t, T::set1(-1.6668057665e-1f));
+  p = T::fmadd(p, t, T::set1(2.0000714765e-1f));
+  p = T::fmadd(p, t, T::set1(-2.4999993993e-1f));
+  p = T::fmadd(p, t, T::set1(3.3333331174e-1f));
+  V y = T::mul(T::mul(p, t), z);
+  y = T::fmadd(e, T::set1(-2.12194440e-4f), y);
+  y = T::fmadd(z, T::set1(-0.5f), y);
+  y = T::fmadd(e, T::set1(0.693359375f), T::add(t, y));
+  y = T::select(T::lt(x, T::set1(0.f)), T::set1(NAN), y);
+  y = T::select(T::eq(x, T::set1(0.f)), T::set1(-HUGE_VALF), y);
+  y = T::select(T::eq(x, T::set1(HUGE_VALF)), x, y);
+  return T::select(T::isnan(x), x, y);
+}
+
+template <typename T>
+inline typename T::V Log1p(typename T::V x) {
+  typedef typename T::V V;
+  // log(u) * x / (u - 1) cancels the rounding error of u = 1 + x.
+  const V u = T::add(x, T::set1(1.f));
+  const V y = T::div(T::mul(Log<T>(u), x), T::sub(u, T::set1(1.f)));
+  return T::select(T::eq(u, T::set1(1.f)), x,
+      T::select(T::eq(u, T::set1(HUGE_VALF)), u, y));
+}
+
+template <typename T>
+inline typename T::V Tanh(typename T::V x) {
+  typedef typename T::V V;
+  const V a = T::abs(x);
+  // Near 0, an odd polynomial.
+  const V z = T::mul(x, x);
+  V p = T::set1(-5.70498872745e-3f);
+  p = T::fmadd(p, z, T::set1(2.06390887954e-2f));
+  p = T::fmadd(p, z, T::set1(-5.37397155531e-2f));
+  p = T::fmadd(p, z, T::set1(1.33314422036e-1f));
+  p = T::fmadd(p, z, T::set1(-3.33332819422e-1f));
+  const V small = T::fmadd(T::mul(x, z), p, x);
+  // Elsewhere, 1 - 2 / (exp(2 |x|) + 1).
+  const V e = Exp<T>(T::min(T::add(a, a), T::set1(88.f)));
+  const V large = T::copysign(T::sub(T::set1(1.f),
+      T::div(T::set1(2.f), T::add(e, T::set1(1.f)))), x);
+  const V y = T::select(T::lt(a, T::set1(0.625f)), small, large);
+  return T::select(T::isnan(x), x, T::copysign(y, x));
+}
+
+template <typename T>
+inline typename T::V Sigmoid(typename T::V x) {
+  const typename T::V one = T::set1(1.f);
+  return T::div(one, T::add(one, Exp<T>(T::sub(T::set1(0.f), x))));
+}
+
+// |x|^b, with the sign of x if b is an odd integer, or NaN for finite
+// negative x if b is not an integer.
+template <typename T>
+inline typename T::V Pow(typename T::V x, float b, bool integral, bool odd) {
+  typedef typename T::V V;
+  const V y = Exp<T>(T::mul(T::set1(b), Log<T>(T::abs(x))));
+  if (odd) {
+    return T::copysign(y, x);
+  }
+  if (integral) {
+    return y;
+  }
+  return T::select(T::and_(T::lt(x, T::set1(0.f)),
+      T::gt(x, T::set1(-HUGE_VALF))), T::set1(NAN), y);
+}
+
+// Applies Kernel to the whole vectors at the front of a.
+template <typename T, typename T::V (*Kernel)(typename T::V)>
+int Apply(const int n, const float* a, float* y) {
+  int i = 0;
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T::store(y + i, Kernel(T::load(a + i)));
+  }
+  return i;
+}
+
+template <typename T>
+int ApplyPow(const int n, const float* a, const float b, const bool integral,
+    const bool odd, float* y) {
+  int i = 0;
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T::store(y + i, Pow<T>(T::load(a + i), b, integral, odd));
+  }
+  return i;
+}
+
+}  // namespace simd
+
+// The kernels for the traits T. Instantiate it with traits defined in an
+// unnamed namespace, so that the kernels stay local to the translation unit.
+template <typename T>
+SimdKernels MakeSimdKernels(const char* isa) {
+  SimdKernels kernels;
+  kernels.isa = isa;
+  kernels.exp = simd::Apply<T, simd::Exp<T> >;
+  kernels.log = simd::Apply<T, simd::Log<T> >;
+  kernels.log1p = simd::Apply<T, simd::Log1p<T> >;
+  kernels.tanh = simd::Apply<T, simd::Tanh<T> >;
+  kernels.sigmoid = simd::Apply<T, simd::Sigmoid<T> >;
+  kernels.powx = simd::ApplyPow<T>;
+  return kernels;
+}
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_SIMD_KERNELS_H_
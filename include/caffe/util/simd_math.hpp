@@ -0,0 +1,43 @@
+#ifndef CAFFE_UTIL_SIMD_MATH_H_
+#define CAFFE_UTIL_SIMD_MATH_H_
+
+#include <string>
+
+namespace caffe {
+
+// Elementwise transcendental functions of floats, computed with polynomial
+// approximations on vectors of the best instruction set the CPU supports:
+// AVX-512, AVX2 with FMA, or SSE2. The choice is made once, with cpuid, and
+// the environment variable CAFFE_SIMD_ISA can lower it, e.g. to compare
+// them, to any of those names or "scalar". Without vectors, and for the
+// elements after the last whole vector, they call libm. The math functions
+// use them for float unless Caffe is built with MKL. y may alias a.
+//
+// Within the normal range the relative error is below 1e-6 for exp, log,
+// log1p, tanh and sigmoid, and grows with |b * log(x)| for powx. Results of
+// exp and powx under FLT_MIN flush to 0, and those of exp over 2.7e38
+// overflow to inf. NaN, infinite, zero and negative inputs give the same
+// results as std::exp, std::log, std::log1p, std::tanh and std::pow.
+
+void simd_exp(const int n, const float* a, float* y);
+void simd_log(const int n, const float* a, float* y);
+// log(1 + a), accurate for small a.
+void simd_log1p(const int n, const float* a, float* y);
+void simd_tanh(const int n, const float* a, float* y);
+// 1 / (1 + exp(-a))
+void simd_sigmoid(const int n, const float* a, float* y);
+// a^b
+void simd_powx(const int n, const float* a, const float b, float* y);
+
+// The instruction set the functions use: "avx512", "avx2", "sse2" or
+// "scalar".
+const char* simd_isa();
+// Whether this CPU and build support the instruction set, by the names above.
+bool simd_isa_supported(const std::string& isa);
+// Makes the functions use the instruction set, if supported, e.g. to test
+// each. Not thread safe with the functions.
+bool simd_set_isa(const std::string& isa);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_SIMD_MATH_H_
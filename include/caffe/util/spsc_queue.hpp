@@ -0,0 +1,76 @@
+#ifndef CAFFE_UTIL_SPSC_QUEUE_HPP_
+#define CAFFE_UTIL_SPSC_QUEUE_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A bounded lock-free queue between exactly one producer thread and
+ *        one consumer thread.
+ *
+ * Items live in a ring buffer indexed by two monotonic counters, each
+ * written by one side only, so pushing and popping take no lock. A side
+ * that has to wait spins briefly, then yields, then parks on a condition
+ * variable; the other side takes the lock only to wake a parked peer.
+ * Waits are counted and timed so callers can report pipeline stalls.
+ */
+template<typename T>
+class SPSCQueue {
+ public:
+  explicit SPSCQueue(int capacity);
+
+  // Producer side. push blocks while the queue is full.
+  void push(const T& t);
+  bool try_push(const T& t);
+  // Pushes all items, publishing as many at a time as there is room for.
+  void push(const vector<T>& items);
+
+  // Consumer side. pop and peek block while the queue is empty and log
+  // log_on_wait (every 1000th time) when they do.
+  T pop(const string& log_on_wait = "");
+  bool try_pop(T* t);
+  // Blocks until at least one item is available, then replaces the
+  // contents of items with up to max_items of them.
+  void pop(int max_items, vector<T>* items, const string& log_on_wait = "");
+  T peek();
+  bool try_peek(T* t);
+
+  size_t size() const;
+  inline int capacity() const { return capacity_; }
+
+  // Stall metrics: how often each side had to wait, and for how long in
+  // total, in microseconds.
+  uint64_t pop_stalls() const;
+  uint64_t pop_stall_us() const;
+  uint64_t push_stalls() const;
+  uint64_t push_stall_us() const;
+
+ protected:
+  /**
+   Keep the atomics and wait primitives out of the header, like
+   BlockingQueue, to avoid the boost/NVCC issues (#1009, #1010).
+   */
+  class sync;
+
+  void wait_not_empty(const string& log_on_wait);
+  void wait_not_full();
+  void notify_consumer();
+  void notify_producer();
+
+  const int capacity_;
+  const size_t mask_;
+  vector<T> buffer_;
+  shared_ptr<sync> sync_;
+
+DISABLE_COPY_AND_ASSIGN(SPSCQueue);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_SPSC_QUEUE_HPP_
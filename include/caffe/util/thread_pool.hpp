@@ -0,0 +1,92 @@
+#ifndef CAFFE_UTIL_THREAD_POOL_HPP_
+#define CAFFE_UTIL_THREAD_POOL_HPP_
+
+#include <boost/function.hpp>
+#include <boost/ref.hpp>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief The process-wide pool of threads that CPU code splits its loops
+ *        over, through parallel_for: elementwise math, layer loops and the
+ *        data transformer.
+ *
+ * The thread calling parallel_for runs a share of the loop, so a pool of N
+ * threads has N - 1 workers, which sleep between loops. Only one loop runs
+ * on the pool at a time: loops nested in a chunk, or started by another
+ * thread (e.g. a prefetching data layer) while the pool is busy, run on the
+ * calling thread alone, so the cores are never oversubscribed.
+ *
+ * By default the pool has as many threads as the BLAS library, or one per
+ * core when the library's count is unknown; SetNumThreads sets both. As the
+ * BLAS threads run the matrix products and the pool the rest, one does not
+ * wait on the other.
+ */
+class ThreadPool {
+ public:
+  typedef boost::function<void(int, int)> Body;
+
+  /// The number of threads loops are split over, the caller included.
+  static int num_threads();
+  /**
+   * @brief Resizes the pool, 0 meaning one thread per core, and sets the
+   *        BLAS threads to the same count.
+   */
+  static void SetNumThreads(int threads);
+  /**
+   * @brief Pins each worker to one CPU, taking the CPUs of the calling
+   *        thread's NUMA node first, and binds the caller to that node, so
+   *        the memory the threads touch first is local to them. Linux only.
+   */
+  static void SetNumaPinning(bool pin);
+  static bool numa_pinning();
+  /**
+   * @brief Replaces the workers with new threads, which inherit what the
+   *        calling thread set up since, e.g. PerfCounters.
+   */
+  static void RestartWorkers();
+  /**
+   * @brief Calls body(begin, end) on disjoint ranges covering [0, n), of at
+   *        least grain iterations each, on up to num_threads() threads, and
+   *        returns when all are done.
+   */
+  static void ParallelFor(int n, int grain, const Body& body);
+
+ private:
+  class Impl;
+  static Impl* pool();
+};
+
+/// The fewest elements an elementwise op hands to a thread.
+const int kParallelGrain = 32768;
+
+/// The elements an elementwise op passes at once to a vectorized math call,
+/// such as caffe_exp, through a buffer on the stack of its loop body.
+const int kVectorBlock = 1024;
+
+/**
+ * @brief Runs body(begin, end) over [0, n) on the ThreadPool, in ranges of
+ *        at least grain iterations; short loops run on the calling thread.
+ *        The ranges run concurrently and must not write to the same data.
+ */
+template <typename Function>
+inline void parallel_for(int n, int grain, const Function& body) {
+  if (n < 2 * grain || ThreadPool::num_threads() == 1) {
+    if (n > 0) {
+      body(0, n);
+    }
+    return;
+  }
+  ThreadPool::ParallelFor(n, grain, boost::cref(body));
+}
+
+template <typename Function>
+inline void parallel_for(int n, const Function& body) {
+  parallel_for(n, kParallelGrain, body);
+}
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_THREAD_POOL_HPP_
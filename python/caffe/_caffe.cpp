@@ -7,14 +7,22 @@
 #include <boost/python.hpp>
 #include <boost/python/raw_function.hpp>
 #include <boost/python/suite/indexing/vector_indexing_suite.hpp>
+#include <boost/thread.hpp>
 #include <numpy/arrayobject.h>
+#ifdef USE_OPENCV
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#endif  // USE_OPENCV
 
 // these need to be included after boost on OS X
+#include <algorithm>  // NOLINT(build/include_order)
 #include <string>  // NOLINT(build/include_order)
 #include <vector>  // NOLINT(build/include_order)
 #include <fstream>  // NOLINT
 
 #include "caffe/caffe.hpp"
+#include "caffe/data_transformer.hpp"
+#include "caffe/layers/base_data_layer.hpp"
 #include "caffe/layers/memory_data_layer.hpp"
 #include "caffe/layers/python_layer.hpp"
 #include "caffe/sgd_solvers.hpp"
@@ -47,9 +55,74 @@ namespace caffe {
 typedef float Dtype;
 const int NPY_DTYPE = NPY_FLOAT32;
 
+// Caffe keeps its mode and device in a thread-local singleton (Caffe::Get),
+// but Python users expect set_mode_gpu() and set_device() to be
+// process-wide. The last selection is kept here and applied to any thread
+// that runs a net before configuring itself, so a worker started with
+// threading.Thread inherits the main thread's choice. A thread that calls
+// set_mode_*() or set_device() itself keeps its own setting. These globals
+// are only touched with the GIL held.
+static Caffe::Brew python_mode = Caffe::CPU;
+static int python_device = -1;
+static boost::thread_specific_ptr<bool> python_thread_configured;
+
+static void MarkThreadConfigured() {
+  if (!python_thread_configured.get()) {
+    python_thread_configured.reset(new bool(true));
+  }
+}
+
+// Bring the calling thread's Caffe context in line with the process-wide
+// Python selection if the thread has not chosen a mode on its own.
+static void ApplyPythonContext() {
+  if (python_thread_configured.get()) {
+    return;
+  }
+  if (python_mode == Caffe::GPU && python_device >= 0) {
+    Caffe::SetDevice(python_device);
+  }
+  Caffe::set_mode(python_mode);
+  MarkThreadConfigured();
+}
+
 // Selecting mode.
-void set_mode_cpu() { Caffe::set_mode(Caffe::CPU); }
-void set_mode_gpu() { Caffe::set_mode(Caffe::GPU); }
+void set_mode_cpu() {
+  python_mode = Caffe::CPU;
+  Caffe::set_mode(Caffe::CPU);
+  MarkThreadConfigured();
+}
+void set_mode_gpu() {
+  python_mode = Caffe::GPU;
+  Caffe::set_mode(Caffe::GPU);
+  MarkThreadConfigured();
+}
+void set_device(int device_id) {
+  python_device = device_id;
+  Caffe::SetDevice(device_id);
+  MarkThreadConfigured();
+}
+// Whether this build can run nets in GPU mode on this machine.
+bool has_gpu() {
+#ifdef CPU_ONLY
+  return false;
+#else
+  return Caffe::FindDevice() >= 0;
+#endif
+}
+
+// Releases the GIL for the lifetime of the object so other Python threads
+// (e.g. preprocessing workers) can run while Caffe computes. Anything that
+// calls back into Python from inside this scope (PythonLayer, solver
+// callbacks) reacquires it with ScopedGILAcquire.
+class ScopedGILRelease {
+ public:
+  ScopedGILRelease() : state_(PyEval_SaveThread()) { }
+  ~ScopedGILRelease() { PyEval_RestoreThread(state_); }
+
+ private:
+  PyThreadState* state_;
+  DISABLE_COPY_AND_ASSIGN(ScopedGILRelease);
+};
 
 void InitLog(int level) {
   FLAGS_logtostderr = 1;
@@ -106,6 +179,7 @@ shared_ptr<Net<Dtype> > Net_Init(string network_file, int phase,
     const int level, const bp::object& stages,
     const bp::object& weights) {
   CheckFile(network_file);
+  ApplyPythonContext();
 
   // Convert stages from list to vector
   vector<string> stages_vector;
@@ -139,6 +213,7 @@ shared_ptr<Net<Dtype> > Net_Init_Load(
     << ", weights='" << pretrained_param_file << "')";
   CheckFile(param_file);
   CheckFile(pretrained_param_file);
+  ApplyPythonContext();
 
   shared_ptr<Net<Dtype> > net(new Net<Dtype>(param_file,
       static_cast<Phase>(phase)));
@@ -160,6 +235,49 @@ void Net_LoadHDF5(Net<Dtype>* net, string filename) {
   net->CopyTrainedLayersFromHDF5(filename.c_str());
 }
 
+bp::dict HistogramToDict(const Histogram& histogram) {
+  bp::dict summary;
+  summary["count"] = histogram.count();
+  summary["mean"] = histogram.mean();
+  summary["min"] = histogram.min();
+  summary["max"] = histogram.max();
+  summary["p50"] = histogram.Percentile(0.5);
+  summary["p90"] = histogram.Percentile(0.9);
+  summary["p99"] = histogram.Percentile(0.99);
+  return summary;
+}
+
+// Returns {layer name: {metric: summary}} for the prefetching data layers.
+bp::dict Net_DataPipelineStats(Net<Dtype>* net) {
+  bp::dict stats;
+  for (int i = 0; i < net->layers().size(); ++i) {
+    const BasePrefetchingDataLayer<Dtype>* layer =
+        dynamic_cast<BasePrefetchingDataLayer<Dtype>*>(net->layers()[i].get());
+    if (!layer) {
+      continue;
+    }
+    const DataPipelineStats layer_stats = layer->pipeline_stats();
+    bp::dict metrics;
+    metrics["read_us"] = HistogramToDict(layer_stats.read_us);
+    metrics["decode_us"] = HistogramToDict(layer_stats.decode_us);
+    metrics["transform_us"] = HistogramToDict(layer_stats.transform_us);
+    metrics["wait_us"] = HistogramToDict(layer_stats.wait_us);
+    metrics["queue_depth"] = HistogramToDict(layer_stats.queue_depth);
+    stats[net->layer_names()[i]] = metrics;
+  }
+  return stats;
+}
+
+void Net_ResetDataPipelineStats(Net<Dtype>* net) {
+  for (int i = 0; i < net->layers().size(); ++i) {
+    BasePrefetchingDataLayer<Dtype>* layer =
+        dynamic_cast<BasePrefetchingDataLayer<Dtype>*>(net->layers()[i].get());
+    if (layer) {
+      layer->ResetPipelineStats();
+    }
+  }
+}
+
 void Net_SetInputArrays(Net<Dtype>* net, bp::object data_obj,
     bp::object labels_obj) {
   // check that this network has an input MemoryDataLayer
@@ -192,9 +310,298 @@ void Net_SetInputArrays(Net<Dtype>* net, bp::object data_obj,
       PyArray_DIMS(data_arr)[0]);
 }
 
+// Deleter for a SyncedMemory whose host buffer belongs to a NumPy array: the
+// array is kept alive for exactly as long as some Blob references the
+// memory, i.e. until the blob is rebound, reshaped beyond the array's size,
+// or destroyed.
+class NdarrayMemoryDeleter {
+ public:
+  explicit NdarrayMemoryDeleter(PyObject* arr) : arr_(arr) { Py_INCREF(arr_); }
+  void operator()(SyncedMemory* mem) {
+    delete mem;
+    if (Py_IsInitialized()) {
+      ScopedGILAcquire gil;
+      Py_DECREF(arr_);
+    }
+  }
+
+ private:
+  PyObject* arr_;
+};
+
+// Marks the host copy of the input blobs bound with bind_input as the latest,
+// since writes to their arrays bypass SyncedMemory. Without this, a GPU
+// forward after the first would keep reading the stale device copy.
+static void SyncBoundInputs(Net<Dtype>* net) {
+  for (int i = 0; i < net->input_blobs().size(); ++i) {
+    Blob<Dtype>* blob = net->input_blobs()[i];
+    if (boost::get_deleter<NdarrayMemoryDeleter>(blob->data())) {
+      blob->mutable_cpu_data();
+    }
+  }
+}
+
+// The compute entry points below drop the GIL. Callers must not touch the
+// net's blobs from other Python threads while these run.
+Dtype Net_ForwardFromTo(Net<Dtype>* net, int start, int end) {
+  ApplyPythonContext();
+  SyncBoundInputs(net);
+  ScopedGILRelease nogil;
+  return net->ForwardFromTo(start, end);
+}
+
+void Net_BackwardFromTo(Net<Dtype>* net, int start, int end) {
+  ApplyPythonContext();
+  ScopedGILRelease nogil;
+  net->BackwardFromTo(start, end);
+}
+
+void Solver_Step(Solver<Dtype>* solver, int iters) {
+  ApplyPythonContext();
+  ScopedGILRelease nogil;
+  solver->Step(iters);
+}
+
+void Solver_Solve(Solver<Dtype>* solver, const bp::object& resume_file) {
+  string resume_file_str;
+  if (!resume_file.is_none()) {
+    resume_file_str = bp::extract<string>(resume_file);
+  }
+  ApplyPythonContext();
+  ScopedGILRelease nogil;
+  solver->Solve(resume_file.is_none() ? NULL : resume_file_str.c_str());
+}
+
+// Bind a C-contiguous float32 array of any shape as the data of a net input
+// blob without copying. The blob takes the array's shape; writes to the
+// array are seen by the next forward pass, in GPU mode too as forward
+// uploads bound inputs again, and vice versa.
+void Net_BindInput(Net<Dtype>* net, const string& name, bp::object arr_obj) {
+  const vector<int>& inputs = net->input_blob_indices();
+  bool is_input = false;
+  for (int i = 0; i < inputs.size(); ++i) {
+    is_input |= (net->blob_names()[inputs[i]] == name);
+  }
+  if (!is_input) {
+    throw std::runtime_error(name + " is not an input blob of the net");
+  }
+  if (!PyArray_Check(arr_obj.ptr())) {
+    throw std::runtime_error(name + " must be bound to a numpy array");
+  }
+  PyArrayObject* arr = reinterpret_cast<PyArrayObject*>(arr_obj.ptr());
+  if (!PyArray_ISCARRAY(arr)) {
+    throw std::runtime_error(name + " array must be C contiguous, aligned"
+        " and writeable");
+  }
+  if (PyArray_TYPE(arr) != NPY_FLOAT32) {
+    throw std::runtime_error(name + " array must be float32");
+  }
+  if (PyArray_NDIM(arr) > kMaxBlobAxes) {
+    throw std::runtime_error(name + " array has too many axes");
+  }
+  if (PyArray_SIZE(arr) == 0) {
+    throw std::runtime_error(name + " array must not be empty");
+  }
+  vector<int> shape(PyArray_NDIM(arr));
+  for (int i = 0; i < shape.size(); ++i) {
+    if (PyArray_DIMS(arr)[i] > INT_MAX) {
+      throw std::runtime_error(name + " array is too large");
+    }
+    shape[i] = PyArray_DIMS(arr)[i];
+  }
+  shared_ptr<Blob<Dtype> > blob = net->blob_by_name(name);
+  blob->Reshape(shape);
+  shared_ptr<SyncedMemory> memory(
+      new SyncedMemory(blob->count() * sizeof(Dtype)),
+      NdarrayMemoryDeleter(arr_obj.ptr()));
+  memory->set_cpu_data(PyArray_DATA(arr));
+  blob->ShareDataMemory(memory);
+}
+
+// A borrowed uint8 HWC image buffer handed to Net_PreprocessBatch.
+struct ImageView {
+  const uint8_t* data;
+  int height;
+  int width;
+  int channels;
+};
+
+// Transpose an HWC image into a CHW uint8 Datum, reading input channel
+// channel_swap[c] for output channel c. The datum's buffer is reused.
+static void HWCToDatum(const uint8_t* pixels, int height, int width,
+    int channels, const vector<int>& channel_swap, Datum* datum) {
+  datum->set_channels(channels);
+  datum->set_height(height);
+  datum->set_width(width);
+  datum->set_encoded(false);
+  string* buffer = datum->mutable_data();
+  buffer->resize(channels * height * width);
+  for (int c = 0; c < channels; ++c) {
+    const uint8_t* src = pixels + channel_swap[c];
+    char* dst = &(*buffer)[c * height * width];
+    for (int i = 0; i < height * width; ++i) {
+      dst[i] = static_cast<char>(src[i * channels]);
+    }
+  }
+}
+
+// Preprocess images[begin], images[begin + step], ... into their slots of
+// top_data. Runs without the GIL; each worker owns its transformer.
+static void PreprocessImages(const vector<ImageView>& images, int begin,
+    int step, const vector<int>& channel_swap, int resize_height,
+    int resize_width, DataTransformer<Dtype>* transformer,
+    const vector<int>& item_shape, Dtype* top_data) {
+  Blob<Dtype> transformed(item_shape);
+  Datum datum;
+  for (int i = begin; i < images.size(); i += step) {
+    const ImageView& image = images[i];
+    const uint8_t* pixels = image.data;
+    int height = image.height;
+    int width = image.width;
+#ifdef USE_OPENCV
+    cv::Mat resized;
+    if (resize_height > 0 &&
+        (height != resize_height || width != resize_width)) {
+      cv::Mat source(height, width, CV_8UC(image.channels),
+          const_cast<uint8_t*>(pixels));
+      cv::resize(source, resized, cv::Size(resize_width, resize_height));
+      pixels = resized.data;
+      height = resize_height;
+      width = resize_width;
+    }
+#endif  // USE_OPENCV
+    HWCToDatum(pixels, height, width, image.channels, channel_swap, &datum);
+    transformed.set_cpu_data(top_data + i * transformed.count());
+    transformer->Transform(datum, &transformed);
+  }
+}
+
+// Batch counterpart of caffe.io.Transformer.preprocess for uint8 HWC
+// images: resize (OpenCV builds only), HWC -> CHW with channel swap, then
+// DataTransformer's crop, mean subtraction and scaling, written straight
+// into the blob on num_threads threads with the GIL released. The blob is
+// reshaped to (len(images), channels, out_height, out_width), where the
+// output size is crop_size if set and otherwise the resize size.
+void Net_PreprocessBatch(Net<Dtype>* net, const string& blob_name,
+    bp::list images_list, int resize_height, int resize_width,
+    bp::object channel_swap_obj, Dtype scale, bp::object mean_value,
+    const string& mean_file, int crop_size, int num_threads) {
+  if (!net->has_blob(blob_name)) {
+    throw std::runtime_error("Net has no blob named " + blob_name);
+  }
+  const int num = bp::len(images_list);
+  if (num == 0) {
+    throw std::runtime_error("No images to preprocess");
+  }
+  // Resizing needs both sides; 0 for both keeps the images' size.
+  if (resize_height < 0 || resize_width < 0 ||
+      (resize_height > 0) != (resize_width > 0)) {
+    throw std::runtime_error(
+        "resize_height and resize_width must both be positive or both 0");
+  }
+  vector<ImageView> images(num);
+  for (int i = 0; i < num; ++i) {
+    bp::object image_obj = images_list[i];
+    if (!PyArray_Check(image_obj.ptr())) {
+      throw std::runtime_error("images must be numpy arrays");
+    }
+    PyArrayObject* arr = reinterpret_cast<PyArrayObject*>(image_obj.ptr());
+    if (!(PyArray_FLAGS(arr) & NPY_ARRAY_C_CONTIGUOUS)) {
+      throw std::runtime_error("images must be C contiguous");
+    }
+    if (PyArray_TYPE(arr) != NPY_UINT8) {
+      throw std::runtime_error("images must be uint8");
+    }
+    if (PyArray_NDIM(arr) != 2 && PyArray_NDIM(arr) != 3) {
+      throw std::runtime_error("images must be H x W or H x W x C");
+    }
+    images[i].data = static_cast<const uint8_t*>(PyArray_DATA(arr));
+    images[i].height = PyArray_DIMS(arr)[0];
+    images[i].width = PyArray_DIMS(arr)[1];
+    images[i].channels = PyArray_NDIM(arr) == 3 ? PyArray_DIMS(arr)[2] : 1;
+    if (images[i].channels != images[0].channels) {
+      throw std::runtime_error("images must all have the same channels");
+    }
+    const int height = resize_height > 0 ? resize_height : images[i].height;
+    const int width = resize_width > 0 ? resize_width : images[i].width;
+#ifndef USE_OPENCV
+    if (height != images[i].height || width != images[i].width) {
+      throw std::runtime_error("resizing images requires OpenCV");
+    }
+#endif  // USE_OPENCV
+    if (crop_size > height || crop_size > width) {
+      throw std::runtime_error("crop_size exceeds the image size");
+    }
+    if (!crop_size && (height != images[0].height ||
+        width != images[0].width) && resize_height <= 0) {
+      throw std::runtime_error("images must all have the same size");
+    }
+  }
+  const int channels = images[0].channels;
+  vector<int> channel_swap(channels);
+  for (int c = 0; c < channels; ++c) {
+    channel_swap[c] = c;
+  }
+  if (!channel_swap_obj.is_none()) {
+    if (bp::len(channel_swap_obj) != channels) {
+      throw std::runtime_error("channel_swap must list every channel");
+    }
+    for (int c = 0; c < channels; ++c) {
+      channel_swap[c] = bp::extract<int>(channel_swap_obj[c]);
+      if (channel_swap[c] < 0 || channel_swap[c] >= channels) {
+        throw std::runtime_error("channel_swap index out of range");
+      }
+    }
+  }
+
+  TransformationParameter param;
+  param.set_scale(scale);
+  param.set_crop_size(crop_size);
+  if (!mean_file.empty()) {
+    CheckFile(mean_file);
+    param.set_mean_file(mean_file);
+  }
+  if (!mean_value.is_none()) {
+    for (int c = 0; c < bp::len(mean_value); ++c) {
+      param.add_mean_value(bp::extract<float>(mean_value[c]));
+    }
+  }
+
+  vector<int> item_shape(4);
+  item_shape[0] = 1;
+  item_shape[1] = channels;
+  item_shape[2] = crop_size ? crop_size :
+      (resize_height > 0 ? resize_height : images[0].height);
+  item_shape[3] = crop_size ? crop_size :
+      (resize_width > 0 ? resize_width : images[0].width);
+  shared_ptr<Blob<Dtype> > blob = net->blob_by_name(blob_name);
+  vector<int> top_shape(item_shape);
+  top_shape[0] = num;
+  blob->Reshape(top_shape);
+  Dtype* top_data = blob->mutable_cpu_data();
+
+  num_threads = std::max(1, std::min(num_threads, num));
+  vector<shared_ptr<DataTransformer<Dtype> > > transformers(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    transformers[t].reset(new DataTransformer<Dtype>(param, TEST));
+  }
+  ScopedGILRelease nogil;
+  boost::thread_group workers;
+  for (int t = 1; t < num_threads; ++t) {
+    workers.create_thread(boost::bind(&PreprocessImages, boost::cref(images),
+        t, num_threads, boost::cref(channel_swap), resize_height,
+        resize_width, transformers[t].get(), boost::cref(item_shape),
+        top_data));
+  }
+  PreprocessImages(images, 0, num_threads, channel_swap, resize_height,
+      resize_width, transformers[0].get(), item_shape, top_data);
+  workers.join_all();
+}
+
 Solver<Dtype>* GetSolverFromFile(const string& filename) {
   SolverParameter param;
   ReadSolverParamsFromTextFileOrDie(filename, &param);
+  ApplyPythonContext();
   return SolverRegistry<Dtype>::CreateSolver(param);
 }
 
@@ -275,9 +682,11 @@ class PythonCallback: public Solver<Dtype>::Callback {
   PythonCallback(bp::object on_start, bp::object on_gradients_ready)
     : on_start_(on_start), on_gradients_ready_(on_gradients_ready) { }
   virtual void on_gradients_ready() {
+    ScopedGILAcquire gil;
     on_gradients_ready_();
   }
   virtual void on_start() {
+    ScopedGILAcquire gil;
     on_start_();
   }
 };
@@ -287,8 +696,6 @@ void Solver_add_callback(Solver<Dtype> * solver, bp::object on_start,
   solver->add_callback(new PythonCallback<Dtype>(on_start, on_gradients_ready));
 }
 
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SolveOverloads, Solve, 0, 1);
-
 BOOST_PYTHON_MODULE(_caffe) {
   // below, we prepend an underscore to methods that will be replaced
   // in Python
@@ -302,7 +709,8 @@ BOOST_PYTHON_MODULE(_caffe) {
   bp::def("set_mode_cpu", &set_mode_cpu);
   bp::def("set_mode_gpu", &set_mode_gpu);
   bp::def("set_random_seed", &set_random_seed);
-  bp::def("set_device", &Caffe::SetDevice);
+  bp::def("set_device", &set_device);
+  bp::def("has_gpu", &has_gpu);
 
   bp::def("layer_type_list", &LayerRegistry<Dtype>::LayerTypeList);
 
@@ -315,8 +723,8 @@ BOOST_PYTHON_MODULE(_caffe) {
             bp::arg("weights")=bp::object())))
     // Legacy constructor
     .def("__init__", bp::make_constructor(&Net_Init_Load))
-    .def("_forward", &Net<Dtype>::ForwardFromTo)
-    .def("_backward", &Net<Dtype>::BackwardFromTo)
+    .def("_forward", &Net_ForwardFromTo)
+    .def("_backward", &Net_BackwardFromTo)
     .def("reshape", &Net<Dtype>::Reshape)
     .def("clear_param_diffs", &Net<Dtype>::ClearParamDiffs)
     // The cast is to select a particular overload.
@@ -342,11 +750,15 @@ BOOST_PYTHON_MODULE(_caffe) {
     .add_property("_outputs",
         bp::make_function(&Net<Dtype>::output_blob_indices,
         bp::return_value_policy<bp::copy_const_reference>()))
+    .def("bind_input", &Net_BindInput)
+    .def("_preprocess_batch", &Net_PreprocessBatch)
     .def("_set_input_arrays", &Net_SetInputArrays,
         bp::with_custodian_and_ward<1, 2, bp::with_custodian_and_ward<1, 3> >())
     .def("save", &Net_Save)
     .def("save_hdf5", &Net_SaveHDF5)
-    .def("load_hdf5", &Net_LoadHDF5);
+    .def("load_hdf5", &Net_LoadHDF5)
+    .def("data_pipeline_stats", &Net_DataPipelineStats)
+    .def("reset_data_pipeline_stats", &Net_ResetDataPipelineStats);
   BP_REGISTER_SHARED_PTR_TO_PYTHON(Net<Dtype>);
 
   bp::class_<Blob<Dtype>, shared_ptr<Blob<Dtype> >, boost::noncopyable>(
@@ -387,9 +799,8 @@ BOOST_PYTHON_MODULE(_caffe) {
           bp::return_internal_reference<>()))
     .add_property("iter", &Solver<Dtype>::iter)
     .def("add_callback", &Solver_add_callback<Dtype>)
-    .def("solve", static_cast<void (Solver<Dtype>::*)(const char*)>(
-          &Solver<Dtype>::Solve), SolveOverloads())
-    .def("step", &Solver<Dtype>::Step)
+    .def("solve", &Solver_Solve, (bp::arg("resume_file")=bp::object()))
+    .def("step", &Solver_Step)
     .def("restore", &Solver<Dtype>::Restore)
     .def("snapshot", &Solver<Dtype>::Snapshot);
   BP_REGISTER_SHARED_PTR_TO_PYTHON(Solver<Dtype>);
@@ -412,6 +823,12 @@ BOOST_PYTHON_MODULE(_caffe) {
   bp::class_<AdamSolver<Dtype>, bp::bases<Solver<Dtype> >,
     shared_ptr<AdamSolver<Dtype> >, boost::noncopyable>(
         "AdamSolver", bp::init<string>());
+  bp::class_<LARSSolver<Dtype>, bp::bases<Solver<Dtype> >,
+    shared_ptr<LARSSolver<Dtype> >, boost::noncopyable>(
+        "LARSSolver", bp::init<string>());
+  bp::class_<LAMBSolver<Dtype>, bp::bases<Solver<Dtype> >,
+    shared_ptr<LAMBSolver<Dtype> >, boost::noncopyable>(
+        "LAMBSolver", bp::init<string>());
 
   bp::def("get_solver", &GetSolverFromFile,
       bp::return_value_policy<bp::manage_new_object>());
@@ -435,6 +852,12 @@ BOOST_PYTHON_MODULE(_caffe) {
   bp::class_<vector<bool> >("BoolVec")
     .def(bp::vector_indexing_suite<vector<bool> >());
 
+#if PY_VERSION_HEX < 0x03070000
+  // Make sure the GIL exists before any entry point tries to release it;
+  // Python >= 3.7 always creates it at startup.
+  PyEval_InitThreads();
+#endif
+
   // boost python expects a void (missing) return value, while import_array
   // returns NULL for python3. import_array1() forces a void return value.
   import_array1();
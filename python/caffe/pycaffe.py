@@ -8,10 +8,11 @@ try:
     from itertools import izip_longest
 except:
     from itertools import zip_longest as izip_longest
+import multiprocessing
 import numpy as np
 
 from ._caffe import Net, SGDSolver, NesterovSolver, AdaGradSolver, \
-        RMSPropSolver, AdaDeltaSolver, AdamSolver
+        RMSPropSolver, AdaDeltaSolver, AdamSolver, LARSSolver, LAMBSolver
 import caffe.io
 
 import six
@@ -259,6 +260,45 @@ def _Net_set_input_arrays(self, data, labels):
     return self._set_input_arrays(data, labels)
 
 
+def _Net_preprocess_batch(self, images, blob=None, resize=None,
+                          channel_swap=None, scale=1.0, mean_value=None,
+                          mean_file=None, crop_size=0, threads=None):
+    """
+    Preprocess a batch of uint8 H x W x C (or H x W) images straight into
+    an input blob in C++, in parallel and without holding the GIL.
+
+    Take
+    images: list of C contiguous uint8 arrays.
+    blob: name of the blob to fill; defaults to the first net input.
+    resize: (height, width) to resize to before cropping (needs OpenCV);
+        defaults to the blob's spatial shape unless crop_size is given.
+    channel_swap: input channel for each output channel, e.g. (2, 1, 0)
+        for RGB to BGR.
+    scale, mean_value, mean_file, crop_size: as in TransformationParameter;
+        the mean is in output channel order and subtracted before scaling.
+    threads: number of worker threads; defaults to the number of CPUs.
+
+    Give
+    data: the blob's data, shaped (len(images), C, H, W).
+    """
+    if blob is None:
+        blob = self.inputs[0]
+    if resize is None and not crop_size:
+        resize = list(self.blobs[blob].shape)[2:]
+    resize_height, resize_width = resize if resize is not None else (0, 0)
+    if threads is None:
+        threads = multiprocessing.cpu_count()
+    if channel_swap is not None:
+        channel_swap = [int(c) for c in channel_swap]
+    if mean_value is not None:
+        mean_value = [float(m) for m in np.ravel(mean_value)]
+    images = [np.ascontiguousarray(im) for im in images]
+    self._preprocess_batch(blob, images, resize_height, resize_width,
+                           channel_swap, scale, mean_value, mean_file or '',
+                           crop_size, threads)
+    return self.blobs[blob].data
+
+
 def _Net_batch(self, blobs):
     """
     Batch blob lists according to net's batch size.
@@ -327,6 +367,7 @@ Net.backward = _Net_backward
 Net.forward_all = _Net_forward_all
 Net.forward_backward_all = _Net_forward_backward_all
 Net.set_input_arrays = _Net_set_input_arrays
+Net.preprocess_batch = _Net_preprocess_batch
 Net._batch = _Net_batch
 Net.inputs = _Net_inputs
 Net.outputs = _Net_outputs
@@ -3,6 +3,7 @@ import tempfile
 import os
 import numpy as np
 import six
+import threading
 from collections import OrderedDict
 
 import caffe
@@ -64,6 +65,111 @@ class TestNet(unittest.TestCase):
         self.net.forward()
         self.net.backward()
 
+    def test_forward_backward_threads(self):
+        """Nets may run concurrently from Python threads, since forward and
+        backward release the GIL"""
+        net_file = simple_net_file(self.num_output)
+        nets = [caffe.Net(net_file, caffe.TRAIN) for _ in range(3)]
+        os.remove(net_file)
+        losses = [None] * len(nets)
+
+        def run(i):
+            nets[i].blobs['label'].data[...] = 0
+            for _ in range(5):
+                losses[i] = nets[i].forward()['loss']
+                nets[i].backward()
+
+        threads = [threading.Thread(target=run, args=(i,))
+                   for i in range(len(nets))]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        for loss in losses:
+            self.assertTrue(np.isfinite(loss))
+
+    def test_bind_input(self):
+        """Input blobs can be backed by a caller-owned array of any shape
+        without copying"""
+        with tempfile.NamedTemporaryFile(mode='w+', delete=False) as f:
+            f.write("""name: 'bindnet'
+            layer { type: 'Input' name: 'input' top: 'x'
+              input_param { shape { dim: 1 } } }
+            layer { type: 'Power' name: 'double' bottom: 'x' top: 'y'
+              power_param { scale: 2 } }""")
+        net = caffe.Net(f.name, caffe.TEST)
+        os.remove(f.name)
+        x = np.arange(24, dtype=np.float32).reshape(2, 3, 4)
+        net.bind_input('x', x)
+        del x  # the net keeps the array alive
+        net.reshape()
+        self.assertEqual(net.blobs['x'].data.shape, (2, 3, 4))
+        y = net.forward()['y']
+        np.testing.assert_array_equal(y, 2 * np.arange(24).reshape(2, 3, 4))
+        # Writes through the blob and the array are the same memory.
+        z = np.zeros(5, dtype=np.float32)
+        net.bind_input('x', z)
+        net.reshape()
+        z[...] = 3
+        np.testing.assert_array_equal(net.forward()['y'], 6 * np.ones(5))
+        self.assertRaises(RuntimeError, net.bind_input, 'y', z)
+        self.assertRaises(RuntimeError, net.bind_input, 'x', z[::2])
+        self.assertRaises(RuntimeError, net.bind_input, 'x',
+                          z.astype(np.float64))
+
+    @unittest.skipIf(not caffe.has_gpu(), 'no GPU available')
+    def test_bind_input_gpu(self):
+        """Writes to a bound array reach the device on every forward"""
+        with tempfile.NamedTemporaryFile(mode='w+', delete=False) as f:
+            f.write("""name: 'bindnet'
+            layer { type: 'Input' name: 'input' top: 'x'
+              input_param { shape { dim: 1 } } }
+            layer { type: 'Power' name: 'double' bottom: 'x' top: 'y'
+              power_param { scale: 2 } }""")
+        caffe.set_mode_gpu()
+        try:
+            net = caffe.Net(f.name, caffe.TEST)
+            os.remove(f.name)
+            x = np.ones(4, dtype=np.float32)
+            net.bind_input('x', x)
+            net.reshape()
+            np.testing.assert_array_equal(net.forward()['y'], 2 * np.ones(4))
+            x[...] = 5
+            np.testing.assert_array_equal(net.forward()['y'],
+                                          10 * np.ones(4))
+        finally:
+            caffe.set_mode_cpu()
+
+    def test_preprocess_batch(self):
+        with tempfile.NamedTemporaryFile(mode='w+', delete=False) as f:
+            f.write("""name: 'prepnet'
+            layer { type: 'Input' name: 'input' top: 'data'
+              input_param { shape { dim: 1 dim: 3 dim: 4 dim: 5 } } }""")
+        net = caffe.Net(f.name, caffe.TEST)
+        os.remove(f.name)
+        images = [np.random.randint(256, size=(4, 5, 3)).astype(np.uint8)
+                  for _ in range(7)]
+        mean = np.array([10, 20, 30], dtype=np.float32)
+        data = net.preprocess_batch(images, channel_swap=(2, 1, 0),
+                                    scale=0.5, mean_value=mean, threads=3)
+        self.assertEqual(data.shape, (7, 3, 4, 5))
+        for im, out in zip(images, data):
+            expected = im.transpose(2, 0, 1)[[2, 1, 0]].astype(np.float32)
+            expected = (expected - mean[:, None, None]) * 0.5
+            np.testing.assert_allclose(out, expected)
+        # Center crop without resizing.
+        data = net.preprocess_batch(images[:2], crop_size=3)
+        self.assertEqual(data.shape, (2, 3, 3, 3))
+        np.testing.assert_array_equal(
+            data[1], images[1].transpose(2, 0, 1)[:, 0:3, 1:4])
+        self.assertRaises(RuntimeError, net.preprocess_batch,
+                          [im.astype(np.float32) for im in images])
+        # Resizing one side only.
+        self.assertRaises(RuntimeError, net.preprocess_batch, images,
+                          resize=(4, 0))
+        self.assertRaises(RuntimeError, net.preprocess_batch, images,
+                          resize=(0, 5))
+
     def test_clear_param_diffs(self):
         # Run a forward/backward step to have non-zero diffs
         self.net.forward()
@@ -75,6 +181,12 @@ class TestNet(unittest.TestCase):
         # Check that the diffs are now 0
         self.assertTrue((diff == 0).all())
 
+    def test_data_pipeline_stats(self):
+        # DummyData does not prefetch, so there is nothing to report
+        self.net.forward()
+        self.assertEqual(self.net.data_pipeline_stats(), {})
+        self.net.reset_data_pipeline_stats()
+
     def test_inputs_outputs(self):
         self.assertEqual(self.net.inputs, [])
         self.assertEqual(self.net.outputs, ['loss'])
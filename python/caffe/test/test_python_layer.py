@@ -2,6 +2,7 @@ import unittest
 import tempfile
 import os
 import six
+import threading
 
 import caffe
 
@@ -119,6 +120,20 @@ class TestPythonLayer(unittest.TestCase):
         for y in self.net.blobs['data'].diff.flat:
             self.assertEqual(y, 10**3 * x)
 
+    def test_forward_backward_thread(self):
+        # Python layers must reacquire the GIL released by forward/backward.
+        x = 3
+        self.net.blobs['data'].data[...] = x
+        self.net.blobs['three'].diff[...] = x
+        t = threading.Thread(target=lambda: (self.net.forward(),
+                                             self.net.backward()))
+        t.start()
+        t.join()
+        for y in self.net.blobs['three'].data.flat:
+            self.assertEqual(y, 10**3 * x)
+        for y in self.net.blobs['data'].diff.flat:
+            self.assertEqual(y, 10**3 * x)
+
     def test_reshape(self):
         s = 4
         self.net.blobs['data'].reshape(s, s, s, s)
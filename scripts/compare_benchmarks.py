@@ -0,0 +1,92 @@
+#!/usr/bin/env python
+"""
+Compares two result files written by `caffe_benchmarks --json=...`, e.g. of
+the parent commit and of a change, and reports the benchmarks that got
+slower (or faster) by more than a threshold.
+
+Exits with status 1 if any benchmark regressed, so it can gate a build.
+"""
+from __future__ import print_function
+
+import argparse
+import json
+import sys
+
+
+def load_results(filename):
+    with open(filename) as f:
+        results = json.load(f)
+    return results.get('context', {}), \
+        dict((b['name'], b) for b in results['benchmarks'])
+
+
+def describe(context):
+    parts = [context.get(key) for key in ('label', 'caffe_version', 'date')]
+    return ' '.join(str(part) for part in parts if part)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Compare two caffe_benchmarks JSON result files.')
+    parser.add_argument('baseline', help='results of the reference build')
+    parser.add_argument('contender', help='results of the build to check')
+    parser.add_argument('--metric', default='median_us',
+                        choices=['median_us', 'mean_us', 'min_us'],
+                        help='time per call to compare (default: %(default)s)')
+    parser.add_argument('--threshold', type=float, default=0.05,
+                        help='relative slowdown reported as a regression '
+                        '(default: %(default)s)')
+    parser.add_argument('--all', action='store_true',
+                        help='print every benchmark, not only the changes')
+    parser.add_argument('--no-fail', action='store_true',
+                        help='always exit with status 0')
+    args = parser.parse_args()
+
+    base_context, base = load_results(args.baseline)
+    new_context, new = load_results(args.contender)
+    print('baseline:  %s' % describe(base_context))
+    print('contender: %s' % describe(new_context))
+    if base_context.get('batch_size') != new_context.get('batch_size'):
+        print('warning: the layer benchmarks used different batch sizes')
+
+    regressions = []
+    improvements = []
+    rows = []
+    for name in sorted(set(base) & set(new)):
+        before = base[name][args.metric]
+        after = new[name][args.metric]
+        if before <= 0:
+            continue
+        change = after / before - 1
+        if change > args.threshold:
+            regressions.append(name)
+            status = 'SLOWER'
+        elif change < -args.threshold:
+            improvements.append(name)
+            status = 'faster'
+        else:
+            status = ''
+        if status or args.all:
+            rows.append((name, before, after, change, status))
+
+    if rows:
+        width = max(len(row[0]) for row in rows)
+        print('\n%-*s %14s %14s %8s' % (width, 'benchmark', 'baseline',
+                                         'contender', 'change'))
+        for name, before, after, change, status in rows:
+            print('%-*s %14.2f %14.2f %+7.1f%% %s' % (
+                width, name, before, after, 100 * change, status))
+    for name in sorted(set(base) - set(new)):
+        print('only in baseline: %s' % name)
+    for name in sorted(set(new) - set(base)):
+        print('only in contender: %s' % name)
+
+    print('\n%d compared, %d slower and %d faster by more than %.1f%% (%s)' % (
+        len(set(base) & set(new)), len(regressions), len(improvements),
+        100 * args.threshold, args.metric))
+    if regressions and not args.no_fail:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
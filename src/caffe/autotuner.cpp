@@ -0,0 +1,218 @@
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/autotuner.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/io.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+// The passes timed per candidate, after one to warm up.
+static const int kTimedPasses = 3;
+
+// Serializes the tuning of the nets of the process, which would otherwise
+// time their layers against each other and overwrite each other's results.
+static boost::mutex tune_mutex;
+
+template <typename Dtype>
+Autotuner<Dtype>::Autotuner(const string& cache_file)
+    : cache_file_(cache_file), cpu_model_(CpuModel()) {
+  Load();
+}
+
+template <typename Dtype>
+void Autotuner<Dtype>::Load() {
+  cache_.Clear();
+  index_.clear();
+  if (!cache_file_.empty() && boost::filesystem::exists(cache_file_)) {
+    CHECK(ReadProtoFromTextFile(cache_file_, &cache_))
+        << "Failed to parse autotune cache " << cache_file_;
+  }
+  for (int i = 0; i < cache_.result_size(); ++i) {
+    if (cache_.result(i).cpu() == cpu_model_) {
+      index_[cache_.result(i).layer()] = i;
+    }
+  }
+}
+
+template <typename Dtype>
+void Autotuner<Dtype>::Save() const {
+  // Write a temporary file and rename it over the cache, so that other
+  // processes never read a partial file.
+  const string temp_file = boost::filesystem::unique_path(
+      cache_file_ + ".%%%%-%%%%-%%%%").string();
+  WriteProtoToTextFile(cache_, temp_file);
+  boost::filesystem::rename(temp_file, cache_file_);
+}
+
+template <typename Dtype>
+string Autotuner<Dtype>::CpuModel() {
+  string model = "unknown";
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  string line;
+  while (std::getline(cpuinfo, line)) {
+    if (line.compare(0, 10, "model name") == 0) {
+      const size_t colon = line.find(':');
+      if (colon != string::npos && colon + 2 <= line.size()) {
+        model = line.substr(colon + 2);
+      }
+      break;
+    }
+  }
+  ostringstream stream;
+  stream << model << " (" << boost::thread::hardware_concurrency()
+      << " threads)";
+  return stream.str();
+}
+
+template <typename Dtype>
+string Autotuner<Dtype>::LayerKey(const Layer<Dtype>& layer,
+    const vector<Blob<Dtype>*>& bottom) {
+  // Keep only what determines the computation: not the names, the learned
+  // parameters, their fillers or the training settings.
+  LayerParameter param(layer.layer_param());
+  param.clear_name();
+  param.clear_bottom();
+  param.clear_top();
+  param.clear_loss_weight();
+  param.clear_param();
+  param.clear_blobs();
+  param.clear_propagate_down();
+  param.clear_include();
+  param.clear_exclude();
+  const google::protobuf::Reflection* reflection = param.GetReflection();
+  vector<const google::protobuf::FieldDescriptor*> fields;
+  reflection->ListFields(param, &fields);
+  for (int i = 0; i < fields.size(); ++i) {
+    if (fields[i]->type() != google::protobuf::FieldDescriptor::TYPE_MESSAGE
+        || fields[i]->is_repeated()) {
+      continue;
+    }
+    google::protobuf::Message* message =
+        reflection->MutableMessage(&param, fields[i]);
+    const char* fillers[] = { "weight_filler", "bias_filler" };
+    for (int j = 0; j < 2; ++j) {
+      const google::protobuf::FieldDescriptor* filler =
+          message->GetDescriptor()->FindFieldByName(fillers[j]);
+      if (filler) {
+        message->GetReflection()->ClearField(message, filler);
+      }
+    }
+  }
+  string key = param.ShortDebugString();
+  for (int i = 0; i < bottom.size(); ++i) {
+    key += " bottom: " + bottom[i]->shape_string();
+  }
+  return key;
+}
+
+template <typename Dtype>
+void Autotuner<Dtype>::Tune(Net<Dtype>* net) {
+  boost::lock_guard<boost::mutex> lock(tune_mutex);
+  // Another net may have saved results since construction.
+  Load();
+  bool tuned = false;
+  for (int i = 0; i < net->layers().size(); ++i) {
+    Layer<Dtype>* layer = net->layers()[i].get();
+    if (layer->cpu_algorithms().empty()) {
+      continue;
+    }
+    const string key = LayerKey(*layer, net->bottom_vecs()[i]);
+    if (!index_.count(key)) {
+      AutotuneResult result = TuneLayer(net, i);
+      result.set_cpu(cpu_model_);
+      result.set_layer(key);
+      LOG_IF(INFO, Caffe::root_solver()) << "Autotuned "
+          << net->layer_names()[i] << ": " << result.algorithm() << " with "
+          << result.threads() << " BLAS threads, " << result.time_us()
+          << " us";
+      index_[key] = cache_.result_size();
+      *cache_.add_result() = result;
+      tuned = true;
+    }
+    Apply(cache_.result(index_[key]), layer);
+  }
+  if (tuned && !cache_file_.empty()) {
+    Save();
+  }
+}
+
+template <typename Dtype>
+AutotuneResult Autotuner<Dtype>::TuneLayer(Net<Dtype>* net, int layer_id) {
+  Layer<Dtype>* layer = net->layers()[layer_id].get();
+  const vector<string> algorithms = layer->cpu_algorithms();
+  vector<int> threads;
+  const int max_threads = caffe_blas_threads();
+  if (caffe_has_local_blas_threads()) {
+    for (int t = 1; t < max_threads; t *= 2) {
+      threads.push_back(t);
+    }
+  }
+  threads.push_back(max_threads);
+  AutotuneResult best;
+  for (int a = 0; a < algorithms.size(); ++a) {
+    for (int t = 0; t < threads.size(); ++t) {
+      layer->set_cpu_algorithm(a);
+      layer->set_cpu_threads(threads[t]);
+      const float time = TimeLayer(net, layer_id);
+      if (!best.has_time_us() || time < best.time_us()) {
+        best.set_algorithm(algorithms[a]);
+        best.set_threads(threads[t]);
+        best.set_time_us(time);
+      }
+    }
+  }
+  // The passes accumulated into the parameter gradients.
+  for (int i = 0; i < layer->blobs().size(); ++i) {
+    Blob<Dtype>* blob = layer->blobs()[i].get();
+    caffe_set(blob->count(), Dtype(0), blob->mutable_cpu_diff());
+  }
+  return best;
+}
+
+template <typename Dtype>
+float Autotuner<Dtype>::TimeLayer(Net<Dtype>* net, int layer_id) {
+  Layer<Dtype>* layer = net->layers()[layer_id].get();
+  const vector<Blob<Dtype>*>& bottom = net->bottom_vecs()[layer_id];
+  const vector<Blob<Dtype>*>& top = net->top_vecs()[layer_id];
+  const bool backward = net->layer_need_backward()[layer_id];
+  CPUTimer timer;
+  float fastest = 0;
+  for (int pass = 0; pass <= kTimedPasses; ++pass) {
+    timer.Start();
+    layer->Forward(bottom, top);
+    if (backward) {
+      layer->Backward(top, net->bottom_need_backward()[layer_id], bottom);
+    }
+    timer.Stop();
+    if (pass == 1 || (pass > 1 && timer.MicroSeconds() < fastest)) {
+      fastest = timer.MicroSeconds();
+    }
+  }
+  return fastest;
+}
+
+template <typename Dtype>
+void Autotuner<Dtype>::Apply(const AutotuneResult& result,
+    Layer<Dtype>* layer) {
+  const vector<string> algorithms = layer->cpu_algorithms();
+  for (int i = 0; i < algorithms.size(); ++i) {
+    if (algorithms[i] == result.algorithm()) {
+      layer->set_cpu_algorithm(i);
+      layer->set_cpu_threads(result.threads());
+      return;
+    }
+  }
+  LOG(WARNING) << "Ignoring the autotuned " << layer->layer_param().name()
+      << " implementation " << result.algorithm() << ", which it lacks";
+}
+
+INSTANTIATE_CLASS(Autotuner);
+
+}  // namespace caffe
@@ -41,6 +41,15 @@ void Blob<Dtype>::Reshape(const vector<int>& shape) {
     capacity_ = count_;
     data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
     diff_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+  } else {
+    // The data or diff was bound via ShareDataMemory / ShareDiffMemory to a
+    // buffer smaller than the capacity.
+    if (data_ && data_->size() < count_ * sizeof(Dtype)) {
+      data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+    }
+    if (diff_ && diff_->size() < count_ * sizeof(Dtype)) {
+      diff_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+    }
   }
 }
 
@@ -146,6 +155,20 @@ void Blob<Dtype>::ShareDiff(const Blob& other) {
   diff_ = other.diff();
 }
 
+template <typename Dtype>
+void Blob<Dtype>::ShareDataMemory(const shared_ptr<SyncedMemory>& data) {
+  CHECK(data);
+  CHECK_GE(data->size(), count_ * sizeof(Dtype));
+  data_ = data;
+}
+
+template <typename Dtype>
+void Blob<Dtype>::ShareDiffMemory(const shared_ptr<SyncedMemory>& diff) {
+  CHECK(diff);
+  CHECK_GE(diff->size(), count_ * sizeof(Dtype));
+  diff_ = diff;
+}
+
 // The "update" method is used for parameter blobs in a Net, which are stored
 // as Blob<float> or Blob<double> -- hence we do not define it for
 // Blob<int> or Blob<unsigned int>.
@@ -49,6 +49,17 @@ void GlobalInit(int* pargc, char*** pargv) {
   ::google::InstallFailureSignalHandler();
 }
 
+// Process-wide, unlike the rest of the Caffe state.
+static string autotune_cache_;
+
+const string& Caffe::autotune_cache() {
+  return autotune_cache_;
+}
+
+void Caffe::set_autotune_cache(const string& path) {
+  autotune_cache_ = path;
+}
+
 #ifdef CPU_ONLY  // CPU-only Caffe.
 
 Caffe::Caffe()
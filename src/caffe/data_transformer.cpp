@@ -2,6 +2,7 @@
 #include <opencv2/core/core.hpp>
 #endif  // USE_OPENCV
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -9,6 +10,7 @@
 #include "caffe/util/io.hpp"
 #include "caffe/util/math_functions.hpp"
 #include "caffe/util/rng.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
@@ -93,10 +95,14 @@ void DataTransformer<Dtype>::Transform(const Datum& datum,
     }
   }
 
-  Dtype datum_element;
-  int top_index, data_index;
-  for (int c = 0; c < datum_channels; ++c) {
-    for (int h = 0; h < height; ++h) {
+  // The rows of all channels are transformed in parallel.
+  parallel_for(datum_channels * height, std::max(kParallelGrain / width, 1),
+      [&](int begin, int end) {
+    Dtype datum_element;
+    int top_index, data_index;
+    for (int row = begin; row < end; ++row) {
+      const int c = row / height;
+      const int h = row % height;
       for (int w = 0; w < width; ++w) {
         data_index = (c * datum_height + h_off + h) * datum_width + w_off + w;
         if (do_mirror) {
@@ -123,7 +129,7 @@ void DataTransformer<Dtype>::Transform(const Datum& datum,
         }
       }
     }
-  }
+  });
 }
 
 
@@ -133,17 +139,8 @@ void DataTransformer<Dtype>::Transform(const Datum& datum,
   // If datum is encoded, decoded and transform the cv::image.
   if (datum.encoded()) {
 #ifdef USE_OPENCV
-    CHECK(!(param_.force_color() && param_.force_gray()))
-        << "cannot set both force_color and force_gray";
-    cv::Mat cv_img;
-    if (param_.force_color() || param_.force_gray()) {
-    // If force_color then decode in color otherwise decode in gray.
-      cv_img = DecodeDatumToCVMat(datum, param_.force_color());
-    } else {
-      cv_img = DecodeDatumToCVMatNative(datum);
-    }
     // Transform the cv::image into blob.
-    return Transform(cv_img, transformed_blob);
+    return Transform(Decode(datum), transformed_blob);
 #else
     LOG(FATAL) << "Encoded datum requires OpenCV; compile with USE_OPENCV.";
 #endif  // USE_OPENCV
@@ -202,6 +199,18 @@ void DataTransformer<Dtype>::Transform(const vector<Datum> & datum_vector,
 }
 
 #ifdef USE_OPENCV
+template<typename Dtype>
+cv::Mat DataTransformer<Dtype>::Decode(const Datum& datum) {
+  CHECK(datum.encoded()) << "Datum is not encoded";
+  CHECK(!(param_.force_color() && param_.force_gray()))
+      << "cannot set both force_color and force_gray";
+  if (param_.force_color() || param_.force_gray()) {
+    // If force_color then decode in color otherwise decode in gray.
+    return DecodeDatumToCVMat(datum, param_.force_color());
+  }
+  return DecodeDatumToCVMatNative(datum);
+}
+
 template<typename Dtype>
 void DataTransformer<Dtype>::Transform(const vector<cv::Mat> & mat_vector,
                                        Blob<Dtype>* transformed_blob) {
@@ -294,34 +303,39 @@ void DataTransformer<Dtype>::Transform(const cv::Mat& cv_img,
   CHECK(cv_cropped_img.data);
 
   Dtype* transformed_data = transformed_blob->mutable_cpu_data();
-  int top_index;
-  for (int h = 0; h < height; ++h) {
-    const uchar* ptr = cv_cropped_img.ptr<uchar>(h);
-    int img_index = 0;
-    for (int w = 0; w < width; ++w) {
-      for (int c = 0; c < img_channels; ++c) {
-        if (do_mirror) {
-          top_index = (c * height + h) * width + (width - 1 - w);
-        } else {
-          top_index = (c * height + h) * width + w;
-        }
-        // int top_index = (c * height + h) * width + w;
-        Dtype pixel = static_cast<Dtype>(ptr[img_index++]);
-        if (has_mean_file) {
-          int mean_index = (c * img_height + h_off + h) * img_width + w_off + w;
-          transformed_data[top_index] =
-            (pixel - mean[mean_index]) * scale;
-        } else {
-          if (has_mean_values) {
+  // The rows are transformed in parallel.
+  parallel_for(height, std::max(kParallelGrain / (width * img_channels), 1),
+      [&](int begin, int end) {
+    int top_index;
+    for (int h = begin; h < end; ++h) {
+      const uchar* ptr = cv_cropped_img.ptr<uchar>(h);
+      int img_index = 0;
+      for (int w = 0; w < width; ++w) {
+        for (int c = 0; c < img_channels; ++c) {
+          if (do_mirror) {
+            top_index = (c * height + h) * width + (width - 1 - w);
+          } else {
+            top_index = (c * height + h) * width + w;
+          }
+          // int top_index = (c * height + h) * width + w;
+          Dtype pixel = static_cast<Dtype>(ptr[img_index++]);
+          if (has_mean_file) {
+            int mean_index =
+                (c * img_height + h_off + h) * img_width + w_off + w;
             transformed_data[top_index] =
-              (pixel - mean_values_[c]) * scale;
+              (pixel - mean[mean_index]) * scale;
           } else {
-            transformed_data[top_index] = pixel * scale;
+            if (has_mean_values) {
+              transformed_data[top_index] =
+                (pixel - mean_values_[c]) * scale;
+            } else {
+              transformed_data[top_index] = pixel * scale;
+            }
           }
         }
       }
     }
-  }
+  });
 }
 #endif  // USE_OPENCV
 
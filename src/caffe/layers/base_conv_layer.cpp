@@ -271,6 +271,46 @@ void BaseConvolutionLayer<Dtype>::forward_cpu_gemm(const Dtype* input,
   }
 }
 
+// Largest number of column buffer elements forward_cpu_gemm_batched computes
+// at once.
+const int kMaxBatchedColSize = 1 << 22;
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::forward_cpu_gemm_batched(const Dtype* input,
+    const Dtype* weights, Dtype* output) {
+  CHECK(can_batch_gemm());
+  const int spatial_dim = conv_out_spatial_dim_;
+  const int batch = std::max(1, std::min(num_,
+      kMaxBatchedColSize / (kernel_dim_ * spatial_dim)));
+  batched_col_buffer_.Reshape(1, 1, kernel_dim_, batch * spatial_dim);
+  batched_output_.Reshape(1, 1, conv_out_channels_, batch * spatial_dim);
+  Dtype* batch_col = batched_col_buffer_.mutable_cpu_data();
+  Dtype* batch_output = batched_output_.mutable_cpu_data();
+  for (int n_start = 0; n_start < num_; n_start += batch) {
+    const int images = std::min(batch, num_ - n_start);
+    const int batch_dim = images * spatial_dim;
+    // Image n fills columns [n * spatial_dim, (n + 1) * spatial_dim).
+    for (int n = 0; n < images; ++n) {
+      Dtype* col_buff = col_buffer_.mutable_cpu_data();
+      conv_im2col_cpu(input + (n_start + n) * bottom_dim_, col_buff);
+      for (int k = 0; k < kernel_dim_; ++k) {
+        caffe_copy(spatial_dim, col_buff + k * spatial_dim,
+            batch_col + k * batch_dim + n * spatial_dim);
+      }
+    }
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, conv_out_channels_,
+        batch_dim, kernel_dim_, (Dtype)1., weights, batch_col,
+        (Dtype)0., batch_output);
+    for (int n = 0; n < images; ++n) {
+      Dtype* image_output = output + (n_start + n) * top_dim_;
+      for (int c = 0; c < conv_out_channels_; ++c) {
+        caffe_copy(spatial_dim, batch_output + c * batch_dim + n * spatial_dim,
+            image_output + c * spatial_dim);
+      }
+    }
+  }
+}
+
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::forward_cpu_bias(Dtype* output,
     const Dtype* bias) {
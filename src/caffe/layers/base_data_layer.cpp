@@ -1,4 +1,7 @@
 #include <boost/thread.hpp>
+#include <iomanip>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -7,10 +10,24 @@
 #include "caffe/layer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
-#include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/spsc_queue.hpp"
 
 namespace caffe {
 
+string DataPipelineStats::Summary() const {
+  std::ostringstream summary;
+  summary << std::fixed << std::setprecision(2) << wait_us.count()
+      << " batches, mean/p99 ms: read " << read_us.mean() / 1000 << "/"
+      << read_us.Percentile(0.99) / 1000 << ", decode "
+      << decode_us.mean() / 1000 << "/" << decode_us.Percentile(0.99) / 1000
+      << ", transform " << transform_us.mean() / 1000 << "/"
+      << transform_us.Percentile(0.99) / 1000 << ", wait "
+      << wait_us.mean() / 1000 << "/" << wait_us.Percentile(0.99) / 1000
+      << "; batches ready " << queue_depth.mean();
+  return summary.str();
+}
+
 template <typename Dtype>
 BaseDataLayer<Dtype>::BaseDataLayer(const LayerParameter& param)
     : Layer<Dtype>(param),
@@ -36,7 +53,8 @@ template <typename Dtype>
 BasePrefetchingDataLayer<Dtype>::BasePrefetchingDataLayer(
     const LayerParameter& param)
     : BaseDataLayer<Dtype>(param),
-      prefetch_free_(), prefetch_full_() {
+      prefetch_free_(PREFETCH_COUNT), prefetch_full_(PREFETCH_COUNT),
+      stats_mutex_(new boost::mutex()) {
   for (int i = 0; i < PREFETCH_COUNT; ++i) {
     prefetch_free_.push(&prefetch_[i]);
   }
@@ -101,10 +119,44 @@ void BasePrefetchingDataLayer<Dtype>::InternalThreadEntry() {
 #endif
 }
 
+template <typename Dtype>
+Batch<Dtype>* BasePrefetchingDataLayer<Dtype>::NextBatch() {
+  const int queue_depth = prefetch_full_.size();
+  CPUTimer timer;
+  timer.Start();
+  Batch<Dtype>* batch = prefetch_full_.pop("Data layer prefetch queue empty");
+  const double wait_us = timer.MicroSeconds();
+  boost::mutex::scoped_lock lock(*stats_mutex_);
+  stats_.wait_us.Add(wait_us);
+  stats_.queue_depth.Add(queue_depth);
+  return batch;
+}
+
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::RecordBatchTimes(double read_us,
+    double decode_us, double transform_us) {
+  boost::mutex::scoped_lock lock(*stats_mutex_);
+  stats_.read_us.Add(read_us);
+  stats_.decode_us.Add(decode_us);
+  stats_.transform_us.Add(transform_us);
+}
+
+template <typename Dtype>
+DataPipelineStats BasePrefetchingDataLayer<Dtype>::pipeline_stats() const {
+  boost::mutex::scoped_lock lock(*stats_mutex_);
+  return stats_;
+}
+
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::ResetPipelineStats() {
+  boost::mutex::scoped_lock lock(*stats_mutex_);
+  stats_ = DataPipelineStats();
+}
+
 template <typename Dtype>
 void BasePrefetchingDataLayer<Dtype>::Forward_cpu(
     const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
-  Batch<Dtype>* batch = prefetch_full_.pop("Data layer prefetch queue empty");
+  Batch<Dtype>* batch = NextBatch();
   // Reshape to loaded data.
   top[0]->ReshapeLike(batch->data_);
   // Copy the data
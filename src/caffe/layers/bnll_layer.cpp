@@ -1,23 +1,36 @@
 #include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "caffe/layers/bnll_layer.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
-const float kBNLL_THRESHOLD = 50.;
-
 template <typename Dtype>
 void BNLLLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
   const int count = bottom[0]->count();
-  for (int i = 0; i < count; ++i) {
-    top_data[i] = bottom_data[i] > 0 ?
-        bottom_data[i] + log(1. + exp(-bottom_data[i])) :
-        log(1. + exp(bottom_data[i]));
-  }
+  // max(x, 0) + log(1 + exp(-|x|)), with the transcendentals vectorized
+  // over blocks on the side, as the layer may run in place.
+  parallel_for(count, [=](int begin, int end) {
+    Dtype softplus[kVectorBlock];
+    for (int block = begin; block < end; block += kVectorBlock) {
+      const int size = std::min(end - block, kVectorBlock);
+      for (int i = 0; i < size; ++i) {
+        softplus[i] = -std::abs(bottom_data[block + i]);
+      }
+      caffe_exp(size, softplus, softplus);
+      caffe_log1p(size, softplus, softplus);
+      for (int i = 0; i < size; ++i) {
+        top_data[block + i] =
+            std::max(bottom_data[block + i], Dtype(0)) + softplus[i];
+      }
+    }
+  });
 }
 
 template <typename Dtype>
@@ -29,11 +42,17 @@ void BNLLLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     const Dtype* top_diff = top[0]->cpu_diff();
     Dtype* bottom_diff = bottom[0]->mutable_cpu_diff();
     const int count = bottom[0]->count();
-    Dtype expval;
-    for (int i = 0; i < count; ++i) {
-      expval = exp(std::min(bottom_data[i], Dtype(kBNLL_THRESHOLD)));
-      bottom_diff[i] = top_diff[i] * expval / (expval + 1.);
-    }
+    // The derivative is the sigmoid.
+    parallel_for(count, [=](int begin, int end) {
+      Dtype sigmoid[kVectorBlock];
+      for (int block = begin; block < end; block += kVectorBlock) {
+        const int size = std::min(end - block, kVectorBlock);
+        caffe_sigmoid(size, bottom_data + block, sigmoid);
+        for (int i = 0; i < size; ++i) {
+          bottom_diff[block + i] = top_diff[block + i] * sigmoid[i];
+        }
+      }
+    });
   }
 }
 
@@ -1,3 +1,4 @@
+#include <string>
 #include <vector>
 
 #include "caffe/layers/conv_layer.hpp"
@@ -21,16 +22,32 @@ void ConvolutionLayer<Dtype>::compute_output_shape() {
   }
 }
 
+template <typename Dtype>
+vector<string> ConvolutionLayer<Dtype>::cpu_algorithms() const {
+  vector<string> algorithms(1, "gemm");
+  if (this->can_batch_gemm() && this->num_ > 1) {
+    algorithms.push_back("batched_gemm");
+  }
+  return algorithms;
+}
+
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   const Dtype* weight = this->blobs_[0]->cpu_data();
+  const bool use_batched = this->cpu_algorithm_ == BATCHED_GEMM &&
+      this->can_batch_gemm();
   for (int i = 0; i < bottom.size(); ++i) {
     const Dtype* bottom_data = bottom[i]->cpu_data();
     Dtype* top_data = top[i]->mutable_cpu_data();
+    if (use_batched) {
+      this->forward_cpu_gemm_batched(bottom_data, weight, top_data);
+    }
     for (int n = 0; n < this->num_; ++n) {
-      this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
-          top_data + n * this->top_dim_);
+      if (!use_batched) {
+        this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
+            top_data + n * this->top_dim_);
+      }
       if (this->bias_term_) {
         const Dtype* bias = this->blobs_[1]->cpu_data();
         this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
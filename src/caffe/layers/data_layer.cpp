@@ -57,6 +57,7 @@ void DataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   CPUTimer batch_timer;
   batch_timer.Start();
   double read_time = 0;
+  double decode_time = 0;
   double trans_time = 0;
   CPUTimer timer;
   CHECK(batch->data_.count());
@@ -79,29 +80,50 @@ void DataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   if (this->output_labels_) {
     top_label = batch->label_.mutable_cpu_data();
   }
-  for (int item_id = 0; item_id < batch_size; ++item_id) {
+  vector<Datum*> datums;
+  int item_id = 0;
+  while (item_id < batch_size) {
     timer.Start();
-    // get a datum
-    Datum& datum = *(reader_.full().pop("Waiting for data"));
+    // get as many datums as are ready, up to the rest of the batch
+    reader_.full().pop(batch_size - item_id, &datums, "Waiting for data");
     read_time += timer.MicroSeconds();
-    timer.Start();
-    // Apply data transformations (mirror, scale, crop...)
-    int offset = batch->data_.offset(item_id);
-    this->transformed_data_.set_cpu_data(top_data + offset);
-    this->data_transformer_->Transform(datum, &(this->transformed_data_));
-    // Copy label.
-    if (this->output_labels_) {
-      top_label[item_id] = datum.label();
+    for (int i = 0; i < datums.size(); ++i, ++item_id) {
+      // Apply data transformations (mirror, scale, crop...)
+      int offset = batch->data_.offset(item_id);
+      this->transformed_data_.set_cpu_data(top_data + offset);
+#ifdef USE_OPENCV
+      if (datums[i]->encoded()) {
+        timer.Start();
+        cv::Mat cv_img = this->data_transformer_->Decode(*datums[i]);
+        decode_time += timer.MicroSeconds();
+        timer.Start();
+        this->data_transformer_->Transform(cv_img,
+            &(this->transformed_data_));
+        trans_time += timer.MicroSeconds();
+      } else {
+#endif  // USE_OPENCV
+        timer.Start();
+        this->data_transformer_->Transform(*datums[i],
+            &(this->transformed_data_));
+        trans_time += timer.MicroSeconds();
+#ifdef USE_OPENCV
+      }
+#endif  // USE_OPENCV
+      // Copy label.
+      if (this->output_labels_) {
+        top_label[item_id] = datums[i]->label();
+      }
     }
-    trans_time += timer.MicroSeconds();
 
-    reader_.free().push(const_cast<Datum*>(&datum));
+    reader_.free().push(datums);
   }
   timer.Stop();
   batch_timer.Stop();
   DLOG(INFO) << "Prefetch batch: " << batch_timer.MilliSeconds() << " ms.";
   DLOG(INFO) << "     Read time: " << read_time / 1000 << " ms.";
+  DLOG(INFO) << "   Decode time: " << decode_time / 1000 << " ms.";
   DLOG(INFO) << "Transform time: " << trans_time / 1000 << " ms.";
+  this->RecordBatchTimes(read_time, decode_time, trans_time);
 }
 
 INSTANTIATE_CLASS(DataLayer);
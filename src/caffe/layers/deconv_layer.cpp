@@ -1,9 +1,17 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
 #include <vector>
 
 #include "caffe/layers/deconv_layer.hpp"
+#include "caffe/util/math_functions.hpp"
 
 namespace caffe {
 
+// Largest number of column buffer elements computed at once by the tiled
+// forward pass. Layers whose whole column buffer fits use the plain GEMM path.
+const int kMaxColTileSize = 1 << 18;
+
 template <typename Dtype>
 void DeconvolutionLayer<Dtype>::compute_output_shape() {
   const int* kernel_shape_data = this->kernel_shape_.cpu_data();
@@ -21,18 +29,190 @@ void DeconvolutionLayer<Dtype>::compute_output_shape() {
   }
 }
 
+template <typename Dtype>
+void DeconvolutionLayer<Dtype>::forward_cpu_tiled(const Dtype* input,
+    const Dtype* weights, const Dtype* bias, Dtype* output) {
+  const int* kernel_shape = this->kernel_shape_.cpu_data();
+  const int* stride = this->stride_.cpu_data();
+  const int* pad = this->pad_.cpu_data();
+  const int* dilation = this->dilation_.cpu_data();
+  const int height = this->input_shape(1);
+  const int width = this->input_shape(2);
+  const int height_out = this->output_shape_[0];
+  const int width_out = this->output_shape_[1];
+  const int channels_in = this->channels_ / this->group_;
+  const int channels_out = this->num_output_ / this->group_;
+  const int kernel_size = kernel_shape[0] * kernel_shape[1];
+  const int kernel_dim = channels_out * kernel_size;
+  const int tile_rows = std::min(height,
+      std::max(1, kMaxColTileSize / (kernel_dim * width)));
+  input_tile_.Reshape(1, 1, channels_in, tile_rows * width);
+  col_tile_.Reshape(1, 1, kernel_dim, tile_rows * width);
+  Dtype* input_tile = input_tile_.mutable_cpu_data();
+  Dtype* col_tile = col_tile_.mutable_cpu_data();
+  // The bias initializes the output instead of being added afterwards.
+  for (int c = 0; c < this->num_output_; ++c) {
+    caffe_set(height_out * width_out, bias ? bias[c] : Dtype(0),
+        output + c * height_out * width_out);
+  }
+  for (int g = 0; g < this->group_; ++g) {
+    const Dtype* group_weights = weights + g * channels_in * kernel_dim;
+    const Dtype* group_input = input + g * channels_in * height * width;
+    Dtype* group_output = output + g * channels_out * height_out * width_out;
+    for (int h_start = 0; h_start < height; h_start += tile_rows) {
+      const int rows = std::min(tile_rows, height - h_start);
+      const int tile_dim = rows * width;
+      for (int c = 0; c < channels_in; ++c) {
+        caffe_copy(tile_dim, group_input + (c * height + h_start) * width,
+            input_tile + c * tile_dim);
+      }
+      caffe_cpu_gemm<Dtype>(CblasTrans, CblasNoTrans, kernel_dim, tile_dim,
+          channels_in, (Dtype)1., group_weights, input_tile,
+          (Dtype)0., col_tile);
+      // col2im restricted to the rows of the tile, accumulating into output.
+      for (int row = 0; row < kernel_dim; ++row) {
+        const int c = row / kernel_size;
+        const int kernel_row = (row / kernel_shape[1]) % kernel_shape[0];
+        const int kernel_col = row % kernel_shape[1];
+        const Dtype* col = col_tile + row * tile_dim;
+        Dtype* channel_output = group_output + c * height_out * width_out;
+        for (int h = 0; h < rows; ++h) {
+          const int h_out = (h_start + h) * stride[0] - pad[0] +
+              kernel_row * dilation[0];
+          if (h_out < 0 || h_out >= height_out) { continue; }
+          for (int w = 0; w < width; ++w) {
+            const int w_out = w * stride[1] - pad[1] + kernel_col * dilation[1];
+            if (w_out >= 0 && w_out < width_out) {
+              channel_output[h_out * width_out + w_out] += col[h * width + w];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+bool DeconvolutionLayer<Dtype>::is_bilinear_upsampling() {
+  const int* kernel_shape = this->kernel_shape_.cpu_data();
+  const int* dilation = this->dilation_.cpu_data();
+  if (this->num_spatial_axes_ != 2 || this->group_ != this->channels_ ||
+      this->group_ != this->num_output_ || kernel_shape[0] != kernel_shape[1] ||
+      dilation[0] != 1 || dilation[1] != 1) {
+    return false;
+  }
+  // Same coefficients as BilinearFiller.
+  const int kernel_size = kernel_shape[0];
+  const int f = ceil(kernel_size / 2.);
+  const float c = (2 * f - 1 - f % 2) / (2. * f);
+  bilinear_kernel_.resize(kernel_size);
+  for (int i = 0; i < kernel_size; ++i) {
+    bilinear_kernel_[i] = 1 - std::fabs(static_cast<float>(i) / f - c);
+  }
+  const Dtype* weights = this->blobs_[0]->cpu_data();
+  for (int i = 0; i < this->blobs_[0]->count(); ++i) {
+    const Dtype expected = bilinear_kernel_[(i / kernel_size) % kernel_size] *
+        bilinear_kernel_[i % kernel_size];
+    if (std::fabs(weights[i] - expected) > Dtype(1e-6)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Dtype>
+void DeconvolutionLayer<Dtype>::forward_cpu_bilinear(const Dtype* input,
+    const Dtype* bias, Dtype* output) {
+  const int* stride = this->stride_.cpu_data();
+  const int* pad = this->pad_.cpu_data();
+  const int kernel_size = bilinear_kernel_.size();
+  const int height = this->input_shape(1);
+  const int width = this->input_shape(2);
+  const int height_out = this->output_shape_[0];
+  const int width_out = this->output_shape_[1];
+  const Dtype* kernel = bilinear_kernel_.data();
+  interp_buffer_.Reshape(1, 1, height, width_out);
+  Dtype* interp = interp_buffer_.mutable_cpu_data();
+  for (int c = 0; c < this->channels_; ++c) {
+    const Dtype* channel_input = input + c * height * width;
+    Dtype* channel_output = output + c * height_out * width_out;
+    // Interpolate along the rows: each output column gets contributions
+    // from the input columns w with 0 <= w_out + pad - w * stride < K.
+    for (int w_out = 0; w_out < width_out; ++w_out) {
+      const int offset = w_out + pad[1];
+      const int w_start = std::max(0,
+          (offset - kernel_size + stride[1]) / stride[1]);
+      const int w_end = std::min(width - 1, offset / stride[1]);
+      for (int h = 0; h < height; ++h) {
+        Dtype sum = 0;
+        for (int w = w_start; w <= w_end; ++w) {
+          sum += channel_input[h * width + w] * kernel[offset - w * stride[1]];
+        }
+        interp[h * width_out + w_out] = sum;
+      }
+    }
+    // Interpolate the rows along the columns.
+    for (int h_out = 0; h_out < height_out; ++h_out) {
+      const int offset = h_out + pad[0];
+      const int h_start = std::max(0,
+          (offset - kernel_size + stride[0]) / stride[0]);
+      const int h_end = std::min(height - 1, offset / stride[0]);
+      Dtype* output_row = channel_output + h_out * width_out;
+      caffe_set(width_out, bias ? bias[c] : Dtype(0), output_row);
+      for (int h = h_start; h <= h_end; ++h) {
+        caffe_axpy(width_out, kernel[offset - h * stride[0]],
+            interp + h * width_out, output_row);
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+bool DeconvolutionLayer<Dtype>::tiled_by_default() const {
+  const vector<int>& bottom_shape = *this->bottom_shape_;
+  return this->blobs_[0]->count(1) * bottom_shape[this->channel_axis_ + 1] *
+      bottom_shape[this->channel_axis_ + 2] > kMaxColTileSize;
+}
+
+template <typename Dtype>
+vector<string> DeconvolutionLayer<Dtype>::cpu_algorithms() const {
+  vector<string> algorithms(1, "gemm");
+  if (this->num_spatial_axes_ == 2 && !this->force_nd_im2col_ &&
+      !this->is_1x1_) {
+    algorithms.push_back("tiled");
+  }
+  return algorithms;
+}
+
 template <typename Dtype>
 void DeconvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   const Dtype* weight = this->blobs_[0]->cpu_data();
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
+  const bool use_2d = this->num_spatial_axes_ == 2 &&
+      !this->force_nd_im2col_ && !this->is_1x1_;
+  const bool use_bilinear = use_2d && is_bilinear_upsampling();
+  // The default depends on the shapes, but a set algorithm is kept whatever
+  // they become.
+  const bool use_tiled = use_2d && (this->cpu_algorithm_set() ?
+      this->cpu_algorithm_ == TILED : tiled_by_default());
   for (int i = 0; i < bottom.size(); ++i) {
     const Dtype* bottom_data = bottom[i]->cpu_data();
     Dtype* top_data = top[i]->mutable_cpu_data();
     for (int n = 0; n < this->num_; ++n) {
+      if (use_bilinear) {
+        forward_cpu_bilinear(bottom_data + n * this->bottom_dim_, bias,
+            top_data + n * this->top_dim_);
+        continue;
+      }
+      if (use_tiled) {
+        forward_cpu_tiled(bottom_data + n * this->bottom_dim_, weight, bias,
+            top_data + n * this->top_dim_);
+        continue;
+      }
       this->backward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
           top_data + n * this->top_dim_);
       if (this->bias_term_) {
-        const Dtype* bias = this->blobs_[1]->cpu_data();
         this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
       }
     }
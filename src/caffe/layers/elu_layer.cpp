@@ -2,6 +2,8 @@
 #include <vector>
 
 #include "caffe/layers/elu_layer.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
@@ -12,10 +14,22 @@ void ELULayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   Dtype* top_data = top[0]->mutable_cpu_data();
   const int count = bottom[0]->count();
   Dtype alpha = this->layer_param_.elu_param().alpha();
-  for (int i = 0; i < count; ++i) {
-    top_data[i] = std::max(bottom_data[i], Dtype(0))
-        + alpha * (exp(std::min(bottom_data[i], Dtype(0))) - Dtype(1));
-  }
+  // Blocks of exponentials are computed together, vectorized, on the side
+  // as the layer may run in place.
+  parallel_for(count, [=](int begin, int end) {
+    Dtype negative[kVectorBlock];
+    for (int block = begin; block < end; block += kVectorBlock) {
+      const int size = std::min(end - block, kVectorBlock);
+      for (int i = 0; i < size; ++i) {
+        negative[i] = std::min(bottom_data[block + i], Dtype(0));
+      }
+      caffe_exp(size, negative, negative);
+      for (int i = 0; i < size; ++i) {
+        top_data[block + i] = std::max(bottom_data[block + i], Dtype(0))
+            + alpha * (negative[i] - Dtype(1));
+      }
+    }
+  });
 }
 
 template <typename Dtype>
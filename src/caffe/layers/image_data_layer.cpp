@@ -165,6 +165,8 @@ void ImageDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   DLOG(INFO) << "Prefetch batch: " << batch_timer.MilliSeconds() << " ms.";
   DLOG(INFO) << "     Read time: " << read_time / 1000 << " ms.";
   DLOG(INFO) << "Transform time: " << trans_time / 1000 << " ms.";
+  // Reading an image decodes it too.
+  this->RecordBatchTimes(read_time, 0, trans_time);
 }
 
 INSTANTIATE_CLASS(ImageDataLayer);
@@ -0,0 +1,203 @@
+#include <boost/random.hpp>
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "caffe/data_transformer.hpp"
+#include "caffe/layers/mixed_data_layer.hpp"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/rng.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+MixedDataLayer<Dtype>::MixedDataLayer(const LayerParameter& param)
+  : BasePrefetchingDataLayer<Dtype>(param) {}
+
+template <typename Dtype>
+MixedDataLayer<Dtype>::~MixedDataLayer() {
+  this->StopInternalThread();
+}
+
+template <typename Dtype>
+void MixedDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) {
+  const MixedDataParameter& mixed_param =
+      this->layer_param_.mixed_data_param();
+  CHECK_GT(mixed_param.source_size(), 0) << "MixedData needs a source.";
+  CHECK_GT(mixed_param.batch_size(), 0);
+  CHECK(mixed_param.weight_size() == 0 ||
+      mixed_param.weight_size() == mixed_param.source_size())
+      << "Specify either no weight or one weight per source.";
+  std::set<string> sources;
+  float total_weight = 0;
+  for (int i = 0; i < mixed_param.source_size(); ++i) {
+    const DataParameter& source = mixed_param.source(i);
+    CHECK(sources.insert(source.source()).second)
+        << "Source " << source.source() << " is listed more than once.";
+    const float weight = mixed_param.weight_size() ? mixed_param.weight(i) : 1;
+    CHECK_GE(weight, 0) << "Source weights must be non-negative.";
+    total_weight += weight;
+    cumulative_weights_.push_back(total_weight);
+    // Each source gets its own reader, keyed by layer name and source.
+    LayerParameter reader_param(this->layer_param_);
+    DataParameter* data_param = reader_param.mutable_data_param();
+    data_param->CopyFrom(source);
+    data_param->set_batch_size(mixed_param.batch_size());
+    data_param->set_prefetch(mixed_param.prefetch());
+    readers_.push_back(shared_ptr<DataReader>(new DataReader(reader_param)));
+  }
+  CHECK_GT(total_weight, 0) << "At least one source weight must be positive.";
+
+  const int batch_size = mixed_param.batch_size();
+  // Read a data point of each source; they must all have the same shape.
+  vector<int> top_shape =
+      this->data_transformer_->InferBlobShape(*(readers_[0]->full().peek()));
+  for (int i = 1; i < readers_.size(); ++i) {
+    CHECK(this->data_transformer_->InferBlobShape(
+        *(readers_[i]->full().peek())) == top_shape)
+        << "Source " << mixed_param.source(i).source()
+        << " has a different data shape than "
+        << mixed_param.source(0).source();
+  }
+  // Reshape top[0] and prefetch_data according to the batch_size.
+  top_shape[0] = batch_size;
+  top[0]->Reshape(top_shape);
+  for (int i = 0; i < this->PREFETCH_COUNT; ++i) {
+    this->prefetch_[i].data_.Reshape(top_shape);
+  }
+  LOG(INFO) << "output data size: " << top[0]->num() << ","
+      << top[0]->channels() << "," << top[0]->height() << ","
+      << top[0]->width();
+  // label
+  if (this->output_labels_) {
+    vector<int> label_shape(1, batch_size);
+    top[1]->Reshape(label_shape);
+    for (int i = 0; i < this->PREFETCH_COUNT; ++i) {
+      this->prefetch_[i].label_.Reshape(label_shape);
+    }
+  }
+  // The transformers keep per-call state, so each group of items needs its
+  // own.
+  const int num_groups = std::max<int>(1, mixed_param.num_threads());
+  transformers_.push_back(this->data_transformer_);
+  for (int t = 1; t < num_groups; ++t) {
+    transformers_.push_back(shared_ptr<DataTransformer<Dtype> >(
+        new DataTransformer<Dtype>(this->transform_param_, this->phase_)));
+    transformers_[t]->InitRand();
+  }
+  for (int t = 0; t < num_groups; ++t) {
+    transformed_items_.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+  }
+  const unsigned int prefetch_rng_seed = caffe_rng_rand();
+  prefetch_rng_.reset(new Caffe::RNG(prefetch_rng_seed));
+}
+
+template <typename Dtype>
+int MixedDataLayer<Dtype>::SampleSource() {
+  caffe::rng_t* prefetch_rng =
+      static_cast<caffe::rng_t*>(prefetch_rng_->generator());
+  boost::uniform_real<float> random_distribution(0,
+      cumulative_weights_.back());
+  boost::variate_generator<caffe::rng_t*, boost::uniform_real<float> >
+      variate_generator(prefetch_rng, random_distribution);
+  const float r = variate_generator();
+  // The first source whose cumulative weight exceeds r; sources of zero
+  // weight cover an empty range and are never picked.
+  const int source = std::upper_bound(cumulative_weights_.begin(),
+      cumulative_weights_.end(), r) - cumulative_weights_.begin();
+  return std::min<int>(source, cumulative_weights_.size() - 1);
+}
+
+template <typename Dtype>
+void MixedDataLayer<Dtype>::TransformItems(const vector<Datum*>& datums,
+    int group, int num_groups, Dtype* top_data) {
+  Blob<Dtype>* item = transformed_items_[group].get();
+  for (int item_id = group; item_id < datums.size();
+       item_id += num_groups) {
+    // Apply data transformations (mirror, scale, crop...)
+    item->set_cpu_data(top_data + item_id * item->count());
+    transformers_[group]->Transform(*datums[item_id], item);
+  }
+}
+
+// This function is called on prefetch thread
+template<typename Dtype>
+void MixedDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
+  CPUTimer batch_timer;
+  batch_timer.Start();
+  double read_time = 0;
+  double trans_time = 0;
+  CPUTimer timer;
+  CHECK(batch->data_.count());
+
+  // Draw the source of every item up front, so the mix only depends on the
+  // random seed.
+  const int batch_size = this->layer_param_.mixed_data_param().batch_size();
+  vector<vector<int> > source_items(readers_.size());
+  for (int item_id = 0; item_id < batch_size; ++item_id) {
+    source_items[SampleSource()].push_back(item_id);
+  }
+  timer.Start();
+  vector<Datum*> datums(batch_size);
+  vector<vector<Datum*> > source_datums(readers_.size());
+  for (int s = 0; s < readers_.size(); ++s) {
+    const int num = source_items[s].size();
+    vector<Datum*> popped;
+    while (source_datums[s].size() < num) {
+      readers_[s]->full().pop(num - source_datums[s].size(), &popped,
+          "Waiting for data");
+      source_datums[s].insert(source_datums[s].end(), popped.begin(),
+          popped.end());
+    }
+    for (int i = 0; i < num; ++i) {
+      datums[source_items[s][i]] = source_datums[s][i];
+    }
+  }
+  read_time += timer.MicroSeconds();
+
+  // Reshape according to the first datum of each batch
+  // on single input batches allows for inputs of varying dimension.
+  vector<int> top_shape = this->data_transformer_->InferBlobShape(*datums[0]);
+  for (int t = 0; t < transformed_items_.size(); ++t) {
+    transformed_items_[t]->Reshape(top_shape);
+  }
+  top_shape[0] = batch_size;
+  batch->data_.Reshape(top_shape);
+  Dtype* top_data = batch->data_.mutable_cpu_data();
+  if (this->output_labels_) {
+    Dtype* top_label = batch->label_.mutable_cpu_data();
+    for (int item_id = 0; item_id < batch_size; ++item_id) {
+      top_label[item_id] = datums[item_id]->label();
+    }
+  }
+
+  timer.Start();
+  // The groups run on the thread pool, each with its own transformer, so
+  // the items get the same random transformations whatever the pool size.
+  const int num_groups = transformers_.size();
+  parallel_for(num_groups, 1, [&](int begin, int end) {
+    for (int group = begin; group < end; ++group) {
+      TransformItems(datums, group, num_groups, top_data);
+    }
+  });
+  trans_time += timer.MicroSeconds();
+
+  for (int s = 0; s < readers_.size(); ++s) {
+    readers_[s]->free().push(source_datums[s]);
+  }
+  timer.Stop();
+  batch_timer.Stop();
+  DLOG(INFO) << "Prefetch batch: " << batch_timer.MilliSeconds() << " ms.";
+  DLOG(INFO) << "     Read time: " << read_time / 1000 << " ms.";
+  DLOG(INFO) << "Transform time: " << trans_time / 1000 << " ms.";
+  this->RecordBatchTimes(read_time, 0, trans_time);
+}
+
+INSTANTIATE_CLASS(MixedDataLayer);
+REGISTER_LAYER_CLASS(MixedData);
+
+}  // namespace caffe
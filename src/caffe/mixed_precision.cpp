@@ -0,0 +1,187 @@
+#include <cmath>
+#include <vector>
+
+#include "caffe/mixed_precision.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+MixedPrecision<Dtype>::MixedPrecision(const SolverParameter& param,
+    Net<Dtype>* net)
+    : precision_(param.precision()),
+      dynamic_(param.dynamic_loss_scale()),
+      factor_(param.loss_scale_factor()),
+      window_(param.loss_scale_window()),
+      loss_scale_(param.loss_scale()),
+      loss_scale_iter_(0),
+      net_(net),
+      after_forward_(this, &MixedPrecision::AfterForward),
+      before_backward_(this, &MixedPrecision::BeforeBackward),
+      after_backward_(this, &MixedPrecision::AfterBackward) {
+  CHECK_NE(precision_, SolverParameter_Precision_FLOAT);
+  CHECK_GT(loss_scale_, 0) << "loss_scale must be positive.";
+  if (dynamic_) {
+    CHECK_GT(factor_, 1) << "loss_scale_factor must be greater than 1.";
+    CHECK_GT(window_, 0) << "loss_scale_window must be positive.";
+  }
+  const vector<Blob<Dtype>*>& params = net_->learnable_params();
+  for (int i = 0; i < params.size(); ++i) {
+    masters_.push_back(shared_ptr<Blob<Dtype> >(
+        new Blob<Dtype>(params[i]->shape())));
+  }
+  net_->add_after_forward(&after_forward_);
+  net_->add_before_backward(&before_backward_);
+  net_->add_after_backward(&after_backward_);
+  LOG(INFO) << "Training in "
+      << SolverParameter_Precision_Name(precision_) << " with "
+      << (dynamic_ ? "initial " : "") << "loss scale " << loss_scale_;
+}
+
+template <typename Dtype>
+void MixedPrecision<Dtype>::set_loss_scale(float loss_scale,
+    int loss_scale_iter) {
+  CHECK_GT(loss_scale, 0);
+  loss_scale_ = loss_scale;
+  loss_scale_iter_ = loss_scale_iter;
+}
+
+template <typename Dtype>
+void MixedPrecision<Dtype>::Round(Blob<Dtype>* blob, bool diff) {
+  const int count = blob->count();
+  switch (Caffe::mode()) {
+  case Caffe::CPU: {
+    Dtype* values = diff ? blob->mutable_cpu_diff() : blob->mutable_cpu_data();
+    if (precision_ == SolverParameter_Precision_FLOAT16) {
+      caffe_round_fp16(count, values, values);
+    } else {
+      caffe_round_bf16(count, values, values);
+    }
+    break;
+  }
+  case Caffe::GPU: {
+#ifndef CPU_ONLY
+    Dtype* values = diff ? blob->mutable_gpu_diff() : blob->mutable_gpu_data();
+    if (precision_ == SolverParameter_Precision_FLOAT16) {
+      caffe_gpu_round_fp16(count, values, values);
+    } else {
+      caffe_gpu_round_bf16(count, values, values);
+    }
+#else
+    NO_GPU;
+#endif
+    break;
+  }
+  default:
+    LOG(FATAL) << "Unknown caffe mode: " << Caffe::mode();
+  }
+}
+
+template <typename Dtype>
+void MixedPrecision<Dtype>::SetLossDiffs(int layer_id, bool scaled) {
+  const shared_ptr<Layer<Dtype> >& layer = net_->layers()[layer_id];
+  const vector<Blob<Dtype>*>& top = net_->top_vecs()[layer_id];
+  for (int top_id = 0; top_id < top.size(); ++top_id) {
+    if (layer->loss(top_id) == Dtype(0)) { continue; }
+    const Dtype weight = layer->loss(top_id) * (scaled ? loss_scale_ : 1);
+    switch (Caffe::mode()) {
+    case Caffe::CPU:
+      caffe_set(top[top_id]->count(), weight,
+          top[top_id]->mutable_cpu_diff());
+      break;
+    case Caffe::GPU:
+#ifndef CPU_ONLY
+      caffe_gpu_set(top[top_id]->count(), weight,
+          top[top_id]->mutable_gpu_diff());
+#else
+      NO_GPU;
+#endif
+      break;
+    default:
+      LOG(FATAL) << "Unknown caffe mode: " << Caffe::mode();
+    }
+  }
+}
+
+template <typename Dtype>
+void MixedPrecision<Dtype>::AfterForward(int layer_id) {
+  // The outputs of the data layers, which have no inputs, are kept, as
+  // labels may not be representable.
+  if (net_->bottom_vecs()[layer_id].empty()) { return; }
+  const shared_ptr<Layer<Dtype> >& layer = net_->layers()[layer_id];
+  const vector<Blob<Dtype>*>& top = net_->top_vecs()[layer_id];
+  for (int i = 0; i < top.size(); ++i) {
+    // Losses feed only the displayed loss, which must not overflow to inf.
+    if (layer->loss(i) != Dtype(0)) { continue; }
+    Round(top[i], false);
+  }
+}
+
+template <typename Dtype>
+void MixedPrecision<Dtype>::BeforeBackward(int layer_id) {
+  SetLossDiffs(layer_id, true);
+}
+
+template <typename Dtype>
+void MixedPrecision<Dtype>::AfterBackward(int layer_id) {
+  // The loss weights are the diffs of the loss blobs during Forward too.
+  SetLossDiffs(layer_id, false);
+  const vector<Blob<Dtype>*>& bottom = net_->bottom_vecs()[layer_id];
+  for (int i = 0; i < bottom.size(); ++i) {
+    if (net_->bottom_need_backward()[layer_id][i]) {
+      Round(bottom[i], true);
+    }
+  }
+  const vector<shared_ptr<Blob<Dtype> > >& blobs =
+      net_->layers()[layer_id]->blobs();
+  for (int i = 0; i < blobs.size(); ++i) {
+    Round(blobs[i].get(), true);
+  }
+}
+
+template <typename Dtype>
+void MixedPrecision<Dtype>::Begin() {
+  const vector<Blob<Dtype>*>& params = net_->learnable_params();
+  for (int i = 0; i < params.size(); ++i) {
+    if (!updated(i)) { continue; }
+    masters_[i]->CopyFrom(*params[i]);
+    Round(params[i], false);
+  }
+}
+
+template <typename Dtype>
+bool MixedPrecision<Dtype>::End() {
+  const vector<Blob<Dtype>*>& params = net_->learnable_params();
+  Dtype sum = 0;
+  for (int i = 0; i < params.size(); ++i) {
+    // Params the solver does not update, like the BatchNorm statistics, keep
+    // the values the forward pass accumulated in them.
+    if (updated(i)) { params[i]->CopyFrom(*masters_[i]); }
+    sum += params[i]->asum_diff();
+  }
+  if (!std::isfinite(static_cast<double>(sum))) {
+    if (!dynamic_) {
+      LOG(WARNING) << "Gradients overflowed with loss scale " << loss_scale_
+          << ", skipping the update.";
+      return false;
+    }
+    loss_scale_ /= factor_;
+    loss_scale_iter_ = 0;
+    LOG(INFO) << "Gradients overflowed, skipping the update and decreasing "
+        << "the loss scale to " << loss_scale_;
+    return false;
+  }
+  for (int i = 0; i < params.size(); ++i) {
+    params[i]->scale_diff(Dtype(1) / loss_scale_);
+  }
+  if (dynamic_ && ++loss_scale_iter_ >= window_) {
+    loss_scale_ *= factor_;
+    loss_scale_iter_ = 0;
+    DLOG(INFO) << "Increasing the loss scale to " << loss_scale_;
+  }
+  return true;
+}
+
+INSTANTIATE_CLASS(MixedPrecision);
+
+}  // namespace caffe
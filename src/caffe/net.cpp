@@ -1,17 +1,21 @@
 #include <algorithm>
+#include <iomanip>
 #include <map>
 #include <set>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "hdf5.h"
 
+#include "caffe/autotuner.hpp"
 #include "caffe/common.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/net.hpp"
 #include "caffe/parallel.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/syncedmem.hpp"
 #include "caffe/util/hdf5.hpp"
 #include "caffe/util/insert_splits.hpp"
 #include "caffe/util/math_functions.hpp"
@@ -73,6 +77,7 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
   param_id_vecs_.resize(param.layer_size());
   top_id_vecs_.resize(param.layer_size());
   bottom_need_backward_.resize(param.layer_size());
+  layer_memory_.resize(param.layer_size());
   for (int layer_id = 0; layer_id < param.layer_size(); ++layer_id) {
     // For non-root solvers, whether this layer is shared from root_net_.
     bool share_from_root = !Caffe::root_solver()
@@ -89,6 +94,9 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
           << "propagate_down param must be specified "
           << "either 0 or bottom_size times ";
     }
+    // Charge the memory the layer allocates, including its top blobs, to it.
+    layer_memory_[layer_id].reset(new MemoryAccount(layer_param.name()));
+    MemoryAccount::Scope memory_scope(layer_memory_[layer_id]);
     if (share_from_root) {
       LOG(INFO) << "Sharing layer " << layer_param.name() << " from root net";
       layers_.push_back(root_net_->layers_[layer_id]);
@@ -279,7 +287,13 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
     layer_names_index_[layer_names_[layer_id]] = layer_id;
   }
   ShareWeights();
+  if (param.share_diffs()) {
+    ShareDiffs();
+  }
   debug_info_ = param.debug_info();
+  if (Caffe::mode() == Caffe::CPU && !Caffe::autotune_cache().empty()) {
+    Autotuner<Dtype>(Caffe::autotune_cache()).Tune(this);
+  }
   LOG_IF(INFO, Caffe::root_solver()) << "Network initialization done.";
 }
 
@@ -547,9 +561,16 @@ Dtype Net<Dtype>::ForwardFromTo(int start, int end) {
   Dtype loss = 0;
   for (int i = start; i <= end; ++i) {
     // LOG(ERROR) << "Forwarding " << layer_names_[i];
+    for (int c = 0; c < before_forward_.size(); ++c) {
+      before_forward_[c]->run(i);
+    }
+    MemoryAccount::Scope memory_scope(layer_memory_[i]);
     Dtype layer_loss = layers_[i]->Forward(bottom_vecs_[i], top_vecs_[i]);
     loss += layer_loss;
     if (debug_info_) { ForwardDebugInfo(i); }
+    for (int c = 0; c < after_forward_.size(); ++c) {
+      after_forward_[c]->run(i);
+    }
   }
   return loss;
 }
@@ -592,11 +613,133 @@ void Net<Dtype>::BackwardFromTo(int start, int end) {
   CHECK_LT(start, layers_.size());
   for (int i = start; i >= end; --i) {
     if (layer_need_backward_[i]) {
+      for (int c = 0; c < before_backward_.size(); ++c) {
+        before_backward_[c]->run(i);
+      }
+      MemoryAccount::Scope memory_scope(layer_memory_[i]);
       layers_[i]->Backward(
           top_vecs_[i], bottom_need_backward_[i], bottom_vecs_[i]);
       if (debug_info_) { BackwardDebugInfo(i); }
+      for (int c = 0; c < after_backward_.size(); ++c) {
+        after_backward_[c]->run(i);
+      }
+    }
+  }
+}
+
+// Helper for Net::Init: assign shared diff memory to intermediate blobs.
+// The diff of a blob is written by the backward pass of the last layer using
+// it and read by the backward pass of the layer producing it, so it is only
+// live while Backward runs over the layers between its first and last use.
+// Blobs with disjoint live ranges can then be given the same memory.
+template <typename Dtype>
+void Net<Dtype>::ShareDiffs() {
+  // Blobs already sharing their diff (e.g. through Flatten or Reshape layers)
+  // form a single group that must be treated as one allocation.
+  map<SyncedMemory*, int> group_index;
+  vector<int> blob_group(blobs_.size(), -1);
+  vector<vector<int> > group_blobs;
+  for (int blob_id = 0; blob_id < blobs_.size(); ++blob_id) {
+    if (blobs_[blob_id]->count() == 0) { continue; }
+    SyncedMemory* diff = blobs_[blob_id]->diff().get();
+    if (group_index.find(diff) == group_index.end()) {
+      group_index[diff] = group_blobs.size();
+      group_blobs.push_back(vector<int>());
+    }
+    blob_group[blob_id] = group_index[diff];
+    group_blobs[blob_group[blob_id]].push_back(blob_id);
+  }
+  const int num_groups = group_blobs.size();
+  vector<int> first_use(num_groups, INT_MAX);
+  vector<int> last_use(num_groups, -1);
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    vector<int> blob_ids(bottom_id_vecs_[layer_id]);
+    blob_ids.insert(blob_ids.end(), top_id_vecs_[layer_id].begin(),
+                    top_id_vecs_[layer_id].end());
+    for (int i = 0; i < blob_ids.size(); ++i) {
+      const int group = blob_group[blob_ids[i]];
+      if (group < 0) { continue; }
+      first_use[group] = std::min(first_use[group], layer_id);
+      last_use[group] = std::max(last_use[group], layer_id);
+    }
+  }
+  // Only gradients that are computed in Backward are allocated at all, and of
+  // those only the ones that are not loss weights and not visible from outside
+  // the net as inputs or outputs may be shared.
+  vector<bool> group_needed(num_groups, false);
+  vector<bool> group_shareable(num_groups, true);
+  vector<size_t> group_bytes(num_groups, 0);
+  for (int blob_id = 0; blob_id < blobs_.size(); ++blob_id) {
+    const int group = blob_group[blob_id];
+    if (group < 0) { continue; }
+    group_needed[group] = group_needed[group] || blob_need_backward_[blob_id];
+    group_bytes[group] = std::max(group_bytes[group],
+        blobs_[blob_id]->count() * sizeof(Dtype));
+    if (blob_id < blob_loss_weights_.size() &&
+        blob_loss_weights_[blob_id] != Dtype(0)) {
+      group_shareable[group] = false;
+    }
+  }
+  for (int i = 0; i < net_input_blob_indices_.size(); ++i) {
+    const int group = blob_group[net_input_blob_indices_[i]];
+    if (group >= 0) { group_shareable[group] = false; }
+  }
+  for (int i = 0; i < net_output_blob_indices_.size(); ++i) {
+    const int group = blob_group[net_output_blob_indices_[i]];
+    if (group >= 0) { group_shareable[group] = false; }
+  }
+  // Greedily assign the groups, largest first, to the first shared buffer
+  // whose users are all live over disjoint ranges of layers.
+  vector<pair<size_t, int> > candidates;
+  size_t diff_bytes = 0;
+  size_t planned_diff_bytes = 0;
+  for (int group = 0; group < num_groups; ++group) {
+    if (!group_needed[group]) { continue; }
+    diff_bytes += group_bytes[group];
+    if (group_shareable[group]) {
+      candidates.push_back(make_pair(group_bytes[group], -group));
+    } else {
+      planned_diff_bytes += group_bytes[group];
+    }
+  }
+  std::sort(candidates.rbegin(), candidates.rend());
+  vector<size_t> buffer_bytes;
+  vector<vector<int> > buffer_groups;
+  for (int i = 0; i < candidates.size(); ++i) {
+    const int group = -candidates[i].second;
+    int buffer = 0;
+    for (; buffer < buffer_groups.size(); ++buffer) {
+      bool overlaps = false;
+      for (int j = 0; !overlaps && j < buffer_groups[buffer].size(); ++j) {
+        const int other = buffer_groups[buffer][j];
+        overlaps = first_use[group] <= last_use[other] &&
+                   first_use[other] <= last_use[group];
+      }
+      if (!overlaps) { break; }
+    }
+    if (buffer == buffer_groups.size()) {
+      buffer_bytes.push_back(0);
+      buffer_groups.push_back(vector<int>());
     }
+    buffer_bytes[buffer] = std::max(buffer_bytes[buffer], group_bytes[group]);
+    buffer_groups[buffer].push_back(group);
   }
+  for (int buffer = 0; buffer < buffer_groups.size(); ++buffer) {
+    planned_diff_bytes += buffer_bytes[buffer];
+    shared_ptr<SyncedMemory> diff(new SyncedMemory(buffer_bytes[buffer]));
+    for (int i = 0; i < buffer_groups[buffer].size(); ++i) {
+      const vector<int>& blob_ids = group_blobs[buffer_groups[buffer][i]];
+      for (int j = 0; j < blob_ids.size(); ++j) {
+        blobs_[blob_ids[j]]->ShareDiffMemory(diff);
+      }
+    }
+  }
+  LOG_IF(INFO, Caffe::root_solver())
+      << "Memory required for data and diffs: "
+      << memory_used_ * sizeof(Dtype) + diff_bytes << " ("
+      << memory_used_ * sizeof(Dtype) + planned_diff_bytes
+      << " after sharing " << candidates.size() << " diffs in "
+      << buffer_groups.size() << " buffers)";
 }
 
 template <typename Dtype>
@@ -710,6 +853,37 @@ void Net<Dtype>::ShareTrainedLayersWith(const Net* other) {
   }
 }
 
+template <typename Dtype>
+void Net<Dtype>::CopyTrainedLayersFrom(const Net* other) {
+  int num_source_layers = other->layers().size();
+  for (int i = 0; i < num_source_layers; ++i) {
+    Layer<Dtype>* source_layer = other->layers()[i].get();
+    const string& source_layer_name = other->layer_names()[i];
+    int target_layer_id = 0;
+    while (target_layer_id != layer_names_.size() &&
+        layer_names_[target_layer_id] != source_layer_name) {
+      ++target_layer_id;
+    }
+    if (target_layer_id == layer_names_.size()) {
+      DLOG(INFO) << "Ignoring source layer " << source_layer_name;
+      continue;
+    }
+    vector<shared_ptr<Blob<Dtype> > >& target_blobs =
+        layers_[target_layer_id]->blobs();
+    CHECK_EQ(target_blobs.size(), source_layer->blobs().size())
+        << "Incompatible number of blobs for layer " << source_layer_name;
+    for (int j = 0; j < target_blobs.size(); ++j) {
+      Blob<Dtype>* source_blob = source_layer->blobs()[j].get();
+      CHECK(target_blobs[j]->shape() == source_blob->shape())
+          << "Cannot copy param " << j << " weights from layer '"
+          << source_layer_name << "'; shape mismatch.  Source param shape is "
+          << source_blob->shape_string() << "; target param shape is "
+          << target_blobs[j]->shape_string();
+      target_blobs[j]->CopyFrom(*source_blob);
+    }
+  }
+}
+
 template <typename Dtype>
 void Net<Dtype>::BackwardFrom(int start) {
   BackwardFromTo(start, 0);
@@ -742,10 +916,132 @@ void Net<Dtype>::Backward() {
 template <typename Dtype>
 void Net<Dtype>::Reshape() {
   for (int i = 0; i < layers_.size(); ++i) {
+    MemoryAccount::Scope memory_scope(layer_memory_[i]);
     layers_[i]->Reshape(bottom_vecs_[i], top_vecs_[i]);
   }
 }
 
+// Helpers for Net::MemoryReport.
+namespace {
+
+// The bytes of a report cell, per MemoryAccount::Location.
+struct MemoryBytes {
+  MemoryBytes() { bytes[0] = bytes[1] = 0; }
+  MemoryBytes& operator+=(const MemoryBytes& other) {
+    bytes[0] += other.bytes[0];
+    bytes[1] += other.bytes[1];
+    return *this;
+  }
+  size_t bytes[2];
+};
+
+// Adds the memory of mem to *bytes, and to *charged if it is charged to
+// account, unless an earlier cell of the report already counted it.
+void CountMemory(const shared_ptr<SyncedMemory>& mem,
+    const shared_ptr<MemoryAccount>& account,
+    set<const SyncedMemory*>* counted, MemoryBytes* bytes,
+    MemoryBytes* charged) {
+  if (!mem || !counted->insert(mem.get()).second) { return; }
+  MemoryBytes mem_bytes;
+  mem_bytes.bytes[MemoryAccount::HOST] = mem->host_bytes();
+  mem_bytes.bytes[MemoryAccount::DEVICE] = mem->device_bytes();
+  *bytes += mem_bytes;
+  if (mem->account() == account) { *charged += mem_bytes; }
+}
+
+string FormatMB(size_t bytes) {
+  std::ostringstream mb;
+  mb << std::fixed << std::setprecision(2) << bytes / (1024. * 1024.);
+  return mb.str();
+}
+
+}  // namespace
+
+template <typename Dtype>
+string Net<Dtype>::MemoryReport() const {
+  // Each SyncedMemory is counted once, in the first cell that holds it, so
+  // in-place layers, shared parameters and shared diffs are not counted twice.
+  // What a layer's account holds besides the parameters and top blobs
+  // counted in its row are its internal buffers.
+  enum Column { PARAMS, DATA, DIFF, INTERNAL, NUM_COLUMNS };
+  set<const SyncedMemory*> counted;
+  vector<vector<MemoryBytes> > rows(layers_.size(),
+      vector<MemoryBytes>(NUM_COLUMNS));
+  vector<MemoryBytes> totals(NUM_COLUMNS);
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    const shared_ptr<MemoryAccount>& account = layer_memory_[layer_id];
+    vector<MemoryBytes>& row = rows[layer_id];
+    MemoryBytes charged;
+    const vector<shared_ptr<Blob<Dtype> > >& params =
+        layers_[layer_id]->blobs();
+    for (int i = 0; i < params.size(); ++i) {
+      CountMemory(params[i]->data(), account, &counted, &row[PARAMS],
+          &charged);
+      CountMemory(params[i]->diff(), account, &counted, &row[PARAMS],
+          &charged);
+    }
+    const vector<Blob<Dtype>*>& top = top_vecs_[layer_id];
+    for (int i = 0; i < top.size(); ++i) {
+      CountMemory(top[i]->data(), account, &counted, &row[DATA], &charged);
+      CountMemory(top[i]->diff(), account, &counted, &row[DIFF], &charged);
+    }
+    for (int location = 0; location < 2; ++location) {
+      const size_t live = account->live_bytes(
+          static_cast<MemoryAccount::Location>(location));
+      row[INTERNAL].bytes[location] = live > charged.bytes[location] ?
+          live - charged.bytes[location] : 0;
+    }
+    for (int column = 0; column < NUM_COLUMNS; ++column) {
+      totals[column] += row[column];
+    }
+  }
+  const char* location_names[] = { "host", "device" };
+  const char* column_names[] = { "params", "data", "diff", "internal" };
+  const int name_width = 24;
+  const int column_width = 10;
+  std::ostringstream report;
+  for (int location = 0; location < 2; ++location) {
+    const MemoryAccount::Location loc =
+        static_cast<MemoryAccount::Location>(location);
+    size_t net_bytes = 0;
+    for (int column = 0; column < NUM_COLUMNS; ++column) {
+      net_bytes += totals[column].bytes[location];
+    }
+    if (location == MemoryAccount::DEVICE && net_bytes == 0) { continue; }
+    report << "Memory of net " << name_ << " on the "
+        << location_names[location] << ", in MB:\n";
+    report << std::left << std::setw(name_width) << "layer" << std::right;
+    for (int column = 0; column < NUM_COLUMNS; ++column) {
+      report << std::setw(column_width) << column_names[column];
+    }
+    report << std::setw(column_width) << "total"
+        << std::setw(column_width) << "peak" << "\n";
+    for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+      size_t layer_bytes = 0;
+      report << std::left << std::setw(name_width) << layer_names_[layer_id]
+          << std::right;
+      for (int column = 0; column < NUM_COLUMNS; ++column) {
+        const size_t bytes = rows[layer_id][column].bytes[location];
+        layer_bytes += bytes;
+        report << std::setw(column_width) << FormatMB(bytes);
+      }
+      report << std::setw(column_width) << FormatMB(layer_bytes)
+          << std::setw(column_width)
+          << FormatMB(layer_memory_[layer_id]->peak_bytes(loc)) << "\n";
+    }
+    report << std::left << std::setw(name_width) << "total" << std::right;
+    for (int column = 0; column < NUM_COLUMNS; ++column) {
+      report << std::setw(column_width)
+          << FormatMB(totals[column].bytes[location]);
+    }
+    report << std::setw(column_width) << FormatMB(net_bytes) << "\n";
+    report << "Process total on the " << location_names[location] << ": "
+        << FormatMB(MemoryAccount::Total().live_bytes(loc)) << " MB, peak "
+        << FormatMB(MemoryAccount::Total().peak_bytes(loc)) << " MB\n";
+  }
+  return report.str();
+}
+
 template <typename Dtype>
 void Net<Dtype>::CopyTrainedLayersFrom(const NetParameter& param) {
   int num_source_layers = param.layer_size();
@@ -0,0 +1,346 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#ifdef USE_OPENCV
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#endif  // USE_OPENCV
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "caffe/data_transformer.hpp"
+#include "caffe/internal_thread.hpp"
+#include "caffe/predictor.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+namespace caffe {
+
+namespace {
+
+// Orders indices by descending score.
+template <typename Dtype>
+class ScoreGreater {
+ public:
+  explicit ScoreGreater(const Dtype* scores) : scores_(scores) { }
+  bool operator()(int a, int b) const { return scores_[a] > scores_[b]; }
+
+ private:
+  const Dtype* scores_;
+};
+
+// Hands the results of an asynchronous request back to a blocked caller.
+template <typename Dtype>
+class PredictionWaiter {
+ public:
+  PredictionWaiter() : done_(false) { }
+
+  void Done(const vector<Prediction<Dtype> >& results) {
+    boost::mutex::scoped_lock lock(mutex_);
+    results_ = results;
+    done_ = true;
+    condition_.notify_one();
+  }
+
+  vector<Prediction<Dtype> > Wait() {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (!done_) {
+      condition_.wait(lock);
+    }
+    return results_;
+  }
+
+ private:
+  boost::mutex mutex_;
+  boost::condition_variable condition_;
+  bool done_;
+  vector<Prediction<Dtype> > results_;
+};
+
+}  // namespace
+
+// A request: the images of one Predict or PredictAsync call.
+template <typename Dtype>
+struct Predictor<Dtype>::Job {
+  vector<Datum> datums;
+#ifdef USE_OPENCV
+  vector<cv::Mat> images;
+#endif  // USE_OPENCV
+  int top_k;
+  Callback done;
+  vector<Prediction<Dtype> > results;
+
+  int size() const {
+#ifdef USE_OPENCV
+    return datums.size() + images.size();
+#else
+    return datums.size();
+#endif  // USE_OPENCV
+  }
+};
+
+// Serves jobs on its own net replica. Buffers used during preprocessing are
+// members so they are allocated once and reused for every batch.
+template <typename Dtype>
+class Predictor<Dtype>::Worker : public InternalThread {
+ public:
+  Worker(Predictor* predictor, const shared_ptr<Net<Dtype> >& net)
+      : predictor_(predictor), net_(net),
+        transformer_(predictor->transform_param_, TEST),
+        item_(predictor->input_shape_) {
+    transformer_.InitRand();
+  }
+  virtual ~Worker() { StopInternalThread(); }
+
+ protected:
+  virtual void InternalThreadEntry();
+  // Runs one forward pass over items [begin, end) of the popped jobs.
+  void Forward(const vector<std::pair<Job*, int> >& items, int begin,
+      int end);
+  void TransformItem(const Job& job, int index);
+
+  Predictor* predictor_;
+  shared_ptr<Net<Dtype> > net_;
+  DataTransformer<Dtype> transformer_;
+  // One image's slot in the input blob.
+  Blob<Dtype> item_;
+  vector<int> order_;
+#ifdef USE_OPENCV
+  cv::Mat converted_;
+  cv::Mat resized_;
+#endif  // USE_OPENCV
+
+  DISABLE_COPY_AND_ASSIGN(Worker);
+};
+
+template <typename Dtype>
+void Predictor<Dtype>::Worker::InternalThreadEntry() {
+  const int max_batch_size = predictor_->max_batch_size_;
+  try {
+    while (!must_stop()) {
+      // Block for one job, then take whatever else is already queued to
+      // fill up the batch.
+      vector<Job*> jobs(1, predictor_->jobs_.pop());
+      int num = jobs[0]->size();
+      Job* job;
+      while (num < max_batch_size && predictor_->jobs_.try_pop(&job)) {
+        jobs.push_back(job);
+        num += job->size();
+      }
+      vector<std::pair<Job*, int> > items;
+      items.reserve(num);
+      for (int j = 0; j < jobs.size(); ++j) {
+        jobs[j]->results.resize(jobs[j]->size());
+        for (int i = 0; i < jobs[j]->size(); ++i) {
+          items.push_back(std::make_pair(jobs[j], i));
+        }
+      }
+      for (int begin = 0; begin < items.size(); begin += max_batch_size) {
+        Forward(items, begin,
+            std::min<int>(begin + max_batch_size, items.size()));
+      }
+      for (int j = 0; j < jobs.size(); ++j) {
+        jobs[j]->done(jobs[j]->results);
+        delete jobs[j];
+      }
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+template <typename Dtype>
+void Predictor<Dtype>::Worker::Forward(
+    const vector<std::pair<Job*, int> >& items, int begin, int end) {
+  Blob<Dtype>* input = net_->input_blobs()[0];
+  vector<int> shape = predictor_->input_shape_;
+  shape[0] = end - begin;
+  // Shrinking keeps the allocation, so a full-size batch allocates once.
+  input->Reshape(shape);
+  Dtype* input_data = input->mutable_cpu_data();
+  for (int i = begin; i < end; ++i) {
+    item_.set_cpu_data(input_data + input->offset(i - begin));
+    TransformItem(*items[i].first, items[i].second);
+  }
+  net_->Forward();
+
+  const Blob<Dtype>* output = net_->output_blobs()[0];
+  const int dim = output->count() / output->shape(0);
+  const Dtype* output_data = output->cpu_data();
+  for (int i = begin; i < end; ++i) {
+    const Dtype* scores = output_data + (i - begin) * dim;
+    Prediction<Dtype>& prediction = items[i].first->results[items[i].second];
+    prediction.scores.assign(scores, scores + dim);
+    const int top_k = std::min(items[i].first->top_k, dim);
+    if (top_k > 0) {
+      order_.resize(dim);
+      for (int d = 0; d < dim; ++d) {
+        order_[d] = d;
+      }
+      std::partial_sort(order_.begin(), order_.begin() + top_k, order_.end(),
+          ScoreGreater<Dtype>(scores));
+      prediction.top_k.assign(order_.begin(), order_.begin() + top_k);
+    }
+  }
+}
+
+template <typename Dtype>
+void Predictor<Dtype>::Worker::TransformItem(const Job& job, int index) {
+  if (index < job.datums.size()) {
+    transformer_.Transform(job.datums[index], &item_);
+    return;
+  }
+#ifdef USE_OPENCV
+  const cv::Mat* image = &job.images[index - job.datums.size()];
+  const int channels = item_.channels();
+  if (image->channels() != channels) {
+    if (image->channels() == 3 && channels == 1) {
+      cv::cvtColor(*image, converted_, cv::COLOR_BGR2GRAY);
+    } else if (image->channels() == 4 && channels == 1) {
+      cv::cvtColor(*image, converted_, cv::COLOR_BGRA2GRAY);
+    } else if (image->channels() == 4 && channels == 3) {
+      cv::cvtColor(*image, converted_, cv::COLOR_BGRA2BGR);
+    } else if (image->channels() == 1 && channels == 3) {
+      cv::cvtColor(*image, converted_, cv::COLOR_GRAY2BGR);
+    } else {
+      LOG(FATAL) << "Cannot convert an image with " << image->channels()
+          << " channels to " << channels;
+    }
+    image = &converted_;
+  }
+  const cv::Size geometry(item_.width(), item_.height());
+  if (!predictor_->transform_param_.crop_size() &&
+      image->size() != geometry) {
+    cv::resize(*image, resized_, geometry);
+    image = &resized_;
+  }
+  transformer_.Transform(*image, &item_);
+#endif  // USE_OPENCV
+}
+
+template <typename Dtype>
+Predictor<Dtype>::Predictor(const NetParameter& net_param,
+    const string& weights_file, const TransformationParameter& transform_param,
+    int num_workers, int max_batch_size)
+    : transform_param_(transform_param), max_batch_size_(max_batch_size) {
+  Init(net_param, weights_file, num_workers);
+}
+
+template <typename Dtype>
+Predictor<Dtype>::Predictor(const string& model_file,
+    const string& weights_file, const TransformationParameter& transform_param,
+    int num_workers, int max_batch_size)
+    : transform_param_(transform_param), max_batch_size_(max_batch_size) {
+  NetParameter net_param;
+  ReadNetParamsFromTextFileOrDie(model_file, &net_param);
+  Init(net_param, weights_file, num_workers);
+}
+
+template <typename Dtype>
+void Predictor<Dtype>::Init(const NetParameter& net_param,
+    const string& weights_file, int num_workers) {
+  CHECK_GT(num_workers, 0);
+  CHECK_GT(max_batch_size_, 0);
+  NetParameter param(net_param);
+  param.mutable_state()->set_phase(TEST);
+  for (int i = 0; i < num_workers; ++i) {
+    nets_.push_back(shared_ptr<Net<Dtype> >(new Net<Dtype>(param)));
+    if (i == 0) {
+      if (!weights_file.empty()) {
+        nets_[0]->CopyTrainedLayersFrom(weights_file);
+      }
+    } else {
+      nets_[i]->ShareTrainedLayersWith(nets_[0].get());
+    }
+  }
+  CHECK_EQ(nets_[0]->num_inputs(), 1) << "Network should have one input.";
+  CHECK_GE(nets_[0]->num_outputs(), 1) << "Network should have an output.";
+  input_shape_ = nets_[0]->input_blobs()[0]->shape();
+  CHECK_EQ(input_shape_.size(), 4) << "Input should be N x C x H x W.";
+  input_shape_[0] = 1;
+  if (transform_param_.crop_size()) {
+    CHECK_EQ(input_shape_[2], transform_param_.crop_size());
+    CHECK_EQ(input_shape_[3], transform_param_.crop_size());
+  }
+  // The replicas share the weights' SyncedMemory. Sync them to the device
+  // now, as the workers' first forward passes would otherwise race to.
+  const vector<shared_ptr<Blob<Dtype> > >& params = nets_[0]->params();
+  for (int i = 0; i < params.size(); ++i) {
+    if (Caffe::mode() == Caffe::GPU) {
+      params[i]->gpu_data();
+    } else {
+      params[i]->cpu_data();
+    }
+  }
+  for (int i = 0; i < num_workers; ++i) {
+    workers_.push_back(shared_ptr<Worker>(new Worker(this, nets_[i])));
+    workers_[i]->StartInternalThread();
+  }
+}
+
+template <typename Dtype>
+Predictor<Dtype>::~Predictor() {
+  workers_.clear();
+  Job* job;
+  while (jobs_.try_pop(&job)) {
+    // Complete the jobs no worker got to with no results, so that callers
+    // blocked in Predict return.
+    job->done(vector<Prediction<Dtype> >());
+    delete job;
+  }
+}
+
+template <typename Dtype>
+void Predictor<Dtype>::Submit(Job* job) {
+  if (job->size() == 0) {
+    job->done(job->results);
+    delete job;
+    return;
+  }
+  jobs_.push(job);
+}
+
+template <typename Dtype>
+void Predictor<Dtype>::PredictAsync(const vector<Datum>& datums, int top_k,
+    const Callback& done) {
+  Job* job = new Job();
+  job->datums = datums;
+  job->top_k = top_k;
+  job->done = done;
+  Submit(job);
+}
+
+template <typename Dtype>
+vector<Prediction<Dtype> > Predictor<Dtype>::Predict(
+    const vector<Datum>& datums, int top_k) {
+  PredictionWaiter<Dtype> waiter;
+  PredictAsync(datums, top_k,
+      boost::bind(&PredictionWaiter<Dtype>::Done, &waiter, _1));
+  return waiter.Wait();
+}
+
+#ifdef USE_OPENCV
+template <typename Dtype>
+void Predictor<Dtype>::PredictAsync(const vector<cv::Mat>& images,
+    int top_k, const Callback& done) {
+  Job* job = new Job();
+  job->images = images;
+  job->top_k = top_k;
+  job->done = done;
+  Submit(job);
+}
+
+template <typename Dtype>
+vector<Prediction<Dtype> > Predictor<Dtype>::Predict(
+    const vector<cv::Mat>& images, int top_k) {
+  PredictionWaiter<Dtype> waiter;
+  PredictAsync(images, top_k,
+      boost::bind(&PredictionWaiter<Dtype>::Done, &waiter, _1));
+  return waiter.Wait();
+}
+#endif  // USE_OPENCV
+
+INSTANTIATE_CLASS(Predictor);
+
+}  // namespace caffe
@@ -1,9 +1,15 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
 #include <cstdio>
 
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include "caffe/internal_thread.hpp"
+#include "caffe/layers/base_data_layer.hpp"
 #include "caffe/solver.hpp"
+#include "caffe/util/blocking_queue.hpp"
 #include "caffe/util/format.hpp"
 #include "caffe/util/hdf5.hpp"
 #include "caffe/util/io.hpp"
@@ -11,6 +17,71 @@
 
 namespace caffe {
 
+/**
+ * @brief Tests the test nets of a solver on a background thread, for
+ *        test_async.
+ *
+ * The solver copies its weights into the test nets, which share no blobs
+ * with the train net, then requests a test as of its current iteration.
+ * Tests run one at a time, in the order requested, so that data read in
+ * sequence reaches them as it would synchronous tests. Random numbers drawn
+ * in the forward passes come from this thread's generator instead, so layers
+ * drawing them, e.g. DummyData with random fillers, see different data.
+ */
+template <typename Dtype>
+class AsyncTester : public InternalThread {
+ public:
+  explicit AsyncTester(Solver<Dtype>* solver)
+      : solver_(solver), pending_(false) {
+    StartInternalThread();
+  }
+  virtual ~AsyncTester() {
+    StopInternalThread();
+  }
+
+  // Tests the nets, whose weights are those of the given iteration.
+  void Test(int iter) {
+    CHECK(!pending_) << "Wait for the previous test first.";
+    pending_ = true;
+    requests_.push(iter);
+  }
+  // Waits for the requested test, if any, to finish.
+  void Wait() {
+    if (pending_) {
+      done_.pop();
+      pending_ = false;
+    }
+  }
+
+ protected:
+  virtual void InternalThreadEntry() {
+    try {
+      while (!must_stop()) {
+        const int iter = requests_.pop();
+        std::ostringstream log_prefix;
+        log_prefix << "Iteration " << iter << ", ";
+        for (int i = 0; i < solver_->test_nets_.size(); ++i) {
+          LOG(INFO) << log_prefix.str() << "Testing net (#" << i
+              << ") in the background";
+          if (!solver_->TestNet(i, log_prefix.str(),
+                  boost::bind(&AsyncTester::must_stop, this))) {
+            break;
+          }
+        }
+        done_.push(iter);
+      }
+    } catch (boost::thread_interrupted&) {
+      // Interrupted while waiting, e.g. for test data.
+    }
+  }
+
+  Solver<Dtype>* solver_;
+  // Whether a test was requested and not waited for.
+  bool pending_;
+  BlockingQueue<int> requests_;
+  BlockingQueue<int> done_;
+};
+
 template<typename Dtype>
 void Solver<Dtype>::SetActionFunction(ActionCallback func) {
   action_request_function_ = func;
@@ -55,6 +126,11 @@ void Solver<Dtype>::Init(const SolverParameter& param) {
   }
   // Scaffolding code
   InitTrainNet();
+  if (param_.precision() != SolverParameter_Precision_FLOAT) {
+    CHECK_EQ(Caffe::solver_count(), 1)
+        << "Reduced precision training supports a single solver only.";
+    mixed_precision_.reset(new MixedPrecision<Dtype>(param_, net_.get()));
+  }
   if (Caffe::root_solver()) {
     InitTestNets();
     LOG(INFO) << "Solver scaffolding done.";
@@ -188,6 +264,10 @@ void Solver<Dtype>::InitTestNets() {
     }
     test_nets_[i]->set_debug_info(param_.debug_info());
   }
+  if (param_.test_async() && num_test_net_instances) {
+    CHECK(Caffe::root_solver());
+    async_tester_.reset(new AsyncTester<Dtype>(this));
+  }
 }
 
 template <typename Dtype>
@@ -216,6 +296,9 @@ void Solver<Dtype>::Step(int iters) {
     }
     const bool display = param_.display() && iter_ % param_.display() == 0;
     net_->set_debug_info(display && param_.debug_info());
+    if (mixed_precision_) {
+      mixed_precision_->Begin();
+    }
     // accumulate the loss and gradient
     Dtype loss = 0;
     for (int i = 0; i < param_.iter_size(); ++i) {
@@ -246,6 +329,9 @@ void Solver<Dtype>::Step(int iters) {
               << result_vec[k] << loss_msg_stream.str();
         }
       }
+      if (Caffe::root_solver()) {
+        DisplayDataPipelineStats();
+      }
     }
     for (int i = 0; i < callbacks_.size(); ++i) {
       callbacks_[i]->on_gradients_ready();
@@ -273,6 +359,20 @@ void Solver<Dtype>::Step(int iters) {
   }
 }
 
+template <typename Dtype>
+void Solver<Dtype>::DisplayDataPipelineStats() {
+  const vector<shared_ptr<Layer<Dtype> > >& layers = net_->layers();
+  for (int i = 0; i < layers.size(); ++i) {
+    BasePrefetchingDataLayer<Dtype>* data_layer =
+        dynamic_cast<BasePrefetchingDataLayer<Dtype>*>(layers[i].get());
+    if (data_layer) {
+      LOG(INFO) << "    Data layer " << net_->layer_names()[i] << ": "
+          << data_layer->pipeline_stats().Summary();
+      data_layer->ResetPipelineStats();
+    }
+  }
+}
+
 template <typename Dtype>
 void Solver<Dtype>::Solve(const char* resume_file) {
   CHECK(Caffe::root_solver());
@@ -319,11 +419,18 @@ void Solver<Dtype>::Solve(const char* resume_file) {
   if (param_.test_interval() && iter_ % param_.test_interval() == 0) {
     TestAll();
   }
+  if (async_tester_) {
+    async_tester_->Wait();
+  }
   LOG(INFO) << "Optimization Done.";
 }
 
 template <typename Dtype>
 void Solver<Dtype>::TestAll() {
+  if (async_tester_) {
+    TestAllAsync();
+    return;
+  }
   for (int test_net_id = 0;
        test_net_id < test_nets_.size() && !requested_early_exit_;
        ++test_net_id) {
@@ -331,6 +438,17 @@ void Solver<Dtype>::TestAll() {
   }
 }
 
+template <typename Dtype>
+void Solver<Dtype>::TestAllAsync() {
+  CHECK(Caffe::root_solver());
+  CHECK(async_tester_);
+  async_tester_->Wait();
+  for (int i = 0; i < test_nets_.size(); ++i) {
+    test_nets_[i]->CopyTrainedLayersFrom(net_.get());
+  }
+  async_tester_->Test(iter_);
+}
+
 template <typename Dtype>
 void Solver<Dtype>::Test(const int test_net_id) {
   CHECK(Caffe::root_solver());
@@ -338,24 +456,38 @@ void Solver<Dtype>::Test(const int test_net_id) {
             << ", Testing net (#" << test_net_id << ")";
   CHECK_NOTNULL(test_nets_[test_net_id].get())->
       ShareTrainedLayersWith(net_.get());
+  if (!TestNet(test_net_id, "",
+          boost::bind(&Solver<Dtype>::HandleTestRequests, this))) {
+    LOG(INFO)     << "Test interrupted.";
+  }
+}
+
+template <typename Dtype>
+bool Solver<Dtype>::HandleTestRequests() {
+  SolverAction::Enum request = GetRequestedAction();
+  // Check to see if stoppage of testing/training has been requested.
+  while (request != SolverAction::NONE) {
+      if (SolverAction::SNAPSHOT == request) {
+        Snapshot();
+      } else if (SolverAction::STOP == request) {
+        requested_early_exit_ = true;
+      }
+      request = GetRequestedAction();
+  }
+  return requested_early_exit_;
+}
+
+template <typename Dtype>
+bool Solver<Dtype>::TestNet(const int test_net_id, const string& log_prefix,
+    const boost::function<bool()>& stop) {
   vector<Dtype> test_score;
   vector<int> test_score_output_id;
   const shared_ptr<Net<Dtype> >& test_net = test_nets_[test_net_id];
   Dtype loss = 0;
   for (int i = 0; i < param_.test_iter(test_net_id); ++i) {
-    SolverAction::Enum request = GetRequestedAction();
-    // Check to see if stoppage of testing/training has been requested.
-    while (request != SolverAction::NONE) {
-        if (SolverAction::SNAPSHOT == request) {
-          Snapshot();
-        } else if (SolverAction::STOP == request) {
-          requested_early_exit_ = true;
-        }
-        request = GetRequestedAction();
-    }
-    if (requested_early_exit_) {
+    if (stop()) {
       // break out of test loop.
-      break;
+      return false;
     }
 
     Dtype iter_loss;
@@ -382,14 +514,12 @@ void Solver<Dtype>::Test(const int test_net_id) {
       }
     }
   }
-  if (requested_early_exit_) {
-    LOG(INFO)     << "Test interrupted.";
-    return;
-  }
   if (param_.test_compute_loss()) {
     loss /= param_.test_iter(test_net_id);
-    LOG(INFO) << "Test loss: " << loss;
+    LOG(INFO) << log_prefix << "Test loss: " << loss;
   }
+  // Synchronous outputs are indented under the "Testing net" line.
+  const string output_prefix = log_prefix.empty() ? "    " : log_prefix;
   for (int i = 0; i < test_score.size(); ++i) {
     const int output_blob_index =
         test_net->output_blob_indices()[test_score_output_id[i]];
@@ -401,9 +531,10 @@ void Solver<Dtype>::Test(const int test_net_id) {
       loss_msg_stream << " (* " << loss_weight
                       << " = " << loss_weight * mean_score << " loss)";
     }
-    LOG(INFO) << "    Test net output #" << i << ": " << output_name << " = "
-              << mean_score << loss_msg_stream.str();
+    LOG(INFO) << output_prefix << "Test net output #" << i << ": "
+              << output_name << " = " << mean_score << loss_msg_stream.str();
   }
+  return true;
 }
 
 template <typename Dtype>
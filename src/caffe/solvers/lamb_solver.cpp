@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "caffe/sgd_solvers.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+namespace caffe {
+
+#ifndef CPU_ONLY
+template <typename Dtype>
+int lamb_update_gpu(int N, const Dtype* w, Dtype* g, Dtype* m, Dtype* v,
+    Dtype beta1, Dtype beta2, Dtype correction1, Dtype correction2,
+    Dtype eps_hat, Dtype local_decay, Dtype* partial);
+#endif
+
+// Updates the moments and replaces g by the step r, summing the squares of
+// w and r in the same pass, over blocks that are summed in a fixed order so
+// that the result does not depend on the thread count.
+template <typename Dtype>
+static void lamb_update_cpu(int N, const Dtype* w, Dtype* g, Dtype* m,
+    Dtype* v, Dtype beta1, Dtype beta2, Dtype correction1, Dtype correction2,
+    Dtype eps_hat, Dtype local_decay, Dtype* sumsq_w, Dtype* sumsq_r) {
+  const int blocks = (N + kParallelGrain - 1) / kParallelGrain;
+  vector<Dtype> partial(2 * blocks);
+  Dtype* partial_data = partial.data();
+  parallel_for(blocks, 1, [=](int begin, int end) {
+    for (int b = begin; b < end; ++b) {
+      Dtype sum_w = 0;
+      Dtype sum_r = 0;
+      const int block_end = std::min(N, (b + 1) * kParallelGrain);
+      for (int i = b * kParallelGrain; i < block_end; ++i) {
+        const Dtype gi = g[i];
+        const Dtype mi = m[i] = beta1 * m[i] + (1 - beta1) * gi;
+        const Dtype vi = v[i] = beta2 * v[i] + (1 - beta2) * gi * gi;
+        const Dtype ri = correction1 * mi /
+            (std::sqrt(correction2 * vi) + eps_hat) + local_decay * w[i];
+        g[i] = ri;
+        sum_w += w[i] * w[i];
+        sum_r += ri * ri;
+      }
+      partial_data[2 * b] = sum_w;
+      partial_data[2 * b + 1] = sum_r;
+    }
+  });
+  *sumsq_w = 0;
+  *sumsq_r = 0;
+  for (int b = 0; b < blocks; ++b) {
+    *sumsq_w += partial[2 * b];
+    *sumsq_r += partial[2 * b + 1];
+  }
+}
+
+template <typename Dtype>
+void LAMBSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
+  const vector<Blob<Dtype>*>& net_params = this->net_->learnable_params();
+  const vector<float>& net_params_lr = this->net_->params_lr();
+  const vector<float>& net_params_weight_decay =
+      this->net_->params_weight_decay();
+  Blob<Dtype>* param = net_params[param_id];
+  const Dtype local_rate = rate * net_params_lr[param_id];
+  const Dtype local_decay =
+      this->param_.weight_decay() * net_params_weight_decay[param_id];
+  const Dtype beta1 = this->param_.momentum();
+  const Dtype beta2 = this->param_.momentum2();
+  const Dtype eps_hat = this->param_.delta();
+
+  // the moments, as in Adam
+  Blob<Dtype>* val_m = this->history_[param_id].get();
+  Blob<Dtype>* val_v = this->history_[param_id + net_params.size()].get();
+
+  // the bias corrections of the moments
+  const int t = this->iter_ + 1;
+  const Dtype correction1 = Dtype(1) / (Dtype(1) - pow(beta1, t));
+  const Dtype correction2 = Dtype(1) / (Dtype(1) - pow(beta2, t));
+  const int N = param->count();
+  Dtype sumsq_w = 0;
+  Dtype sumsq_r = 0;
+
+  switch (Caffe::mode()) {
+  case Caffe::CPU: {
+    lamb_update_cpu(N, param->cpu_data(), param->mutable_cpu_diff(),
+        val_m->mutable_cpu_data(), val_v->mutable_cpu_data(), beta1, beta2,
+        correction1, correction2, eps_hat, local_decay, &sumsq_w, &sumsq_r);
+    break;
+  }
+  case Caffe::GPU: {
+#ifndef CPU_ONLY
+    sumsq_.Reshape(vector<int>(1, 2 * CAFFE_HIP_NUM_THREADS));
+    const int blocks = lamb_update_gpu(N, param->gpu_data(),
+        param->mutable_gpu_diff(), val_m->mutable_gpu_data(),
+        val_v->mutable_gpu_data(), beta1, beta2, correction1, correction2,
+        eps_hat, local_decay, sumsq_.mutable_gpu_data());
+    const Dtype* partial = sumsq_.cpu_data();
+    for (int b = 0; b < blocks; ++b) {
+      sumsq_w += partial[2 * b];
+      sumsq_r += partial[2 * b + 1];
+    }
+#else
+    NO_GPU;
+#endif
+    break;
+  }
+  default:
+    LOG(FATAL) << "Unknown caffe mode: " << Caffe::mode();
+  }
+  // Blobs that are zero, or have no step, keep the global rate.
+  Dtype trust = 1;
+  if (sumsq_w > 0 && sumsq_r > 0) {
+    trust = std::sqrt(sumsq_w) / std::sqrt(sumsq_r);
+  }
+  param->scale_diff(local_rate * trust);
+}
+
+INSTANTIATE_CLASS(LAMBSolver);
+REGISTER_SOLVER_CLASS(LAMB);
+
+}  // namespace caffe
@@ -0,0 +1,60 @@
+#include <algorithm>
+
+#include "caffe/util/math_functions.hpp"
+
+
+namespace caffe {
+
+// Updates the moments and replaces g by the step r. Each block also sums
+// the squares of its share of w and r, and writes the two sums to
+// partial[2 * block] and partial[2 * block + 1].
+template <typename Dtype>
+__global__ void LAMBUpdate(int N, const Dtype* w, Dtype* g, Dtype* m,
+    Dtype* v, Dtype beta1, Dtype beta2, Dtype correction1, Dtype correction2,
+    Dtype eps_hat, Dtype local_decay, Dtype* partial) {
+  __shared__ Dtype sum_w[CAFFE_HIP_NUM_THREADS];
+  __shared__ Dtype sum_r[CAFFE_HIP_NUM_THREADS];
+  Dtype local_w = 0;
+  Dtype local_r = 0;
+  HIP_KERNEL_LOOP(i, N) {
+    Dtype gi = g[i];
+    Dtype mi = m[i] = m[i]*beta1 + gi*(1-beta1);
+    Dtype vi = v[i] = v[i]*beta2 + gi*gi*(1-beta2);
+    Dtype ri = g[i] = correction1 * mi / (sqrt(correction2 * vi) + eps_hat)
+        + local_decay * w[i];
+    local_w += w[i] * w[i];
+    local_r += ri * ri;
+  }
+  sum_w[hipThreadIdx_x] = local_w;
+  sum_r[hipThreadIdx_x] = local_r;
+  __syncthreads();
+  for (int s = hipBlockDim_x / 2; s > 0; s >>= 1) {
+    if (hipThreadIdx_x < s) {
+      sum_w[hipThreadIdx_x] += sum_w[hipThreadIdx_x + s];
+      sum_r[hipThreadIdx_x] += sum_r[hipThreadIdx_x + s];
+    }
+    __syncthreads();
+  }
+  if (hipThreadIdx_x == 0) {
+    partial[2 * hipBlockIdx_x] = sum_w[0];
+    partial[2 * hipBlockIdx_x + 1] = sum_r[0];
+  }
+}
+template <typename Dtype>
+int lamb_update_gpu(int N, const Dtype* w, Dtype* g, Dtype* m, Dtype* v,
+    Dtype beta1, Dtype beta2, Dtype correction1, Dtype correction2,
+    Dtype eps_hat, Dtype local_decay, Dtype* partial) {
+  // At most CAFFE_HIP_NUM_THREADS blocks, each looping over its share.
+  const int blocks = std::min(CAFFE_GET_BLOCKS(N), CAFFE_HIP_NUM_THREADS);
+  hipLaunchKernelGGL(LAMBUpdate<Dtype>,  // NOLINT_NEXT_LINE(whitespace/operators)
+      dim3(blocks), dim3(CAFFE_HIP_NUM_THREADS), 0, 0,
+      N, w, g, m, v, beta1, beta2, correction1, correction2, eps_hat,
+      local_decay, partial);
+  return blocks;
+}
+template int lamb_update_gpu<float>(int, const float*, float*, float*,
+    float*, float, float, float, float, float, float, float*);
+template int lamb_update_gpu<double>(int, const double*, double*, double*,
+    double*, double, double, double, double, double, double, double*);
+
+}  // namespace caffe
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "caffe/sgd_solvers.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+namespace caffe {
+
+#ifndef CPU_ONLY
+template <typename Dtype>
+int lars_sumsq_gpu(int N, const Dtype* w, const Dtype* g, Dtype* partial);
+#endif
+
+// Sums the squares of w and g in one pass, over blocks that are summed in
+// a fixed order so that the result does not depend on the thread count.
+template <typename Dtype>
+static void lars_sumsq_cpu(int N, const Dtype* w, const Dtype* g,
+    Dtype* sumsq_w, Dtype* sumsq_g) {
+  const int blocks = (N + kParallelGrain - 1) / kParallelGrain;
+  vector<Dtype> partial(2 * blocks);
+  Dtype* partial_data = partial.data();
+  parallel_for(blocks, 1, [=](int begin, int end) {
+    for (int b = begin; b < end; ++b) {
+      Dtype sum_w = 0;
+      Dtype sum_g = 0;
+      const int block_end = std::min(N, (b + 1) * kParallelGrain);
+      for (int i = b * kParallelGrain; i < block_end; ++i) {
+        sum_w += w[i] * w[i];
+        sum_g += g[i] * g[i];
+      }
+      partial_data[2 * b] = sum_w;
+      partial_data[2 * b + 1] = sum_g;
+    }
+  });
+  *sumsq_w = 0;
+  *sumsq_g = 0;
+  for (int b = 0; b < blocks; ++b) {
+    *sumsq_w += partial[2 * b];
+    *sumsq_g += partial[2 * b + 1];
+  }
+}
+
+template <typename Dtype>
+void LARSSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
+  Blob<Dtype>* param = this->net_->learnable_params()[param_id];
+  const int N = param->count();
+  Dtype sumsq_w = 0;
+  Dtype sumsq_g = 0;
+  switch (Caffe::mode()) {
+  case Caffe::CPU: {
+    lars_sumsq_cpu(N, param->cpu_data(), param->cpu_diff(), &sumsq_w,
+        &sumsq_g);
+    break;
+  }
+  case Caffe::GPU: {
+#ifndef CPU_ONLY
+    sumsq_.Reshape(vector<int>(1, 2 * CAFFE_HIP_NUM_THREADS));
+    const int blocks = lars_sumsq_gpu(N, param->gpu_data(), param->gpu_diff(),
+        sumsq_.mutable_gpu_data());
+    const Dtype* partial = sumsq_.cpu_data();
+    for (int b = 0; b < blocks; ++b) {
+      sumsq_w += partial[2 * b];
+      sumsq_g += partial[2 * b + 1];
+    }
+#else
+    NO_GPU;
+#endif
+    break;
+  }
+  default:
+    LOG(FATAL) << "Unknown caffe mode: " << Caffe::mode();
+  }
+  // Blobs that are zero, or have no gradient, keep the global rate.
+  Dtype trust = 1;
+  if (sumsq_w > 0 && sumsq_g > 0) {
+    trust = this->param_.trust_coefficient() *
+        std::sqrt(sumsq_w) / std::sqrt(sumsq_g);
+  }
+  // The momentum update of SGD, with the scaled rate.
+  SGDSolver<Dtype>::ComputeUpdateValue(param_id, rate * trust);
+}
+
+INSTANTIATE_CLASS(LARSSolver);
+REGISTER_SOLVER_CLASS(LARS);
+
+}  // namespace caffe
@@ -0,0 +1,49 @@
+#include <algorithm>
+
+#include "caffe/util/math_functions.hpp"
+
+
+namespace caffe {
+
+// Each block sums the squares of its share of w and g, and writes the two
+// sums to partial[2 * block] and partial[2 * block + 1].
+template <typename Dtype>
+__global__ void LARSSumSquares(int N, const Dtype* w, const Dtype* g,
+    Dtype* partial) {
+  __shared__ Dtype sum_w[CAFFE_HIP_NUM_THREADS];
+  __shared__ Dtype sum_g[CAFFE_HIP_NUM_THREADS];
+  Dtype local_w = 0;
+  Dtype local_g = 0;
+  HIP_KERNEL_LOOP(i, N) {
+    local_w += w[i] * w[i];
+    local_g += g[i] * g[i];
+  }
+  sum_w[hipThreadIdx_x] = local_w;
+  sum_g[hipThreadIdx_x] = local_g;
+  __syncthreads();
+  for (int s = hipBlockDim_x / 2; s > 0; s >>= 1) {
+    if (hipThreadIdx_x < s) {
+      sum_w[hipThreadIdx_x] += sum_w[hipThreadIdx_x + s];
+      sum_g[hipThreadIdx_x] += sum_g[hipThreadIdx_x + s];
+    }
+    __syncthreads();
+  }
+  if (hipThreadIdx_x == 0) {
+    partial[2 * hipBlockIdx_x] = sum_w[0];
+    partial[2 * hipBlockIdx_x + 1] = sum_g[0];
+  }
+}
+template <typename Dtype>
+int lars_sumsq_gpu(int N, const Dtype* w, const Dtype* g, Dtype* partial) {
+  // At most CAFFE_HIP_NUM_THREADS blocks, each looping over its share.
+  const int blocks = std::min(CAFFE_GET_BLOCKS(N), CAFFE_HIP_NUM_THREADS);
+  hipLaunchKernelGGL(LARSSumSquares<Dtype>,  // NOLINT_NEXT_LINE(whitespace/operators)
+      dim3(blocks), dim3(CAFFE_HIP_NUM_THREADS), 0, 0,
+      N, w, g, partial);
+  return blocks;
+}
+template int lars_sumsq_gpu<float>(int, const float*, const float*, float*);
+template int lars_sumsq_gpu<double>(int, const double*, const double*,
+    double*);
+
+}  // namespace caffe
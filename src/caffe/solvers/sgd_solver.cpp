@@ -105,6 +105,10 @@ void SGDSolver<Dtype>::ApplyUpdate() {
   if (this->param_.display() && this->iter_ % this->param_.display() == 0) {
     LOG(INFO) << "Iteration " << this->iter_ << ", lr = " << rate;
   }
+  if (this->mixed_precision_ && !this->mixed_precision_->End()) {
+    // The gradients overflowed in the reduced precision.
+    return;
+  }
   ClipGradients();
   for (int param_id = 0; param_id < this->net_->learnable_params().size();
        ++param_id) {
@@ -263,6 +267,10 @@ void SGDSolver<Dtype>::SnapshotSolverStateToBinaryProto(
   state.set_iter(this->iter_);
   state.set_learned_net(model_filename);
   state.set_current_step(this->current_step_);
+  if (this->mixed_precision_) {
+    state.set_loss_scale(this->mixed_precision_->loss_scale());
+    state.set_loss_scale_iter(this->mixed_precision_->loss_scale_iter());
+  }
   state.clear_history();
   for (int i = 0; i < history_.size(); ++i) {
     // Add history
@@ -288,6 +296,12 @@ void SGDSolver<Dtype>::SnapshotSolverStateToHDF5(
   hdf5_save_int(file_hid, "iter", this->iter_);
   hdf5_save_string(file_hid, "learned_net", model_filename);
   hdf5_save_int(file_hid, "current_step", this->current_step_);
+  if (this->mixed_precision_) {
+    hdf5_save_float(file_hid, "loss_scale",
+        this->mixed_precision_->loss_scale());
+    hdf5_save_int(file_hid, "loss_scale_iter",
+        this->mixed_precision_->loss_scale_iter());
+  }
   hid_t history_hid = H5Gcreate2(file_hid, "history", H5P_DEFAULT, H5P_DEFAULT,
       H5P_DEFAULT);
   CHECK_GE(history_hid, 0)
@@ -313,6 +327,10 @@ void SGDSolver<Dtype>::RestoreSolverStateFromBinaryProto(
     this->net_->CopyTrainedLayersFrom(net_param);
   }
   this->current_step_ = state.current_step();
+  if (this->mixed_precision_ && state.has_loss_scale()) {
+    this->mixed_precision_->set_loss_scale(state.loss_scale(),
+        state.loss_scale_iter());
+  }
   CHECK_EQ(state.history_size(), history_.size())
       << "Incorrect length of history blobs.";
   LOG(INFO) << "SGDSolver: restoring history";
@@ -331,6 +349,11 @@ void SGDSolver<Dtype>::RestoreSolverStateFromHDF5(const string& state_file) {
     this->net_->CopyTrainedLayersFrom(learned_net);
   }
   this->current_step_ = hdf5_load_int(file_hid, "current_step");
+  if (this->mixed_precision_ && H5LTfind_dataset(file_hid, "loss_scale")) {
+    this->mixed_precision_->set_loss_scale(
+        hdf5_load_float(file_hid, "loss_scale"),
+        hdf5_load_int(file_hid, "loss_scale_iter"));
+  }
   hid_t history_hid = H5Gopen2(file_hid, "history", H5P_DEFAULT);
   CHECK_GE(history_hid, 0) << "Error reading history from " << state_file;
   int state_history_size = hdf5_get_num_links(history_hid);
@@ -1,12 +1,96 @@
+#include <atomic>
+#include <string>
+
 #include "caffe/common.hpp"
 #include "caffe/syncedmem.hpp"
 #include "caffe/util/math_functions.hpp"
 
 namespace caffe {
 
+class MemoryAccount::Counters {
+ public:
+  Counters() {
+    for (int i = 0; i < 2; ++i) {
+      live_[i] = 0;
+      peak_[i] = 0;
+    }
+  }
+
+  std::atomic<size_t> live_[2];
+  std::atomic<size_t> peak_[2];
+};
+
+// The account in scope on each thread. Only the Scope objects, which live on
+// the thread's stack, hold the shared_ptr.
+static thread_local const shared_ptr<MemoryAccount>* current_account = NULL;
+
+MemoryAccount::MemoryAccount(const string& name)
+    : name_(name), counters_(new Counters()) {}
+
+MemoryAccount::~MemoryAccount() {}
+
+size_t MemoryAccount::live_bytes(Location location) const {
+  return counters_->live_[location].load();
+}
+
+size_t MemoryAccount::peak_bytes(Location location) const {
+  return counters_->peak_[location].load();
+}
+
+void MemoryAccount::ResetPeak() {
+  for (int i = 0; i < 2; ++i) {
+    counters_->peak_[i] = counters_->live_[i].load();
+  }
+}
+
+void MemoryAccount::Allocate(Location location, size_t size) {
+  const size_t live = counters_->live_[location].fetch_add(size) + size;
+  size_t peak = counters_->peak_[location].load();
+  while (live > peak &&
+      !counters_->peak_[location].compare_exchange_weak(peak, live)) {}
+}
+
+void MemoryAccount::Free(Location location, size_t size) {
+  counters_->live_[location].fetch_sub(size);
+}
+
+MemoryAccount& MemoryAccount::Total() {
+  // Never destroyed, so that SyncedMemory freed at exit can still refund it.
+  static MemoryAccount* total = new MemoryAccount("total");
+  return *total;
+}
+
+shared_ptr<MemoryAccount> MemoryAccount::Current() {
+  return current_account ? *current_account : shared_ptr<MemoryAccount>();
+}
+
+MemoryAccount::Scope::Scope(const shared_ptr<MemoryAccount>& account)
+    : previous_(current_account) {
+  current_account = &account;
+}
+
+MemoryAccount::Scope::~Scope() {
+  current_account = previous_;
+}
+
+void SyncedMemory::Charge(MemoryAccount::Location location) {
+  MemoryAccount::Total().Allocate(location, size_);
+  if (account_) {
+    account_->Allocate(location, size_);
+  }
+}
+
+void SyncedMemory::Refund(MemoryAccount::Location location) {
+  MemoryAccount::Total().Free(location, size_);
+  if (account_) {
+    account_->Free(location, size_);
+  }
+}
+
 SyncedMemory::~SyncedMemory() {
   if (cpu_ptr_ && own_cpu_data_) {
     CaffeFreeHost(cpu_ptr_, cpu_malloc_use_hip_);
+    Refund(MemoryAccount::HOST);
   }
 
 #ifndef CPU_ONLY
@@ -18,6 +102,7 @@ SyncedMemory::~SyncedMemory() {
     }
     HIP_CHECK(hipFree(gpu_ptr_));
     hipSetDevice(initial_device);
+    Refund(MemoryAccount::DEVICE);
   }
 #endif  // CPU_ONLY
 }
@@ -26,6 +111,7 @@ inline void SyncedMemory::to_cpu() {
   switch (head_) {
   case UNINITIALIZED:
     CaffeMallocHost(&cpu_ptr_, size_, &cpu_malloc_use_hip_);
+    Charge(MemoryAccount::HOST);
     caffe_memset(size_, 0, cpu_ptr_);
     head_ = HEAD_AT_CPU;
     own_cpu_data_ = true;
@@ -34,6 +120,7 @@ inline void SyncedMemory::to_cpu() {
 #ifndef CPU_ONLY
     if (cpu_ptr_ == NULL) {
       CaffeMallocHost(&cpu_ptr_, size_, &cpu_malloc_use_hip_);
+      Charge(MemoryAccount::HOST);
       own_cpu_data_ = true;
     }
     caffe_gpu_memcpy(size_, gpu_ptr_, cpu_ptr_);
@@ -54,6 +141,7 @@ inline void SyncedMemory::to_gpu() {
   case UNINITIALIZED:
     HIP_CHECK(hipGetDevice(&gpu_device_));
     HIP_CHECK(hipMalloc(&gpu_ptr_, size_));
+    Charge(MemoryAccount::DEVICE);
     caffe_gpu_memset(size_, 0, gpu_ptr_);
     head_ = HEAD_AT_GPU;
     own_gpu_data_ = true;
@@ -62,6 +150,7 @@ inline void SyncedMemory::to_gpu() {
     if (gpu_ptr_ == NULL) {
       HIP_CHECK(hipGetDevice(&gpu_device_));
       HIP_CHECK(hipMalloc(&gpu_ptr_, size_));
+      Charge(MemoryAccount::DEVICE);
       own_gpu_data_ = true;
     }
     caffe_gpu_memcpy(size_, cpu_ptr_, gpu_ptr_);
@@ -85,6 +174,7 @@ void SyncedMemory::set_cpu_data(void* data) {
   CHECK(data);
   if (own_cpu_data_) {
     CaffeFreeHost(cpu_ptr_, cpu_malloc_use_hip_);
+    Refund(MemoryAccount::HOST);
   }
   cpu_ptr_ = data;
   head_ = HEAD_AT_CPU;
@@ -112,6 +202,7 @@ void SyncedMemory::set_gpu_data(void* data) {
     }
     HIP_CHECK(hipFree(gpu_ptr_));
     hipSetDevice(initial_device);
+    Refund(MemoryAccount::DEVICE);
   }
   gpu_ptr_ = data;
   head_ = HEAD_AT_GPU;
@@ -144,6 +235,7 @@ void SyncedMemory::async_gpu_push(const hipStream_t& stream) {
   if (gpu_ptr_ == NULL) {
     HIP_CHECK(hipGetDevice(&gpu_device_));
     HIP_CHECK(hipMalloc(&gpu_ptr_, size_));
+    Charge(MemoryAccount::DEVICE);
     own_gpu_data_ = true;
   }
   const hipMemcpyKind put = hipMemcpyHostToDevice;
@@ -0,0 +1,150 @@
+#include <boost/thread.hpp>
+
+#include <string>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+
+#include "caffe/autotuner.hpp"
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layers/conv_layer.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/io.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class AutotunerTest : public CPUDeviceTest<TypeParam> {
+ protected:
+  AutotunerTest() {
+    MakeTempFilename(&cache_file_);
+    const string proto =
+        "name: 'TunedNet' "
+        "layer { "
+        "  name: 'data' type: 'DummyData' top: 'data' "
+        "  dummy_data_param { shape { dim: 4 dim: 3 dim: 8 dim: 8 } } "
+        "} "
+        "layer { "
+        "  name: 'conv' type: 'Convolution' bottom: 'data' top: 'conv' "
+        "  convolution_param { "
+        "    num_output: 4 kernel_size: 3 "
+        "    weight_filler { type: 'gaussian' } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'ip' type: 'InnerProduct' bottom: 'conv' top: 'ip' "
+        "  inner_product_param { num_output: 2 } "
+        "} ";
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param_));
+  }
+
+  virtual ~AutotunerTest() {
+    Caffe::set_autotune_cache("");
+    remove(cache_file_.c_str());
+  }
+
+  string cache_file_;
+  NetParameter param_;
+};
+
+TYPED_TEST_CASE(AutotunerTest, TestDtypes);
+
+TYPED_TEST(AutotunerTest, TestTuneNet) {
+  Caffe::set_autotune_cache(this->cache_file_);
+  Net<TypeParam> net(this->param_);
+  AutotuneCache cache;
+  ASSERT_TRUE(ReadProtoFromTextFile(this->cache_file_, &cache));
+  ASSERT_EQ(2, cache.result_size());
+  // The conv and ip layers, in order.
+  const int layer_ids[] = { 1, 2 };
+  for (int i = 0; i < 2; ++i) {
+    const AutotuneResult& result = cache.result(i);
+    EXPECT_EQ(Autotuner<TypeParam>::CpuModel(), result.cpu());
+    const int id = layer_ids[i];
+    const Layer<TypeParam>& layer = *net.layers()[id];
+    EXPECT_EQ(Autotuner<TypeParam>::LayerKey(layer, net.bottom_vecs()[id]),
+        result.layer());
+    EXPECT_EQ(layer.cpu_algorithms()[layer.cpu_algorithm()],
+        result.algorithm());
+    EXPECT_EQ(layer.cpu_threads(), result.threads());
+    EXPECT_GE(result.time_us(), 0);
+  }
+  // Tuning leaves no gradients behind.
+  const Blob<TypeParam>& weights = *net.layer_by_name("conv")->blobs()[0];
+  for (int i = 0; i < weights.count(); ++i) {
+    EXPECT_EQ(0, weights.cpu_diff()[i]);
+  }
+}
+
+TYPED_TEST(AutotunerTest, TestReuseCache) {
+  Caffe::set_autotune_cache(this->cache_file_);
+  {
+    Net<TypeParam> net(this->param_);
+  }
+  // Nets with the same layers apply the cached choices without tuning.
+  AutotuneCache cache;
+  ASSERT_TRUE(ReadProtoFromTextFile(this->cache_file_, &cache));
+  ASSERT_EQ(2, cache.result_size());
+  cache.mutable_result(0)->set_algorithm("batched_gemm");
+  cache.mutable_result(0)->set_threads(1);
+  WriteProtoToTextFile(cache, this->cache_file_);
+  this->param_.set_name("SameLayers");
+  Net<TypeParam> net(this->param_);
+  EXPECT_EQ(1, net.layer_by_name("conv")->cpu_algorithm());
+  EXPECT_EQ(1, net.layer_by_name("conv")->cpu_threads());
+  AutotuneCache reread;
+  ASSERT_TRUE(ReadProtoFromTextFile(this->cache_file_, &reread));
+  EXPECT_EQ(2, reread.result_size());
+}
+
+template <typename Dtype>
+void CreateTunedNet(const NetParameter* param) {
+  Caffe::set_mode(Caffe::CPU);
+  Net<Dtype> net(*param);
+}
+
+TYPED_TEST(AutotunerTest, TestConcurrentNets) {
+  Caffe::set_autotune_cache(this->cache_file_);
+  // Nets with different layers tune at the same time, each keeping the
+  // other's results.
+  vector<NetParameter> params(4, this->param_);
+  boost::thread_group threads;
+  for (int i = 0; i < params.size(); ++i) {
+    params[i].mutable_layer(1)->mutable_convolution_param()->set_num_output(
+        i + 1);
+    threads.create_thread(boost::bind(&CreateTunedNet<TypeParam>,
+        &params[i]));
+  }
+  threads.join_all();
+  AutotuneCache cache;
+  ASSERT_TRUE(ReadProtoFromTextFile(this->cache_file_, &cache));
+  // A conv and an ip layer per net.
+  EXPECT_EQ(8, cache.result_size());
+}
+
+TYPED_TEST(AutotunerTest, TestLayerKey) {
+  Net<TypeParam> net(this->param_);
+  const Layer<TypeParam>& conv = *net.layer_by_name("conv");
+  const vector<Blob<TypeParam>*>& bottom = net.bottom_vecs()[1];
+  const string key = Autotuner<TypeParam>::LayerKey(conv, bottom);
+  // Names and fillers do not matter.
+  LayerParameter renamed(conv.layer_param());
+  renamed.set_name("other");
+  renamed.mutable_convolution_param()->mutable_weight_filler()->set_std(2);
+  EXPECT_EQ(key, Autotuner<TypeParam>::LayerKey(
+      ConvolutionLayer<TypeParam>(renamed), bottom));
+  // The geometry does.
+  LayerParameter wider(conv.layer_param());
+  wider.mutable_convolution_param()->set_num_output(8);
+  EXPECT_NE(key, Autotuner<TypeParam>::LayerKey(
+      ConvolutionLayer<TypeParam>(wider), bottom));
+  Blob<TypeParam> larger(4, 3, 16, 16);
+  EXPECT_NE(key, Autotuner<TypeParam>::LayerKey(
+      conv, vector<Blob<TypeParam>*>(1, &larger)));
+}
+
+}  // namespace caffe
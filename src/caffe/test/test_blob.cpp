@@ -59,6 +59,26 @@ TYPED_TEST(BlobSimpleTest, TestReshapeZero) {
   EXPECT_EQ(this->blob_->count(), 0);
 }
 
+TYPED_TEST(BlobSimpleTest, TestShareDataMemory) {
+  vector<TypeParam> external(24, TypeParam(3));
+  this->blob_->Reshape(2, 3, 5, 1);
+  this->blob_->Reshape(2, 3, 4, 1);
+  shared_ptr<SyncedMemory> memory(
+      new SyncedMemory(external.size() * sizeof(TypeParam)));
+  memory->set_cpu_data(external.data());
+  this->blob_->ShareDataMemory(memory);
+  EXPECT_EQ(this->blob_->cpu_data(), external.data());
+  this->blob_->mutable_cpu_data()[5] = 7;
+  EXPECT_EQ(external[5], 7);
+  // Shrinking keeps the external memory; growing past it reallocates even
+  // within the blob's capacity.
+  this->blob_->Reshape(2, 3, 2, 1);
+  EXPECT_EQ(this->blob_->cpu_data(), external.data());
+  this->blob_->Reshape(2, 3, 5, 1);
+  EXPECT_NE(this->blob_->cpu_data(), external.data());
+  EXPECT_EQ(memory.use_count(), 1);
+}
+
 TYPED_TEST(BlobSimpleTest, TestLegacyBlobProtoShapeEquals) {
   BlobProto blob_proto;
 
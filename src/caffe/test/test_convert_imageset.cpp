@@ -0,0 +1,88 @@
+#if defined(USE_LMDB) && defined(USE_OPENCV)
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/scoped_ptr.hpp"
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/convert_imageset.hpp"
+#include "caffe/util/db.hpp"
+#include "caffe/util/io.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+using boost::scoped_ptr;
+
+class ConvertImagesetTest : public ::testing::Test {
+ protected:
+  ConvertImagesetTest()
+      : root_images_(string(EXAMPLES_SOURCE_DIR) + string("images/")) {
+    const string files[] = {"cat.jpg", "fish-bike.jpg", "cat_gray.jpg",
+        "missing.jpg"};
+    for (int i = 0; i < 23; ++i) {
+      lines_.push_back(std::make_pair(files[i % 4], i));
+    }
+    options_.resize_height = 32;
+    options_.resize_width = 48;
+    options_.chunk_size = 2;
+  }
+
+  // Converts the images into a new DB and reads back its keys and values.
+  int Convert(vector<std::pair<string, string> >* entries) {
+    string source;
+    MakeTempDir(&source);
+    source += "/db";
+    scoped_ptr<db::DB> db(db::GetDB("lmdb"));
+    db->Open(source, db::NEW);
+    const int count = ConvertImageset(lines_, root_images_, options_,
+        db.get(), NULL);
+    db->Close();
+    db->Open(source, db::READ);
+    scoped_ptr<db::Cursor> cursor(db->NewCursor());
+    entries->clear();
+    for (cursor->SeekToFirst(); cursor->valid(); cursor->Next()) {
+      entries->push_back(std::make_pair(cursor->key(), cursor->value()));
+    }
+    return count;
+  }
+
+  string root_images_;
+  vector<std::pair<string, int> > lines_;
+  ConvertImagesetOptions options_;
+};
+
+TEST_F(ConvertImagesetTest, TestThreadsMatchSingleThread) {
+  vector<std::pair<string, string> > expected;
+  options_.num_threads = 1;
+  // The missing images are skipped.
+  EXPECT_EQ(18, Convert(&expected));
+  ASSERT_EQ(18, expected.size());
+  EXPECT_EQ("00000000_cat.jpg", expected[0].first);
+  Datum datum;
+  ASSERT_TRUE(datum.ParseFromString(expected[17].second));
+  EXPECT_EQ(22, datum.label());
+  EXPECT_EQ(32, datum.height());
+  EXPECT_EQ(48, datum.width());
+  // The next chunks are converted while the current one is written, and the
+  // DB must not depend on how the threads interleave.
+  for (int num_threads = 2; num_threads <= 4; ++num_threads) {
+    for (int chunk_size = 1; chunk_size <= 3; ++chunk_size) {
+      options_.num_threads = num_threads;
+      options_.chunk_size = chunk_size;
+      vector<std::pair<string, string> > entries;
+      EXPECT_EQ(18, Convert(&entries));
+      ASSERT_EQ(expected.size(), entries.size());
+      for (int i = 0; i < entries.size(); ++i) {
+        EXPECT_EQ(expected[i].first, entries[i].first);
+        EXPECT_TRUE(expected[i].second == entries[i].second);
+      }
+    }
+  }
+}
+
+}  // namespace caffe
+#endif  // USE_LMDB && USE_OPENCV
@@ -10,6 +10,7 @@
 #include "caffe/filler.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/io.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
 
@@ -340,5 +341,67 @@ TYPED_TEST(DataTransformTest, TestMeanFile) {
   }
 }
 
+TYPED_TEST(DataTransformTest, TestCropParallel) {
+  TransformationParameter transform_param;
+  const bool unique_pixels = true;  // pixels are consecutive ints [0,size]
+  const int label = 0;
+  const int channels = 3;
+  // Enough rows to split the loop over the threads of the pool.
+  const int height = 256;
+  const int width = 256;
+  const int crop_size = 200;
+  const int offset = (height - crop_size) / 2;
+
+  transform_param.set_crop_size(crop_size);
+  Datum datum;
+  FillDatum(label, channels, height, width, unique_pixels, &datum);
+  Blob<TypeParam> blob(1, channels, crop_size, crop_size);
+  DataTransformer<TypeParam> transformer(transform_param, TEST);
+  transformer.InitRand();
+  const int threads = ThreadPool::num_threads();
+  ThreadPool::SetNumThreads(4);
+  transformer.Transform(datum, &blob);
+  ThreadPool::SetNumThreads(threads);
+  for (int c = 0; c < channels; ++c) {
+    for (int h = 0; h < crop_size; ++h) {
+      for (int w = 0; w < crop_size; ++w) {
+        const int index = (c * height + offset + h) * width + offset + w;
+        EXPECT_EQ(blob.data_at(0, c, h, w), static_cast<uint8_t>(index));
+      }
+    }
+  }
+}
+
+TYPED_TEST(DataTransformTest, TestMatParallel) {
+  TransformationParameter transform_param;
+  const int channels = 3;
+  // Enough rows to split the loop over the threads of the pool.
+  const int height = 256;
+  const int width = 256;
+
+  cv::Mat cv_img(height, width, CV_8UC3);
+  for (int h = 0; h < height; ++h) {
+    uchar* ptr = cv_img.ptr<uchar>(h);
+    for (int i = 0; i < width * channels; ++i) {
+      ptr[i] = static_cast<uchar>(h + i);
+    }
+  }
+  Blob<TypeParam> blob(1, channels, height, width);
+  DataTransformer<TypeParam> transformer(transform_param, TEST);
+  transformer.InitRand();
+  const int threads = ThreadPool::num_threads();
+  ThreadPool::SetNumThreads(4);
+  transformer.Transform(cv_img, &blob);
+  ThreadPool::SetNumThreads(threads);
+  for (int c = 0; c < channels; ++c) {
+    for (int h = 0; h < height; ++h) {
+      for (int w = 0; w < width; ++w) {
+        EXPECT_EQ(blob.data_at(0, c, h, w),
+            static_cast<uchar>(h + w * channels + c));
+      }
+    }
+  }
+}
+
 }  // namespace caffe
 #endif  // USE_OPENCV
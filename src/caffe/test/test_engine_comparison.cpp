@@ -0,0 +1,137 @@
+#include <string>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/engine_comparison.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class EngineComparisonTest : public ::testing::Test {
+ protected:
+  EngineComparisonTest() : threads_(ThreadPool::num_threads()) {
+    Caffe::set_mode(Caffe::CPU);
+    ThreadPool::SetNumThreads(2);
+    const string proto =
+        "name: 'ComparedNet' "
+        "layer { "
+        "  name: 'data' type: 'Input' top: 'data' "
+        "  input_param { shape { dim: 2 dim: 3 dim: 8 dim: 8 } } "
+        "} "
+        "layer { "
+        "  name: 'conv' type: 'Convolution' bottom: 'data' top: 'conv' "
+        "  convolution_param { "
+        "    num_output: 4 kernel_size: 3 "
+        "    weight_filler { type: 'gaussian' } "
+        "    bias_filler { type: 'gaussian' } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'relu' type: 'ReLU' bottom: 'conv' top: 'relu' "
+        "} ";
+    NetParameter param;
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+    net_.reset(new Net<float>(param));
+    Blob<float>* input = net_->input_blobs()[0];
+    caffe_rng_gaussian<float>(input->count(), 0, 1,
+        input->mutable_cpu_data());
+  }
+
+  virtual ~EngineComparisonTest() {
+    ThreadPool::SetNumThreads(threads_);
+  }
+
+  // Runs the layer under the variant, forward and backward, on the inputs
+  // it sees in the net.
+  bool Run(int layer_id, const EngineVariant& variant, BlobVec* top_diffs,
+      EngineResult* result) {
+    const BlobVec inputs = CopyBlobs(net_->bottom_vecs()[layer_id], false);
+    return RunLayerVariant(variant, net_->layers()[layer_id].get(), inputs,
+        net_->top_vecs()[layer_id].size(),
+        vector<bool>(inputs.size(), true), true, 1, top_diffs, result);
+  }
+
+  const int threads_;
+  shared_ptr<Net<float> > net_;
+};
+
+TEST_F(EngineComparisonTest, TestCpuVariants) {
+  const vector<EngineVariant> variants = EngineVariants(*net_, false);
+  vector<string> names;
+  for (int i = 0; i < variants.size(); ++i) {
+    names.push_back(variants[i].name());
+  }
+  // Without a GPU the CPU variants alone must still give a comparison.
+  ASSERT_EQ(4, names.size());
+  EXPECT_EQ("CAFFE/CPUx1", names[0]);
+  EXPECT_EQ("CAFFE/CPUx2", names[1]);
+  EXPECT_EQ("CAFFE/CPUx2:batched_gemm", names[2]);
+  EXPECT_EQ("CAFFE/CPUx2:gemm", names[3]);
+}
+
+TEST_F(EngineComparisonTest, TestSingleThreadHasNoThreadedVariant) {
+  ThreadPool::SetNumThreads(1);
+  const vector<EngineVariant> variants = EngineVariants(*net_, false);
+  // The reference, then only the CPU implementations of the convolution.
+  ASSERT_EQ(3, variants.size());
+  EXPECT_EQ("CAFFE/CPUx1", variants[0].name());
+  EXPECT_EQ("CAFFE/CPUx1:batched_gemm", variants[1].name());
+  EXPECT_EQ("CAFFE/CPUx1:gemm", variants[2].name());
+}
+
+TEST_F(EngineComparisonTest, TestVariantsAgree) {
+  const int conv = 1;
+  const vector<EngineVariant> variants = EngineVariants(*net_, false);
+  BlobVec top_diffs;
+  EngineResult reference;
+  ASSERT_TRUE(Run(conv, variants[0], &top_diffs, &reference));
+  // The outputs, and the bottom, weight and bias gradients.
+  EXPECT_EQ(1, reference.outputs.size());
+  EXPECT_EQ(3, reference.gradients.size());
+  for (int v = 1; v < variants.size(); ++v) {
+    EngineResult result;
+    ASSERT_TRUE(Run(conv, variants[v], &top_diffs, &result))
+        << variants[v].name();
+    double max_abs, max_rel;
+    CompareBlobs(result.outputs, reference.outputs, &max_abs, &max_rel);
+    EXPECT_LT(max_rel, 1e-4) << variants[v].name();
+    CompareBlobs(result.gradients, reference.gradients, &max_abs, &max_rel);
+    EXPECT_LT(max_rel, 1e-4) << variants[v].name();
+  }
+}
+
+TEST_F(EngineComparisonTest, TestMissingAlgorithmSkipsLayer) {
+  const int relu = 2;
+  BlobVec top_diffs;
+  EngineResult result;
+  EXPECT_TRUE(Run(relu, EngineVariant("CAFFE", Caffe::CPU, 2), &top_diffs,
+      &result));
+  EXPECT_FALSE(Run(relu, EngineVariant("CAFFE", Caffe::CPU, 2,
+      "batched_gemm"), &top_diffs, &result));
+  EXPECT_EQ(2, ThreadPool::num_threads());
+}
+
+TEST_F(EngineComparisonTest, TestDetectsDifference) {
+  const int conv = 1;
+  BlobVec top_diffs;
+  EngineResult reference, result;
+  ASSERT_TRUE(Run(conv, EngineVariant("CAFFE", Caffe::CPU, 1), &top_diffs,
+      &reference));
+  ASSERT_TRUE(Run(conv, EngineVariant("CAFFE", Caffe::CPU, 1), &top_diffs,
+      &result));
+  result.outputs[0]->mutable_cpu_data()[0] += 1;
+  double max_abs, max_rel;
+  CompareBlobs(result.outputs, reference.outputs, &max_abs, &max_rel);
+  EXPECT_NEAR(1, max_abs, 1e-5);
+  EXPECT_GT(max_rel, 1e-3);
+}
+
+}  // namespace caffe
@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/histogram.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class HistogramTest : public ::testing::Test {};
+
+TEST_F(HistogramTest, TestEmpty) {
+  Histogram histogram;
+  EXPECT_EQ(histogram.count(), 0);
+  EXPECT_EQ(histogram.mean(), 0);
+  EXPECT_EQ(histogram.min(), 0);
+  EXPECT_EQ(histogram.max(), 0);
+  EXPECT_EQ(histogram.Percentile(0.5), 0);
+}
+
+TEST_F(HistogramTest, TestMoments) {
+  Histogram histogram;
+  histogram.Add(0.5);
+  histogram.Add(3);
+  histogram.Add(1e6);
+  EXPECT_EQ(histogram.count(), 3);
+  EXPECT_DOUBLE_EQ(histogram.sum(), 1e6 + 3.5);
+  EXPECT_DOUBLE_EQ(histogram.mean(), (1e6 + 3.5) / 3);
+  EXPECT_EQ(histogram.min(), 0.5);
+  EXPECT_EQ(histogram.max(), 1e6);
+  EXPECT_EQ(histogram.Percentile(0), 0.5);
+  EXPECT_EQ(histogram.Percentile(1), 1e6);
+  histogram.Clear();
+  EXPECT_EQ(histogram.count(), 0);
+  EXPECT_EQ(histogram.sum(), 0);
+}
+
+TEST_F(HistogramTest, TestPercentiles) {
+  Histogram histogram;
+  for (int i = 1; i <= 10000; ++i) {
+    histogram.Add(i);
+  }
+  // The buckets are at most a quarter of their lower bound wide.
+  EXPECT_NEAR(histogram.Percentile(0.5), 5000, 5000 * 0.25);
+  EXPECT_NEAR(histogram.Percentile(0.9), 9000, 9000 * 0.25);
+  EXPECT_NEAR(histogram.Percentile(0.99), 9900, 9900 * 0.25);
+  EXPECT_LE(histogram.Percentile(0.5), histogram.Percentile(0.9));
+  EXPECT_LE(histogram.Percentile(0.9), histogram.Percentile(0.99));
+  EXPECT_LE(histogram.Percentile(0.99), 10000);
+}
+
+TEST_F(HistogramTest, TestMerge) {
+  Histogram low, high, all;
+  for (int i = 0; i < 100; ++i) {
+    low.Add(i);
+    high.Add(1000 + i);
+    all.Add(i);
+    all.Add(1000 + i);
+  }
+  Histogram merged;
+  merged.Merge(low);
+  merged.Merge(high);
+  EXPECT_EQ(merged.count(), all.count());
+  EXPECT_DOUBLE_EQ(merged.sum(), all.sum());
+  EXPECT_EQ(merged.min(), 0);
+  EXPECT_EQ(merged.max(), 1099);
+  for (int i = 0; i <= 10; ++i) {
+    EXPECT_DOUBLE_EQ(merged.Percentile(i / 10.), all.Percentile(i / 10.));
+  }
+}
+
+}  // namespace caffe
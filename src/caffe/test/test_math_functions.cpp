@@ -1,6 +1,8 @@
 #include <stdint.h>  // for uint32_t & uint64_t
 #include <time.h>
 #include <cmath>  // for std::fabs
+#include <limits>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -96,6 +98,61 @@ TYPED_TEST(CPUMathFunctionsTest, TestFabs) {
   }
 }
 
+// Inputs and their nearest fp16 and bfloat16 values.
+static const float kRoundingCases[][3] = {
+  { 1.f, 1.f, 1.f },
+  { -0.1f, -0.0999755859375f, -0.10009765625f },
+  { 3.14159265f, 3.140625f, 3.140625f },
+  // The largest fp16, and the largest input that still rounds to it.
+  { 65504.f, 65504.f, 65536.f },
+  { 65519.f, 65504.f, 65536.f },
+  // Halfway between mantissa values, to the even one.
+  { 1.00048828125f, 1.f, 1.f },
+  { 1.00146484375f, 1.001953125f, 1.f },
+  { 1.00390625f, 1.00390625f, 1.f },
+  { 1.01171875f, 1.01171875f, 1.015625f },
+  // fp16 subnormals are multiples of 2^-24.
+  { 5.9604644775390625e-08f, 5.9604644775390625e-08f,
+    5.9604644775390625e-08f },
+  { 2.98023223876953125e-08f, 0.f, 2.98023223876953125e-08f },
+  { 8.94069671630859375e-08f, 1.1920928955078125e-07f,
+    8.94069671630859375e-08f },
+};
+
+TYPED_TEST(CPUMathFunctionsTest, TestRoundFp16) {
+  const int n = sizeof(kRoundingCases) / sizeof(kRoundingCases[0]);
+  vector<TypeParam> x(n + 3), y(n + 3);
+  for (int i = 0; i < n; ++i) {
+    x[i] = kRoundingCases[i][0];
+  }
+  x[n] = 65520;
+  x[n + 1] = -1e10;
+  x[n + 2] = std::numeric_limits<TypeParam>::quiet_NaN();
+  caffe_round_fp16<TypeParam>(n + 3, &x[0], &y[0]);
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(static_cast<TypeParam>(kRoundingCases[i][1]), y[i]) << x[i];
+  }
+  EXPECT_EQ(std::numeric_limits<TypeParam>::infinity(), y[n]);
+  EXPECT_EQ(-std::numeric_limits<TypeParam>::infinity(), y[n + 1]);
+  EXPECT_TRUE(std::isnan(y[n + 2]));
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestRoundBf16) {
+  const int n = sizeof(kRoundingCases) / sizeof(kRoundingCases[0]);
+  vector<TypeParam> x(n + 2), y(n + 2);
+  for (int i = 0; i < n; ++i) {
+    x[i] = kRoundingCases[i][0];
+  }
+  x[n] = std::numeric_limits<float>::max();
+  x[n + 1] = std::numeric_limits<TypeParam>::quiet_NaN();
+  caffe_round_bf16<TypeParam>(n + 2, &x[0], &y[0]);
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(static_cast<TypeParam>(kRoundingCases[i][2]), y[i]) << x[i];
+  }
+  EXPECT_EQ(std::numeric_limits<TypeParam>::infinity(), y[n]);
+  EXPECT_TRUE(std::isnan(y[n + 1]));
+}
+
 TYPED_TEST(CPUMathFunctionsTest, TestScale) {
   int n = this->blob_bottom_->count();
   TypeParam alpha = this->blob_bottom_->cpu_diff()[caffe_rng_rand() %
@@ -119,6 +176,76 @@ TYPED_TEST(CPUMathFunctionsTest, TestCopy) {
   }
 }
 
+// Expects function to be within tolerance of reference, relative to the
+// result, at n points spread over [lo, hi].
+template <typename Dtype>
+void ExpectAccurate(void (*function)(const int, const Dtype*, Dtype*),
+    double (*reference)(double), double lo, double hi, double tolerance) {
+  // Not a multiple of the vector widths, to cover the remainders too.
+  const int n = 10007;
+  vector<Dtype> x(n), y(n);
+  for (int i = 0; i < n; ++i) {
+    x[i] = lo + (hi - lo) * i / (n - 1);
+  }
+  function(n, &x[0], &y[0]);
+  for (int i = 0; i < n; ++i) {
+    const double expected = reference(x[i]);
+    EXPECT_NEAR(y[i], expected, tolerance * std::fabs(expected))
+        << "at " << x[i];
+  }
+}
+
+static double sigmoid(double x) {
+  return 1. / (1. + std::exp(-x));
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestExp) {
+  ExpectAccurate<TypeParam>(caffe_exp<TypeParam>, std::exp, -87, 88, 1e-6);
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestLog) {
+  ExpectAccurate<TypeParam>(caffe_log<TypeParam>, std::log, 1e-30, 1e30,
+      1e-6);
+  ExpectAccurate<TypeParam>(caffe_log<TypeParam>, std::log, 1e-3, 3, 1e-6);
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestLog1p) {
+  ExpectAccurate<TypeParam>(caffe_log1p<TypeParam>, std::log1p, -0.99, 100,
+      1e-6);
+  ExpectAccurate<TypeParam>(caffe_log1p<TypeParam>, std::log1p, -1e-4, 1e-4,
+      1e-6);
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestTanh) {
+  ExpectAccurate<TypeParam>(caffe_tanh<TypeParam>, std::tanh, -10, 10, 1e-6);
+  ExpectAccurate<TypeParam>(caffe_tanh<TypeParam>, std::tanh, -1e-3, 1e-3,
+      1e-6);
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestSigmoid) {
+  ExpectAccurate<TypeParam>(caffe_sigmoid<TypeParam>, sigmoid, -80, 80, 1e-6);
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestPowx) {
+  const int n = 10007;
+  vector<TypeParam> x(n), y(n);
+  const TypeParam exponents[] = { 3, -2, 0.75, -0.75, 0.5, 2 };
+  for (int e = 0; e < 6; ++e) {
+    const TypeParam b = exponents[e];
+    // Negative bases only for integral exponents, and never exactly 0.
+    const double lo = (b == std::floor(b)) ? -99 : 1e-3;
+    for (int i = 0; i < n; ++i) {
+      x[i] = lo + (100 - lo) * i / (n - 1);
+    }
+    caffe_powx<TypeParam>(n, &x[0], b, &y[0]);
+    for (int i = 0; i < n; ++i) {
+      const double expected = std::pow(static_cast<double>(x[i]), b);
+      EXPECT_NEAR(y[i], expected, 1e-5 * std::fabs(expected))
+          << x[i] << "^" << b;
+    }
+  }
+}
+
 #ifndef CPU_ONLY
 
 template <typename Dtype>
@@ -172,6 +299,26 @@ TYPED_TEST(GPUMathFunctionsTest, TestFabs) {
   }
 }
 
+TYPED_TEST(GPUMathFunctionsTest, TestRound) {
+  int n = this->blob_bottom_->count();
+  const TypeParam* x = this->blob_bottom_->cpu_data();
+  vector<TypeParam> expected(n);
+  caffe_round_fp16<TypeParam>(n, x, &expected[0]);
+  caffe_gpu_round_fp16<TypeParam>(n, this->blob_bottom_->gpu_data(),
+                                  this->blob_bottom_->mutable_gpu_diff());
+  const TypeParam* rounded = this->blob_bottom_->cpu_diff();
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(expected[i], rounded[i]);
+  }
+  caffe_round_bf16<TypeParam>(n, x, &expected[0]);
+  caffe_gpu_round_bf16<TypeParam>(n, this->blob_bottom_->gpu_data(),
+                                  this->blob_bottom_->mutable_gpu_diff());
+  rounded = this->blob_bottom_->cpu_diff();
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(expected[i], rounded[i]);
+  }
+}
+
 TYPED_TEST(GPUMathFunctionsTest, TestScale) {
   int n = this->blob_bottom_->count();
   TypeParam alpha = this->blob_bottom_->cpu_diff()[caffe_rng_rand() %
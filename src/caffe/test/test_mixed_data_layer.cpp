@@ -0,0 +1,153 @@
+#if defined(USE_LEVELDB) || defined(USE_LMDB)
+#include <string>
+#include <vector>
+
+#include "boost/scoped_ptr.hpp"
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layers/mixed_data_layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/db.hpp"
+#include "caffe/util/io.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+using boost::scoped_ptr;
+
+template <typename TypeParam>
+class MixedDataLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  MixedDataLayerTest()
+      : blob_top_data_(new Blob<Dtype>()),
+        blob_top_label_(new Blob<Dtype>()) {}
+  virtual void SetUp() {
+    blob_top_vec_.push_back(blob_top_data_);
+    blob_top_vec_.push_back(blob_top_label_);
+  }
+  virtual ~MixedDataLayerTest() {
+    delete blob_top_data_;
+    delete blob_top_label_;
+  }
+
+  // Fill a new DB with 5 images labeled first_label, first_label + 1, ...
+  // whose pixels all equal their label, and return its path.
+  string Fill(int first_label, DataParameter_DB backend) {
+    string filename;
+    MakeTempDir(&filename);
+    filename += "/db";
+    LOG(INFO) << "Using temporary dataset " << filename;
+    scoped_ptr<db::DB> db(db::GetDB(backend));
+    db->Open(filename, db::NEW);
+    scoped_ptr<db::Transaction> txn(db->NewTransaction());
+    for (int i = 0; i < 5; ++i) {
+      Datum datum;
+      datum.set_label(first_label + i);
+      datum.set_channels(2);
+      datum.set_height(3);
+      datum.set_width(4);
+      datum.mutable_data()->assign(24, static_cast<char>(first_label + i));
+      stringstream ss;
+      ss << i;
+      string out;
+      CHECK(datum.SerializeToString(&out));
+      txn->Put(ss.str(), out);
+    }
+    txn->Commit();
+    db->Close();
+    return filename;
+  }
+
+  void TestMix(DataParameter_DB backend, float weight_b) {
+    const int batch_size = 8;
+    LayerParameter param;
+    param.set_phase(TRAIN);
+    MixedDataParameter* mixed_param = param.mutable_mixed_data_param();
+    mixed_param->set_batch_size(batch_size);
+    mixed_param->set_num_threads(3);
+    DataParameter* source_a = mixed_param->add_source();
+    source_a->set_source(Fill(0, backend));
+    source_a->set_backend(backend);
+    DataParameter* source_b = mixed_param->add_source();
+    source_b->set_source(Fill(10, backend));
+    source_b->set_backend(backend);
+    mixed_param->add_weight(3);
+    mixed_param->add_weight(weight_b);
+
+    // Seed the source sampling so the mix is reproducible.
+    Caffe::set_random_seed(1701);
+    MixedDataLayer<Dtype> layer(param);
+    layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+    EXPECT_EQ(blob_top_data_->num(), batch_size);
+    EXPECT_EQ(blob_top_data_->channels(), 2);
+    EXPECT_EQ(blob_top_data_->height(), 3);
+    EXPECT_EQ(blob_top_data_->width(), 4);
+    EXPECT_EQ(blob_top_label_->num(), batch_size);
+
+    const int num_iters = 100;
+    int num_a = 0;
+    int next_label[2] = {0, 10};
+    for (int iter = 0; iter < num_iters; ++iter) {
+      layer.Forward(blob_bottom_vec_, blob_top_vec_);
+      for (int i = 0; i < batch_size; ++i) {
+        const int label = blob_top_label_->cpu_data()[i];
+        const int source = label < 10 ? 0 : 1;
+        num_a += source == 0;
+        // Each source is read in order by its own cursor.
+        EXPECT_EQ(label, next_label[source]);
+        next_label[source] = (label + 1 - 10 * source) % 5 + 10 * source;
+        for (int j = 0; j < 24; ++j) {
+          EXPECT_EQ(label, blob_top_data_->cpu_data()[i * 24 + j]);
+        }
+      }
+    }
+    const float fraction_a = static_cast<float>(num_a) /
+        (num_iters * batch_size);
+    EXPECT_NEAR(fraction_a, 3. / (3. + weight_b), 0.05);
+
+    // Every Forward took a batch that the prefetch thread had loaded.
+    const DataPipelineStats stats = layer.pipeline_stats();
+    EXPECT_EQ(stats.wait_us.count(), num_iters);
+    EXPECT_GE(stats.read_us.count(), num_iters);
+    EXPECT_EQ(stats.transform_us.count(), stats.read_us.count());
+    const int prefetch_count = MixedDataLayer<Dtype>::PREFETCH_COUNT;
+    EXPECT_LE(stats.queue_depth.max(), prefetch_count);
+    layer.ResetPipelineStats();
+    EXPECT_EQ(layer.pipeline_stats().wait_us.count(), 0);
+  }
+
+  Blob<Dtype>* const blob_top_data_;
+  Blob<Dtype>* const blob_top_label_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+TYPED_TEST_CASE(MixedDataLayerTest, TestDtypesAndDevices);
+
+#ifdef USE_LEVELDB
+TYPED_TEST(MixedDataLayerTest, TestMixLevelDB) {
+  this->TestMix(DataParameter_DB_LEVELDB, 1);
+}
+
+TYPED_TEST(MixedDataLayerTest, TestZeroWeightLevelDB) {
+  this->TestMix(DataParameter_DB_LEVELDB, 0);
+}
+#endif  // USE_LEVELDB
+
+#ifdef USE_LMDB
+TYPED_TEST(MixedDataLayerTest, TestMixLMDB) {
+  this->TestMix(DataParameter_DB_LMDB, 1);
+}
+
+TYPED_TEST(MixedDataLayerTest, TestZeroWeightLMDB) {
+  this->TestMix(DataParameter_DB_LMDB, 0);
+}
+#endif  // USE_LMDB
+
+}  // namespace caffe
+#endif  // USE_LEVELDB || USE_LMDB
@@ -839,6 +839,86 @@ class NetTest : public MultiDeviceTest<TypeParam> {
     InitNetFromProtoFileWithState(proto, phase, level, stages);
   }
 
+  virtual void InitDeepNet(const bool share_diffs) {
+    string proto =
+        "name: 'DeepTestNetwork' "
+        "layer { "
+        "  name: 'data' "
+        "  type: 'DummyData' "
+        "  dummy_data_param { "
+        "    shape { dim: 5 dim: 6 } "
+        "    data_filler { type: 'gaussian' std: 1 } "
+        "    shape { dim: 5 dim: 2 } "
+        "    data_filler { type: 'constant' value: 1 } "
+        "  } "
+        "  top: 'data' "
+        "  top: 'label' "
+        "} "
+        "layer { "
+        "  name: 'innerproduct1' "
+        "  type: 'InnerProduct' "
+        "  inner_product_param { "
+        "    num_output: 10 "
+        "    weight_filler { type: 'gaussian' std: 1 } "
+        "    bias_filler { type: 'gaussian' std: 1 } "
+        "  } "
+        "  bottom: 'data' "
+        "  top: 'innerproduct1' "
+        "} "
+        "layer { "
+        "  name: 'relu1' "
+        "  type: 'ReLU' "
+        "  bottom: 'innerproduct1' "
+        "  top: 'innerproduct1' "
+        "} "
+        "layer { "
+        "  name: 'innerproduct2' "
+        "  type: 'InnerProduct' "
+        "  inner_product_param { "
+        "    num_output: 10 "
+        "    weight_filler { type: 'gaussian' std: 1 } "
+        "    bias_filler { type: 'gaussian' std: 1 } "
+        "  } "
+        "  bottom: 'innerproduct1' "
+        "  top: 'innerproduct2' "
+        "} "
+        "layer { "
+        "  name: 'relu2' "
+        "  type: 'ReLU' "
+        "  bottom: 'innerproduct2' "
+        "  top: 'innerproduct2' "
+        "} "
+        "layer { "
+        "  name: 'reshape' "
+        "  type: 'Reshape' "
+        "  reshape_param { shape { dim: 0 dim: 2 dim: 5 } } "
+        "  bottom: 'innerproduct2' "
+        "  top: 'reshape' "
+        "} "
+        "layer { "
+        "  name: 'innerproduct3' "
+        "  type: 'InnerProduct' "
+        "  inner_product_param { "
+        "    num_output: 2 "
+        "    axis: 1 "
+        "    weight_filler { type: 'gaussian' std: 1 } "
+        "    bias_filler { type: 'gaussian' std: 1 } "
+        "  } "
+        "  bottom: 'reshape' "
+        "  top: 'innerproduct3' "
+        "} "
+        "layer { "
+        "  name: 'loss' "
+        "  type: 'EuclideanLoss' "
+        "  bottom: 'innerproduct3' "
+        "  bottom: 'label' "
+        "} ";
+    if (share_diffs) {
+      proto += "share_diffs: true ";
+    }
+    InitNetFromProtoString(proto);
+  }
+
   int seed_;
   shared_ptr<Net<Dtype> > net_;
 };
@@ -854,6 +934,64 @@ TYPED_TEST(NetTest, TestHasBlob) {
   EXPECT_TRUE(this->net_->has_blob("top_loss"));
 }
 
+TYPED_TEST(NetTest, TestMemoryReport) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->InitTinyNet();
+  this->net_->Forward();
+  this->net_->Backward();
+  const vector<shared_ptr<MemoryAccount> >& accounts =
+      this->net_->layer_memory();
+  ASSERT_EQ(this->net_->layers().size(), accounts.size());
+  // The InnerProduct layer holds its weights, bias and their diffs.
+  const shared_ptr<MemoryAccount>& ip_account = accounts[1];
+  EXPECT_EQ("innerproduct", ip_account->name());
+  const size_t param_bytes = 2 * (1000 * 24 + 1000) * sizeof(Dtype);
+  EXPECT_GE(ip_account->live_bytes(MemoryAccount::HOST) +
+      ip_account->live_bytes(MemoryAccount::DEVICE), param_bytes);
+  // The SoftmaxWithLoss layer holds its internal probabilities.
+  const shared_ptr<MemoryAccount>& loss_account = accounts[2];
+  EXPECT_GE(loss_account->peak_bytes(MemoryAccount::HOST) +
+      loss_account->peak_bytes(MemoryAccount::DEVICE),
+      5 * 1000 * sizeof(Dtype));
+  const string report = this->net_->MemoryReport();
+  EXPECT_NE(string::npos, report.find("TinyTestNetwork"));
+  EXPECT_NE(string::npos, report.find("innerproduct"));
+  EXPECT_NE(string::npos, report.find("internal"));
+  EXPECT_NE(string::npos, report.find("Process total"));
+}
+
+// Records the layers a Net callback is run for.
+template <typename Dtype>
+class RecordingCallback : public Net<Dtype>::Callback {
+ public:
+  vector<int> layers;
+
+ protected:
+  virtual void run(int layer) { layers.push_back(layer); }
+};
+
+TYPED_TEST(NetTest, TestCallbacks) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->InitTinyNet();
+  RecordingCallback<Dtype> before_forward, after_forward, before_backward,
+      after_backward;
+  this->net_->add_before_forward(&before_forward);
+  this->net_->add_after_forward(&after_forward);
+  this->net_->add_before_backward(&before_backward);
+  this->net_->add_after_backward(&after_backward);
+  this->net_->Forward();
+  this->net_->Backward();
+  // The data layer needs no backward pass.
+  const int forward_layers[] = {0, 1, 2};
+  const int backward_layers[] = {2, 1};
+  EXPECT_EQ(vector<int>(forward_layers, forward_layers + 3),
+      before_forward.layers);
+  EXPECT_EQ(before_forward.layers, after_forward.layers);
+  EXPECT_EQ(vector<int>(backward_layers, backward_layers + 2),
+      before_backward.layers);
+  EXPECT_EQ(before_backward.layers, after_backward.layers);
+}
+
 TYPED_TEST(NetTest, TestGetBlob) {
   this->InitTinyNet();
   EXPECT_EQ(this->net_->blob_by_name("data"), this->net_->blobs()[0]);
@@ -2601,4 +2739,36 @@ TYPED_TEST(NetTest, TestAllInOneNetDeploy) {
   ASSERT_TRUE(found_data);
 }
 
+TYPED_TEST(NetTest, TestShareDiffs) {
+  typedef typename TypeParam::Dtype Dtype;
+  const bool kShareDiffs = true;
+  const bool kCopyDiff = true;
+  Caffe::set_random_seed(this->seed_);
+  this->InitDeepNet(!kShareDiffs);
+  const Dtype loss = this->net_->ForwardBackward();
+  vector<shared_ptr<Blob<Dtype> > > param_grads;
+  this->CopyNetParams(kCopyDiff, &param_grads);
+
+  Caffe::set_random_seed(this->seed_);
+  this->InitDeepNet(kShareDiffs);
+  // The gradients of 'innerproduct1' and 'innerproduct3' are never live at
+  // the same time, while 'innerproduct2' overlaps with both of them.
+  Blob<Dtype>* ip1 = this->net_->blob_by_name("innerproduct1").get();
+  Blob<Dtype>* ip2 = this->net_->blob_by_name("innerproduct2").get();
+  Blob<Dtype>* ip3 = this->net_->blob_by_name("innerproduct3").get();
+  EXPECT_EQ(ip1->diff(), ip3->diff());
+  EXPECT_NE(ip1->diff(), ip2->diff());
+  EXPECT_NE(ip2->diff(), ip3->diff());
+  EXPECT_EQ(ip2->diff(), this->net_->blob_by_name("reshape")->diff());
+  EXPECT_EQ(loss, this->net_->ForwardBackward());
+  const vector<shared_ptr<Blob<Dtype> > >& params = this->net_->params();
+  ASSERT_EQ(param_grads.size(), params.size());
+  for (int i = 0; i < params.size(); ++i) {
+    ASSERT_EQ(param_grads[i]->count(), params[i]->count());
+    for (int j = 0; j < params[i]->count(); ++j) {
+      EXPECT_EQ(param_grads[i]->cpu_diff()[j], params[i]->cpu_diff()[j]);
+    }
+  }
+}
+
 }  // namespace caffe
@@ -30,6 +30,8 @@
 
 #include "caffe/test/test_caffe_main.hpp"
 #include "caffe/test/test_gradient_check_util.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
@@ -260,6 +262,38 @@ TYPED_TEST(NeuronLayerTest, TestReLUGradientWithNegativeSlope) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(NeuronLayerTest, TestReLUParallel) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Enough elements to split the loops over the threads of the pool.
+  this->blob_bottom_->Reshape(4, 8, 64, 64);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(this->blob_bottom_);
+  LayerParameter layer_param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(
+      "relu_param { negative_slope: 0.01 }", &layer_param));
+  ReLULayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  filler.Fill(this->blob_top_);
+  caffe_copy(this->blob_top_->count(), this->blob_top_->cpu_data(),
+      this->blob_top_->mutable_cpu_diff());
+  const int threads = ThreadPool::num_threads();
+  ThreadPool::SetNumThreads(4);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Backward(this->blob_top_vec_, vector<bool>(1, true),
+      this->blob_bottom_vec_);
+  ThreadPool::SetNumThreads(threads);
+  const Dtype* bottom_data = this->blob_bottom_->cpu_data();
+  const Dtype* bottom_diff = this->blob_bottom_->cpu_diff();
+  const Dtype* top_data = this->blob_top_->cpu_data();
+  const Dtype* top_diff = this->blob_top_->cpu_diff();
+  for (int i = 0; i < this->blob_bottom_->count(); ++i) {
+    const Dtype slope = bottom_data[i] > 0 ? 1 : 0.01;
+    EXPECT_FLOAT_EQ(top_data[i], bottom_data[i] * slope);
+    EXPECT_FLOAT_EQ(bottom_diff[i], top_diff[i] * slope);
+  }
+}
+
 TYPED_TEST(NeuronLayerTest, TestELU) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
@@ -0,0 +1,78 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/perf_counters.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class PerfCountersTest : public ::testing::Test {};
+
+TEST_F(PerfCountersTest, TestCountsArithmetic) {
+  PerfCounts a, b;
+  a.count[PerfCounts::CYCLES] = 1000;
+  a.count[PerfCounts::INSTRUCTIONS] = 2500;
+  a.count[PerfCounts::CACHE_REFERENCES] = 40;
+  a.count[PerfCounts::CACHE_MISSES] = 10;
+  b.count[PerfCounts::CYCLES] = 400;
+  b.count[PerfCounts::CACHE_MISSES] = 20;
+  EXPECT_DOUBLE_EQ(2.5, a.ipc());
+  EXPECT_DOUBLE_EQ(0.25, a.cache_miss_rate());
+  EXPECT_DOUBLE_EQ(10 * PerfCounts::kCacheLineBytes, a.memory_bytes());
+  const PerfCounts difference = a - b;
+  EXPECT_EQ(600, difference.count[PerfCounts::CYCLES]);
+  EXPECT_EQ(2500, difference.count[PerfCounts::INSTRUCTIONS]);
+  // Differences are clamped at 0.
+  EXPECT_EQ(0, difference.count[PerfCounts::CACHE_MISSES]);
+  a += b;
+  EXPECT_EQ(1400, a.count[PerfCounts::CYCLES]);
+  EXPECT_EQ(30, a.count[PerfCounts::CACHE_MISSES]);
+  EXPECT_EQ(0, PerfCounts().ipc());
+  EXPECT_EQ(0, PerfCounts().cache_miss_rate());
+}
+
+// Passes whether or not the machine allows the counters.
+TEST_F(PerfCountersTest, TestRead) {
+  PerfCounters counters;
+  const PerfCounts before = counters.Read();
+  volatile double sum = 0;
+  for (int i = 0; i < 1000000; ++i) {
+    sum += i;
+  }
+  const PerfCounts after = counters.Read();
+  if (!counters.available()) {
+    for (int i = 0; i < PerfCounts::NUM_EVENTS; ++i) {
+      EXPECT_EQ(0, after.count[i]);
+    }
+    return;
+  }
+  EXPECT_GT(after.count[PerfCounts::CYCLES],
+      before.count[PerfCounts::CYCLES]);
+  EXPECT_GT(after.count[PerfCounts::INSTRUCTIONS],
+      before.count[PerfCounts::INSTRUCTIONS] + 1000000);
+}
+
+TEST_F(PerfCountersTest, TestLayerReport) {
+  LayerPerfCounters counters(2);
+  for (int layer_id = 0; layer_id < 2; ++layer_id) {
+    counters.Start();
+    counters.Stop(layer_id, false);
+    counters.Start();
+    counters.Stop(layer_id, true);
+  }
+  vector<string> names;
+  names.push_back("conv1");
+  names.push_back("pool1");
+  const string report = counters.Report(names, 1);
+  EXPECT_NE(string::npos, report.find("conv1"));
+  EXPECT_NE(string::npos, report.find("pool1"));
+  EXPECT_NE(string::npos, report.find("backward"));
+  counters.Clear();
+  EXPECT_EQ(0, counters.forward(0).count[PerfCounts::CYCLES]);
+}
+
+}  // namespace caffe
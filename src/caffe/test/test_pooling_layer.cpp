@@ -6,6 +6,8 @@
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
 #include "caffe/layers/pooling_layer.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 #ifdef USE_CUDNN
 #include "caffe/layers/cudnn_pooling_layer.hpp"
@@ -609,6 +611,46 @@ TYPED_TEST(PoolingLayerTest, TestGradientAvePadded) {
   }
 }
 
+TYPED_TEST(PoolingLayerTest, TestParallel) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Enough planes to split the loops over the threads of the pool.
+  this->blob_bottom_->Reshape(4, 8, 64, 64);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(this->blob_bottom_);
+  const int threads = ThreadPool::num_threads();
+  for (int pool = 0; pool < 2; ++pool) {
+    LayerParameter layer_param;
+    PoolingParameter* pooling_param = layer_param.mutable_pooling_param();
+    pooling_param->set_kernel_size(3);
+    pooling_param->set_stride(2);
+    pooling_param->set_pool(pool == 0 ? PoolingParameter_PoolMethod_MAX :
+        PoolingParameter_PoolMethod_AVE);
+    PoolingLayer<Dtype> layer(layer_param);
+    layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    const vector<bool> propagate_down(1, true);
+    Blob<Dtype> top[2];
+    Blob<Dtype> bottom_diff[2];
+    for (int run = 0; run < 2; ++run) {
+      ThreadPool::SetNumThreads(run == 0 ? 1 : 4);
+      layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+      caffe_copy(this->blob_top_->count(), this->blob_top_->cpu_data(),
+          this->blob_top_->mutable_cpu_diff());
+      layer.Backward(this->blob_top_vec_, propagate_down,
+          this->blob_bottom_vec_);
+      top[run].CopyFrom(*this->blob_top_, false, true);
+      bottom_diff[run].CopyFrom(*this->blob_bottom_, true, true);
+    }
+    ThreadPool::SetNumThreads(threads);
+    for (int i = 0; i < top[0].count(); ++i) {
+      EXPECT_EQ(top[0].cpu_data()[i], top[1].cpu_data()[i]);
+    }
+    for (int i = 0; i < bottom_diff[0].count(); ++i) {
+      EXPECT_EQ(bottom_diff[0].cpu_diff()[i], bottom_diff[1].cpu_diff()[i]);
+    }
+  }
+}
+
 #ifdef USE_CUDNN
 template <typename Dtype>
 class CuDNNPoolingLayerTest : public GPUDeviceTest<Dtype> {
@@ -0,0 +1,202 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/data_transformer.hpp"
+#include "caffe/net.hpp"
+#include "caffe/predictor.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class PredictorTest : public ::testing::Test {
+ protected:
+  PredictorTest() : seed_(1701) {
+    const string proto =
+        "name: 'TestNetwork' "
+        "layer { "
+        "  name: 'data' type: 'Input' top: 'data' "
+        "  input_param { shape { dim: 1 dim: 3 dim: 4 dim: 5 } } "
+        "} "
+        "layer { "
+        "  name: 'ip' type: 'InnerProduct' bottom: 'data' top: 'ip' "
+        "  inner_product_param { "
+        "    num_output: 7 "
+        "    weight_filler { type: 'gaussian' std: 0.1 } "
+        "    bias_filler { type: 'gaussian' std: 0.1 } "
+        "  } "
+        "} "
+        "layer { name: 'prob' type: 'Softmax' bottom: 'ip' top: 'prob' } ";
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto, &net_param_));
+    transform_param_.set_scale(1. / 255);
+    transform_param_.add_mean_value(100);
+    // Build inputs of random pixels.
+    Caffe::set_random_seed(seed_);
+    for (int i = 0; i < 11; ++i) {
+      Datum datum;
+      datum.set_channels(3);
+      datum.set_height(4);
+      datum.set_width(5);
+      string* data = datum.mutable_data();
+      for (int j = 0; j < 3 * 4 * 5; ++j) {
+        data->push_back(static_cast<char>(caffe_rng_rand() % 256));
+      }
+      datums_.push_back(datum);
+    }
+  }
+
+  // Classify each datum on its own with a plain Net initialized from the
+  // same seed as the Predictor replicas.
+  vector<vector<Dtype> > ReferenceScores() {
+    Caffe::set_random_seed(seed_);
+    Net<Dtype> net(net_param_);
+    DataTransformer<Dtype> transformer(transform_param_, TEST);
+    vector<vector<Dtype> > scores;
+    for (int i = 0; i < datums_.size(); ++i) {
+      transformer.Transform(datums_[i], net.input_blobs()[0]);
+      net.Forward();
+      const Blob<Dtype>* output = net.output_blobs()[0];
+      scores.push_back(vector<Dtype>(output->cpu_data(),
+          output->cpu_data() + output->count()));
+    }
+    return scores;
+  }
+
+  void CheckPredictions(const vector<Prediction<Dtype> >& predictions,
+      const vector<vector<Dtype> >& expected, int top_k) {
+    ASSERT_EQ(predictions.size(), expected.size());
+    for (int i = 0; i < predictions.size(); ++i) {
+      ASSERT_EQ(predictions[i].scores.size(), expected[i].size());
+      for (int j = 0; j < expected[i].size(); ++j) {
+        EXPECT_NEAR(predictions[i].scores[j], expected[i][j], 1e-5);
+      }
+      ASSERT_EQ(predictions[i].top_k.size(), top_k);
+      for (int k = 0; k < top_k; ++k) {
+        const Dtype score = expected[i][predictions[i].top_k[k]];
+        int num_greater = 0;
+        for (int j = 0; j < expected[i].size(); ++j) {
+          num_greater += expected[i][j] > score;
+        }
+        EXPECT_EQ(num_greater, k);
+      }
+    }
+  }
+
+  const int seed_;
+  NetParameter net_param_;
+  TransformationParameter transform_param_;
+  vector<Datum> datums_;
+};
+
+TYPED_TEST_CASE(PredictorTest, TestDtypes);
+
+TYPED_TEST(PredictorTest, TestPredict) {
+  const vector<vector<TypeParam> > expected = this->ReferenceScores();
+  Caffe::set_random_seed(this->seed_);
+  Predictor<TypeParam> predictor(this->net_param_, "",
+      this->transform_param_, 2, 4);
+  EXPECT_EQ(predictor.num_workers(), 2);
+  EXPECT_EQ(predictor.input_shape()[0], 1);
+  this->CheckPredictions(predictor.Predict(this->datums_, 3), expected, 3);
+  this->CheckPredictions(predictor.Predict(this->datums_), expected, 0);
+  EXPECT_EQ(predictor.Predict(vector<Datum>()).size(), 0);
+}
+
+template <typename Dtype>
+void PredictInLoop(Predictor<Dtype>* predictor, const vector<Datum>& datums,
+    int iterations, vector<vector<Prediction<Dtype> > >* results) {
+  for (int i = 0; i < iterations; ++i) {
+    results->push_back(predictor->Predict(datums, 2));
+  }
+}
+
+TYPED_TEST(PredictorTest, TestConcurrentClients) {
+  const vector<vector<TypeParam> > expected = this->ReferenceScores();
+  Caffe::set_random_seed(this->seed_);
+  Predictor<TypeParam> predictor(this->net_param_, "",
+      this->transform_param_, 3, 5);
+  const int num_clients = 4;
+  vector<vector<vector<Prediction<TypeParam> > > > results(num_clients);
+  boost::thread_group clients;
+  for (int c = 0; c < num_clients; ++c) {
+    clients.create_thread(boost::bind(&PredictInLoop<TypeParam>, &predictor,
+        boost::cref(this->datums_), 10, &results[c]));
+  }
+  clients.join_all();
+  for (int c = 0; c < num_clients; ++c) {
+    ASSERT_EQ(results[c].size(), 10);
+    for (int i = 0; i < results[c].size(); ++i) {
+      this->CheckPredictions(results[c][i], expected, 2);
+    }
+  }
+}
+
+template <typename Dtype>
+void CollectPredictions(boost::mutex* mutex, int* num_done,
+    vector<Prediction<Dtype> >* out,
+    const vector<Prediction<Dtype> >& results) {
+  boost::mutex::scoped_lock lock(*mutex);
+  *out = results;
+  ++*num_done;
+}
+
+TYPED_TEST(PredictorTest, TestPredictAsync) {
+  const vector<vector<TypeParam> > expected = this->ReferenceScores();
+  Caffe::set_random_seed(this->seed_);
+  const int num_requests = 8;
+  boost::mutex mutex;
+  int num_done = 0;
+  vector<vector<Prediction<TypeParam> > > results(num_requests);
+  {
+    Predictor<TypeParam> predictor(this->net_param_, "",
+        this->transform_param_, 2, 16);
+    for (int r = 0; r < num_requests; ++r) {
+      predictor.PredictAsync(this->datums_, 1,
+          boost::bind(&CollectPredictions<TypeParam>, &mutex, &num_done,
+              &results[r], _1));
+    }
+    // Wait for the callbacks before the predictor goes out of scope.
+    while (true) {
+      boost::mutex::scoped_lock lock(mutex);
+      if (num_done == num_requests) {
+        break;
+      }
+      lock.unlock();
+      boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    }
+  }
+  for (int r = 0; r < num_requests; ++r) {
+    this->CheckPredictions(results[r], expected, 1);
+  }
+}
+
+TYPED_TEST(PredictorTest, TestDestroyCompletesQueuedRequests) {
+  const int num_requests = 64;
+  boost::mutex mutex;
+  int num_done = 0;
+  vector<vector<Prediction<TypeParam> > > results(num_requests);
+  {
+    Predictor<TypeParam> predictor(this->net_param_, "",
+        this->transform_param_, 1, 1);
+    for (int r = 0; r < num_requests; ++r) {
+      predictor.PredictAsync(this->datums_, 0,
+          boost::bind(&CollectPredictions<TypeParam>, &mutex, &num_done,
+              &results[r], _1));
+    }
+  }
+  // Every callback ran, with no results for the requests still queued.
+  EXPECT_EQ(num_done, num_requests);
+  for (int r = 0; r < num_requests; ++r) {
+    EXPECT_TRUE(results[r].empty() ||
+        results[r].size() == this->datums_.size());
+  }
+}
+
+}  // namespace caffe
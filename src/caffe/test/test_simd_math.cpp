@@ -0,0 +1,208 @@
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/simd_math.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class SimdMathTest : public ::testing::Test {
+ protected:
+  SimdMathTest() {
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float specials[] = { 0.f, -0.f, inf, -inf, nan, 1.f, -1.f, 2.f,
+        -2.f, 0.5f, -0.5f, 1e-20f, -1e-20f, 80.f, -80.f, 1e20f, -1e20f };
+    const int num_specials = sizeof(specials) / sizeof(specials[0]);
+    // Repeated so that each value lands in every lane and in the remainder.
+    for (int i = 0; i < 37; ++i) {
+      x_.push_back(specials[i % num_specials]);
+    }
+    const char* isas[] = { "avx512", "avx2", "sse2", "scalar" };
+    for (int i = 0; i < 4; ++i) {
+      if (simd_isa_supported(isas[i])) {
+        isas_.push_back(isas[i]);
+      }
+    }
+    original_isa_ = simd_isa();
+  }
+
+  virtual ~SimdMathTest() {
+    simd_set_isa(original_isa_);
+  }
+
+  // Expects y to match reference at x_, where NaN matches NaN and zeros
+  // match in sign.
+  void ExpectSpecials(const vector<float>& y, float (*reference)(float)) {
+    ASSERT_EQ(x_.size(), y.size());
+    for (int i = 0; i < x_.size(); ++i) {
+      const float expected = reference(x_[i]);
+      if (std::isnan(expected)) {
+        EXPECT_TRUE(std::isnan(y[i])) << "at " << x_[i];
+      } else if (expected == 0 || std::isinf(expected)) {
+        EXPECT_EQ(expected, y[i]) << "at " << x_[i];
+        EXPECT_EQ(std::signbit(expected), std::signbit(y[i]))
+            << "at " << x_[i];
+      } else {
+        EXPECT_NEAR(expected, y[i], 1e-6 * std::fabs(expected))
+            << "at " << x_[i];
+      }
+    }
+  }
+
+  vector<float> x_;
+  // The instruction sets to test each function with.
+  vector<string> isas_;
+  string original_isa_;
+};
+
+static float exp_ref(float x) { return std::exp(x); }
+static float log_ref(float x) { return std::log(x); }
+static float log1p_ref(float x) { return std::log1p(x); }
+static float tanh_ref(float x) { return std::tanh(x); }
+static float sigmoid_ref(float x) { return 1.f / (1.f + std::exp(-x)); }
+
+TEST_F(SimdMathTest, TestSetIsa) {
+  // The best instruction set is the default, unless overridden.
+  if (!getenv("CAFFE_SIMD_ISA")) {
+    EXPECT_EQ(isas_[0], original_isa_);
+  }
+  EXPECT_TRUE(simd_isa_supported("scalar"));
+  EXPECT_FALSE(simd_isa_supported("avx1024"));
+  EXPECT_FALSE(simd_set_isa("avx1024"));
+  EXPECT_EQ(original_isa_, simd_isa());
+  for (int i = 0; i < isas_.size(); ++i) {
+    EXPECT_TRUE(simd_set_isa(isas_[i]));
+    EXPECT_EQ(isas_[i], simd_isa());
+  }
+}
+
+TEST_F(SimdMathTest, TestAccuracy) {
+  // Not a multiple of the vector widths, to cover the remainders too.
+  const int n = 10007;
+  vector<float> x(n), y(n);
+  for (int i = 0; i < n; ++i) {
+    x[i] = -20 + 40. * i / (n - 1);
+  }
+  for (int i = 0; i < isas_.size(); ++i) {
+    SCOPED_TRACE(isas_[i]);
+    ASSERT_TRUE(simd_set_isa(isas_[i]));
+    simd_exp(n, &x[0], &y[0]);
+    for (int j = 0; j < n; ++j) {
+      EXPECT_NEAR(std::exp(x[j]), y[j], 1e-6 * std::exp(x[j])) << x[j];
+    }
+    simd_tanh(n, &x[0], &y[0]);
+    for (int j = 0; j < n; ++j) {
+      EXPECT_NEAR(std::tanh(x[j]), y[j], 1e-6 * std::fabs(std::tanh(x[j])))
+          << x[j];
+    }
+    simd_powx(n, &x[0], 3.f, &y[0]);
+    for (int j = 0; j < n; ++j) {
+      const float expected = std::pow(x[j], 3.f);
+      EXPECT_NEAR(expected, y[j], 1e-5 * std::fabs(expected)) << x[j];
+    }
+  }
+}
+
+TEST_F(SimdMathTest, TestExpSpecials) {
+  for (int i = 0; i < isas_.size(); ++i) {
+    SCOPED_TRACE(isas_[i]);
+    ASSERT_TRUE(simd_set_isa(isas_[i]));
+    vector<float> y(x_.size());
+    simd_exp(x_.size(), &x_[0], &y[0]);
+    ExpectSpecials(y, exp_ref);
+  }
+}
+
+TEST_F(SimdMathTest, TestLogSpecials) {
+  for (int i = 0; i < isas_.size(); ++i) {
+    SCOPED_TRACE(isas_[i]);
+    ASSERT_TRUE(simd_set_isa(isas_[i]));
+    vector<float> y(x_.size());
+    simd_log(x_.size(), &x_[0], &y[0]);
+    ExpectSpecials(y, log_ref);
+  }
+}
+
+TEST_F(SimdMathTest, TestLog1pSpecials) {
+  for (int i = 0; i < isas_.size(); ++i) {
+    SCOPED_TRACE(isas_[i]);
+    ASSERT_TRUE(simd_set_isa(isas_[i]));
+    vector<float> y(x_.size());
+    simd_log1p(x_.size(), &x_[0], &y[0]);
+    ExpectSpecials(y, log1p_ref);
+  }
+}
+
+TEST_F(SimdMathTest, TestTanhSpecials) {
+  for (int i = 0; i < isas_.size(); ++i) {
+    SCOPED_TRACE(isas_[i]);
+    ASSERT_TRUE(simd_set_isa(isas_[i]));
+    vector<float> y(x_.size());
+    simd_tanh(x_.size(), &x_[0], &y[0]);
+    ExpectSpecials(y, tanh_ref);
+  }
+}
+
+TEST_F(SimdMathTest, TestSigmoidSpecials) {
+  for (int i = 0; i < isas_.size(); ++i) {
+    SCOPED_TRACE(isas_[i]);
+    ASSERT_TRUE(simd_set_isa(isas_[i]));
+    vector<float> y(x_.size());
+    simd_sigmoid(x_.size(), &x_[0], &y[0]);
+    ExpectSpecials(y, sigmoid_ref);
+  }
+}
+
+TEST_F(SimdMathTest, TestPowxSpecials) {
+  const float exponents[] = { 0.f, 0.5f, 1.f, 2.f, 3.f, -1.f, -2.f, 0.75f,
+      -0.75f };
+  const int num_exponents = sizeof(exponents) / sizeof(exponents[0]);
+  for (int k = 0; k < isas_.size(); ++k) {
+    SCOPED_TRACE(isas_[k]);
+    ASSERT_TRUE(simd_set_isa(isas_[k]));
+    for (int e = 0; e < num_exponents; ++e) {
+      const float b = exponents[e];
+      vector<float> y(x_.size());
+      simd_powx(x_.size(), &x_[0], b, &y[0]);
+      for (int i = 0; i < x_.size(); ++i) {
+        const float expected = std::pow(x_[i], b);
+        if (std::isnan(expected)) {
+          EXPECT_TRUE(std::isnan(y[i])) << x_[i] << "^" << b;
+        } else if (expected == 0 || std::isinf(expected)) {
+          EXPECT_EQ(expected, y[i]) << x_[i] << "^" << b;
+          EXPECT_EQ(std::signbit(expected), std::signbit(y[i]))
+              << x_[i] << "^" << b;
+        } else if (std::fabs(expected) < std::numeric_limits<float>::min()) {
+          // Denormal results flush to zero.
+          EXPECT_NEAR(expected, y[i], std::numeric_limits<float>::min())
+              << x_[i] << "^" << b;
+        } else {
+          EXPECT_NEAR(expected, y[i], 1e-5 * std::fabs(expected))
+              << x_[i] << "^" << b;
+        }
+      }
+    }
+  }
+}
+
+TEST_F(SimdMathTest, TestInPlace) {
+  vector<float> y(x_.size());
+  simd_tanh(x_.size(), &x_[0], &y[0]);
+  simd_tanh(x_.size(), &x_[0], &x_[0]);
+  for (int i = 0; i < x_.size(); ++i) {
+    if (std::isnan(y[i])) {
+      EXPECT_TRUE(std::isnan(x_[i]));
+    } else {
+      EXPECT_EQ(y[i], x_[i]);
+    }
+  }
+}
+
+}  // namespace caffe
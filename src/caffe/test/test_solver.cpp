@@ -1,3 +1,4 @@
+#include <cmath>
 #include <string>
 #include <utility>
 #include <vector>
@@ -9,6 +10,7 @@
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/sgd_solvers.hpp"
 #include "caffe/solver.hpp"
+#include "caffe/util/math_functions.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
 
@@ -106,4 +108,217 @@ TYPED_TEST(SolverTest, TestInitTrainTestNets) {
   EXPECT_TRUE(this->solver_->test_nets()[1]->has_layer("accuracy"));
 }
 
+TYPED_TEST(SolverTest, TestAsyncTest) {
+  typedef typename TypeParam::Dtype Dtype;
+  const string& proto =
+     "base_lr: 0.1 "
+     "lr_policy: 'fixed' "
+     "random_seed: 1701 "
+     "max_iter: 3 "
+     "test_interval: 2 "
+     "test_iter: 3 "
+     "test_initialization: false "
+     "snapshot_after_train: false "
+     "test_async: true "
+     "net_param { "
+     "  name: 'TestNetwork' "
+     "  layer { "
+     "    name: 'data' "
+     "    type: 'DummyData' "
+     "    dummy_data_param { "
+     "      shape { dim: 5 dim: 3 } "
+     "      shape { dim: 5 } "
+     "      data_filler { type: 'gaussian' } "
+     "      data_filler { type: 'constant' value: 1 } "
+     "    } "
+     "    top: 'data' "
+     "    top: 'label' "
+     "  } "
+     "  layer { "
+     "    name: 'innerprod' "
+     "    type: 'InnerProduct' "
+     "    inner_product_param { "
+     "      num_output: 2 "
+     "      weight_filler { type: 'gaussian' } "
+     "    } "
+     "    bottom: 'data' "
+     "    top: 'innerprod' "
+     "  } "
+     "  layer { "
+     "    name: 'loss' "
+     "    type: 'SoftmaxWithLoss' "
+     "    bottom: 'innerprod' "
+     "    bottom: 'label' "
+     "    top: 'loss' "
+     "  } "
+     "} ";
+  // The weights after 2 iterations, when the test runs.
+  this->InitSolverFromProtoString(proto);
+  this->solver_->Step(2);
+  const Blob<Dtype>& expected = *this->solver_->net()->params()[0];
+  vector<Dtype> expected_weights(expected.cpu_data(),
+      expected.cpu_data() + expected.count());
+  // Train 3 iterations, testing in the background at the second.
+  this->InitSolverFromProtoString(proto);
+  this->solver_->Solve();
+  EXPECT_EQ(3, this->solver_->iter());
+  const Blob<Dtype>& trained = *this->solver_->net()->params()[0];
+  const Blob<Dtype>& tested = *this->solver_->test_nets()[0]->params()[0];
+  // The test net has its own copy of the weights of the second iteration.
+  EXPECT_NE(trained.cpu_data(), tested.cpu_data());
+  ASSERT_EQ(expected_weights.size(), tested.count());
+  bool updated = false;
+  for (int i = 0; i < tested.count(); ++i) {
+    EXPECT_EQ(expected_weights[i], tested.cpu_data()[i]);
+    updated |= trained.cpu_data()[i] != tested.cpu_data()[i];
+  }
+  EXPECT_TRUE(updated);
+}
+
+// A linear classifier on random data, trained in the given precision.
+static string MixedPrecisionSolverProto(const string& precision) {
+  return "base_lr: 0.1 "
+     "lr_policy: 'fixed' "
+     "random_seed: 1701 "
+     "precision: " + precision + " "
+     "loss_scale: 1024 "
+     "loss_scale_window: 2 "
+     "net_param { "
+     "  name: 'TestNetwork' "
+     "  layer { "
+     "    name: 'data' "
+     "    type: 'DummyData' "
+     "    dummy_data_param { "
+     "      shape { dim: 5 dim: 3 } "
+     "      shape { dim: 5 } "
+     "      data_filler { type: 'gaussian' } "
+     "      data_filler { type: 'constant' value: 1 } "
+     "    } "
+     "    top: 'data' "
+     "    top: 'label' "
+     "  } "
+     "  layer { "
+     "    name: 'innerprod' "
+     "    type: 'InnerProduct' "
+     "    inner_product_param { "
+     "      num_output: 2 "
+     "      weight_filler { type: 'gaussian' } "
+     "    } "
+     "    bottom: 'data' "
+     "    top: 'innerprod' "
+     "  } "
+     "  layer { "
+     "    name: 'loss' "
+     "    type: 'SoftmaxWithLoss' "
+     "    bottom: 'innerprod' "
+     "    bottom: 'label' "
+     "    top: 'loss' "
+     "  } "
+     "} ";
+}
+
+TYPED_TEST(SolverTest, TestMixedPrecision) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->InitSolverFromProtoString(MixedPrecisionSolverProto("FLOAT"));
+  EXPECT_TRUE(this->solver_->mixed_precision() == NULL);
+  this->solver_->Step(2);
+  const Blob<Dtype>& expected = *this->solver_->net()->params()[0];
+  vector<Dtype> expected_weights(expected.cpu_data(),
+      expected.cpu_data() + expected.count());
+  this->InitSolverFromProtoString(MixedPrecisionSolverProto("FLOAT16"));
+  MixedPrecision<Dtype>* mixed_precision = this->solver_->mixed_precision();
+  ASSERT_TRUE(mixed_precision != NULL);
+  this->solver_->Step(1);
+  EXPECT_EQ(1024, mixed_precision->loss_scale());
+  EXPECT_EQ(1, mixed_precision->loss_scale_iter());
+  // The window of iterations without overflow doubles the loss scale.
+  this->solver_->Step(1);
+  EXPECT_EQ(2048, mixed_precision->loss_scale());
+  EXPECT_EQ(0, mixed_precision->loss_scale_iter());
+  // The weights are the float masters, close to those trained in float.
+  const Blob<Dtype>& trained = *this->solver_->net()->params()[0];
+  ASSERT_EQ(expected_weights.size(), trained.count());
+  vector<Dtype> rounded(trained.count());
+  caffe_round_fp16(trained.count(), trained.cpu_data(), &rounded[0]);
+  bool unrounded = false;
+  for (int i = 0; i < trained.count(); ++i) {
+    EXPECT_NEAR(expected_weights[i], trained.cpu_data()[i], 1e-2);
+    unrounded |= rounded[i] != trained.cpu_data()[i];
+  }
+  EXPECT_TRUE(unrounded);
+  // A loss beyond the fp16 range is not rounded to inf.
+  string proto = MixedPrecisionSolverProto("FLOAT16");
+  proto.insert(proto.find("shape { dim: 5 } ") + 17,
+      "shape { dim: 5 dim: 2 } ");
+  proto.insert(proto.find("value: 1 } ") + 11,
+      "data_filler { type: 'constant' value: 300 } ");
+  proto.insert(proto.find("top: 'label' ") + 13, "top: 'target' ");
+  proto.insert(proto.rfind("} "),
+      "  layer { "
+      "    name: 'distance' "
+      "    type: 'EuclideanLoss' "
+      "    bottom: 'innerprod' "
+      "    bottom: 'target' "
+      "    top: 'distance' "
+      "    loss_weight: 1e-6 "
+      "  } ");
+  this->InitSolverFromProtoString(proto);
+  this->solver_->Step(1);
+  const Dtype distance =
+      this->solver_->net()->blob_by_name("distance")->cpu_data()[0];
+  EXPECT_TRUE(std::isfinite(static_cast<double>(distance)));
+  EXPECT_GT(distance, 65504);
+}
+
+TYPED_TEST(SolverTest, TestMixedPrecisionBatchNorm) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Normalize the data in place before the classifier.
+  const string batch_norm =
+     "  layer { "
+     "    name: 'bn' "
+     "    type: 'BatchNorm' "
+     "    bottom: 'data' "
+     "    top: 'data' "
+     "  } ";
+  string proto = MixedPrecisionSolverProto("FLOAT");
+  proto.insert(proto.find("  layer {     name: 'innerprod'"), batch_norm);
+  this->InitSolverFromProtoString(proto);
+  this->solver_->Step(2);
+  const vector<shared_ptr<Blob<Dtype> > > expected =
+      this->solver_->net()->layer_by_name("bn")->blobs();
+  proto.replace(proto.find("precision: FLOAT"), 16, "precision: FLOAT16");
+  this->InitSolverFromProtoString(proto);
+  this->solver_->Step(2);
+  // The statistics BatchNorm accumulates in Forward are not updated by the
+  // solver, and are not restored from masters.
+  const vector<shared_ptr<Blob<Dtype> > >& stats =
+      this->solver_->net()->layer_by_name("bn")->blobs();
+  ASSERT_EQ(3, stats.size());
+  EXPECT_FLOAT_EQ(1.999, stats[2]->cpu_data()[0]);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(expected[i]->count(), stats[i]->count());
+    for (int j = 0; j < stats[i]->count(); ++j) {
+      EXPECT_NE(0, stats[i]->cpu_data()[j]);
+      EXPECT_FLOAT_EQ(expected[i]->cpu_data()[j], stats[i]->cpu_data()[j]);
+    }
+  }
+}
+
+TYPED_TEST(SolverTest, TestMixedPrecisionOverflow) {
+  typedef typename TypeParam::Dtype Dtype;
+  string proto = MixedPrecisionSolverProto("FLOAT16");
+  proto.replace(proto.find("loss_scale: 1024"), 16, "loss_scale: 1e20");
+  this->InitSolverFromProtoString(proto);
+  const Blob<Dtype>& weights = *this->solver_->net()->params()[0];
+  vector<Dtype> initial_weights(weights.cpu_data(),
+      weights.cpu_data() + weights.count());
+  // The scaled gradients overflow fp16, so the update is skipped.
+  this->solver_->Step(1);
+  EXPECT_EQ(1, this->solver_->iter());
+  EXPECT_FLOAT_EQ(5e19, this->solver_->mixed_precision()->loss_scale());
+  for (int i = 0; i < weights.count(); ++i) {
+    EXPECT_EQ(initial_weights[i], weights.cpu_data()[i]);
+  }
+}
+
 }  // namespace caffe
@@ -0,0 +1,119 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/spsc_queue.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class SPSCQueueTest : public ::testing::Test {
+ protected:
+  SPSCQueueTest() : datums_(10000) {}
+
+  vector<Datum> datums_;
+};
+
+TEST_F(SPSCQueueTest, TestTryPushPop) {
+  SPSCQueue<Datum*> queue(3);
+  EXPECT_EQ(queue.capacity(), 3);
+  Datum* datum;
+  EXPECT_FALSE(queue.try_pop(&datum));
+  EXPECT_FALSE(queue.try_peek(&datum));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(queue.try_push(&datums_[i]));
+  }
+  // The capacity is exact even though the ring is rounded up to 4 slots.
+  EXPECT_FALSE(queue.try_push(&datums_[3]));
+  EXPECT_EQ(queue.size(), 3);
+  EXPECT_TRUE(queue.try_peek(&datum));
+  EXPECT_EQ(datum, &datums_[0]);
+  EXPECT_EQ(queue.peek(), &datums_[0]);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(queue.try_pop(&datum));
+    EXPECT_EQ(datum, &datums_[i]);
+  }
+  EXPECT_EQ(queue.size(), 0);
+  EXPECT_EQ(queue.pop_stalls(), 0);
+  EXPECT_EQ(queue.push_stalls(), 0);
+}
+
+TEST_F(SPSCQueueTest, TestBatchPushPop) {
+  SPSCQueue<Datum*> queue(8);
+  vector<Datum*> items;
+  for (int i = 0; i < 5; ++i) {
+    items.push_back(&datums_[i]);
+  }
+  queue.push(items);
+  vector<Datum*> popped;
+  queue.pop(3, &popped);
+  ASSERT_EQ(popped.size(), 3);
+  queue.pop(10, &popped);
+  ASSERT_EQ(popped.size(), 2);
+  EXPECT_EQ(popped[0], &datums_[3]);
+  EXPECT_EQ(popped[1], &datums_[4]);
+}
+
+void Produce(SPSCQueue<Datum*>* queue, vector<Datum>* datums) {
+  // Alternate single and batch pushes of different sizes.
+  int i = 0;
+  while (i < datums->size()) {
+    if (i % 2) {
+      queue->push(&(*datums)[i++]);
+    } else {
+      vector<Datum*> items;
+      for (int j = 0; j < 7 && i < datums->size(); ++j) {
+        items.push_back(&(*datums)[i++]);
+      }
+      queue->push(items);
+    }
+  }
+}
+
+TEST_F(SPSCQueueTest, TestProducerConsumer) {
+  // A queue smaller than a batch forces both sides to wait.
+  SPSCQueue<Datum*> queue(5);
+  boost::thread producer(&Produce, &queue, &this->datums_);
+  int i = 0;
+  vector<Datum*> popped;
+  while (i < this->datums_.size()) {
+    if (i % 3) {
+      EXPECT_EQ(queue.pop(), &this->datums_[i++]);
+    } else {
+      queue.pop(4, &popped);
+      ASSERT_GT(popped.size(), 0);
+      for (int j = 0; j < popped.size(); ++j) {
+        EXPECT_EQ(popped[j], &this->datums_[i++]);
+      }
+    }
+  }
+  producer.join();
+  EXPECT_EQ(queue.size(), 0);
+  EXPECT_GT(queue.pop_stalls() + queue.push_stalls(), 0);
+}
+
+void PopOne(SPSCQueue<Datum*>* queue, bool* interrupted) {
+  try {
+    queue->pop();
+  } catch (boost::thread_interrupted&) {
+    *interrupted = true;
+  }
+}
+
+TEST_F(SPSCQueueTest, TestInterruptPop) {
+  SPSCQueue<Datum*> queue(2);
+  bool interrupted = false;
+  boost::thread consumer(&PopOne, &queue, &interrupted);
+  // Let the consumer park before interrupting it.
+  boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+  consumer.interrupt();
+  consumer.join();
+  EXPECT_TRUE(interrupted);
+}
+
+}  // namespace caffe
@@ -122,4 +122,52 @@ TEST_F(SyncedMemoryTest, TestGPUWrite) {
 
 #endif
 
+TEST_F(SyncedMemoryTest, TestTotalAccount) {
+  MemoryAccount& total = MemoryAccount::Total();
+  const size_t live = total.live_bytes(MemoryAccount::HOST);
+  {
+    SyncedMemory mem(1000);
+    EXPECT_EQ(live, total.live_bytes(MemoryAccount::HOST));
+    mem.cpu_data();
+    EXPECT_EQ(1000, mem.host_bytes());
+    EXPECT_EQ(live + 1000, total.live_bytes(MemoryAccount::HOST));
+    EXPECT_GE(total.peak_bytes(MemoryAccount::HOST), live + 1000);
+  }
+  EXPECT_EQ(live, total.live_bytes(MemoryAccount::HOST));
+}
+
+TEST_F(SyncedMemoryTest, TestScopedAccount) {
+  shared_ptr<MemoryAccount> account(new MemoryAccount("test"));
+  EXPECT_EQ("test", account->name());
+  shared_ptr<SyncedMemory> mem;
+  {
+    MemoryAccount::Scope scope(account);
+    EXPECT_EQ(account, MemoryAccount::Current());
+    mem.reset(new SyncedMemory(1000));
+  }
+  EXPECT_TRUE(MemoryAccount::Current().get() == NULL);
+  // Memory not allocated in the scope is still charged to its account.
+  SyncedMemory other(500);
+  other.cpu_data();
+  mem->cpu_data();
+  EXPECT_EQ(account, mem->account());
+  EXPECT_EQ(1000, account->live_bytes(MemoryAccount::HOST));
+  EXPECT_EQ(0, account->live_bytes(MemoryAccount::DEVICE));
+  mem.reset();
+  EXPECT_EQ(0, account->live_bytes(MemoryAccount::HOST));
+  EXPECT_EQ(1000, account->peak_bytes(MemoryAccount::HOST));
+  account->ResetPeak();
+  EXPECT_EQ(0, account->peak_bytes(MemoryAccount::HOST));
+}
+
+TEST_F(SyncedMemoryTest, TestExternalDataNotCharged) {
+  shared_ptr<MemoryAccount> account(new MemoryAccount("test"));
+  MemoryAccount::Scope scope(account);
+  float data[10];
+  SyncedMemory mem(sizeof(data));
+  mem.set_cpu_data(data);
+  EXPECT_EQ(0, mem.host_bytes());
+  EXPECT_EQ(0, account->live_bytes(MemoryAccount::HOST));
+}
+
 }  // namespace caffe
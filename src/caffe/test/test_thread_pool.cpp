@@ -0,0 +1,158 @@
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class ThreadPoolTest : public ::testing::Test {
+ protected:
+  ThreadPoolTest() : threads_(ThreadPool::num_threads()) {}
+  virtual ~ThreadPoolTest() {
+    ThreadPool::SetNumaPinning(false);
+    ThreadPool::SetNumThreads(threads_);
+  }
+
+  // Runs a loop of n iterations, counting the visits of each index, the
+  // ranges and the size of the smallest.
+  void Count(int n, int grain) {
+    visits_.assign(n, 0);
+    ranges_ = 0;
+    smallest_ = n;
+    parallel_for(n, grain, [this](int begin, int end) {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      for (int i = begin; i < end; ++i) {
+        ++visits_[i];
+      }
+      ++ranges_;
+      smallest_ = std::min(smallest_, end - begin);
+    });
+  }
+
+  bool VisitedOnce() const {
+    return std::count(visits_.begin(), visits_.end(), 1) == visits_.size();
+  }
+
+  const int threads_;
+  vector<int> visits_;
+  int ranges_;
+  int smallest_;
+  boost::mutex mutex_;
+};
+
+TEST_F(ThreadPoolTest, TestCoversRange) {
+  ThreadPool::SetNumThreads(4);
+  EXPECT_EQ(4, ThreadPool::num_threads());
+  Count(100003, 1000);
+  EXPECT_TRUE(VisitedOnce());
+  EXPECT_EQ(4, ranges_);
+}
+
+TEST_F(ThreadPoolTest, TestGrain) {
+  ThreadPool::SetNumThreads(4);
+  // Too short for four ranges of at least 1000.
+  Count(2500, 1000);
+  EXPECT_TRUE(VisitedOnce());
+  EXPECT_EQ(2, ranges_);
+  EXPECT_GE(smallest_, 1000);
+  // Too short for two: run on the caller.
+  Count(1999, 1000);
+  EXPECT_TRUE(VisitedOnce());
+  EXPECT_EQ(1, ranges_);
+  Count(0, 1000);
+  EXPECT_EQ(0, ranges_);
+}
+
+TEST_F(ThreadPoolTest, TestSingleThread) {
+  ThreadPool::SetNumThreads(1);
+  EXPECT_EQ(1, ThreadPool::num_threads());
+  Count(100000, 10);
+  EXPECT_TRUE(VisitedOnce());
+  EXPECT_EQ(1, ranges_);
+}
+
+TEST_F(ThreadPoolTest, TestResizeAfterLoops) {
+  // Workers started after loops have run must wait for the next one.
+  for (int threads = 2; threads <= 5; ++threads) {
+    Count(10000, 100);
+    ThreadPool::SetNumThreads(threads);
+    for (int loop = 0; loop < 20; ++loop) {
+      Count(10000, 100);
+      EXPECT_TRUE(VisitedOnce());
+      EXPECT_EQ(threads, ranges_);
+    }
+  }
+}
+
+TEST_F(ThreadPoolTest, TestRestartWorkers) {
+  ThreadPool::SetNumThreads(3);
+  Count(10000, 100);
+  ThreadPool::RestartWorkers();
+  EXPECT_EQ(3, ThreadPool::num_threads());
+  Count(10000, 100);
+  EXPECT_TRUE(VisitedOnce());
+  EXPECT_EQ(3, ranges_);
+}
+
+TEST_F(ThreadPoolTest, TestNested) {
+  ThreadPool::SetNumThreads(4);
+  const int n = 64;
+  vector<int> visits(n * n, 0);
+  parallel_for(n, 1, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      // Runs on the thread of the outer range.
+      parallel_for(n, 1, [&](int inner_begin, int inner_end) {
+        for (int j = inner_begin; j < inner_end; ++j) {
+          ++visits[i * n + j];
+        }
+      });
+    }
+  });
+  EXPECT_EQ(n * n, std::count(visits.begin(), visits.end(), 1));
+}
+
+// Adds 1 to each element, loops times.
+static void AddOnes(vector<int>* data, int loops) {
+  for (int loop = 0; loop < loops; ++loop) {
+    int* values = &(*data)[0];
+    parallel_for(data->size(), 16, [values](int begin, int end) {
+      for (int i = begin; i < end; ++i) {
+        ++values[i];
+      }
+    });
+  }
+}
+
+TEST_F(ThreadPoolTest, TestConcurrentCallers) {
+  ThreadPool::SetNumThreads(3);
+  vector<vector<int> > data(4, vector<int>(1000, 0));
+  vector<shared_ptr<boost::thread> > threads;
+  for (int i = 0; i < data.size(); ++i) {
+    threads.push_back(shared_ptr<boost::thread>(
+        new boost::thread(&AddOnes, &data[i], 50)));
+  }
+  for (int i = 0; i < data.size(); ++i) {
+    threads[i]->join();
+    EXPECT_EQ(1000, std::count(data[i].begin(), data[i].end(), 50));
+  }
+}
+
+TEST_F(ThreadPoolTest, TestNumaPinning) {
+  ThreadPool::SetNumThreads(2);
+  ThreadPool::SetNumaPinning(true);
+  EXPECT_TRUE(ThreadPool::numa_pinning());
+  EXPECT_EQ(2, ThreadPool::num_threads());
+  Count(10000, 100);
+  EXPECT_TRUE(VisitedOnce());
+  ThreadPool::SetNumaPinning(false);
+  EXPECT_FALSE(ThreadPool::numa_pinning());
+}
+
+}  // namespace caffe
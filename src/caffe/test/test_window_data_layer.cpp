@@ -0,0 +1,159 @@
+#ifdef USE_OPENCV
+#include <opencv2/core/core.hpp>
+
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layers/window_data_layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/io.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class WindowDataLayerTest : public CPUDeviceTest<TypeParam> {
+ protected:
+  WindowDataLayerTest()
+      : seed_(1701), threads_(ThreadPool::num_threads()),
+        blob_top_data_(new Blob<TypeParam>()),
+        blob_top_label_(new Blob<TypeParam>()) {}
+  virtual void SetUp() {
+    blob_top_vec_.push_back(blob_top_data_);
+    blob_top_vec_.push_back(blob_top_label_);
+    // Create a window file of four images with a foreground and a
+    // background window each.
+    MakeTempFilename(&filename_);
+    std::ofstream outfile(filename_.c_str(), std::ofstream::out);
+    LOG(INFO) << "Using temporary file " << filename_;
+    const char* images[] = { "cat.jpg", "fish-bike.jpg" };
+    for (int i = 0; i < 4; ++i) {
+      outfile << "# " << i << std::endl
+          << EXAMPLES_SOURCE_DIR "images/" << images[i % 2] << std::endl
+          << "3" << std::endl << "320" << std::endl << "480" << std::endl
+          << "2" << std::endl
+          << (i + 1) << " 0.9 " << 10 * i << " 20 " << 100 + 30 * i << " 200"
+          << std::endl
+          << "0 0.1 200 " << 10 * i << " 470 " << 150 + 20 * i << std::endl;
+    }
+    outfile.close();
+  }
+
+  virtual ~WindowDataLayerTest() {
+    ThreadPool::SetNumThreads(threads_);
+    delete blob_top_data_;
+    delete blob_top_label_;
+  }
+
+  // Reads a few batches with the given number of pool threads and decoded
+  // cache size.
+  vector<vector<TypeParam> > Read(int threads, int cache_mb) {
+    ThreadPool::SetNumThreads(threads);
+    Caffe::set_random_seed(seed_);
+    LayerParameter param;
+    WindowDataParameter* window_data_param =
+        param.mutable_window_data_param();
+    window_data_param->set_source(filename_);
+    window_data_param->set_batch_size(16);
+    window_data_param->set_context_pad(2);
+    window_data_param->set_decoded_cache_mb(cache_mb);
+    param.mutable_transform_param()->set_crop_size(24);
+    param.mutable_transform_param()->set_mirror(true);
+    param.mutable_transform_param()->add_mean_value(100);
+    WindowDataLayer<TypeParam> layer(param);
+    layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+    EXPECT_EQ(16, blob_top_data_->num());
+    EXPECT_EQ(3, blob_top_data_->channels());
+    EXPECT_EQ(24, blob_top_data_->height());
+    EXPECT_EQ(24, blob_top_data_->width());
+    vector<vector<TypeParam> > batches;
+    for (int iter = 0; iter < 3; ++iter) {
+      layer.Forward(blob_bottom_vec_, blob_top_vec_);
+      batches.push_back(vector<TypeParam>(blob_top_data_->cpu_data(),
+          blob_top_data_->cpu_data() + blob_top_data_->count()));
+      batches.back().insert(batches.back().end(),
+          blob_top_label_->cpu_data(),
+          blob_top_label_->cpu_data() + blob_top_label_->count());
+    }
+    return batches;
+  }
+
+  int seed_;
+  int threads_;
+  string filename_;
+  Blob<TypeParam>* const blob_top_data_;
+  Blob<TypeParam>* const blob_top_label_;
+  vector<Blob<TypeParam>*> blob_bottom_vec_;
+  vector<Blob<TypeParam>*> blob_top_vec_;
+};
+
+TYPED_TEST_CASE(WindowDataLayerTest, TestDtypes);
+
+TYPED_TEST(WindowDataLayerTest, TestThreadsAndCacheMatchSerial) {
+  const vector<vector<TypeParam> > expected = this->Read(1, 0);
+  // The windows are warped into disjoint items of the batch, and cached
+  // images are never modified, so neither changes the data.
+  for (int threads = 1; threads <= 4; threads += 3) {
+    for (int cache_mb = 0; cache_mb <= 4; cache_mb += 4) {
+      const vector<vector<TypeParam> > batches =
+          this->Read(threads, cache_mb);
+      ASSERT_EQ(expected.size(), batches.size());
+      for (int i = 0; i < batches.size(); ++i) {
+        EXPECT_TRUE(expected[i] == batches[i]);
+      }
+    }
+  }
+}
+
+class DecodedImageCacheTest : public ::testing::Test {};
+
+TEST_F(DecodedImageCacheTest, TestHits) {
+  DecodedImageCache cache(1 << 20);
+  cv::Mat image(10, 10, CV_8UC3, cv::Scalar(1, 2, 3));
+  cv::Mat cached;
+  EXPECT_FALSE(cache.Get(0, &cached));
+  cache.Put(0, image);
+  ASSERT_TRUE(cache.Get(0, &cached));
+  // The cache hands out the image itself, not a copy.
+  EXPECT_EQ(image.data, cached.data);
+  EXPECT_FALSE(cache.Get(1, &cached));
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(2, cache.misses());
+  EXPECT_EQ(300, cache.bytes());
+}
+
+TEST_F(DecodedImageCacheTest, TestByteLimit) {
+  // Room for three 10 x 10 x 3 images.
+  DecodedImageCache cache(1000);
+  for (int i = 0; i < 3; ++i) {
+    cache.Put(i, cv::Mat(10, 10, CV_8UC3, cv::Scalar(i)));
+  }
+  EXPECT_EQ(900, cache.bytes());
+  // Using images 1, 0 and 2 in turn makes image 1 the least recently used.
+  cv::Mat held;
+  cv::Mat cached;
+  EXPECT_TRUE(cache.Get(1, &held));
+  EXPECT_TRUE(cache.Get(0, &cached));
+  EXPECT_TRUE(cache.Get(2, &cached));
+  cache.Put(3, cv::Mat(10, 10, CV_8UC3, cv::Scalar(3)));
+  EXPECT_EQ(900, cache.bytes());
+  EXPECT_FALSE(cache.Get(1, &cached));
+  EXPECT_TRUE(cache.Get(0, &cached));
+  EXPECT_TRUE(cache.Get(3, &cached));
+  // An evicted image handed out earlier stays valid.
+  EXPECT_EQ(1, held.at<cv::Vec3b>(9, 9)[0]);
+  // Images larger than the whole cache are not kept.
+  cache.Put(4, cv::Mat(20, 20, CV_8UC3));
+  EXPECT_FALSE(cache.Get(4, &cached));
+  EXPECT_EQ(900, cache.bytes());
+}
+
+}  // namespace caffe
+#endif  // USE_OPENCV
@@ -4,6 +4,7 @@
 #include "caffe/data_reader.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/parallel.hpp"
+#include "caffe/predictor.hpp"
 #include "caffe/util/blocking_queue.hpp"
 
 namespace caffe {
@@ -89,8 +90,11 @@ size_t BlockingQueue<T>::size() const {
 template class BlockingQueue<Batch<float>*>;
 template class BlockingQueue<Batch<double>*>;
 template class BlockingQueue<Datum*>;
+template class BlockingQueue<int>;
 template class BlockingQueue<shared_ptr<DataReader::QueuePair> >;
 template class BlockingQueue<P2PSync<float>*>;
 template class BlockingQueue<P2PSync<double>*>;
+template class BlockingQueue<Predictor<float>::Job*>;
+template class BlockingQueue<Predictor<double>::Job*>;
 
 }  // namespace caffe
@@ -0,0 +1,153 @@
+#ifdef USE_OPENCV
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/scoped_ptr.hpp"
+#include "boost/thread.hpp"
+
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/convert_imageset.hpp"
+#include "caffe/util/format.hpp"
+#include "caffe/util/io.hpp"
+
+namespace caffe {
+
+using boost::scoped_ptr;
+
+// An image of the list, converted and serialized by a worker thread.
+struct ConvertedImage {
+  bool status;
+  int data_size;
+  int expected_data_size;
+  string value;
+};
+
+// Converts the images [begin, end) of the list, with each of num_threads
+// threads handling every num_threads-th image.
+static void ConvertImages(const vector<std::pair<string, int> >& lines,
+    const string& root_folder, const ConvertImagesetOptions& options,
+    int begin, int end, int thread_id, vector<ConvertedImage>* images) {
+  const int resize_height = std::max<int>(0, options.resize_height);
+  const int resize_width = std::max<int>(0, options.resize_width);
+  Datum datum;
+  for (int line_id = begin + thread_id; line_id < end;
+       line_id += options.num_threads) {
+    ConvertedImage* image = &(*images)[line_id - begin];
+    string enc = options.encode_type;
+    if (options.encoded && !enc.size()) {
+      // Guess the encoding type from the file name
+      string fn = lines[line_id].first;
+      size_t p = fn.rfind('.');
+      if ( p == fn.npos )
+        LOG(WARNING) << "Failed to guess the encoding of '" << fn << "'";
+      enc = fn.substr(p);
+      std::transform(enc.begin(), enc.end(), enc.begin(), ::tolower);
+    }
+    image->status = ReadImageToDatum(root_folder + lines[line_id].first,
+        lines[line_id].second, resize_height, resize_width, options.is_color,
+        enc, &datum);
+    if (image->status == false) continue;
+    image->data_size = datum.data().size();
+    image->expected_data_size =
+        datum.channels() * datum.height() * datum.width();
+    CHECK(datum.SerializeToString(&image->value));
+  }
+}
+
+// Starts the threads converting the images [begin, end) into images, which
+// must not be moved or resized until the threads are joined.
+static void StartConversion(const vector<std::pair<string, int> >& lines,
+    const string& root_folder, const ConvertImagesetOptions& options,
+    int begin, int end, vector<ConvertedImage>* images,
+    boost::thread_group* threads) {
+  images->resize(end - begin);
+  for (int thread_id = 0; thread_id < options.num_threads; ++thread_id) {
+    threads->create_thread(boost::bind(&ConvertImages, boost::cref(lines),
+        boost::cref(root_folder), boost::cref(options), begin, end,
+        thread_id, images));
+  }
+}
+
+int ConvertImageset(const vector<std::pair<string, int> >& lines,
+    const string& root_folder, const ConvertImagesetOptions& options,
+    db::DB* db, int64_t* total_bytes) {
+  CHECK_GT(options.num_threads, 0);
+  const int num_lines = lines.size();
+  const int chunk_size = std::max(1, options.chunk_size) * options.num_threads;
+  scoped_ptr<db::Transaction> txn(db->NewTransaction());
+  int count = 0;
+  int data_size = 0;
+  bool data_size_initialized = false;
+  int64_t txn_bytes = 0;
+  int64_t bytes = 0;
+  CPUTimer timer;
+  timer.Start();
+
+  // Each chunk is converted into its own vector, which the worker threads
+  // write to until they are joined: swapping the pointers hands the chunk
+  // to the writer without moving the vector under the threads.
+  scoped_ptr<vector<ConvertedImage> > images(new vector<ConvertedImage>());
+  scoped_ptr<vector<ConvertedImage> > next_images;
+  scoped_ptr<boost::thread_group> threads(new boost::thread_group());
+  scoped_ptr<boost::thread_group> next_threads;
+  StartConversion(lines, root_folder, options, 0,
+      std::min(chunk_size, num_lines), images.get(), threads.get());
+  for (int begin = 0; begin < num_lines; begin += chunk_size) {
+    const int end = std::min(begin + chunk_size, num_lines);
+    threads->join_all();
+    next_images.reset(new vector<ConvertedImage>());
+    next_threads.reset(new boost::thread_group());
+    if (end < num_lines) {
+      StartConversion(lines, root_folder, options, end,
+          std::min(end + chunk_size, num_lines), next_images.get(),
+          next_threads.get());
+    }
+    for (int line_id = begin; line_id < end; ++line_id) {
+      const ConvertedImage& image = (*images)[line_id - begin];
+      if (image.status == false) continue;
+      if (options.check_size) {
+        if (!data_size_initialized) {
+          data_size = image.expected_data_size;
+          data_size_initialized = true;
+        } else {
+          CHECK_EQ(image.data_size, data_size) << "Incorrect data field size "
+              << image.data_size;
+        }
+      }
+      // sequential
+      string key_str = format_int(line_id, 8) + "_" + lines[line_id].first;
+
+      // Put in db
+      txn->Put(key_str, image.value);
+      txn_bytes += key_str.size() + image.value.size();
+      ++count;
+
+      if (txn_bytes >= options.commit_bytes) {
+        // Commit db
+        txn->Commit();
+        txn.reset(db->NewTransaction());
+        bytes += txn_bytes;
+        txn_bytes = 0;
+        LOG(INFO) << "Processed " << count << " files ("
+            << count / (timer.MicroSeconds() / 1e6) << " files/s).";
+      }
+    }
+    images.swap(next_images);
+    threads.swap(next_threads);
+  }
+  // write the last batch
+  if (txn_bytes > 0) {
+    txn->Commit();
+    bytes += txn_bytes;
+  }
+  if (total_bytes) {
+    *total_bytes = bytes;
+  }
+  return count;
+}
+
+}  // namespace caffe
+#endif  // USE_OPENCV
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "boost/algorithm/string.hpp"
+#include "google/protobuf/descriptor.h"
+
+#include "caffe/layer_factory.hpp"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/engine_comparison.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+namespace caffe {
+
+using google::protobuf::EnumValueDescriptor;
+using google::protobuf::FieldDescriptor;
+
+string EngineVariant::name() const {
+  std::ostringstream name;
+  name << engine << (mode == Caffe::CPU ? "/CPU" : "/GPU");
+  if (mode == Caffe::CPU && threads > 0) {
+    name << "x" << threads;
+  }
+  if (!cpu_algorithm.empty()) {
+    name << ":" << cpu_algorithm;
+  }
+  return name.str();
+}
+
+vector<EngineVariant> EngineVariants(const Net<float>& net, bool gpu) {
+  vector<EngineVariant> variants(1, EngineVariant("CAFFE", Caffe::CPU, 1));
+  const int threads = ThreadPool::num_threads();
+  if (threads > 1) {
+    variants.push_back(EngineVariant("CAFFE", Caffe::CPU, threads));
+  }
+  std::set<string> algorithms;
+  for (int i = 0; i < net.layers().size(); ++i) {
+    const vector<string> names = net.layers()[i]->cpu_algorithms();
+    algorithms.insert(names.begin(), names.end());
+  }
+  for (std::set<string>::const_iterator it = algorithms.begin();
+       it != algorithms.end(); ++it) {
+    variants.push_back(EngineVariant("CAFFE", Caffe::CPU, threads, *it));
+  }
+#ifndef CPU_ONLY
+  if (gpu) {
+    variants.push_back(EngineVariant("CAFFE", Caffe::GPU));
+#ifdef USE_ACCMI
+    variants.push_back(EngineVariant("CUDNN", Caffe::GPU));
+#endif
+  }
+#endif
+  return variants;
+}
+
+bool SetLayerEngine(const string& engine, LayerParameter* param) {
+  const FieldDescriptor* field = LayerParameter::descriptor()->FindFieldByName(
+      boost::algorithm::to_lower_copy(param->type()) + "_param");
+  if (!field || field->type() != FieldDescriptor::TYPE_MESSAGE) {
+    return false;
+  }
+  const FieldDescriptor* engine_field =
+      field->message_type()->FindFieldByName("engine");
+  if (!engine_field || engine_field->type() != FieldDescriptor::TYPE_ENUM) {
+    return false;
+  }
+  const EnumValueDescriptor* value =
+      engine_field->enum_type()->FindValueByName(engine);
+  if (!value) {
+    return false;
+  }
+  google::protobuf::Message* type_param =
+      param->GetReflection()->MutableMessage(param, field);
+  type_param->GetReflection()->SetEnum(type_param, engine_field, value);
+  return true;
+}
+
+BlobVec CopyBlobs(const vector<Blob<float>*>& blobs, bool diff) {
+  BlobVec copies(blobs.size());
+  for (int i = 0; i < blobs.size(); ++i) {
+    copies[i].reset(new Blob<float>(blobs[i]->shape()));
+    caffe_copy(blobs[i]->count(),
+        diff ? blobs[i]->cpu_diff() : blobs[i]->cpu_data(),
+        copies[i]->mutable_cpu_data());
+  }
+  return copies;
+}
+
+// Resizes the ThreadPool for the lifetime of the object.
+class ScopedCpuThreads {
+ public:
+  explicit ScopedCpuThreads(int threads)
+      : previous_(ThreadPool::num_threads()) {
+    if (threads > 0 && threads != previous_) {
+      ThreadPool::SetNumThreads(threads);
+    }
+  }
+  ~ScopedCpuThreads() {
+    if (ThreadPool::num_threads() != previous_) {
+      ThreadPool::SetNumThreads(previous_);
+    }
+  }
+
+ private:
+  const int previous_;
+};
+
+bool RunLayerVariant(const EngineVariant& variant, Layer<float>* net_layer,
+    const BlobVec& inputs, int num_top, const vector<bool>& propagate_down,
+    bool backward, int iterations, BlobVec* top_diffs, EngineResult* result) {
+  LayerParameter param(net_layer->layer_param());
+  if (!SetLayerEngine(variant.engine, &param) && variant.engine != "CAFFE") {
+    return false;
+  }
+  Caffe::set_mode(variant.mode);
+  ScopedCpuThreads threads(variant.mode == Caffe::CPU ? variant.threads : 0);
+  vector<Blob<float>*> bottom, top;
+  BlobVec bottom_blobs(inputs.size()), top_blobs(num_top);
+  for (int i = 0; i < inputs.size(); ++i) {
+    bottom_blobs[i].reset(new Blob<float>());
+    bottom_blobs[i]->CopyFrom(*inputs[i], false, true);
+    bottom.push_back(bottom_blobs[i].get());
+  }
+  for (int i = 0; i < num_top; ++i) {
+    top_blobs[i].reset(new Blob<float>());
+    top.push_back(top_blobs[i].get());
+  }
+  shared_ptr<Layer<float> > layer = LayerRegistry<float>::CreateLayer(param);
+  layer->SetUp(bottom, top);
+  if (!variant.cpu_algorithm.empty()) {
+    const vector<string> algorithms = layer->cpu_algorithms();
+    const vector<string>::const_iterator it = std::find(algorithms.begin(),
+        algorithms.end(), variant.cpu_algorithm);
+    if (it == algorithms.end()) {
+      return false;
+    }
+    layer->set_cpu_algorithm(it - algorithms.begin());
+  }
+  CHECK_EQ(net_layer->blobs().size(), layer->blobs().size());
+  for (int i = 0; i < layer->blobs().size(); ++i) {
+    layer->blobs()[i]->CopyFrom(*net_layer->blobs()[i]);
+  }
+
+  // One untimed pass first, to allocate memory and pick algorithms.
+  layer->Forward(bottom, top);
+  Timer timer;
+  timer.Start();
+  for (int i = 0; i < iterations; ++i) {
+    layer->Forward(bottom, top);
+  }
+  timer.Stop();
+  result->forward_ms = timer.MilliSeconds() / iterations;
+  result->outputs = CopyBlobs(top, false);
+  if (!backward) {
+    return true;
+  }
+
+  if (top_diffs->empty()) {
+    for (int i = 0; i < top.size(); ++i) {
+      top_diffs->push_back(shared_ptr<Blob<float> >(new Blob<float>()));
+      top_diffs->back()->ReshapeLike(*top[i]);
+      caffe_rng_gaussian<float>(top[i]->count(), 0, 1,
+          top_diffs->back()->mutable_cpu_data());
+    }
+  }
+  // Loss layers keep the loss weight set up as their top diff.
+  for (int i = 0; i < top.size(); ++i) {
+    if (layer->loss(i) == 0) {
+      caffe_copy(top[i]->count(), (*top_diffs)[i]->cpu_data(),
+          top[i]->mutable_cpu_diff());
+    }
+  }
+  layer->Backward(top, propagate_down, bottom);
+  timer.Start();
+  for (int i = 0; i < iterations; ++i) {
+    layer->Backward(top, propagate_down, bottom);
+  }
+  timer.Stop();
+  result->backward_ms = timer.MilliSeconds() / iterations;
+  // Parameter gradients accumulate, so compare those of a single pass.
+  for (int i = 0; i < layer->blobs().size(); ++i) {
+    Blob<float>* blob = layer->blobs()[i].get();
+    caffe_set(blob->count(), 0.f, blob->mutable_cpu_diff());
+  }
+  layer->Backward(top, propagate_down, bottom);
+  vector<Blob<float>*> gradients;
+  for (int i = 0; i < bottom.size(); ++i) {
+    if (propagate_down[i]) {
+      gradients.push_back(bottom[i]);
+    }
+  }
+  for (int i = 0; i < layer->blobs().size(); ++i) {
+    gradients.push_back(layer->blobs()[i].get());
+  }
+  result->gradients = CopyBlobs(gradients, true);
+  return true;
+}
+
+void CompareBlobs(const BlobVec& blobs, const BlobVec& reference,
+    double* max_abs, double* max_rel) {
+  *max_abs = *max_rel = 0;
+  CHECK_EQ(blobs.size(), reference.size());
+  for (int i = 0; i < blobs.size(); ++i) {
+    CHECK_EQ(blobs[i]->count(), reference[i]->count());
+    const float* a = blobs[i]->cpu_data();
+    const float* b = reference[i]->cpu_data();
+    for (int j = 0; j < blobs[i]->count(); ++j) {
+      const double diff = std::fabs(a[j] - b[j]);
+      const double scale = std::max<double>(
+          std::max(std::fabs(a[j]), std::fabs(b[j])), 1.);
+      *max_abs = std::max(*max_abs, diff);
+      *max_rel = std::max(*max_rel, diff / scale);
+    }
+  }
+}
+
+}  // namespace caffe
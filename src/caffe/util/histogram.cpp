@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cmath>
+
+#include "caffe/common.hpp"
+#include "caffe/util/histogram.hpp"
+
+namespace caffe {
+
+Histogram::Histogram() {
+  Clear();
+}
+
+void Histogram::Clear() {
+  std::fill(buckets_, buckets_ + kNumBuckets, 0);
+  count_ = 0;
+  sum_ = 0;
+  min_ = 0;
+  max_ = 0;
+}
+
+int Histogram::Bucket(double value) {
+  if (value < 1) {
+    return 0;
+  }
+  int exponent;
+  // value = fraction * 2^exponent with fraction in [0.5, 1).
+  const double fraction = std::frexp(value, &exponent);
+  const int bucket = 1 + (exponent - 1) * kBucketsPerPowerOfTwo +
+      static_cast<int>((2 * fraction - 1) * kBucketsPerPowerOfTwo);
+  return std::min(bucket, kNumBuckets - 1);
+}
+
+double Histogram::BucketLowerBound(int bucket) {
+  if (bucket == 0) {
+    return 0;
+  }
+  const int exponent = (bucket - 1) / kBucketsPerPowerOfTwo;
+  const int step = (bucket - 1) % kBucketsPerPowerOfTwo;
+  return std::ldexp(1 + static_cast<double>(step) / kBucketsPerPowerOfTwo,
+      exponent);
+}
+
+void Histogram::Add(double value) {
+  CHECK_GE(value, 0);
+  ++buckets_[Bucket(value)];
+  if (count_ == 0 || value < min_) {
+    min_ = value;
+  }
+  if (count_ == 0 || value > max_) {
+    max_ = value;
+  }
+  ++count_;
+  sum_ += value;
+}
+
+void Histogram::Merge(const Histogram& other) {
+  if (other.count_ == 0) {
+    return;
+  }
+  for (int i = 0; i < kNumBuckets; ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  min_ = count_ ? std::min(min_, other.min_) : other.min_;
+  max_ = count_ ? std::max(max_, other.max_) : other.max_;
+  count_ += other.count_;
+  sum_ += other.sum_;
+}
+
+double Histogram::Percentile(double p) const {
+  CHECK_GE(p, 0);
+  CHECK_LE(p, 1);
+  if (count_ == 0) {
+    return 0;
+  }
+  const double rank = p * count_;
+  double below = 0;
+  int bucket = 0;
+  while (bucket < kNumBuckets - 1 && below + buckets_[bucket] < rank) {
+    below += buckets_[bucket++];
+  }
+  // Interpolate within the bucket, clamped to the values actually seen.
+  const double lower = std::max(BucketLowerBound(bucket), min_);
+  const double upper = bucket == kNumBuckets - 1 ? max_ :
+      std::min(BucketLowerBound(bucket + 1), max_);
+  const double within = buckets_[bucket] ?
+      (rank - below) / buckets_[bucket] : 0;
+  return std::max(lower, std::min(upper, lower + within * (upper - lower)));
+}
+
+}  // namespace caffe
@@ -15,15 +15,64 @@
 #endif
 
 #include <boost/random.hpp>
+#include <stdint.h>
 
+#include <cmath>
+#include <cstring>
 #include <limits>
 
 #include "caffe/common.hpp"
 #include "caffe/util/math_functions.hpp"
 #include "caffe/util/rng.hpp"
+#include "caffe/util/simd_math.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+#ifdef USE_OPENBLAS
+extern "C" {
+int openblas_get_num_threads(void);
+void openblas_set_num_threads(int num_threads);
+}
+#endif
 
 namespace caffe {
 
+int caffe_blas_threads() {
+#if defined(USE_MKL)
+  return mkl_get_max_threads();
+#elif defined(USE_OPENBLAS)
+  return openblas_get_num_threads();
+#else
+  return 0;
+#endif
+}
+
+void caffe_set_blas_threads(const int threads) {
+  CHECK_GT(threads, 0);
+#if defined(USE_MKL)
+  mkl_set_num_threads(threads);
+#elif defined(USE_OPENBLAS)
+  openblas_set_num_threads(threads);
+#endif
+}
+
+bool caffe_has_local_blas_threads() {
+#if defined(USE_MKL)
+  return true;
+#else
+  return false;
+#endif
+}
+
+int caffe_set_local_blas_threads(const int threads) {
+  CHECK_GE(threads, 0);
+#if defined(USE_MKL)
+  return mkl_set_num_threads_local(threads);
+#else
+  LOG(FATAL) << "The BLAS library has no per-thread setting.";
+  return 0;
+#endif
+}
+
 template<>
 void caffe_cpu_gemm<float>(const CBLAS_TRANSPOSE TransA,
     const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
@@ -70,13 +119,16 @@ void caffe_axpy<double>(const int N, const double alpha, const double* X,
 
 template <typename Dtype>
 void caffe_set(const int N, const Dtype alpha, Dtype* Y) {
-  if (alpha == 0) {
-    memset(Y, 0, sizeof(Dtype) * N);  // NOLINT(caffe/alt_fn)
-    return;
-  }
-  for (int i = 0; i < N; ++i) {
-    Y[i] = alpha;
-  }
+  parallel_for(N, [=](int begin, int end) {
+    if (alpha == 0) {
+      // NOLINT_NEXT_LINE(caffe/alt_fn)
+      memset(Y + begin, 0, sizeof(Dtype) * (end - begin));
+      return;
+    }
+    for (int i = begin; i < end; ++i) {
+      Y[i] = alpha;
+    }
+  });
 }
 
 template void caffe_set<int>(const int N, const int alpha, int* Y);
@@ -85,16 +137,20 @@ template void caffe_set<double>(const int N, const double alpha, double* Y);
 
 template <>
 void caffe_add_scalar(const int N, const float alpha, float* Y) {
-  for (int i = 0; i < N; ++i) {
-    Y[i] += alpha;
-  }
+  parallel_for(N, [=](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      Y[i] += alpha;
+    }
+  });
 }
 
 template <>
 void caffe_add_scalar(const int N, const double alpha, double* Y) {
-  for (int i = 0; i < N; ++i) {
-    Y[i] += alpha;
-  }
+  parallel_for(N, [=](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      Y[i] += alpha;
+    }
+  });
 }
 
 template <typename Dtype>
@@ -108,7 +164,10 @@ void caffe_copy(const int N, const Dtype* X, Dtype* Y) {
       NO_GPU;
 #endif
     } else {
-      memcpy(Y, X, sizeof(Dtype) * N);  // NOLINT(caffe/alt_fn)
+      parallel_for(N, [=](int begin, int end) {
+        // NOLINT_NEXT_LINE(caffe/alt_fn)
+        memcpy(Y + begin, X + begin, sizeof(Dtype) * (end - begin));
+      });
     }
   }
 }
@@ -144,103 +203,260 @@ void caffe_cpu_axpby<double>(const int N, const double alpha, const double* X,
 template <>
 void caffe_add<float>(const int n, const float* a, const float* b,
     float* y) {
-  vsAdd(n, a, b, y);
+  parallel_for(n, [=](int begin, int end) {
+    vsAdd(end - begin, a + begin, b + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_add<double>(const int n, const double* a, const double* b,
     double* y) {
-  vdAdd(n, a, b, y);
+  parallel_for(n, [=](int begin, int end) {
+    vdAdd(end - begin, a + begin, b + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_sub<float>(const int n, const float* a, const float* b,
     float* y) {
-  vsSub(n, a, b, y);
+  parallel_for(n, [=](int begin, int end) {
+    vsSub(end - begin, a + begin, b + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_sub<double>(const int n, const double* a, const double* b,
     double* y) {
-  vdSub(n, a, b, y);
+  parallel_for(n, [=](int begin, int end) {
+    vdSub(end - begin, a + begin, b + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_mul<float>(const int n, const float* a, const float* b,
     float* y) {
-  vsMul(n, a, b, y);
+  parallel_for(n, [=](int begin, int end) {
+    vsMul(end - begin, a + begin, b + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_mul<double>(const int n, const double* a, const double* b,
     double* y) {
-  vdMul(n, a, b, y);
+  parallel_for(n, [=](int begin, int end) {
+    vdMul(end - begin, a + begin, b + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_div<float>(const int n, const float* a, const float* b,
     float* y) {
-  vsDiv(n, a, b, y);
+  parallel_for(n, [=](int begin, int end) {
+    vsDiv(end - begin, a + begin, b + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_div<double>(const int n, const double* a, const double* b,
     double* y) {
-  vdDiv(n, a, b, y);
+  parallel_for(n, [=](int begin, int end) {
+    vdDiv(end - begin, a + begin, b + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_powx<float>(const int n, const float* a, const float b,
     float* y) {
-  vsPowx(n, a, b, y);
+  parallel_for(n, [=](int begin, int end) {
+#ifdef USE_MKL
+    vsPowx(end - begin, a + begin, b, y + begin);
+#else
+    simd_powx(end - begin, a + begin, b, y + begin);
+#endif
+  });
 }
 
 template <>
 void caffe_powx<double>(const int n, const double* a, const double b,
     double* y) {
-  vdPowx(n, a, b, y);
+  parallel_for(n, [=](int begin, int end) {
+    vdPowx(end - begin, a + begin, b, y + begin);
+  });
 }
 
 template <>
 void caffe_sqr<float>(const int n, const float* a, float* y) {
-  vsSqr(n, a, y);
+  parallel_for(n, [=](int begin, int end) {
+    vsSqr(end - begin, a + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_sqr<double>(const int n, const double* a, double* y) {
-  vdSqr(n, a, y);
+  parallel_for(n, [=](int begin, int end) {
+    vdSqr(end - begin, a + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_exp<float>(const int n, const float* a, float* y) {
-  vsExp(n, a, y);
+  parallel_for(n, [=](int begin, int end) {
+#ifdef USE_MKL
+    vsExp(end - begin, a + begin, y + begin);
+#else
+    simd_exp(end - begin, a + begin, y + begin);
+#endif
+  });
 }
 
 template <>
 void caffe_exp<double>(const int n, const double* a, double* y) {
-  vdExp(n, a, y);
+  parallel_for(n, [=](int begin, int end) {
+    vdExp(end - begin, a + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_log<float>(const int n, const float* a, float* y) {
-  vsLn(n, a, y);
+  parallel_for(n, [=](int begin, int end) {
+#ifdef USE_MKL
+    vsLn(end - begin, a + begin, y + begin);
+#else
+    simd_log(end - begin, a + begin, y + begin);
+#endif
+  });
 }
 
 template <>
 void caffe_log<double>(const int n, const double* a, double* y) {
-  vdLn(n, a, y);
+  parallel_for(n, [=](int begin, int end) {
+    vdLn(end - begin, a + begin, y + begin);
+  });
+}
+
+template <>
+void caffe_log1p<float>(const int n, const float* a, float* y) {
+  parallel_for(n, [=](int begin, int end) {
+    simd_log1p(end - begin, a + begin, y + begin);
+  });
+}
+
+template <>
+void caffe_log1p<double>(const int n, const double* a, double* y) {
+  parallel_for(n, [=](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      y[i] = std::log1p(a[i]);
+    }
+  });
+}
+
+template <>
+void caffe_tanh<float>(const int n, const float* a, float* y) {
+  parallel_for(n, [=](int begin, int end) {
+    simd_tanh(end - begin, a + begin, y + begin);
+  });
+}
+
+template <>
+void caffe_tanh<double>(const int n, const double* a, double* y) {
+  parallel_for(n, [=](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      y[i] = std::tanh(a[i]);
+    }
+  });
+}
+
+template <>
+void caffe_sigmoid<float>(const int n, const float* a, float* y) {
+  parallel_for(n, [=](int begin, int end) {
+    simd_sigmoid(end - begin, a + begin, y + begin);
+  });
+}
+
+template <>
+void caffe_sigmoid<double>(const int n, const double* a, double* y) {
+  parallel_for(n, [=](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      y[i] = 1. / (1. + std::exp(-a[i]));
+    }
+  });
 }
 
 template <>
 void caffe_abs<float>(const int n, const float* a, float* y) {
-    vsAbs(n, a, y);
+  parallel_for(n, [=](int begin, int end) {
+    vsAbs(end - begin, a + begin, y + begin);
+  });
 }
 
 template <>
 void caffe_abs<double>(const int n, const double* a, double* y) {
-    vdAbs(n, a, y);
+  parallel_for(n, [=](int begin, int end) {
+    vdAbs(end - begin, a + begin, y + begin);
+  });
 }
 
+// The nearest fp16 value to x.
+static inline float round_fp16(float x) {
+  const float abs_x = std::fabs(x);
+  if (abs_x != abs_x) {
+    return x;
+  }
+  // Halfway between the largest fp16, 65504, and the next power of 2.
+  if (abs_x >= 65520.f) {
+    return std::copysign(std::numeric_limits<float>::infinity(), x);
+  }
+  // Subnormal fp16 values are multiples of 2^-24.
+  if (abs_x < 6.103515625e-05f) {
+    return std::copysign(std::rint(abs_x * 16777216.f) / 16777216.f, x);
+  }
+  // Round the 23 bit mantissa to 10 bits.
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));  // NOLINT(caffe/alt_fn)
+  bits = (bits + 0xfff + ((bits >> 13) & 1)) & 0xffffe000u;
+  memcpy(&x, &bits, sizeof(x));  // NOLINT(caffe/alt_fn)
+  return x;
+}
+
+// The nearest bfloat16 value to x.
+static inline float round_bf16(float x) {
+  if (x != x) {
+    return x;
+  }
+  // Round the 23 bit mantissa to 7 bits.
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));  // NOLINT(caffe/alt_fn)
+  bits = (bits + 0x7fff + ((bits >> 16) & 1)) & 0xffff0000u;
+  memcpy(&x, &bits, sizeof(x));  // NOLINT(caffe/alt_fn)
+  return x;
+}
+
+template <typename Dtype>
+void caffe_round_fp16(const int n, const Dtype* a, Dtype* y) {
+  parallel_for(n, [=](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      y[i] = round_fp16(static_cast<float>(a[i]));
+    }
+  });
+}
+
+template void caffe_round_fp16<float>(const int n, const float* a, float* y);
+template void caffe_round_fp16<double>(const int n, const double* a,
+    double* y);
+
+template <typename Dtype>
+void caffe_round_bf16(const int n, const Dtype* a, Dtype* y) {
+  parallel_for(n, [=](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      y[i] = round_bf16(static_cast<float>(a[i]));
+    }
+  });
+}
+
+template void caffe_round_bf16<float>(const int n, const float* a, float* y);
+template void caffe_round_bf16<double>(const int n, const double* a,
+    double* y);
+
 unsigned int caffe_rng_rand() {
   return (*caffe_rng())();
 }
@@ -296,6 +296,62 @@ void caffe_gpu_abs<double>(const int N, const double* a, double* y) {
       N, a, y);
 }
 
+// See round_fp16 in math_functions.cpp.
+template <typename Dtype>
+__global__ void round_fp16_kernel(const int n, const Dtype* a, Dtype* y) {
+  HIP_KERNEL_LOOP(index, n) {
+    float x = a[index];
+    const float abs_x = fabsf(x);
+    if (abs_x != abs_x) {
+      // NaN stays NaN.
+    } else if (abs_x >= 65520.f) {
+      x = copysignf(INFINITY, x);
+    } else if (abs_x < 6.103515625e-05f) {
+      x = copysignf(rintf(abs_x * 16777216.f) / 16777216.f, x);
+    } else {
+      const unsigned int bits = __float_as_uint(x);
+      x = __uint_as_float((bits + 0xfff + ((bits >> 13) & 1)) & 0xffffe000u);
+    }
+    y[index] = x;
+  }
+}
+
+template <typename Dtype>
+__global__ void round_bf16_kernel(const int n, const Dtype* a, Dtype* y) {
+  HIP_KERNEL_LOOP(index, n) {
+    float x = a[index];
+    if (x == x) {
+      const unsigned int bits = __float_as_uint(x);
+      x = __uint_as_float((bits + 0x7fff + ((bits >> 16) & 1)) & 0xffff0000u);
+    }
+    y[index] = x;
+  }
+}
+
+template <typename Dtype>
+void caffe_gpu_round_fp16(const int N, const Dtype* a, Dtype* y) {
+  // NOLINT_NEXT_LINE(whitespace/operators)
+  hipLaunchKernelGGL(round_fp16_kernel<Dtype>, dim3(CAFFE_GET_BLOCKS(N)), dim3(CAFFE_HIP_NUM_THREADS), 0, 0,
+      N, a, y);
+}
+
+template void caffe_gpu_round_fp16<float>(const int N, const float* a,
+    float* y);
+template void caffe_gpu_round_fp16<double>(const int N, const double* a,
+    double* y);
+
+template <typename Dtype>
+void caffe_gpu_round_bf16(const int N, const Dtype* a, Dtype* y) {
+  // NOLINT_NEXT_LINE(whitespace/operators)
+  hipLaunchKernelGGL(round_bf16_kernel<Dtype>, dim3(CAFFE_GET_BLOCKS(N)), dim3(CAFFE_HIP_NUM_THREADS), 0, 0,
+      N, a, y);
+}
+
+template void caffe_gpu_round_bf16<float>(const int N, const float* a,
+    float* y);
+template void caffe_gpu_round_bf16<double>(const int N, const double* a,
+    double* y);
+
 
 template <typename Dtype>
 __global__ void exp_kernel(const int n, const Dtype* a, Dtype* y) {
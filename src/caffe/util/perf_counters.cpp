@@ -0,0 +1,190 @@
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/perf_counters.hpp"
+
+namespace caffe {
+
+PerfCounts::PerfCounts() {
+  for (int i = 0; i < NUM_EVENTS; ++i) {
+    count[i] = 0;
+  }
+}
+
+PerfCounts& PerfCounts::operator+=(const PerfCounts& other) {
+  for (int i = 0; i < NUM_EVENTS; ++i) {
+    count[i] += other.count[i];
+  }
+  return *this;
+}
+
+PerfCounts PerfCounts::operator-(const PerfCounts& other) const {
+  PerfCounts difference;
+  for (int i = 0; i < NUM_EVENTS; ++i) {
+    // Scaled counts of multiplexed events can decrease slightly.
+    difference.count[i] = count[i] > other.count[i] ?
+        count[i] - other.count[i] : 0;
+  }
+  return difference;
+}
+
+double PerfCounts::ipc() const {
+  return count[CYCLES] ?
+      static_cast<double>(count[INSTRUCTIONS]) / count[CYCLES] : 0;
+}
+
+double PerfCounts::cache_miss_rate() const {
+  return count[CACHE_REFERENCES] ?
+      static_cast<double>(count[CACHE_MISSES]) / count[CACHE_REFERENCES] : 0;
+}
+
+double PerfCounts::memory_bytes() const {
+  return static_cast<double>(count[CACHE_MISSES]) * kCacheLineBytes;
+}
+
+#ifdef __linux__
+
+// Whether the warning that the counters are unavailable was logged.
+static bool warned_unavailable = false;
+
+PerfCounters::PerfCounters() {
+  const uint64_t configs[PerfCounts::NUM_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_REFERENCES,
+    PERF_COUNT_HW_CACHE_MISSES
+  };
+  int error = 0;
+  for (int i = 0; i < PerfCounts::NUM_EVENTS; ++i) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[i];
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fds_[i] < 0 && !error) {
+      error = errno;
+    }
+  }
+  if (!available() && !warned_unavailable) {
+    warned_unavailable = true;
+    LOG(WARNING) << "Hardware performance counters are unavailable: "
+        << strerror(error) << ". perf_event_open may be disabled by "
+        << "/proc/sys/kernel/perf_event_paranoid or the hypervisor.";
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (int i = 0; i < PerfCounts::NUM_EVENTS; ++i) {
+    if (fds_[i] >= 0) {
+      close(fds_[i]);
+    }
+  }
+}
+
+PerfCounts PerfCounters::Read() const {
+  PerfCounts counts;
+  for (int i = 0; i < PerfCounts::NUM_EVENTS; ++i) {
+    // The value, the time enabled and the time running.
+    uint64_t values[3];
+    if (fds_[i] < 0 || read(fds_[i], values, sizeof(values)) !=
+        sizeof(values) || values[2] == 0) {
+      continue;
+    }
+    counts.count[i] = values[2] < values[1] ?
+        static_cast<uint64_t>(static_cast<double>(values[0]) * values[1] /
+                              values[2]) : values[0];
+  }
+  return counts;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+  for (int i = 0; i < PerfCounts::NUM_EVENTS; ++i) {
+    fds_[i] = -1;
+  }
+}
+
+PerfCounters::~PerfCounters() {}
+
+PerfCounts PerfCounters::Read() const {
+  return PerfCounts();
+}
+
+#endif  // __linux__
+
+bool PerfCounters::available() const {
+  return available(PerfCounts::CYCLES) && available(PerfCounts::INSTRUCTIONS);
+}
+
+bool PerfCounters::available(PerfCounts::Event event) const {
+  return fds_[event] >= 0;
+}
+
+LayerPerfCounters::LayerPerfCounters(int num_layers)
+    : forward_(num_layers), backward_(num_layers) {}
+
+void LayerPerfCounters::Start() {
+  start_ = counters_.Read();
+}
+
+void LayerPerfCounters::Stop(int layer_id, bool backward) {
+  const PerfCounts counts = counters_.Read() - start_;
+  if (backward) {
+    backward_[layer_id] += counts;
+  } else {
+    forward_[layer_id] += counts;
+  }
+}
+
+void LayerPerfCounters::Clear() {
+  forward_.assign(forward_.size(), PerfCounts());
+  backward_.assign(backward_.size(), PerfCounts());
+}
+
+string LayerPerfCounters::Report(const vector<string>& layer_names,
+    int iterations) const {
+  CHECK_EQ(layer_names.size(), forward_.size());
+  CHECK_GT(iterations, 0);
+  std::ostringstream report;
+  report << std::left << std::setw(20) << "layer" << std::setw(10) << "pass"
+      << std::right << std::setw(12) << "Mcycles" << std::setw(8) << "IPC"
+      << std::setw(12) << "LLC miss %" << std::setw(14) << "MB from mem"
+      << "\n";
+  report << std::fixed;
+  for (int i = 0; i < layer_names.size(); ++i) {
+    for (int pass = 0; pass < 2; ++pass) {
+      const PerfCounts& counts = pass ? backward_[i] : forward_[i];
+      report << std::left << std::setw(20) << layer_names[i] << std::setw(10)
+          << (pass ? "backward" : "forward") << std::right
+          << std::setprecision(2) << std::setw(12)
+          << counts.count[PerfCounts::CYCLES] / 1e6 / iterations
+          << std::setw(8) << counts.ipc()
+          << std::setprecision(1) << std::setw(12)
+          << 100 * counts.cache_miss_rate()
+          << std::setprecision(2) << std::setw(14)
+          << counts.memory_bytes() / (1024 * 1024) / iterations << "\n";
+    }
+  }
+  return report.str();
+}
+
+}  // namespace caffe
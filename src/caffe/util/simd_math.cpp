@@ -0,0 +1,248 @@
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "caffe/common.hpp"
+#include "caffe/util/simd_kernels.hpp"
+#include "caffe/util/simd_math.hpp"
+
+namespace caffe {
+
+namespace {
+
+#if defined(__SSE2__)
+
+struct Sse2 {
+  typedef __m128 V;
+  typedef __m128 M;
+  static const int kWidth = 4;
+
+  static V load(const float* p) { return _mm_loadu_ps(p); }
+  static void store(float* p, V a) { _mm_storeu_ps(p, a); }
+  static V set1(float a) { return _mm_set1_ps(a); }
+  static V add(V a, V b) { return _mm_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm_div_ps(a, b); }
+  static V fmadd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+  static V min(V a, V b) { return _mm_min_ps(a, b); }
+  static V max(V a, V b) { return _mm_max_ps(a, b); }
+  static V sqrt(V a) { return _mm_sqrt_ps(a); }
+  // Only for |a| < 2^31, which is all the kernels need.
+  static V round(V a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+  static V abs(V a) {
+    return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+  }
+  static V copysign(V magnitude, V sign) {
+    const __m128 sign_bit = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+    return _mm_or_ps(_mm_andnot_ps(sign_bit, magnitude),
+        _mm_and_ps(sign_bit, sign));
+  }
+  static M lt(V a, V b) { return _mm_cmplt_ps(a, b); }
+  static M gt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+  static M eq(V a, V b) { return _mm_cmpeq_ps(a, b); }
+  static M isnan(V a) { return _mm_cmpunord_ps(a, a); }
+  static M and_(M a, M b) { return _mm_and_ps(a, b); }
+  static V select(M m, V a, V b) {
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+  }
+  static V pow2(V n) {
+    const __m128i biased = _mm_add_epi32(_mm_cvtps_epi32(n),
+        _mm_set1_epi32(127));
+    return _mm_castsi128_ps(_mm_slli_epi32(biased, 23));
+  }
+  static V frexp(V a, V* exponent) {
+    const __m128i bits = _mm_castps_si128(a);
+    *exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(
+        _mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff)),
+        _mm_set1_epi32(126)));
+    return _mm_castsi128_ps(_mm_or_si128(
+        _mm_and_si128(bits, _mm_set1_epi32(0x807fffff)),
+        _mm_set1_epi32(0x3f000000)));
+  }
+};
+
+#endif
+
+// The instruction sets with kernels, best first.
+const char* const kIsas[] = { "avx512", "avx2", "sse2" };
+const int kNumIsas = sizeof(kIsas) / sizeof(kIsas[0]);
+
+const float kInf = std::numeric_limits<float>::infinity();
+
+// Whether the CPU, and the OS for the wider registers, support the
+// instruction set, as cpuid tells.
+bool CpuSupports(const string& isa) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if (isa == "avx512") {
+    return __builtin_cpu_supports("avx512f");
+  }
+  if (isa == "avx2") {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  }
+  if (isa == "sse2") {
+    return __builtin_cpu_supports("sse2");
+  }
+#endif
+  return false;
+}
+
+// The kernels of the instruction set, or NULL if the CPU lacks it or the
+// build did not compile them.
+const SimdKernels* KernelsFor(const string& isa) {
+  // Checked first, as the kernels and even their accessor may use the
+  // instructions.
+  if (!CpuSupports(isa)) {
+    return NULL;
+  }
+  if (isa == "avx512") {
+    return simd_avx512_kernels();
+  }
+  if (isa == "avx2") {
+    return simd_avx2_kernels();
+  }
+  if (isa == "sse2") {
+    return simd_sse2_kernels();
+  }
+  return NULL;
+}
+
+// The best kernels, unless CAFFE_SIMD_ISA names other ones.
+const SimdKernels* SelectKernels() {
+  const char* forced = getenv("CAFFE_SIMD_ISA");
+  if (forced && *forced) {
+    if (string(forced) == "scalar") {
+      return NULL;
+    }
+    const SimdKernels* kernels = KernelsFor(forced);
+    if (kernels) {
+      return kernels;
+    }
+    LOG(WARNING) << "CAFFE_SIMD_ISA=" << forced << " is not supported by "
+        << "this CPU or build; using the best instruction set.";
+  }
+  for (int i = 0; i < kNumIsas; ++i) {
+    const SimdKernels* kernels = KernelsFor(kIsas[i]);
+    if (kernels) {
+      return kernels;
+    }
+  }
+  return NULL;
+}
+
+// The kernels in use, or NULL to use libm only.
+const SimdKernels*& selected_kernels() {
+  static const SimdKernels* kernels = SelectKernels();
+  return kernels;
+}
+
+float Exp(float x) { return std::exp(x); }
+float Log(float x) { return std::log(x); }
+float Log1p(float x) { return std::log1p(x); }
+float Tanh(float x) { return std::tanh(x); }
+float Sigmoid(float x) { return 1.f / (1.f + std::exp(-x)); }
+
+typedef int (*VectorFunction)(const int n, const float* a, float* y);
+
+// Applies the selected vector kernel to the whole vectors of a, then libm to
+// the remaining elements.
+template <float (*Libm)(float)>
+void Apply(VectorFunction SimdKernels::*kernel, const int n, const float* a,
+    float* y) {
+  const SimdKernels* kernels = selected_kernels();
+  int i = kernels ? (kernels->*kernel)(n, a, y) : 0;
+  for (; i < n; ++i) {
+    y[i] = Libm(a[i]);
+  }
+}
+
+}  // namespace
+
+const SimdKernels* simd_sse2_kernels() {
+#if defined(__SSE2__)
+  static const SimdKernels kernels = MakeSimdKernels<Sse2>("sse2");
+  return &kernels;
+#else
+  return NULL;
+#endif
+}
+
+void simd_exp(const int n, const float* a, float* y) {
+  Apply<Exp>(&SimdKernels::exp, n, a, y);
+}
+
+void simd_log(const int n, const float* a, float* y) {
+  Apply<Log>(&SimdKernels::log, n, a, y);
+}
+
+void simd_log1p(const int n, const float* a, float* y) {
+  Apply<Log1p>(&SimdKernels::log1p, n, a, y);
+}
+
+void simd_tanh(const int n, const float* a, float* y) {
+  Apply<Tanh>(&SimdKernels::tanh, n, a, y);
+}
+
+void simd_sigmoid(const int n, const float* a, float* y) {
+  Apply<Sigmoid>(&SimdKernels::sigmoid, n, a, y);
+}
+
+void simd_powx(const int n, const float* a, const float b, float* y) {
+  // The usual exponents, exactly.
+  if (b == 1.f) {
+    memmove(y, a, sizeof(float) * n);  // NOLINT(caffe/alt_fn)
+    return;
+  }
+  if (b == 2.f) {
+    for (int i = 0; i < n; ++i) {
+      y[i] = a[i] * a[i];
+    }
+    return;
+  }
+  if (b == 0.5f) {
+    for (int i = 0; i < n; ++i) {
+      // As pow, unlike sqrt, gives +0 for -0 and inf for -inf.
+      y[i] = a[i] == -kInf ? kInf : std::sqrt(a[i]) + 0.f;
+    }
+    return;
+  }
+  if (b == 0.f) {
+    for (int i = 0; i < n; ++i) {
+      y[i] = 1.f;
+    }
+    return;
+  }
+  const SimdKernels* kernels = selected_kernels();
+  const bool integral = std::floor(b) == b;
+  const bool odd = integral && std::fabs(std::fmod(b, 2.f)) == 1.f;
+  int i = kernels ? kernels->powx(n, a, b, integral, odd, y) : 0;
+  for (; i < n; ++i) {
+    y[i] = std::pow(a[i], b);
+  }
+}
+
+const char* simd_isa() {
+  const SimdKernels* kernels = selected_kernels();
+  return kernels ? kernels->isa : "scalar";
+}
+
+bool simd_isa_supported(const string& isa) {
+  return isa == "scalar" || KernelsFor(isa) != NULL;
+}
+
+bool simd_set_isa(const string& isa) {
+  if (!simd_isa_supported(isa)) {
+    return false;
+  }
+  selected_kernels() = KernelsFor(isa);
+  return true;
+}
+
+}  // namespace caffe
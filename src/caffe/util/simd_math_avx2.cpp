@@ -0,0 +1,85 @@
+// The simd_math kernels for AVX2 with FMA. The build compiles this file with
+// -mavx2 -mfma on x86, and simd_math.cpp calls them only on CPUs that
+// support both.
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+#include <cstddef>
+
+#include "caffe/util/simd_kernels.hpp"
+
+namespace caffe {
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+namespace {
+
+struct Avx2 {
+  typedef __m256 V;
+  typedef __m256 M;
+  static const int kWidth = 8;
+
+  static V load(const float* p) { return _mm256_loadu_ps(p); }
+  static void store(float* p, V a) { _mm256_storeu_ps(p, a); }
+  static V set1(float a) { return _mm256_set1_ps(a); }
+  static V add(V a, V b) { return _mm256_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm256_div_ps(a, b); }
+  static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+  static V min(V a, V b) { return _mm256_min_ps(a, b); }
+  static V max(V a, V b) { return _mm256_max_ps(a, b); }
+  static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+  static V round(V a) {
+    return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static V abs(V a) {
+    return _mm256_and_ps(a, _mm256_castsi256_ps(
+        _mm256_set1_epi32(0x7fffffff)));
+  }
+  static V copysign(V magnitude, V sign) {
+    const __m256 sign_bit = _mm256_castsi256_ps(
+        _mm256_set1_epi32(0x80000000));
+    return _mm256_or_ps(_mm256_andnot_ps(sign_bit, magnitude),
+        _mm256_and_ps(sign_bit, sign));
+  }
+  static M lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static M gt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+  static M eq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  static M isnan(V a) { return _mm256_cmp_ps(a, a, _CMP_UNORD_Q); }
+  static M and_(M a, M b) { return _mm256_and_ps(a, b); }
+  static V select(M m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+  static V pow2(V n) {
+    const __m256i biased = _mm256_add_epi32(_mm256_cvtps_epi32(n),
+        _mm256_set1_epi32(127));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(biased, 23));
+  }
+  static V frexp(V a, V* exponent) {
+    const __m256i bits = _mm256_castps_si256(a);
+    *exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_and_si256(
+        _mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xff)),
+        _mm256_set1_epi32(126)));
+    return _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi32(0x807fffff)),
+        _mm256_set1_epi32(0x3f000000)));
+  }
+};
+
+}  // namespace
+
+const SimdKernels* simd_avx2_kernels() {
+  static const SimdKernels kernels = MakeSimdKernels<Avx2>("avx2");
+  return &kernels;
+}
+
+#else
+
+const SimdKernels* simd_avx2_kernels() {
+  return NULL;
+}
+
+#endif
+
+}  // namespace caffe
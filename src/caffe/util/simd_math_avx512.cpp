@@ -0,0 +1,86 @@
+// The simd_math kernels for AVX-512. The build compiles this file with
+// -mavx512f on x86, and simd_math.cpp calls them only on CPUs that support
+// it.
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include <cstddef>
+
+#include "caffe/util/simd_kernels.hpp"
+
+namespace caffe {
+
+#if defined(__AVX512F__)
+
+namespace {
+
+struct Avx512 {
+  typedef __m512 V;
+  typedef __mmask16 M;
+  static const int kWidth = 16;
+
+  static V load(const float* p) { return _mm512_loadu_ps(p); }
+  static void store(float* p, V a) { _mm512_storeu_ps(p, a); }
+  static V set1(float a) { return _mm512_set1_ps(a); }
+  static V add(V a, V b) { return _mm512_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm512_div_ps(a, b); }
+  static V fmadd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+  static V min(V a, V b) { return _mm512_min_ps(a, b); }
+  static V max(V a, V b) { return _mm512_max_ps(a, b); }
+  static V sqrt(V a) { return _mm512_sqrt_ps(a); }
+  static V round(V a) {
+    return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT |
+        _MM_FROUND_NO_EXC);
+  }
+  static V abs(V a) {
+    return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a),
+        _mm512_set1_epi32(0x7fffffff)));
+  }
+  static V copysign(V magnitude, V sign) {
+    const __m512i sign_bit = _mm512_set1_epi32(0x80000000);
+    return _mm512_castsi512_ps(_mm512_or_si512(
+        _mm512_andnot_si512(sign_bit, _mm512_castps_si512(magnitude)),
+        _mm512_and_si512(sign_bit, _mm512_castps_si512(sign))));
+  }
+  static M lt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+  static M gt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+  static M eq(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+  static M isnan(V a) { return _mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q); }
+  static M and_(M a, M b) { return static_cast<M>(a & b); }
+  static V select(M m, V a, V b) { return _mm512_mask_blend_ps(m, b, a); }
+  static V pow2(V n) {
+    const __m512i biased = _mm512_add_epi32(_mm512_cvtps_epi32(n),
+        _mm512_set1_epi32(127));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(biased, 23));
+  }
+  static V frexp(V a, V* exponent) {
+    const __m512i bits = _mm512_castps_si512(a);
+    *exponent = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_and_si512(
+        _mm512_srli_epi32(bits, 23), _mm512_set1_epi32(0xff)),
+        _mm512_set1_epi32(126)));
+    return _mm512_castsi512_ps(_mm512_or_si512(
+        _mm512_and_si512(bits, _mm512_set1_epi32(0x807fffff)),
+        _mm512_set1_epi32(0x3f000000)));
+  }
+};
+
+}  // namespace
+
+const SimdKernels* simd_avx512_kernels() {
+  static const SimdKernels kernels = MakeSimdKernels<Avx512>("avx512");
+  return &kernels;
+}
+
+#else
+
+const SimdKernels* simd_avx512_kernels() {
+  return NULL;
+}
+
+#endif
+
+}  // namespace caffe
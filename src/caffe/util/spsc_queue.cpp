@@ -0,0 +1,280 @@
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "caffe/layers/base_data_layer.hpp"
+#include "caffe/util/spsc_queue.hpp"
+
+namespace caffe {
+
+// Number of busy checks, then of yields, before a waiting side parks.
+static const int kSpinCount = 256;
+static const int kYieldCount = 64;
+static const int kCacheLineSize = 64;
+
+template<typename T>
+class SPSCQueue<T>::sync {
+ public:
+  sync()
+      : head_(0), tail_(0), consumer_parked_(false), producer_parked_(false),
+        pop_stalls_(0), pop_stall_us_(0), push_stalls_(0),
+        push_stall_us_(0) {
+  }
+
+  // Index of the next item to pop, written by the consumer only.
+  std::atomic<size_t> head_;
+  char head_padding_[kCacheLineSize];
+  // Index of the next free slot, written by the producer only.
+  std::atomic<size_t> tail_;
+  char tail_padding_[kCacheLineSize];
+
+  // Set by a side before it parks; the other side then notifies under the
+  // mutex. Both are sequentially consistent with head_ and tail_, so either
+  // the parking side sees the update or the updating side sees the flag.
+  std::atomic<bool> consumer_parked_;
+  std::atomic<bool> producer_parked_;
+  boost::mutex mutex_;
+  boost::condition_variable not_empty_;
+  boost::condition_variable not_full_;
+
+  std::atomic<uint64_t> pop_stalls_;
+  std::atomic<uint64_t> pop_stall_us_;
+  std::atomic<uint64_t> push_stalls_;
+  std::atomic<uint64_t> push_stall_us_;
+};
+
+static size_t RoundUpToPowerOfTwo(size_t n) {
+  size_t power = 1;
+  while (power < n) {
+    power <<= 1;
+  }
+  return power;
+}
+
+template<typename T>
+SPSCQueue<T>::SPSCQueue(int capacity)
+    : capacity_(capacity), mask_(RoundUpToPowerOfTwo(capacity) - 1),
+      buffer_(mask_ + 1), sync_(new sync()) {
+  CHECK_GT(capacity, 0);
+}
+
+static uint64_t MicroSecondsSince(const boost::posix_time::ptime& start) {
+  return (boost::posix_time::microsec_clock::universal_time() - start)
+      .total_microseconds();
+}
+
+template<typename T>
+void SPSCQueue<T>::wait_not_empty(const string& log_on_wait) {
+  const size_t head = sync_->head_.load(std::memory_order_relaxed);
+  if (sync_->tail_.load(std::memory_order_acquire) != head) {
+    return;
+  }
+  if (!log_on_wait.empty()) {
+    LOG_EVERY_N(INFO, 1000) << log_on_wait;
+  }
+  const boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+  bool ready = false;
+  for (int i = 0; i < kSpinCount + kYieldCount && !ready; ++i) {
+    if (i >= kSpinCount) {
+      boost::this_thread::yield();
+      boost::this_thread::interruption_point();
+    }
+    ready = sync_->tail_.load(std::memory_order_acquire) != head;
+  }
+  if (!ready) {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    sync_->consumer_parked_.store(true);
+    try {
+      while (sync_->tail_.load() == head) {
+        sync_->not_empty_.wait(lock);
+      }
+    } catch (boost::thread_interrupted&) {
+      sync_->consumer_parked_.store(false);
+      throw;
+    }
+    sync_->consumer_parked_.store(false);
+  }
+  sync_->pop_stalls_.fetch_add(1, std::memory_order_relaxed);
+  sync_->pop_stall_us_.fetch_add(MicroSecondsSince(start),
+      std::memory_order_relaxed);
+}
+
+template<typename T>
+void SPSCQueue<T>::wait_not_full() {
+  const size_t tail = sync_->tail_.load(std::memory_order_relaxed);
+  if (tail - sync_->head_.load(std::memory_order_acquire) < capacity_) {
+    return;
+  }
+  const boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+  bool ready = false;
+  for (int i = 0; i < kSpinCount + kYieldCount && !ready; ++i) {
+    if (i >= kSpinCount) {
+      boost::this_thread::yield();
+      boost::this_thread::interruption_point();
+    }
+    ready = tail - sync_->head_.load(std::memory_order_acquire) < capacity_;
+  }
+  if (!ready) {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    sync_->producer_parked_.store(true);
+    try {
+      while (tail - sync_->head_.load() >= capacity_) {
+        sync_->not_full_.wait(lock);
+      }
+    } catch (boost::thread_interrupted&) {
+      sync_->producer_parked_.store(false);
+      throw;
+    }
+    sync_->producer_parked_.store(false);
+  }
+  sync_->push_stalls_.fetch_add(1, std::memory_order_relaxed);
+  sync_->push_stall_us_.fetch_add(MicroSecondsSince(start),
+      std::memory_order_relaxed);
+}
+
+template<typename T>
+void SPSCQueue<T>::notify_consumer() {
+  if (sync_->consumer_parked_.load()) {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    sync_->not_empty_.notify_one();
+  }
+}
+
+template<typename T>
+void SPSCQueue<T>::notify_producer() {
+  if (sync_->producer_parked_.load()) {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    sync_->not_full_.notify_one();
+  }
+}
+
+template<typename T>
+void SPSCQueue<T>::push(const T& t) {
+  wait_not_full();
+  const size_t tail = sync_->tail_.load(std::memory_order_relaxed);
+  buffer_[tail & mask_] = t;
+  sync_->tail_.store(tail + 1);
+  notify_consumer();
+}
+
+template<typename T>
+bool SPSCQueue<T>::try_push(const T& t) {
+  const size_t tail = sync_->tail_.load(std::memory_order_relaxed);
+  if (tail - sync_->head_.load(std::memory_order_acquire) >= capacity_) {
+    return false;
+  }
+  buffer_[tail & mask_] = t;
+  sync_->tail_.store(tail + 1);
+  notify_consumer();
+  return true;
+}
+
+template<typename T>
+void SPSCQueue<T>::push(const vector<T>& items) {
+  size_t pushed = 0;
+  while (pushed < items.size()) {
+    wait_not_full();
+    const size_t tail = sync_->tail_.load(std::memory_order_relaxed);
+    const size_t room =
+        capacity_ - (tail - sync_->head_.load(std::memory_order_acquire));
+    const size_t count = std::min(room, items.size() - pushed);
+    for (size_t i = 0; i < count; ++i) {
+      buffer_[(tail + i) & mask_] = items[pushed + i];
+    }
+    sync_->tail_.store(tail + count);
+    notify_consumer();
+    pushed += count;
+  }
+}
+
+template<typename T>
+T SPSCQueue<T>::pop(const string& log_on_wait) {
+  wait_not_empty(log_on_wait);
+  const size_t head = sync_->head_.load(std::memory_order_relaxed);
+  T t = buffer_[head & mask_];
+  sync_->head_.store(head + 1);
+  notify_producer();
+  return t;
+}
+
+template<typename T>
+bool SPSCQueue<T>::try_pop(T* t) {
+  const size_t head = sync_->head_.load(std::memory_order_relaxed);
+  if (sync_->tail_.load(std::memory_order_acquire) == head) {
+    return false;
+  }
+  *t = buffer_[head & mask_];
+  sync_->head_.store(head + 1);
+  notify_producer();
+  return true;
+}
+
+template<typename T>
+void SPSCQueue<T>::pop(int max_items, vector<T>* items,
+    const string& log_on_wait) {
+  CHECK_GT(max_items, 0);
+  wait_not_empty(log_on_wait);
+  const size_t head = sync_->head_.load(std::memory_order_relaxed);
+  const size_t available = sync_->tail_.load(std::memory_order_acquire) - head;
+  const size_t count = std::min<size_t>(max_items, available);
+  items->resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    (*items)[i] = buffer_[(head + i) & mask_];
+  }
+  sync_->head_.store(head + count);
+  notify_producer();
+}
+
+template<typename T>
+T SPSCQueue<T>::peek() {
+  wait_not_empty("");
+  return buffer_[sync_->head_.load(std::memory_order_relaxed) & mask_];
+}
+
+template<typename T>
+bool SPSCQueue<T>::try_peek(T* t) {
+  const size_t head = sync_->head_.load(std::memory_order_relaxed);
+  if (sync_->tail_.load(std::memory_order_acquire) == head) {
+    return false;
+  }
+  *t = buffer_[head & mask_];
+  return true;
+}
+
+template<typename T>
+size_t SPSCQueue<T>::size() const {
+  // Read head first: the result may be stale but is never negative.
+  const size_t head = sync_->head_.load();
+  return sync_->tail_.load() - head;
+}
+
+template<typename T>
+uint64_t SPSCQueue<T>::pop_stalls() const {
+  return sync_->pop_stalls_.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+uint64_t SPSCQueue<T>::pop_stall_us() const {
+  return sync_->pop_stall_us_.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+uint64_t SPSCQueue<T>::push_stalls() const {
+  return sync_->push_stalls_.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+uint64_t SPSCQueue<T>::push_stall_us() const {
+  return sync_->push_stall_us_.load(std::memory_order_relaxed);
+}
+
+template class SPSCQueue<Batch<float>*>;
+template class SPSCQueue<Batch<double>*>;
+template class SPSCQueue<Datum*>;
+
+}  // namespace caffe
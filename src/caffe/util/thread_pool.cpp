@@ -0,0 +1,315 @@
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>  // NOLINT(readability/streams)
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+namespace caffe {
+
+// The CPUs listed in a sysfs cpulist such as "0-3,8-11".
+static vector<int> ParseCpuList(const string& list) {
+  vector<int> cpus;
+  std::istringstream stream(list);
+  string range;
+  while (std::getline(stream, range, ',')) {
+    int first, last;
+    const int fields = sscanf(range.c_str(), "%d-%d", &first, &last);
+    if (fields < 1) {
+      continue;
+    }
+    for (int cpu = first; cpu <= (fields == 2 ? last : first); ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// The CPUs the process may run on, those of the NUMA node of the calling
+// thread first, starting with the CPU it runs on. The size of that node is
+// returned in node_size.
+static vector<int> NumaOrderedCpus(int* node_size) {
+  vector<vector<int> > nodes;
+  for (int node = 0; ; ++node) {
+    std::ostringstream path;
+    path << "/sys/devices/system/node/node" << node << "/cpulist";
+    std::ifstream file(path.str().c_str());
+    string list;
+    if (!std::getline(file, list)) {
+      break;
+    }
+    nodes.push_back(ParseCpuList(list));
+  }
+  if (nodes.empty()) {
+    nodes.push_back(vector<int>());
+    for (int cpu = 0; cpu < boost::thread::hardware_concurrency(); ++cpu) {
+      nodes[0].push_back(cpu);
+    }
+  }
+  int current = 0;
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  const bool restricted =
+      sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+  current = std::max(sched_getcpu(), 0);
+#endif
+  vector<int> cpus;
+  *node_size = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int n = 0; n < nodes.size(); ++n) {
+      const bool local = std::find(nodes[n].begin(), nodes[n].end(),
+          current) != nodes[n].end();
+      if (local != (pass == 0)) {
+        continue;
+      }
+      for (int i = 0; i < nodes[n].size(); ++i) {
+#ifdef __linux__
+        if (restricted && !CPU_ISSET(nodes[n][i], &allowed)) {
+          continue;
+        }
+#endif
+        cpus.push_back(nodes[n][i]);
+      }
+      if (pass == 0) {
+        vector<int>::iterator it =
+            std::find(cpus.begin(), cpus.end(), current);
+        if (it != cpus.end()) {
+          std::rotate(cpus.begin(), it, cpus.end());
+        }
+        *node_size = cpus.size();
+      }
+    }
+  }
+  return cpus;
+}
+
+// Restricts the calling thread to the given CPUs.
+static void BindThread(const vector<int>& cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int i = 0; i < cpus.size(); ++i) {
+    CPU_SET(cpus[i], &set);
+  }
+  const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  LOG_IF(WARNING, error) << "Failed to pin a thread: " << strerror(error);
+#endif
+}
+
+// Whether the thread is running a chunk of a loop on the pool, so that the
+// loops nested in it run on the thread alone.
+static thread_local bool in_loop = false;
+
+class ThreadPool::Impl {
+ public:
+  explicit Impl(int threads)
+      : num_threads_(1), body_(NULL), n_(0), chunk_(0), num_chunks_(0),
+        next_chunk_(0), pending_(0), generation_(0), stop_(false),
+        pin_(false) {
+    Start(threads);
+  }
+
+  int num_threads() const { return num_threads_; }
+  bool pin() const { return pin_; }
+
+  void Resize(int threads, bool pin) {
+    boost::lock_guard<boost::mutex> run(run_mutex_);
+    Stop();
+    if (pin_ && !pin) {
+      // Let the caller run anywhere again.
+      BindThread(cpus_);
+    }
+    pin_ = pin;
+    cpus_.clear();
+    if (pin_) {
+      int node_size;
+      cpus_ = NumaOrderedCpus(&node_size);
+      if (!cpus_.empty()) {
+        BindThread(vector<int>(cpus_.begin(), cpus_.begin() + node_size));
+      }
+    }
+    Start(threads);
+  }
+
+  void ParallelFor(int n, int grain, const Body& body) {
+    const int num_chunks = std::min(num_threads(), n / std::max(grain, 1));
+    if (in_loop || num_chunks <= 1) {
+      body(0, n);
+      return;
+    }
+    // Another thread's loop may hold the pool.
+    boost::unique_lock<boost::mutex> run(run_mutex_, boost::try_to_lock);
+    if (!run.owns_lock()) {
+      body(0, n);
+      return;
+    }
+    {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      body_ = &body;
+      n_ = n;
+      chunk_ = (n + num_chunks - 1) / num_chunks;
+      num_chunks_ = num_chunks;
+      next_chunk_ = 0;
+      pending_ = workers_.size();
+      ++generation_;
+    }
+    start_.notify_all();
+    RunChunks();
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (pending_ > 0) {
+      done_.wait(lock);
+    }
+    body_ = NULL;
+  }
+
+ private:
+  void Start(int threads) {
+    uint64_t generation;
+    {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      stop_ = false;
+      generation = generation_;
+    }
+    for (int i = 1; i < threads; ++i) {
+      workers_.push_back(shared_ptr<boost::thread>(
+          new boost::thread(&Impl::Work, this, i, generation)));
+    }
+    num_threads_ = threads;
+  }
+
+  void Stop() {
+    {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (int i = 0; i < workers_.size(); ++i) {
+      workers_[i]->join();
+    }
+    workers_.clear();
+  }
+
+  // Runs the loops started after the given generation.
+  void Work(int index, uint64_t generation) {
+    if (!cpus_.empty()) {
+      BindThread(vector<int>(1, cpus_[index % cpus_.size()]));
+    }
+    for (;;) {
+      {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        while (!stop_ && generation_ == generation) {
+          start_.wait(lock);
+        }
+        if (stop_) {
+          return;
+        }
+        generation = generation_;
+      }
+      RunChunks();
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      if (--pending_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  void RunChunks() {
+    in_loop = true;
+    for (int chunk = next_chunk_++; chunk < num_chunks_;
+         chunk = next_chunk_++) {
+      const int begin = chunk * chunk_;
+      (*body_)(begin, std::min(n_, begin + chunk_));
+    }
+    in_loop = false;
+  }
+
+  std::atomic<int> num_threads_;
+  // Held by the thread running a loop on the pool.
+  boost::mutex run_mutex_;
+  // Guards the loop and the workers' state.
+  boost::mutex mutex_;
+  boost::condition_variable start_;
+  boost::condition_variable done_;
+  vector<shared_ptr<boost::thread> > workers_;
+
+  // The loop, split in num_chunks_ chunks of chunk_ iterations.
+  const Body* body_;
+  int n_;
+  int chunk_;
+  int num_chunks_;
+  std::atomic<int> next_chunk_;
+  // The workers still running the loop.
+  int pending_;
+  // Counts the loops, for the workers to tell a new one.
+  uint64_t generation_;
+  bool stop_;
+
+  bool pin_;
+  // The CPUs of the pool, the workers taking cpus_[1] on.
+  vector<int> cpus_;
+};
+
+// The default size: as many threads as the BLAS library, which follows
+// OMP_NUM_THREADS or OPENBLAS_NUM_THREADS, else one per core.
+static int DefaultThreads() {
+  const int blas_threads = caffe_blas_threads();
+  return blas_threads > 0 ? blas_threads :
+      std::max<int>(boost::thread::hardware_concurrency(), 1);
+}
+
+// Created on first use and never destroyed, as loops may run until exit.
+ThreadPool::Impl* ThreadPool::pool() {
+  static ThreadPool::Impl* instance = new ThreadPool::Impl(DefaultThreads());
+  return instance;
+}
+
+int ThreadPool::num_threads() {
+  return pool()->num_threads();
+}
+
+void ThreadPool::SetNumThreads(int threads) {
+  CHECK_GE(threads, 0);
+  if (threads == 0) {
+    threads = std::max<int>(boost::thread::hardware_concurrency(), 1);
+  }
+  if (caffe_blas_threads() > 0) {
+    caffe_set_blas_threads(threads);
+  }
+  if (threads != num_threads()) {
+    pool()->Resize(threads, numa_pinning());
+  }
+  LOG(INFO) << "Using " << threads << " CPU threads";
+}
+
+void ThreadPool::SetNumaPinning(bool pin) {
+  if (pin != numa_pinning()) {
+    pool()->Resize(num_threads(), pin);
+  }
+}
+
+bool ThreadPool::numa_pinning() {
+  return pool()->pin();
+}
+
+void ThreadPool::RestartWorkers() {
+  pool()->Resize(num_threads(), numa_pinning());
+}
+
+void ThreadPool::ParallelFor(int n, int grain, const Body& body) {
+  pool()->ParallelFor(n, grain, body);
+}
+
+}  // namespace caffe
@@ -6,6 +6,7 @@ namespace bp = boost::python;
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <cstring>
 #include <map>
 #include <string>
@@ -13,15 +14,30 @@ namespace bp = boost::python;
 
 #include "boost/algorithm/string.hpp"
 #include "caffe/caffe.hpp"
+#include "caffe/layers/base_data_layer.hpp"
+#include "caffe/util/db.hpp"
+#include "caffe/util/format.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/perf_counters.hpp"
 #include "caffe/util/signal_handler.h"
+#include "caffe/util/simd_math.hpp"
+#include "caffe/util/thread_pool.hpp"
 
+#ifdef USE_OPENCV
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#endif  // USE_OPENCV
+
+using caffe::BasePrefetchingDataLayer;
 using caffe::Blob;
 using caffe::Caffe;
+using caffe::CPUTimer;
 using caffe::Net;
 using caffe::Layer;
 using caffe::Solver;
 using caffe::shared_ptr;
 using caffe::string;
+using caffe::ThreadPool;
 using caffe::Timer;
 using caffe::vector;
 using std::ostringstream;
@@ -54,6 +70,36 @@ DEFINE_string(sigint_effect, "stop",
 DEFINE_string(sighup_effect, "snapshot",
              "Optional; action to take when a SIGHUP signal is received: "
              "snapshot, stop or none.");
+DEFINE_bool(perf_counters, false,
+    "Optional; have 'time' also read the hardware performance counters of "
+    "each layer (Linux perf_event_open) and report IPC and cache misses.");
+DEFINE_int32(warmup, 5,
+    "Optional; the number of untimed iterations 'bench_train' runs first.");
+DEFINE_bool(bench_snapshot, false,
+    "Optional; also time a snapshot at the end of 'bench_train'.");
+DEFINE_int32(synthetic_images, 0,
+    "Optional; for 'bench_train', generate a database of this many random "
+    "images and read it in place of the sources of the net's Data layers.");
+DEFINE_string(synthetic_shape, "3,256,256",
+    "Optional; channels,height,width of the synthetic images.");
+DEFINE_string(synthetic_encoding, "",
+    "Optional; store the synthetic images encoded as 'jpg' or 'png' "
+    "(requires OpenCV) rather than as raw pixels.");
+DEFINE_string(synthetic_backend, "lmdb",
+    "Optional; the backend of the synthetic database: lmdb or leveldb.");
+DEFINE_string(synthetic_db, "",
+    "Optional; where to store the synthetic database. An existing database "
+    "is reused as is. By default a temporary one is removed on exit.");
+DEFINE_string(autotune_cache, "",
+    "Optional; the file keeping the CPU implementation and BLAS threads "
+    "chosen for each layer geometry. Nets run on the CPU use its choices "
+    "and time the layers missing from it; see 'tune'.");
+DEFINE_int32(threads, 0,
+    "Optional; the number of threads CPU layers and the BLAS library use. "
+    "By default the BLAS library's count (e.g. OMP_NUM_THREADS).");
+DEFINE_bool(numa_pinning, false,
+    "Optional; pin each CPU thread to a core, filling the NUMA node the "
+    "process starts on first.");
 
 // A simple registry for caffe commands.
 typedef int (*BrewFunction)();
@@ -133,8 +179,11 @@ vector<string> get_stages_from_flags() {
 // To add a command, define a function "int command()" and register it with
 // RegisterBrewFunction(action);
 
-// Device Query: show diagnostic information for a GPU device.
+// Device Query: show diagnostic information for a GPU device, and the
+// instruction set of the CPU kernels.
 int device_query() {
+  LOG(INFO) << "CPU SIMD instruction set: " << caffe::simd_isa()
+      << " (override with CAFFE_SIMD_ISA)";
   LOG(INFO) << "Querying GPUs " << FLAGS_gpu;
   vector<int> gpus;
   get_gpus(&gpus);
@@ -375,6 +424,17 @@ int time() {
   Timer timer;
   std::vector<double> forward_time_per_layer(layers.size(), 0.0);
   std::vector<double> backward_time_per_layer(layers.size(), 0.0);
+  shared_ptr<caffe::LayerPerfCounters> perf_counters;
+  if (FLAGS_perf_counters) {
+    perf_counters.reset(new caffe::LayerPerfCounters(layers.size()));
+    if (!perf_counters->available()) {
+      perf_counters.reset();
+    } else {
+      // The counters only follow the threads started after them, and the
+      // pool's workers were started by the first passes.
+      ThreadPool::RestartWorkers();
+    }
+  }
   double forward_time = 0.0;
   double backward_time = 0.0;
   for (int j = 0; j < FLAGS_iterations; ++j) {
@@ -382,17 +442,21 @@ int time() {
     iter_timer.Start();
     forward_timer.Start();
     for (int i = 0; i < layers.size(); ++i) {
+      if (perf_counters) { perf_counters->Start(); }
       timer.Start();
       layers[i]->Forward(bottom_vecs[i], top_vecs[i]);
       forward_time_per_layer[i] += timer.MicroSeconds();
+      if (perf_counters) { perf_counters->Stop(i, false); }
     }
     forward_time += forward_timer.MicroSeconds();
     backward_timer.Start();
     for (int i = layers.size() - 1; i >= 0; --i) {
+      if (perf_counters) { perf_counters->Start(); }
       timer.Start();
       layers[i]->Backward(top_vecs[i], bottom_need_backward[i],
                           bottom_vecs[i]);
       backward_time_per_layer[i] += timer.MicroSeconds();
+      if (perf_counters) { perf_counters->Stop(i, true); }
     }
     backward_time += backward_timer.MicroSeconds();
     LOG(INFO) << "Iteration: " << j + 1 << " forward-backward time: "
@@ -408,6 +472,18 @@ int time() {
       "\tbackward: " << backward_time_per_layer[i] / 1000 /
       FLAGS_iterations << " ms.";
   }
+  if (perf_counters) {
+    // The counters see the host thread only: GPU layers show launch costs.
+    LOG(INFO) << "Average hardware counters per layer:";
+    vector<string> lines;
+    boost::split(lines, perf_counters->Report(caffe_net.layer_names(),
+        FLAGS_iterations), boost::is_any_of("\n"));
+    for (int i = 0; i < lines.size(); ++i) {
+      if (!lines[i].empty()) {
+        LOG(INFO) << lines[i];
+      }
+    }
+  }
   total_timer.Stop();
   LOG(INFO) << "Average Forward pass: " << forward_time / 1000 /
     FLAGS_iterations << " ms.";
@@ -421,6 +497,352 @@ int time() {
 }
 RegisterBrewFunction(time);
 
+// Memory: report the memory used by each layer of a model.
+int memory() {
+  CHECK_GT(FLAGS_model.size(), 0) << "Need a model definition to measure.";
+  caffe::Phase phase = get_phase_from_flags(caffe::TRAIN);
+  vector<string> stages = get_stages_from_flags();
+
+  // Set device id and mode
+  vector<int> gpus;
+  get_gpus(&gpus);
+  if (gpus.size() != 0) {
+    LOG(INFO) << "Use GPU with device ID " << gpus[0];
+    Caffe::SetDevice(gpus[0]);
+    Caffe::set_mode(Caffe::GPU);
+  } else {
+    LOG(INFO) << "Use CPU.";
+    Caffe::set_mode(Caffe::CPU);
+  }
+  // Instantiate the caffe net.
+  Net<float> caffe_net(FLAGS_model, phase, FLAGS_level, &stages);
+
+  // Memory is allocated on first use, so run a pass before reporting.
+  LOG(INFO) << "Performing Forward";
+  caffe_net.Forward();
+  if (phase == caffe::TRAIN) {
+    LOG(INFO) << "Performing Backward";
+    caffe_net.Backward();
+  }
+  vector<string> lines;
+  boost::split(lines, caffe_net.MemoryReport(), boost::is_any_of("\n"));
+  for (int i = 0; i < lines.size(); ++i) {
+    if (!lines[i].empty()) {
+      LOG(INFO) << lines[i];
+    }
+  }
+  return 0;
+}
+RegisterBrewFunction(memory);
+
+// Tune: choose the fastest CPU implementation and BLAS threads of each layer
+// of a model and store them in the autotune cache.
+int tune() {
+  CHECK_GT(FLAGS_model.size(), 0) << "Need a model definition to tune.";
+  CHECK_GT(FLAGS_autotune_cache.size(), 0)
+      << "Need an -autotune_cache file to store the choices in.";
+  caffe::Phase phase = get_phase_from_flags(caffe::TRAIN);
+  vector<string> stages = get_stages_from_flags();
+
+  Caffe::set_mode(Caffe::CPU);
+  // The net tunes its layers as it is set up.
+  Net<float> caffe_net(FLAGS_model, phase, FLAGS_level, &stages);
+  const vector<shared_ptr<Layer<float> > >& layers = caffe_net.layers();
+  for (int i = 0; i < layers.size(); ++i) {
+    const vector<string> algorithms = layers[i]->cpu_algorithms();
+    if (!algorithms.empty()) {
+      LOG(INFO) << std::setfill(' ') << std::setw(10)
+          << caffe_net.layer_names()[i] << "\t"
+          << algorithms[layers[i]->cpu_algorithm()] << ", "
+          << layers[i]->cpu_threads() << " BLAS threads";
+    }
+  }
+  return 0;
+}
+RegisterBrewFunction(tune);
+
+// Generates a database of random images with random labels in [0, 1000).
+static void MakeSyntheticDB(const string& source, const string& backend,
+    int num_images, int channels, int height, int width,
+    const string& encoding) {
+  LOG(INFO) << "Generating " << num_images << " synthetic " << channels
+      << "x" << height << "x" << width << " "
+      << (encoding.size() ? encoding : "raw") << " images in " << source;
+  shared_ptr<caffe::db::DB> db(caffe::db::GetDB(backend));
+  db->Open(source, caffe::db::NEW);
+  shared_ptr<caffe::db::Transaction> txn(db->NewTransaction());
+  caffe::Datum datum;
+  string pixels(channels * height * width, 0);
+  for (int i = 0; i < num_images; ++i) {
+    for (int j = 0; j < pixels.size(); ++j) {
+      pixels[j] = caffe::caffe_rng_rand() & 0xFF;
+    }
+    datum.set_label(caffe::caffe_rng_rand() % 1000);
+    if (encoding.size()) {
+#ifdef USE_OPENCV
+      // The pixels are noise, so their order does not matter.
+      cv::Mat image(height, width, CV_8UC(channels), &pixels[0]);
+      vector<uchar> buffer;
+      CHECK(cv::imencode("." + encoding, image, buffer))
+          << "Failed to encode a synthetic image as " << encoding;
+      datum.clear_channels();
+      datum.clear_height();
+      datum.clear_width();
+      datum.set_data(string(buffer.begin(), buffer.end()));
+      datum.set_encoded(true);
+#else
+      LOG(FATAL) << "Encoded synthetic images require OpenCV.";
+#endif  // USE_OPENCV
+    } else {
+      datum.set_channels(channels);
+      datum.set_height(height);
+      datum.set_width(width);
+      datum.set_data(pixels);
+    }
+    string value;
+    CHECK(datum.SerializeToString(&value));
+    txn->Put(caffe::format_int(i, 8), value);
+    if ((i + 1) % 1000 == 0) {
+      txn->Commit();
+      txn.reset(db->NewTransaction());
+    }
+  }
+  txn->Commit();
+  db->Close();
+}
+
+// Makes the kernels queued on the GPU count towards the current timer.
+static void SynchronizeDevice() {
+#ifndef CPU_ONLY
+  if (Caffe::mode() == Caffe::GPU) {
+    HIP_CHECK(hipDeviceSynchronize());
+  }
+#endif
+}
+
+// Splits the wall time of each solver iteration into the forward-backward
+// pass, including the data layers, and the parameter update.
+class IterationTimer : public Solver<float>::Callback {
+ public:
+  IterationTimer() : forward_backward_us_(0), update_us_(0),
+      updating_(false) {}
+  // Ends the timing of the last update.
+  void Stop() {
+    if (updating_) {
+      SynchronizeDevice();
+      update_us_ += timer_.MicroSeconds();
+      updating_ = false;
+    }
+  }
+  double forward_backward_us() const { return forward_backward_us_; }
+  double update_us() const { return update_us_; }
+
+ protected:
+  void on_start() {
+    Stop();
+    timer_.Start();
+  }
+  void on_gradients_ready() {
+    SynchronizeDevice();
+    forward_backward_us_ += timer_.MicroSeconds();
+    timer_.Start();
+    updating_ = true;
+  }
+
+  CPUTimer timer_;
+  double forward_backward_us_;
+  double update_us_;
+  bool updating_;
+};
+
+// Bench-train: measure the training throughput of a solver end to end,
+// including the data pipeline, the update and optionally a snapshot.
+int bench_train() {
+  CHECK_GT(FLAGS_solver.size(), 0) << "Need a solver definition to time.";
+  CHECK_GT(FLAGS_iterations, 0);
+  caffe::SolverParameter solver_param;
+  caffe::ReadSolverParamsFromTextFileOrDie(FLAGS_solver, &solver_param);
+
+  // Benchmark the train net alone, without testing or periodic snapshots.
+  caffe::NetParameter net_param;
+  if (solver_param.has_train_net_param()) {
+    net_param.CopyFrom(solver_param.train_net_param());
+  } else if (solver_param.has_train_net()) {
+    caffe::ReadNetParamsFromTextFileOrDie(solver_param.train_net(),
+        &net_param);
+  } else if (solver_param.has_net_param()) {
+    net_param.CopyFrom(solver_param.net_param());
+  } else {
+    CHECK(solver_param.has_net()) << "The solver must specify a train net.";
+    caffe::ReadNetParamsFromTextFileOrDie(solver_param.net(), &net_param);
+  }
+  solver_param.clear_net();
+  solver_param.clear_train_net();
+  solver_param.clear_train_net_param();
+  solver_param.clear_test_net();
+  solver_param.clear_test_net_param();
+  solver_param.clear_test_state();
+  solver_param.clear_test_iter();
+  solver_param.set_test_interval(0);
+  solver_param.set_snapshot(0);
+
+  // Point the Data layers at a synthetic database.
+  string temp_dir;
+  if (FLAGS_synthetic_images > 0 || FLAGS_bench_snapshot) {
+    caffe::MakeTempDir(&temp_dir);
+  }
+  if (FLAGS_synthetic_images > 0) {
+    vector<string> dims;
+    boost::split(dims, FLAGS_synthetic_shape, boost::is_any_of(","));
+    CHECK_EQ(dims.size(), 3) << "synthetic_shape must be channels,height,width";
+    caffe::DataParameter_DB backend;
+    if (FLAGS_synthetic_backend == "lmdb") {
+      backend = caffe::DataParameter_DB_LMDB;
+    } else {
+      CHECK_EQ(FLAGS_synthetic_backend, "leveldb")
+          << "synthetic_backend must be lmdb or leveldb";
+      backend = caffe::DataParameter_DB_LEVELDB;
+    }
+    const string source = FLAGS_synthetic_db.size() ? FLAGS_synthetic_db :
+        temp_dir + "/synthetic_" + FLAGS_synthetic_backend;
+    if (boost::filesystem::exists(source)) {
+      LOG(INFO) << "Reusing the synthetic database " << source;
+    } else {
+      MakeSyntheticDB(source, FLAGS_synthetic_backend,
+          FLAGS_synthetic_images, boost::lexical_cast<int>(dims[0]),
+          boost::lexical_cast<int>(dims[1]), boost::lexical_cast<int>(dims[2]),
+          FLAGS_synthetic_encoding);
+    }
+    int num_data_layers = 0;
+    for (int i = 0; i < net_param.layer_size(); ++i) {
+      if (net_param.layer(i).type() == "Data") {
+        caffe::DataParameter* data_param =
+            net_param.mutable_layer(i)->mutable_data_param();
+        data_param->set_source(source);
+        data_param->set_backend(backend);
+        ++num_data_layers;
+      }
+    }
+    CHECK_GT(num_data_layers, 0) << "The net has no Data layer to feed "
+        "with synthetic images.";
+  }
+  solver_param.mutable_net_param()->CopyFrom(net_param);
+  if (FLAGS_bench_snapshot) {
+    solver_param.set_snapshot_prefix(temp_dir + "/bench");
+  }
+
+  vector<int> gpus;
+  get_gpus(&gpus);
+  if (gpus.size() != 0) {
+    LOG_IF(WARNING, gpus.size() > 1) << "bench_train only uses GPU "
+        << gpus[0];
+    LOG(INFO) << "Use GPU with device ID " << gpus[0];
+    solver_param.set_device_id(gpus[0]);
+    Caffe::SetDevice(gpus[0]);
+    Caffe::set_mode(Caffe::GPU);
+  } else {
+    LOG(INFO) << "Use CPU.";
+    Caffe::set_mode(Caffe::CPU);
+  }
+  shared_ptr<Solver<float> >
+      solver(caffe::SolverRegistry<float>::CreateSolver(solver_param));
+  const shared_ptr<Net<float> >& net = solver->net();
+
+  // The prefetching data layers, whose queues tell where the pipeline
+  // stalls, and the number of images trained on per iteration.
+  vector<int> data_layer_ids;
+  for (int i = 0; i < net->layers().size(); ++i) {
+    if (dynamic_cast<BasePrefetchingDataLayer<float>*>(
+        net->layers()[i].get())) {
+      data_layer_ids.push_back(i);
+    }
+  }
+  LOG_IF(WARNING, data_layer_ids.empty()) << "The net has no prefetching "
+      "data layer; only the compute is measured.";
+  const int images_per_iter = data_layer_ids.empty() ? 0 :
+      net->top_vecs()[data_layer_ids[0]][0]->shape(0) *
+      solver_param.iter_size();
+
+  LOG(INFO) << "Warming up for " << FLAGS_warmup << " iterations.";
+  solver->Step(FLAGS_warmup);
+  vector<uint64_t> forward_wait_us(data_layer_ids.size());
+  vector<uint64_t> forward_waits(data_layer_ids.size());
+  vector<uint64_t> prefetch_wait_us(data_layer_ids.size());
+  for (int i = 0; i < data_layer_ids.size(); ++i) {
+    const BasePrefetchingDataLayer<float>* layer =
+        static_cast<BasePrefetchingDataLayer<float>*>(
+            net->layers()[data_layer_ids[i]].get());
+    forward_wait_us[i] = layer->forward_wait_us();
+    forward_waits[i] = layer->forward_waits();
+    prefetch_wait_us[i] = layer->prefetch_wait_us();
+  }
+
+  LOG(INFO) << "*** Benchmark begins ***";
+  LOG(INFO) << "Training for " << FLAGS_iterations << " iterations.";
+  IterationTimer iteration_timer;
+  solver->add_callback(&iteration_timer);
+  CPUTimer total_timer;
+  total_timer.Start();
+  solver->Step(FLAGS_iterations);
+  iteration_timer.Stop();
+  const double train_ms = total_timer.MilliSeconds();
+  double snapshot_ms = 0;
+  if (FLAGS_bench_snapshot) {
+    CPUTimer snapshot_timer;
+    snapshot_timer.Start();
+    solver->Snapshot();
+    snapshot_ms = snapshot_timer.MilliSeconds();
+  }
+
+  double data_wait_ms = 0;
+  for (int i = 0; i < data_layer_ids.size(); ++i) {
+    const BasePrefetchingDataLayer<float>* layer =
+        static_cast<BasePrefetchingDataLayer<float>*>(
+            net->layers()[data_layer_ids[i]].get());
+    forward_wait_us[i] = layer->forward_wait_us() - forward_wait_us[i];
+    forward_waits[i] = layer->forward_waits() - forward_waits[i];
+    prefetch_wait_us[i] = layer->prefetch_wait_us() - prefetch_wait_us[i];
+    data_wait_ms += forward_wait_us[i] / 1000.;
+    LOG(INFO) << std::setfill(' ') << std::setw(10)
+        << layer->layer_param().name() << "\tnet waited for data "
+        << forward_waits[i] << " times, "
+        << forward_wait_us[i] / 1000. / FLAGS_iterations
+        << " ms/iteration; prefetch thread waited for the net "
+        << prefetch_wait_us[i] / 1000. / FLAGS_iterations << " ms/iteration.";
+  }
+  const double forward_backward_ms =
+      iteration_timer.forward_backward_us() / 1000.;
+  const double update_ms = iteration_timer.update_us() / 1000.;
+  LOG(INFO) << "Average Forward-Backward: " << forward_backward_ms /
+      FLAGS_iterations << " ms (" << 100 * forward_backward_ms / train_ms
+      << "%), of which waiting for data: " << data_wait_ms / FLAGS_iterations
+      << " ms (" << 100 * data_wait_ms / train_ms << "%).";
+  LOG(INFO) << "Average Update: " << update_ms / FLAGS_iterations << " ms ("
+      << 100 * update_ms / train_ms << "%).";
+  if (FLAGS_bench_snapshot) {
+    LOG(INFO) << "Snapshot: " << snapshot_ms << " ms.";
+  }
+  LOG(INFO) << "Average iteration: " << train_ms / FLAGS_iterations << " ms.";
+  if (images_per_iter) {
+    LOG(INFO) << "Throughput: " << images_per_iter * FLAGS_iterations /
+        (train_ms + snapshot_ms) * 1000 << " images/s (" << images_per_iter
+        << " images per iteration).";
+  }
+  if (data_layer_ids.size()) {
+    LOG(INFO) << (data_wait_ms > 0.05 * train_ms ?
+        "The net is starved for data: speed up the data pipeline." :
+        "The data pipeline keeps up with the net.");
+  }
+  LOG(INFO) << "*** Benchmark ends ***";
+
+  solver.reset();
+  if (temp_dir.size()) {
+    boost::filesystem::remove_all(temp_dir);
+  }
+  return 0;
+}
+RegisterBrewFunction(bench_train);
+
 int main(int argc, char** argv) {
   // Print output to stderr (while still logging).
   FLAGS_alsologtostderr = 1;
@@ -433,14 +855,29 @@ int main(int argc, char** argv) {
       "  train           train or finetune a model\n"
       "  test            score a model\n"
       "  device_query    show GPU diagnostic information\n"
-      "  time            benchmark model execution time");
+      "  time            benchmark model execution time\n"
+      "  memory          report the memory used by each layer\n"
+      "  tune            choose the CPU implementation of each layer\n"
+      "  bench_train     benchmark training throughput, data included");
   // Run tool or show usage.
   caffe::GlobalInit(&argc, &argv);
+  Caffe::set_autotune_cache(FLAGS_autotune_cache);
+  if (FLAGS_threads > 0) {
+    ThreadPool::SetNumThreads(FLAGS_threads);
+  }
+  // The pool starts on first use otherwise, so that it is not running for
+  // the commands that do not need it.
+  if (FLAGS_numa_pinning) {
+    ThreadPool::SetNumaPinning(true);
+  }
   if (argc == 2) {
 #ifdef WITH_PYTHON_LAYER
     try {
 #endif
-      return GetBrewFunction(caffe::string(argv[1]))();
+      // Accept e.g. bench-train for bench_train.
+      caffe::string command(argv[1]);
+      std::replace(command.begin(), command.end(), '-', '_');
+      return GetBrewFunction(command)();
 #ifdef WITH_PYTHON_LAYER
     } catch (bp::error_already_set) {
       PyErr_Print();
@@ -0,0 +1,201 @@
+// Runs each layer of a net under every engine and device available in this
+// build, and on the CPU on the ThreadPool's threads and with each CPU
+// implementation of the layers, on the inputs the layer sees in a forward
+// pass of the net. Reports how far the outputs (and with --backward the
+// gradients) are from those of the CAFFE engine on one CPU thread, and the
+// speedup over it.
+// Usage:
+//    compare_engines --model=net.prototxt [--weights=net.caffemodel]
+//        [--phase=TEST] [--backward] [--iterations=10] [--gpu=0]
+//        [--threads=8] ...
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "boost/algorithm/string.hpp"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/engine_comparison.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+using std::string;
+using std::vector;
+
+DEFINE_string(model, "", "The model definition protocol buffer.");
+DEFINE_string(weights, "",
+    "Optional trained weights; the fillers are used if empty.");
+DEFINE_string(phase, "TEST", "Network phase (TRAIN or TEST).");
+DEFINE_string(layers, "",
+    "Optional comma-separated names of the layers to compare.");
+DEFINE_bool(backward, false, "Also compare and time the backward passes of "
+    "the layers that need one, e.g. with --phase=TRAIN. Random layers such "
+    "as Dropout then differ across engines.");
+DEFINE_int32(iterations, 10, "Timed passes per layer and engine.");
+DEFINE_int32(gpu, 0, "GPU device for the GPU engines; -1 compares the CPU "
+    "engines only.");
+DEFINE_int32(threads, 0, "CPU threads of the threaded variants; 0 keeps "
+    "the ThreadPool's default.");
+DEFINE_double(tolerance, 1e-3, "Largest relative error accepted; the tool "
+    "exits with 1 if an engine exceeds it.");
+
+string FormatError(double error) {
+  std::ostringstream formatted;
+  formatted << std::scientific << std::setprecision(2) << error;
+  return formatted.str();
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Compares the outputs and speed of each layer of a "
+      "net across the engines available in this build.\n"
+      "Usage:\n"
+      "    compare_engines --model=net.prototxt [FLAGS]\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_model.empty()) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/compare_engines");
+    return 1;
+  }
+  CHECK_GT(FLAGS_iterations, 0);
+  CHECK_GE(FLAGS_threads, 0);
+  if (FLAGS_threads > 0) {
+    ThreadPool::SetNumThreads(FLAGS_threads);
+  }
+  CHECK(FLAGS_phase == "TRAIN" || FLAGS_phase == "TEST")
+      << "phase must be \"TRAIN\" or \"TEST\"";
+  const Phase phase = FLAGS_phase == "TRAIN" ? TRAIN : TEST;
+#ifndef CPU_ONLY
+  if (FLAGS_gpu >= 0) {
+    Caffe::SetDevice(FLAGS_gpu);
+  }
+#endif
+
+  // The reference net runs with the default engines on the CPU, which are
+  // the CAFFE ones, and provides the inputs and parameters of every layer.
+  Caffe::set_mode(Caffe::CPU);
+  Net<float> net(FLAGS_model, phase);
+  if (!FLAGS_weights.empty()) {
+    net.CopyTrainedLayersFrom(FLAGS_weights);
+  }
+  for (int i = 0; i < net.num_inputs(); ++i) {
+    Blob<float>* input = net.input_blobs()[i];
+    caffe_rng_gaussian<float>(input->count(), 0, 1,
+        input->mutable_cpu_data());
+  }
+  std::set<string> layer_names;
+  if (!FLAGS_layers.empty()) {
+    vector<string> names;
+    boost::split(names, FLAGS_layers, boost::is_any_of(","));
+    layer_names.insert(names.begin(), names.end());
+  }
+  bool gpu = false;
+#ifndef CPU_ONLY
+  gpu = FLAGS_gpu >= 0;
+#endif
+  const vector<EngineVariant> variants = EngineVariants(net, gpu);
+  // With the reference alone there is nothing to compare, and exiting with 0
+  // would pass for agreement.
+  if (variants.size() < 2) {
+    LOG(ERROR) << "Only " << variants[0].name() << " can run the layers of "
+        << FLAGS_model << "; use --threads above 1 or a GPU build to compare "
+        << "it with another variant";
+    return 1;
+  }
+  for (int i = 0; i < variants.size(); ++i) {
+    LOG(INFO) << "Engine " << variants[i].name();
+  }
+
+  std::ostringstream header;
+  header << std::left << std::setw(20) << "layer" << std::setw(18) << "type"
+      << std::setw(26) << "engine" << std::right << std::setw(10) << "fwd ms"
+      << std::setw(10) << "bwd ms" << std::setw(9) << "speedup"
+      << std::setw(11) << "max abs" << std::setw(11) << "max rel";
+  LOG(INFO) << header.str();
+  bool within_tolerance = true;
+  for (int layer_id = 0; layer_id < net.layers().size(); ++layer_id) {
+    Layer<float>* layer = net.layers()[layer_id].get();
+    const string& layer_name = net.layer_names()[layer_id];
+    // Take the inputs before the layer runs, as it may work in place.
+    const BlobVec inputs = CopyBlobs(net.bottom_vecs()[layer_id], false);
+    Caffe::set_mode(Caffe::CPU);
+    net.ForwardFromTo(layer_id, layer_id);
+    // Layers without bottoms provide the data and are not compared.
+    if (inputs.empty() ||
+        (!layer_names.empty() && !layer_names.count(layer_name))) {
+      continue;
+    }
+    const bool backward = FLAGS_backward &&
+        net.layer_need_backward()[layer_id];
+    BlobVec top_diffs;
+    vector<EngineResult> results;
+    for (int v = 0; v < variants.size(); ++v) {
+      EngineResult result;
+      if (!RunLayerVariant(variants[v], layer, inputs,
+          net.top_vecs()[layer_id].size(),
+          net.bottom_need_backward()[layer_id], backward, FLAGS_iterations,
+          &top_diffs, &result)) {
+        continue;
+      }
+      results.push_back(result);
+      const EngineResult& reference = results[0];
+      const double ms = result.forward_ms + result.backward_ms;
+      const double reference_ms =
+          reference.forward_ms + reference.backward_ms;
+      std::ostringstream row;
+      row << std::left << std::setw(20) << layer_name << std::setw(18)
+          << layer->type() << std::setw(26) << variants[v].name() << std::right
+          << std::fixed << std::setprecision(3) << std::setw(10)
+          << result.forward_ms << std::setw(10) << result.backward_ms
+          << std::setprecision(2) << std::setw(9);
+      // Layers faster than the timer resolution have no meaningful speedup.
+      if (ms > 0 && reference_ms > 0) {
+        row << reference_ms / ms;
+      } else {
+        row << "-";
+      }
+      if (v == 0) {
+        row << std::setw(11) << "-" << std::setw(11) << "-";
+      } else {
+        double forward_abs, forward_rel, backward_abs, backward_rel;
+        CompareBlobs(result.outputs, reference.outputs, &forward_abs,
+            &forward_rel);
+        CompareBlobs(result.gradients, reference.gradients, &backward_abs,
+            &backward_rel);
+        const double max_rel = std::max(forward_rel, backward_rel);
+        row << std::setw(11) << FormatError(std::max(forward_abs,
+            backward_abs)) << std::setw(11) << FormatError(max_rel);
+        if (max_rel > FLAGS_tolerance) {
+          row << "  exceeds tolerance";
+          within_tolerance = false;
+        }
+      }
+      LOG(INFO) << row.str();
+    }
+  }
+  if (!within_tolerance) {
+    LOG(ERROR) << "Some engines differ from " << variants[0].name()
+        << " by more than "
+        << FLAGS_tolerance;
+    return 1;
+  }
+  return 0;
+}
@@ -1,14 +1,19 @@
 #include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "boost/scoped_ptr.hpp"
+#include "boost/thread.hpp"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
 
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
 #include "caffe/util/db.hpp"
 #include "caffe/util/io.hpp"
 
@@ -20,6 +25,148 @@ using boost::scoped_ptr;
 
 DEFINE_string(backend, "lmdb",
         "The backend {leveldb, lmdb} containing the images");
+DEFINE_int32(threads, 0,
+    "Number of threads decoding and accumulating the images "
+    "(0: one per hardware thread).");
+DEFINE_int32(chunk_size, 256,
+    "Number of images accumulated by each thread at a time.");
+DEFINE_int32(sample_step, 1,
+    "Optional: Only use every sample_step-th image, for a quick estimate.");
+
+#ifdef USE_OPENCV
+// Images summed into the 32-bit sums before they are added to the 64-bit
+// ones; 255 times this fits in 32 bits.
+const int kBlockImages = 1 << 16;
+// 16-byte vectors whose squares are summed in 32-bit lanes before they are
+// added to a 64-bit sum; each adds at most 2 * 2 * 255^2 to a lane.
+const int kBlockVectors = 4096;
+
+// sum[j] += bytes[j] for j < n, 16 bytes at a time with SSE2.
+void AddBytes(const uint8_t* bytes, int n, uint32_t* sum) {
+  int j = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  for (; j + 16 <= n; j += 16) {
+    const __m128i v = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(bytes + j));
+    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+    __m128i* s = reinterpret_cast<__m128i*>(sum + j);
+    _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s),
+        _mm_unpacklo_epi16(lo, zero)));
+    _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1),
+        _mm_unpackhi_epi16(lo, zero)));
+    _mm_storeu_si128(s + 2, _mm_add_epi32(_mm_loadu_si128(s + 2),
+        _mm_unpacklo_epi16(hi, zero)));
+    _mm_storeu_si128(s + 3, _mm_add_epi32(_mm_loadu_si128(s + 3),
+        _mm_unpackhi_epi16(hi, zero)));
+  }
+#endif  // __SSE2__
+  for (; j < n; ++j) {
+    sum[j] += bytes[j];
+  }
+}
+
+// The sum of the squares of n bytes, 16 at a time with SSE2.
+int64_t SumSquares(const uint8_t* bytes, int n) {
+  int64_t sumsq = 0;
+  int j = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  while (j + 16 <= n) {
+    __m128i acc = zero;
+    for (int v = 0; v < kBlockVectors && j + 16 <= n; ++v, j += 16) {
+      const __m128i x = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(bytes + j));
+      const __m128i lo = _mm_unpacklo_epi8(x, zero);
+      const __m128i hi = _mm_unpackhi_epi8(x, zero);
+      acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_madd_epi16(lo, lo),
+          _mm_madd_epi16(hi, hi)));
+    }
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    sumsq += static_cast<int64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+  }
+#endif  // __SSE2__
+  for (; j < n; ++j) {
+    sumsq += bytes[j] * bytes[j];
+  }
+  return sumsq;
+}
+
+// Per-thread running sums over the images, kept in integers for uint8 data
+// so that the result does not depend on the summation order.
+struct MeanAccumulator {
+  std::vector<int64_t> byte_sum;
+  // The sums of the last images, up to kBlockImages, not yet in byte_sum.
+  std::vector<uint32_t> block_byte_sum;
+  int block_images;
+  std::vector<double> float_sum;
+  std::vector<int64_t> channel_byte_sumsq;
+  std::vector<double> channel_float_sumsq;
+  int count;
+};
+
+void FlushByteSums(MeanAccumulator* acc) {
+  for (int j = 0; j < acc->byte_sum.size(); ++j) {
+    acc->byte_sum[j] += acc->block_byte_sum[j];
+    acc->block_byte_sum[j] = 0;
+  }
+  acc->block_images = 0;
+}
+
+// Accumulates the serialized Datums of the thread_id-th of num_threads
+// contiguous ranges of values, which are in key order.
+void AccumulateImages(const std::vector<std::string>& values, int thread_id,
+    int num_threads, int channels, int data_size, MeanAccumulator* acc) {
+  const int dim = data_size / channels;
+  const int begin = static_cast<int64_t>(values.size()) * thread_id /
+      num_threads;
+  const int end = static_cast<int64_t>(values.size()) * (thread_id + 1) /
+      num_threads;
+  Datum datum;
+  for (int i = begin; i < end; ++i) {
+    datum.ParseFromString(values[i]);
+    DecodeDatumNative(&datum);
+    const std::string& data = datum.data();
+    const int size_in_datum = std::max<int>(datum.data().size(),
+        datum.float_data_size());
+    CHECK_EQ(size_in_datum, data_size) << "Incorrect data field size " <<
+        size_in_datum;
+    if (data.size() != 0) {
+      const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+      AddBytes(bytes, data_size, acc->block_byte_sum.data());
+      if (++acc->block_images == kBlockImages) {
+        FlushByteSums(acc);
+      }
+      for (int c = 0; c < channels; ++c) {
+        acc->channel_byte_sumsq[c] += SumSquares(bytes + c * dim, dim);
+      }
+    } else {
+      double* sum = acc->float_sum.data();
+      for (int j = 0; j < data_size; ++j) {
+        const double value = datum.float_data(j);
+        sum[j] += value;
+        acc->channel_float_sumsq[j / dim] += value * value;
+      }
+    }
+    ++acc->count;
+  }
+  FlushByteSums(acc);
+}
+
+// Reads the values of the next chunk_size sampled images from the cursor.
+void ReadChunk(db::Cursor* cursor, int chunk_size,
+    std::vector<std::string>* values) {
+  values->clear();
+  while (cursor->valid() && values->size() < chunk_size) {
+    values->push_back(cursor->value());
+    for (int i = 0; i < FLAGS_sample_step && cursor->valid(); ++i) {
+      cursor->Next();
+    }
+  }
+}
+#endif  // USE_OPENCV
 
 int main(int argc, char** argv) {
   ::google::InitGoogleLogging(argv[0]);
@@ -30,7 +177,7 @@ int main(int argc, char** argv) {
 #endif
 
   gflags::SetUsageMessage("Compute the mean_image of a set of images given by"
-        " a leveldb/lmdb\n"
+        " a leveldb/lmdb, and the mean and standard deviation of each channel\n"
         "Usage:\n"
         "    compute_image_mean [FLAGS] INPUT_DB [OUTPUT_FILE]\n");
 
@@ -40,13 +187,13 @@ int main(int argc, char** argv) {
     gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/compute_image_mean");
     return 1;
   }
+  CHECK_GE(FLAGS_sample_step, 1);
 
   scoped_ptr<db::DB> db(db::GetDB(FLAGS_backend));
   db->Open(argv[1], db::READ);
   scoped_ptr<db::Cursor> cursor(db->NewCursor());
 
   BlobProto sum_blob;
-  int count = 0;
   // load first datum
   Datum datum;
   datum.ParseFromString(cursor->value());
@@ -59,67 +206,90 @@ int main(int argc, char** argv) {
   sum_blob.set_channels(datum.channels());
   sum_blob.set_height(datum.height());
   sum_blob.set_width(datum.width());
+  const int channels = datum.channels();
   const int data_size = datum.channels() * datum.height() * datum.width();
-  int size_in_datum = std::max<int>(datum.data().size(),
-                                    datum.float_data_size());
-  for (int i = 0; i < size_in_datum; ++i) {
-    sum_blob.add_data(0.);
-  }
-  LOG(INFO) << "Starting Iteration";
-  while (cursor->valid()) {
-    Datum datum;
-    datum.ParseFromString(cursor->value());
-    DecodeDatumNative(&datum);
 
-    const std::string& data = datum.data();
-    size_in_datum = std::max<int>(datum.data().size(),
-        datum.float_data_size());
-    CHECK_EQ(size_in_datum, data_size) << "Incorrect data field size " <<
-        size_in_datum;
-    if (data.size() != 0) {
-      CHECK_EQ(data.size(), size_in_datum);
-      for (int i = 0; i < size_in_datum; ++i) {
-        sum_blob.set_data(i, sum_blob.data(i) + (uint8_t)data[i]);
-      }
-    } else {
-      CHECK_EQ(datum.float_data_size(), size_in_datum);
-      for (int i = 0; i < size_in_datum; ++i) {
-        sum_blob.set_data(i, sum_blob.data(i) +
-            static_cast<float>(datum.float_data(i)));
-      }
+  int num_threads = FLAGS_threads;
+  if (num_threads <= 0) {
+    num_threads = std::max<int>(1, boost::thread::hardware_concurrency());
+  }
+  std::vector<MeanAccumulator> accumulators(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    accumulators[i].byte_sum.resize(data_size, 0);
+    accumulators[i].block_byte_sum.resize(data_size, 0);
+    accumulators[i].block_images = 0;
+    accumulators[i].float_sum.resize(data_size, 0.);
+    accumulators[i].channel_byte_sumsq.resize(channels, 0);
+    accumulators[i].channel_float_sumsq.resize(channels, 0.);
+    accumulators[i].count = 0;
+  }
+  LOG(INFO) << "Starting Iteration with " << num_threads << " threads";
+  // The cursor is read on this thread while the workers accumulate the
+  // previous chunk.
+  CPUTimer timer;
+  timer.Start();
+  const int chunk_size = std::max(1, FLAGS_chunk_size) * num_threads;
+  std::vector<std::string> values, next_values;
+  ReadChunk(cursor.get(), chunk_size, &values);
+  int count = 0;
+  int logged_count = 0;
+  while (!values.empty()) {
+    boost::thread_group threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.create_thread(boost::bind(&AccumulateImages, boost::cref(values),
+          i, num_threads, channels, data_size, &accumulators[i]));
     }
-    ++count;
-    if (count % 10000 == 0) {
-      LOG(INFO) << "Processed " << count << " files.";
+    ReadChunk(cursor.get(), chunk_size, &next_values);
+    threads.join_all();
+    count += values.size();
+    values.swap(next_values);
+    if (count / 10000 > logged_count / 10000) {
+      LOG(INFO) << "Processed " << count << " files ("
+          << count / (timer.MicroSeconds() / 1e6) << " files/s).";
+      logged_count = count;
     }
-    cursor->Next();
   }
-
-  if (count % 10000 != 0) {
+  if (logged_count != count) {
     LOG(INFO) << "Processed " << count << " files.";
   }
-  for (int i = 0; i < sum_blob.data_size(); ++i) {
-    sum_blob.set_data(i, sum_blob.data(i) / count);
+  CHECK_GT(count, 0) << "No images found.";
+
+  // Reduce the per-thread sums.
+  std::vector<double> channel_sum(channels, 0.);
+  std::vector<double> channel_sumsq(channels, 0.);
+  for (int i = 0; i < data_size; ++i) {
+    int64_t byte_sum = 0;
+    double float_sum = 0.;
+    for (int t = 0; t < num_threads; ++t) {
+      byte_sum += accumulators[t].byte_sum[i];
+      float_sum += accumulators[t].float_sum[i];
+    }
+    const double sum = byte_sum + float_sum;
+    sum_blob.add_data(sum / count);
+    channel_sum[i / (data_size / channels)] += sum;
+  }
+  for (int c = 0; c < channels; ++c) {
+    for (int t = 0; t < num_threads; ++t) {
+      channel_sumsq[c] += accumulators[t].channel_byte_sumsq[c] +
+          accumulators[t].channel_float_sumsq[c];
+    }
   }
   // Write to disk
   if (argc == 3) {
     LOG(INFO) << "Write to " << argv[2];
     WriteProtoToBinaryFile(sum_blob, argv[2]);
   }
-  const int channels = sum_blob.channels();
-  const int dim = sum_blob.height() * sum_blob.width();
-  std::vector<float> mean_values(channels, 0.0);
+  const double dim = sum_blob.height() * sum_blob.width();
   LOG(INFO) << "Number of channels: " << channels;
   for (int c = 0; c < channels; ++c) {
-    for (int i = 0; i < dim; ++i) {
-      mean_values[c] += sum_blob.data(dim * c + i);
-    }
-    LOG(INFO) << "mean_value channel [" << c << "]:" << mean_values[c] / dim;
+    const double mean = channel_sum[c] / (count * dim);
+    const double variance = channel_sumsq[c] / (count * dim) - mean * mean;
+    LOG(INFO) << "mean_value channel [" << c << "]:" << mean;
+    LOG(INFO) << "std_value channel [" << c << "]:"
+        << sqrt(std::max(variance, 0.));
   }
 #else
   LOG(FATAL) << "This tool requires OpenCV; compile with USE_OPENCV.";
 #endif  // USE_OPENCV
   return 0;
 }
-
-
@@ -15,13 +15,15 @@
 #include <vector>
 
 #include "boost/scoped_ptr.hpp"
+#include "boost/thread.hpp"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
 
+#include "caffe/common.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/convert_imageset.hpp"
 #include "caffe/util/db.hpp"
-#include "caffe/util/format.hpp"
-#include "caffe/util/io.hpp"
 #include "caffe/util/rng.hpp"
 
 using namespace caffe;  // NOLINT(build/namespaces)
@@ -42,6 +44,17 @@ DEFINE_bool(encoded, false,
     "When this option is on, the encoded image will be save in datum");
 DEFINE_string(encode_type, "",
     "Optional: What type should we encode the image as ('png','jpg',...).");
+DEFINE_int32(shuffle_seed, -1,
+    "Optional: Seed for --shuffle, so that the order of the keys can be "
+    "reproduced. A random seed is used if negative.");
+DEFINE_int32(threads, 0,
+    "Number of threads reading, resizing and encoding the images "
+    "(0: one per hardware thread).");
+DEFINE_int32(chunk_size, 256,
+    "Number of images converted by each thread before handing them to the "
+    "DB writer.");
+DEFINE_int64(commit_bytes, 64 << 20,
+    "Commit the DB transaction once this many bytes have been put into it.");
 
 int main(int argc, char** argv) {
 #ifdef USE_OPENCV
@@ -66,11 +79,6 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  const bool is_color = !FLAGS_gray;
-  const bool check_size = FLAGS_check_size;
-  const bool encoded = FLAGS_encoded;
-  const string encode_type = FLAGS_encode_type;
-
   std::ifstream infile(argv[2]);
   std::vector<std::pair<std::string, int> > lines;
   std::string line;
@@ -84,74 +92,47 @@ int main(int argc, char** argv) {
   if (FLAGS_shuffle) {
     // randomly shuffle data
     LOG(INFO) << "Shuffling data";
+    if (FLAGS_shuffle_seed >= 0) {
+      Caffe::set_random_seed(FLAGS_shuffle_seed);
+    }
     shuffle(lines.begin(), lines.end());
   }
   LOG(INFO) << "A total of " << lines.size() << " images.";
 
-  if (encode_type.size() && !encoded)
+  if (FLAGS_encode_type.size() && !FLAGS_encoded)
     LOG(INFO) << "encode_type specified, assuming encoded=true.";
 
-  int resize_height = std::max<int>(0, FLAGS_resize_height);
-  int resize_width = std::max<int>(0, FLAGS_resize_width);
+  int num_threads = FLAGS_threads;
+  if (num_threads <= 0) {
+    num_threads = std::max<int>(1, boost::thread::hardware_concurrency());
+  }
+  LOG(INFO) << "Converting with " << num_threads << " threads.";
 
   // Create new DB
   scoped_ptr<db::DB> db(db::GetDB(FLAGS_backend));
   db->Open(argv[3], db::NEW);
-  scoped_ptr<db::Transaction> txn(db->NewTransaction());
+
+  ConvertImagesetOptions options;
+  options.is_color = !FLAGS_gray;
+  options.resize_height = FLAGS_resize_height;
+  options.resize_width = FLAGS_resize_width;
+  options.encoded = FLAGS_encoded;
+  options.encode_type = FLAGS_encode_type;
+  options.check_size = FLAGS_check_size;
+  options.num_threads = num_threads;
+  options.chunk_size = FLAGS_chunk_size;
+  options.commit_bytes = FLAGS_commit_bytes;
 
   // Storing to db
-  std::string root_folder(argv[1]);
-  Datum datum;
-  int count = 0;
-  int data_size = 0;
-  bool data_size_initialized = false;
-
-  for (int line_id = 0; line_id < lines.size(); ++line_id) {
-    bool status;
-    std::string enc = encode_type;
-    if (encoded && !enc.size()) {
-      // Guess the encoding type from the file name
-      string fn = lines[line_id].first;
-      size_t p = fn.rfind('.');
-      if ( p == fn.npos )
-        LOG(WARNING) << "Failed to guess the encoding of '" << fn << "'";
-      enc = fn.substr(p);
-      std::transform(enc.begin(), enc.end(), enc.begin(), ::tolower);
-    }
-    status = ReadImageToDatum(root_folder + lines[line_id].first,
-        lines[line_id].second, resize_height, resize_width, is_color,
-        enc, &datum);
-    if (status == false) continue;
-    if (check_size) {
-      if (!data_size_initialized) {
-        data_size = datum.channels() * datum.height() * datum.width();
-        data_size_initialized = true;
-      } else {
-        const std::string& data = datum.data();
-        CHECK_EQ(data.size(), data_size) << "Incorrect data field size "
-            << data.size();
-      }
-    }
-    // sequential
-    string key_str = caffe::format_int(line_id, 8) + "_" + lines[line_id].first;
-
-    // Put in db
-    string out;
-    CHECK(datum.SerializeToString(&out));
-    txn->Put(key_str, out);
-
-    if (++count % 1000 == 0) {
-      // Commit db
-      txn->Commit();
-      txn.reset(db->NewTransaction());
-      LOG(INFO) << "Processed " << count << " files.";
-    }
-  }
-  // write the last batch
-  if (count % 1000 != 0) {
-    txn->Commit();
-    LOG(INFO) << "Processed " << count << " files.";
-  }
+  CPUTimer timer;
+  timer.Start();
+  int64_t total_bytes = 0;
+  const int count = ConvertImageset(lines, argv[1], options, db.get(),
+      &total_bytes);
+  const double seconds = timer.MicroSeconds() / 1e6;
+  LOG(INFO) << "Processed " << count << " files in " << seconds << " s ("
+      << count / seconds << " files/s, "
+      << total_bytes / seconds / (1 << 20) << " MB/s).";
 #else
   LOG(FATAL) << "This tool requires OpenCV; compile with USE_OPENCV.";
 #endif  // USE_OPENCV
@@ -1,24 +1,214 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
 #include <string>
 #include <vector>
 
 #include "boost/algorithm/string.hpp"
+#include "boost/thread.hpp"
 #include "google/protobuf/text_format.h"
+#include "hdf5.h"
 
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/net.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/blocking_queue.hpp"
 #include "caffe/util/db.hpp"
 #include "caffe/util/format.hpp"
 #include "caffe/util/io.hpp"
 
 using caffe::Blob;
+using caffe::BlockingQueue;
 using caffe::Caffe;
 using caffe::Datum;
 using caffe::Net;
 using std::string;
 namespace db = caffe::db;
 
+// Stores the features extracted from one blob, batch after batch.
+template<typename Dtype>
+class FeatureWriter {
+ public:
+  virtual ~FeatureWriter() {}
+  // Appends num samples; shape is the shape of the feature blob.
+  virtual void Write(const Dtype* features, const std::vector<int>& shape) = 0;
+  virtual void Close() = 0;
+};
+
+// Writes one Datum with float_data per sample into a leveldb/lmdb.
+template<typename Dtype>
+class DatumFeatureWriter : public FeatureWriter<Dtype> {
+ public:
+  DatumFeatureWriter(const string& db_type, const string& dataset_name,
+      const string& blob_name)
+      : db_(db::GetDB(db_type)), blob_name_(blob_name), image_index_(0) {
+    db_->Open(dataset_name, db::NEW);
+    txn_.reset(db_->NewTransaction());
+  }
+  virtual void Write(const Dtype* features, const std::vector<int>& shape) {
+    Blob<Dtype> blob_shape(shape);
+    const int batch_size = blob_shape.num();
+    const int dim_features = blob_shape.count() / batch_size;
+    datum_.set_height(blob_shape.height());
+    datum_.set_width(blob_shape.width());
+    datum_.set_channels(blob_shape.channels());
+    for (int n = 0; n < batch_size; ++n) {
+      datum_.clear_data();
+      datum_.clear_float_data();
+      const Dtype* feature_data = features + n * dim_features;
+      for (int d = 0; d < dim_features; ++d) {
+        datum_.add_float_data(feature_data[d]);
+      }
+      string key_str = caffe::format_int(image_index_, 10);
+
+      string out;
+      CHECK(datum_.SerializeToString(&out));
+      txn_->Put(key_str, out);
+      ++image_index_;
+      if (image_index_ % 1000 == 0) {
+        txn_->Commit();
+        txn_.reset(db_->NewTransaction());
+        LOG(ERROR)<< "Extracted features of " << image_index_ <<
+            " query images for feature blob " << blob_name_;
+      }
+    }
+  }
+  virtual void Close() {
+    if (image_index_ % 1000 != 0) {
+      txn_->Commit();
+    }
+    LOG(ERROR)<< "Extracted features of " << image_index_ <<
+        " query images for feature blob " << blob_name_;
+    db_->Close();
+  }
+
+ private:
+  boost::shared_ptr<db::DB> db_;
+  boost::shared_ptr<db::Transaction> txn_;
+  string blob_name_;
+  int image_index_;
+  Datum datum_;
+};
+
+// Writes all the features into one HDF5 dataset named after the blob, with
+// the shape of the blob except for the first axis that counts all samples.
+template<typename Dtype>
+class HDF5FeatureWriter : public FeatureWriter<Dtype> {
+ public:
+  HDF5FeatureWriter(const string& dataset_name, const string& blob_name,
+      const std::vector<int>& shape, int num_samples)
+      : type_(sizeof(Dtype) == sizeof(float) ? H5T_NATIVE_FLOAT :
+                                               H5T_NATIVE_DOUBLE),
+        num_samples_(num_samples), rows_(0) {
+    file_id_ = H5Fcreate(dataset_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT,
+        H5P_DEFAULT);
+    CHECK_GE(file_id_, 0) << "Failed to open HDF5 file " << dataset_name;
+    std::vector<hsize_t> dims(shape.begin(), shape.end());
+    dims[0] = num_samples;
+    hid_t space_id = H5Screate_simple(dims.size(), dims.data(), NULL);
+    dataset_id_ = H5Dcreate2(file_id_, blob_name.c_str(), type_, space_id,
+        H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    CHECK_GE(dataset_id_, 0) << "Failed to create dataset " << blob_name;
+    H5Sclose(space_id);
+  }
+  virtual void Write(const Dtype* features, const std::vector<int>& shape) {
+    std::vector<hsize_t> offset(shape.size(), 0);
+    std::vector<hsize_t> count(shape.begin(), shape.end());
+    offset[0] = rows_;
+    CHECK_LE(rows_ + shape[0], num_samples_)
+        << "More samples than allocated in the HDF5 dataset";
+    hid_t file_space_id = H5Dget_space(dataset_id_);
+    H5Sselect_hyperslab(file_space_id, H5S_SELECT_SET, offset.data(), NULL,
+        count.data(), NULL);
+    hid_t mem_space_id = H5Screate_simple(count.size(), count.data(), NULL);
+    herr_t status = H5Dwrite(dataset_id_, type_, mem_space_id, file_space_id,
+        H5P_DEFAULT, features);
+    CHECK_GE(status, 0) << "Failed to write HDF5 features";
+    H5Sclose(mem_space_id);
+    H5Sclose(file_space_id);
+    rows_ += shape[0];
+  }
+  virtual void Close() {
+    LOG(ERROR)<< "Extracted features of " << rows_ << " query images";
+    H5Dclose(dataset_id_);
+    H5Fclose(file_id_);
+  }
+
+ private:
+  hid_t type_;
+  hid_t file_id_;
+  hid_t dataset_id_;
+  hsize_t num_samples_;
+  hsize_t rows_;
+};
+
+// Writes all the features as a flat array of Dtype through a memory mapping
+// of the output file.
+template<typename Dtype>
+class RawFeatureWriter : public FeatureWriter<Dtype> {
+ public:
+  RawFeatureWriter(const string& dataset_name, size_t num_values)
+      : size_(num_values * sizeof(Dtype)), offset_(0), map_(NULL) {
+    fd_ = open(dataset_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK_GE(fd_, 0) << "Failed to open " << dataset_name;
+    CHECK_EQ(ftruncate(fd_, size_), 0) << "Failed to resize " << dataset_name;
+    // mmap rejects empty mappings; an empty file needs none.
+    if (size_ > 0) {
+      map_ = static_cast<char*>(mmap(NULL, size_, PROT_READ | PROT_WRITE,
+          MAP_SHARED, fd_, 0));
+      CHECK(map_ != MAP_FAILED) << "Failed to map " << dataset_name;
+    }
+  }
+  virtual void Write(const Dtype* features, const std::vector<int>& shape) {
+    const size_t bytes = Blob<Dtype>(shape).count() * sizeof(Dtype);
+    CHECK_LE(offset_ + bytes, size_) << "More features than allocated";
+    if (bytes > 0) {
+      memcpy(map_ + offset_, features, bytes);
+    }
+    offset_ += bytes;
+  }
+  virtual void Close() {
+    LOG(ERROR)<< "Extracted " << offset_ / sizeof(Dtype) << " features";
+    if (map_) {
+      munmap(map_, size_);
+    }
+    close(fd_);
+  }
+
+ private:
+  size_t size_;
+  size_t offset_;
+  int fd_;
+  char* map_;
+};
+
+// Host copy of the feature blobs of one mini-batch.
+template<typename Dtype>
+struct FeatureBatch {
+  std::vector<std::vector<Dtype> > features;
+  std::vector<std::vector<int> > shapes;
+};
+
+// Writes the batches whose indices arrive in full_batches, and hands each
+// index back in free_batches once written, until it receives -1.
+template<typename Dtype>
+void WriteFeatureBatches(const FeatureBatch<Dtype>* batches,
+    const std::vector<boost::shared_ptr<FeatureWriter<Dtype> > >* writers,
+    BlockingQueue<int>* full_batches, BlockingQueue<int>* free_batches) {
+  for (int index = full_batches->pop(); index >= 0;
+       index = full_batches->pop()) {
+    const FeatureBatch<Dtype>& batch = batches[index];
+    for (size_t i = 0; i < writers->size(); ++i) {
+      (*writers)[i]->Write(batch.features[i].data(), batch.shapes[i]);
+    }
+    free_batches->push(index);
+  }
+}
+
 template<typename Dtype>
 int feature_extraction_pipeline(int argc, char** argv);
 
@@ -39,6 +229,9 @@ int feature_extraction_pipeline(int argc, char** argv) {
     "  feature_extraction_proto_file  extract_feature_blob_name1[,name2,...]"
     "  save_feature_dataset_name1[,name2,...]  num_mini_batches  db_type"
     "  [CPU/GPU] [DEVICE_ID=0]\n"
+    "db_type is one of leveldb, lmdb (one Datum per sample), hdf5 (one"
+    " dataset named after the blob per file) or raw (a flat array of floats"
+    " per file).\n"
     "Note: you can extract multiple features in one pass by specifying"
     " multiple feature blob names and dataset names separated by ','."
     " The names cannot contain white space characters and the number of blobs"
@@ -118,65 +311,69 @@ int feature_extraction_pipeline(int argc, char** argv) {
 
   int num_mini_batches = atoi(argv[++arg_pos]);
 
-  std::vector<boost::shared_ptr<db::DB> > feature_dbs;
-  std::vector<boost::shared_ptr<db::Transaction> > txns;
-  const char* db_type = argv[++arg_pos];
+  // The features of each mini-batch are copied to the host and written by a
+  // background thread while the net computes the next mini-batch.
+  std::vector<boost::shared_ptr<FeatureWriter<Dtype> > > writers;
+  const string db_type = argv[++arg_pos];
   for (size_t i = 0; i < num_features; ++i) {
     LOG(INFO)<< "Opening dataset " << dataset_names[i];
-    boost::shared_ptr<db::DB> db(db::GetDB(db_type));
-    db->Open(dataset_names.at(i), db::NEW);
-    feature_dbs.push_back(db);
-    boost::shared_ptr<db::Transaction> txn(db->NewTransaction());
-    txns.push_back(txn);
+    const boost::shared_ptr<Blob<Dtype> > feature_blob =
+        feature_extraction_net->blob_by_name(blob_names[i]);
+    if (db_type == "hdf5") {
+      writers.push_back(boost::shared_ptr<FeatureWriter<Dtype> >(
+          new HDF5FeatureWriter<Dtype>(dataset_names[i], blob_names[i],
+              feature_blob->shape(), num_mini_batches * feature_blob->num())));
+    } else if (db_type == "raw") {
+      LOG(INFO)<< "Features of " << blob_names[i] << " have shape "
+          << num_mini_batches << " x " << feature_blob->shape_string();
+      writers.push_back(boost::shared_ptr<FeatureWriter<Dtype> >(
+          new RawFeatureWriter<Dtype>(dataset_names[i],
+              static_cast<size_t>(num_mini_batches) * feature_blob->count())));
+    } else {
+      writers.push_back(boost::shared_ptr<FeatureWriter<Dtype> >(
+          new DatumFeatureWriter<Dtype>(db_type, dataset_names[i],
+              blob_names[i])));
+    }
   }
 
   LOG(ERROR)<< "Extracting Features";
 
-  Datum datum;
-  std::vector<int> image_indices(num_features, 0);
+  caffe::CPUTimer timer;
+  timer.Start();
+  // One writer thread for the whole run, and two batches passed back and
+  // forth through the queues: one filled while the other is written.
+  const int kNumBatches = 2;
+  FeatureBatch<Dtype> batches[kNumBatches];
+  BlockingQueue<int> full_batches, free_batches;
+  for (int i = 0; i < kNumBatches; ++i) {
+    free_batches.push(i);
+  }
+  boost::thread writer_thread(&WriteFeatureBatches<Dtype>, batches, &writers,
+      &full_batches, &free_batches);
   for (int batch_index = 0; batch_index < num_mini_batches; ++batch_index) {
     feature_extraction_net->Forward();
+    const int free_index = free_batches.pop();
+    FeatureBatch<Dtype>* batch = &batches[free_index];
+    batch->features.resize(num_features);
+    batch->shapes.resize(num_features);
     for (int i = 0; i < num_features; ++i) {
       const boost::shared_ptr<Blob<Dtype> > feature_blob =
         feature_extraction_net->blob_by_name(blob_names[i]);
-      int batch_size = feature_blob->num();
-      int dim_features = feature_blob->count() / batch_size;
-      const Dtype* feature_blob_data;
-      for (int n = 0; n < batch_size; ++n) {
-        datum.set_height(feature_blob->height());
-        datum.set_width(feature_blob->width());
-        datum.set_channels(feature_blob->channels());
-        datum.clear_data();
-        datum.clear_float_data();
-        feature_blob_data = feature_blob->cpu_data() +
-            feature_blob->offset(n);
-        for (int d = 0; d < dim_features; ++d) {
-          datum.add_float_data(feature_blob_data[d]);
-        }
-        string key_str = caffe::format_int(image_indices[i], 10);
-
-        string out;
-        CHECK(datum.SerializeToString(&out));
-        txns.at(i)->Put(key_str, out);
-        ++image_indices[i];
-        if (image_indices[i] % 1000 == 0) {
-          txns.at(i)->Commit();
-          txns.at(i).reset(feature_dbs.at(i)->NewTransaction());
-          LOG(ERROR)<< "Extracted features of " << image_indices[i] <<
-              " query images for feature blob " << blob_names[i];
-        }
-      }  // for (int n = 0; n < batch_size; ++n)
-    }  // for (int i = 0; i < num_features; ++i)
+      const Dtype* feature_blob_data = feature_blob->cpu_data();
+      batch->features[i].assign(feature_blob_data,
+          feature_blob_data + feature_blob->count());
+      batch->shapes[i] = feature_blob->shape();
+    }
+    full_batches.push(free_index);
   }  // for (int batch_index = 0; batch_index < num_mini_batches; ++batch_index)
+  full_batches.push(-1);
+  writer_thread.join();
   // write the last batch
   for (int i = 0; i < num_features; ++i) {
-    if (image_indices[i] % 1000 != 0) {
-      txns.at(i)->Commit();
-    }
-    LOG(ERROR)<< "Extracted features of " << image_indices[i] <<
-        " query images for feature blob " << blob_names[i];
-    feature_dbs.at(i)->Close();
+    writers[i]->Close();
   }
+  LOG(ERROR)<< "Extracted " << num_mini_batches << " mini-batches in "
+      << timer.Seconds() << " s";
 
   LOG(ERROR)<< "Successfully extracted the features!";
   return 0;
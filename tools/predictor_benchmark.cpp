@@ -0,0 +1,143 @@
+// Load test for caffe::Predictor: a number of client threads issue blocking
+// Predict calls with synthetic images and the tool reports throughput and
+// request latency percentiles.
+// Usage:
+//    predictor_benchmark --model=deploy.prototxt [--weights=net.caffemodel]
+//        [--workers=4] [--max_batch_size=32] [--clients=16] ...
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/predictor.hpp"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/rng.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+using std::string;
+using std::vector;
+
+DEFINE_string(model, "", "The deploy model definition protocol buffer.");
+DEFINE_string(weights, "",
+    "Optional trained weights; the fillers are used if empty.");
+DEFINE_int32(gpu, -1, "GPU device to run on; the CPU is used if negative.");
+DEFINE_int32(workers, 4, "Number of net replicas serving requests.");
+DEFINE_int32(max_batch_size, 32, "Maximum images per forward pass.");
+DEFINE_int32(clients, 16, "Number of concurrent client threads.");
+DEFINE_int32(requests, 100, "Requests issued by each client.");
+DEFINE_int32(request_size, 1, "Images per request.");
+DEFINE_int32(top_k, 5, "Number of top classes computed per image.");
+DEFINE_int32(warmup, 10, "Requests per client excluded from the timing.");
+
+// Issues FLAGS_warmup + FLAGS_requests blocking requests and records the
+// latency of the timed ones in milliseconds.
+void RunClient(Predictor<float>* predictor, const vector<Datum>* images,
+    int client, vector<double>* latencies) {
+  vector<Datum> request(FLAGS_request_size);
+  CPUTimer timer;
+  for (int r = 0; r < FLAGS_warmup + FLAGS_requests; ++r) {
+    for (int i = 0; i < FLAGS_request_size; ++i) {
+      request[i] = (*images)[(client + r + i) % images->size()];
+    }
+    timer.Start();
+    predictor->Predict(request, FLAGS_top_k);
+    timer.Stop();
+    if (r >= FLAGS_warmup) {
+      latencies->push_back(timer.MilliSeconds());
+    }
+  }
+}
+
+double Percentile(const vector<double>& sorted, double p) {
+  const int index = std::min<int>(sorted.size() - 1, p * sorted.size());
+  return sorted[index];
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Load test for the caffe::Predictor inference "
+      "API.\n"
+      "Usage:\n"
+      "    predictor_benchmark --model=deploy.prototxt [FLAGS]\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_model.empty()) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/predictor_benchmark");
+    return 1;
+  }
+  CHECK_GT(FLAGS_clients, 0);
+  CHECK_GT(FLAGS_requests, 0);
+  CHECK_GT(FLAGS_request_size, 0);
+  if (FLAGS_gpu >= 0) {
+    LOG(INFO) << "Use GPU with device ID " << FLAGS_gpu;
+    Caffe::SetDevice(FLAGS_gpu);
+    Caffe::set_mode(Caffe::GPU);
+  } else {
+    LOG(INFO) << "Use CPU.";
+    Caffe::set_mode(Caffe::CPU);
+  }
+
+  TransformationParameter transform_param;
+  transform_param.set_scale(1. / 255);
+  Predictor<float> predictor(FLAGS_model, FLAGS_weights, transform_param,
+      FLAGS_workers, FLAGS_max_batch_size);
+
+  // Synthetic images in the input geometry; the content doesn't matter.
+  const vector<int>& shape = predictor.input_shape();
+  vector<Datum> images(64);
+  for (int i = 0; i < images.size(); ++i) {
+    images[i].set_channels(shape[1]);
+    images[i].set_height(shape[2]);
+    images[i].set_width(shape[3]);
+    string* data = images[i].mutable_data();
+    for (int j = 0; j < shape[1] * shape[2] * shape[3]; ++j) {
+      data->push_back(static_cast<char>(caffe_rng_rand() % 256));
+    }
+  }
+
+  LOG(INFO) << "Running " << FLAGS_clients << " clients x "
+      << FLAGS_requests << " requests x " << FLAGS_request_size
+      << " images on " << FLAGS_workers << " workers, max batch size "
+      << FLAGS_max_batch_size;
+  vector<vector<double> > latencies(FLAGS_clients);
+  Timer total_timer;
+  total_timer.Start();
+  boost::thread_group clients;
+  for (int c = 0; c < FLAGS_clients; ++c) {
+    clients.create_thread(boost::bind(&RunClient, &predictor, &images, c,
+        &latencies[c]));
+  }
+  clients.join_all();
+  total_timer.Stop();
+
+  // The warmup requests overlap the timed ones across clients, so the
+  // wall time covers all of them.
+  vector<double> all;
+  for (int c = 0; c < FLAGS_clients; ++c) {
+    all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+  }
+  std::sort(all.begin(), all.end());
+  const double seconds = total_timer.Seconds();
+  const int num_images = FLAGS_clients * (FLAGS_warmup + FLAGS_requests) *
+      FLAGS_request_size;
+  LOG(INFO) << "Throughput: " << num_images / seconds << " images/s, "
+      << num_images / seconds / FLAGS_request_size << " requests/s";
+  LOG(INFO) << "Latency (ms): p50 " << Percentile(all, 0.5)
+      << ", p90 " << Percentile(all, 0.9)
+      << ", p99 " << Percentile(all, 0.99)
+      << ", max " << all.back();
+  return 0;
+}